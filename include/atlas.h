@@ -0,0 +1,93 @@
+#ifndef __ATLAS_H__
+#define __ATLAS_H__
+
+#include <stdint.h>
+
+#include "atlas_canvas.h"
+#include "backend.h"
+#include "cpu_def.h"
+#include "display.h"
+#include "status_code.h"
+
+/** Parameters to initialize a texture atlas */
+typedef struct atlas_init_param_s
+{
+  /** Number of displays shown, and how many of them are laid out per row */
+  uint32_t cells;
+  uint32_t columns;
+
+  /** Screen pixels per high resolution pixel, each way */
+  uint8_t scale;
+
+  /** Pixel colors, as for the single display; see display_init_param_t */
+  display_init_param_t colors;
+} atlas_init_param_t;
+
+struct atlas_s;
+
+/** Video backend handle of a single cell of an atlas */
+typedef struct atlas_cell_s
+{
+  struct atlas_s *atlas;
+  uint32_t index;
+} atlas_cell_t;
+
+struct SDL_Window;
+struct SDL_Renderer;
+struct SDL_Texture;
+
+/**
+ * One window showing many sessions. Each session renders into its cell of a CPU
+ * side copy of a single streaming texture, which atlas_present uploads at once
+ * and draws cell by cell with batched copies.
+ */
+typedef struct atlas_s
+{
+  struct SDL_Window *window;
+  struct SDL_Renderer *renderer;
+  struct SDL_Texture *texture;
+
+  /** Set once the SDL video subsystem was brought up by atlas_init */
+  uint8_t video_started;
+
+  /** Pixels of the texture and the rows of cells to upload */
+  atlas_canvas_t canvas;
+  uint8_t scale;
+
+  /** Backend handles of the cells, one per session */
+  atlas_cell_t *cell;
+} atlas_t;
+
+/**
+ * Video backend drawing a session into its cell, with an atlas_cell_t as the handle.
+ * Rendering only updates the pixels in memory; the window is updated by atlas_present.
+ * Its cleanup leaves the atlas alone, which is freed by atlas_cleanup.
+ */
+extern const video_backend_t atlas_backend;
+
+/**
+ * Create the window and the texture of an atlas.
+ * @param atlas - Pointer to the atlas to initialize.
+ * @param title - Window title.
+ * @param param - Pointer to the atlas parameters.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t atlas_init(atlas_t *const atlas, const char *title, atlas_init_param_t *const param);
+
+/**
+ * Upload the cells rendered into since the last call, with a single texture
+ * update, and draw every cell to the window.
+ * @param atlas - Pointer to an atlas.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t atlas_present(atlas_t *const atlas);
+
+/**
+ * Free the window, the texture and the pixels of an atlas, and quit the SDL
+ * video subsystem if atlas_init brought it up.
+ * @param atlas - Pointer to an atlas.
+ * @return None
+ */
+void atlas_cleanup(atlas_t *const atlas);
+
+#endif /* __ATLAS_H__ */
@@ -0,0 +1,67 @@
+#ifndef __ATLAS_CANVAS_H__
+#define __ATLAS_CANVAS_H__
+
+#include <stdint.h>
+
+#include "cpu_def.h"
+#include "display.h"
+#include "status_code.h"
+
+/** Every cell holds a display at the high resolution, lower resolution pixels doubled */
+#define ATLAS_CELL_WIDTH (GRAPHICS_HIRES_WIDTH)
+#define ATLAS_CELL_HEIGHT (GRAPHICS_HIRES_HEIGHT)
+#define ATLAS_MAX_CELLS (1024)
+
+/**
+ * The CPU side pixels of a texture atlas: one cell per display, laid out
+ * columns to a row as on screen, and the rows of cells drawn into since they
+ * were last uploaded. It knows nothing of SDL; see atlas.h for the window.
+ */
+typedef struct atlas_canvas_s
+{
+  /** ARGB8888 pixels, width * height of them */
+  uint32_t *pixels;
+  uint32_t width;
+  uint32_t height;
+
+  uint32_t cells;
+  uint32_t columns;
+  uint32_t rows;
+
+  /** Colors indexed by the plane bits of a pixel */
+  uint32_t palette[1 << GRAPHICS_PLANES];
+
+  /** Rows of cells drawn into since the last upload; cleared by the uploader */
+  uint32_t dirty_first;
+  uint32_t dirty_last;
+  uint8_t dirty;
+} atlas_canvas_t;
+
+/**
+ * Allocate the pixels of an atlas, all in the background color and all rows dirty.
+ * @param canvas - Pointer to the canvas to initialize.
+ * @param cells - Number of displays, 1 to ATLAS_MAX_CELLS.
+ * @param columns - Cells per row; more than cells lays them all out in one row.
+ * @param colors - Pointer to the pixel colors; see display_init_param_t.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t atlas_canvas_init(atlas_canvas_t *const canvas, uint32_t const cells, uint32_t const columns,
+                                display_init_param_t const *const colors);
+
+/**
+ * Draw a display into its cell, doubling lower resolution pixels, and mark its row of cells dirty.
+ * @param canvas - Pointer to a canvas.
+ * @param index - Index of the cell.
+ * @param graphics - Pointer to the display to draw.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t atlas_canvas_draw(atlas_canvas_t *const canvas, uint32_t const index, graphics_t const *const graphics);
+
+/**
+ * Free the pixels of a canvas.
+ * @param canvas - Pointer to a canvas.
+ * @return None
+ */
+void atlas_canvas_cleanup(atlas_canvas_t *const canvas);
+
+#endif /* __ATLAS_CANVAS_H__ */
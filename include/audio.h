@@ -2,6 +2,8 @@
 #define __AUDIO_H__
 
 #include <stdint.h>
+#include "backend.h"
+#include "cpu_def.h"
 #include "status_code.h"
 
 #define DEFAULT_SAMPLE_FREQ_HZ (44100) // 44.1 kHz audio sampling rate
@@ -11,38 +13,75 @@
 /** Parameters to initialize the audio module */
 typedef struct audio_init_param_s
 {
-  /** Desired audio sampling rate in Hz, default is 44.1 kHz */
+  /** Desired audio sampling rate in Hz, default is 44.1 kHz; the device may run at another */
   uint32_t sample_freq_hz;
 
   /** Desired beep tone frequency, default is 261 Hz (middle C) */
   uint32_t tone_freq_hz;
 } audio_init_param_t;
 
+/** An SDL audio device playing the sound of one session */
+typedef struct audio_s
+{
+  uint32_t audio_device; // 0 until the first beep opens it
+  uint8_t open_failed;   // Set once opening failed; the output then stays silent
+  uint32_t sample_freq_hz; // Rate the device was opened at, or the desired one until then
+  uint32_t tone_freq_hz;
+  uint32_t sample_num;  // Position within the period of the beep tone
+  uint8_t pattern[AUDIO_PATTERN_SIZE];
+  uint8_t pattern_loaded;
+  double pattern_rate_hz; // Pattern bits played per second, as set by the pitch
+  double pattern_step;  // Pattern bits advanced per output sample
+  double pattern_phase; // Current position within the pattern, in bits
+} audio_t;
+
+/** Audio backend table of audio_t; see backend.h */
+extern const audio_backend_t audio_sdl_backend;
+
 /**
- * Initializes the audio module and allocate resources for it
+ * Initializes the audio module. The SDL audio subsystem and device are only
+ * brought up by the first audio_play_beep, so starting up costs nothing for
+ * ROMs that never beep. If no device can be opened then, the output logs a
+ * warning once and stays silent.
+ * @param audio - Pointer to the audio output to initialize.
  * @param param - Pointer to an initialization parameters struct.
  * @return STATUS_OK if successful, otherwise appropriate error code.
  */
-status_code_t audio_init(audio_init_param_t *const param);
+status_code_t audio_init(audio_t *const audio, audio_init_param_t *const param);
+
+/**
+ * Replace the beep tone with an XO-CHIP audio pattern.
+ * The pattern is played back as 1-bit samples, MSB first, at a rate of
+ * 4000 * 2 ^ ((pitch - 64) / 48) bits per second.
+ * @param audio - Pointer to the audio output.
+ * @param pattern - Pointer to AUDIO_PATTERN_SIZE bytes of pattern data.
+ * @param pitch - Playback pitch as set by the FX3A instruction.
+ * @return None
+ */
+void audio_set_pattern(audio_t *const audio, uint8_t const *const pattern, uint8_t const pitch);
 
 /**
  * Emit tone with a frequency that's configured during initialization.
  * The tone will continue to be emitted until audio_mute is called.
  * This function should be called when the sound timer is greater than 0.
+ * The first call opens the audio device.
+ * @param audio - Pointer to the audio output.
  * @return None
  */
-void audio_play_beep();
+void audio_play_beep(audio_t *const audio);
 
 /**
  * Stop the tone. This should be called when the sound timer is 0.
+ * @param audio - Pointer to the audio output.
  * @return None
  */
-void audio_mute();
+void audio_mute(audio_t *const audio);
 
 /**
  * Cleanup and free audio resources
+ * @param audio - Pointer to the audio output.
  * @return None
  */
-void audio_cleanup();
+void audio_cleanup(audio_t *const audio);
 
 #endif /* __AUDIO_H__ */
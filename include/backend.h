@@ -0,0 +1,45 @@
+#ifndef __BACKEND_H__
+#define __BACKEND_H__
+
+#include <stdint.h>
+
+#include "cpu_def.h"
+#include "status_code.h"
+
+/**
+ * Function tables of the video, audio and input backends a session runs with.
+ * Each function takes the backend's own instance handle as its first argument,
+ * so any number of sessions can each drive their own window, audio device, etc.
+ * Backends are initialized by their own init functions, whose parameters differ,
+ * before being handed to a session; see session.h.
+ */
+
+/** Video output */
+typedef struct video_backend_s
+{
+  /**
+   * Show the framebuffer; called at 60 Hz. Backends may skip rendering unless
+   * graphics->display_update is set, clearing it once rendered.
+   */
+  status_code_t (*render)(void *const handle, graphics_t *const graphics);
+
+  void (*cleanup)(void *const handle);
+} video_backend_t;
+
+/** Sound output: the beep tone, replaced by the XO-CHIP audio pattern once one is loaded */
+typedef struct audio_backend_s
+{
+  void (*set_pattern)(void *const handle, uint8_t const *const pattern, uint8_t const pitch);
+  void (*play_beep)(void *const handle);
+  void (*mute)(void *const handle);
+  void (*cleanup)(void *const handle);
+} audio_backend_t;
+
+/** Keypad input */
+typedef struct input_backend_s
+{
+  /** Read the keypad state; returns STATUS_REQ_EXIT when the user asks to quit */
+  status_code_t (*read)(void *const handle, uint16_t *const keypad);
+} input_backend_t;
+
+#endif /* __BACKEND_H__ */
@@ -1,9 +1,67 @@
 #ifndef __CHIP_8_H__
 #define __CHIP_8_H__
 
+#include <stddef.h>
+
 #include "cpu_def.h"
 #include "status_code.h"
 
+#define INSTRUCTIONS_PER_FRAME (11) // About 700 instructions per second at 60 frames per second
+
+/** Machine cycles of the COSMAC VIP per 60 Hz frame: its 1.7609 MHz clock, 8 clock periods a cycle */
+#define VIP_CYCLES_PER_FRAME (3668)
+
+/** Cycles of every frame stolen by the display DMA of the VIP's CDP1861, 8 per scanline */
+#define VIP_DISPLAY_DMA_CYCLES (1024)
+
+/** How instructions are costed when frames are budgeted in machine cycles; see run_frame_cycles */
+typedef enum
+{
+  /** Every instruction costs 1 cycle, with INSTRUCTIONS_PER_FRAME cycles a frame */
+  TIMING_UNIFORM = 0,
+
+  /**
+   * Approximate cycle counts of the original COSMAC VIP interpreter: DXYN costs more
+   * the taller the sprite, 00E0 takes most of a frame, etc.
+   */
+  TIMING_VIP,
+
+  TIMING_MODE_COUNT,
+} timing_mode_t;
+
+/** Cycle budget of a run of frames, and the load measured over it */
+typedef struct cycle_clock_s
+{
+  timing_mode_t mode;
+
+  /** Cycles each frame gets */
+  uint32_t budget;
+
+  /** Cycles left over from the previous frame; negative once an instruction overran it */
+  int32_t balance;
+
+  /** Cycles spent executing and instructions executed in the last frame, not counting waits */
+  uint32_t busy_cycles;
+  uint32_t instructions;
+
+  /**
+   * Instructions of the last frame spent in idle loops, e.g. polling the delay timer:
+   * a backward jump finding the registers as they were when it was last taken closes
+   * an iteration that did nothing.
+   */
+  uint32_t idle_instructions;
+
+  /** Totals over every frame run; the budget may change between frames */
+  uint64_t total_busy_cycles;
+  uint64_t total_budget_cycles;
+  uint64_t frames;
+
+  /** Idle loop detection: the last backward jump, the registers then, and instructions since */
+  uint16_t loop_pc;
+  uint32_t loop_length;
+  registers_t loop_registers;
+} cycle_clock_t;
+
 /**
  * Initialize the provided CPU state by setting the value of PC to the
  * starting address and the memory to 0.
@@ -12,6 +70,24 @@
  */
 status_code_t init_cpu(cpu_state_t *const state);
 
+/**
+ * Free resources held by the CPU state, i.e. the XO-CHIP address space.
+ * This must be called before a state using the XO-CHIP profile is discarded
+ * or re-initialized with init_cpu.
+ * @param state - Pointer to the CPU state to clean up
+ * @return None
+ */
+void cleanup_cpu(cpu_state_t *const state);
+
+/**
+ * Seed the random number generator of CXNN. Every CPU state has its own, seeded
+ * differently by init_cpu, so instances don't affect each other's numbers.
+ * @param state - Pointer to a CPU state.
+ * @param seed - The seed; any value including 0.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t seed_random(cpu_state_t *const state, uint32_t const seed);
+
 /**
  * Load a ROM file to the memory.
  * @param state - Pointer to a CPU state onto which the rom file will be loaded
@@ -20,6 +96,150 @@ status_code_t init_cpu(cpu_state_t *const state);
  */
 status_code_t load_rom(cpu_state_t *const state, const char *file);
 
+/**
+ * Load a ROM image already in memory, e.g. one generated by a fuzzer.
+ * @param state - Pointer to a CPU state onto which the rom will be loaded
+ * @param data - The ROM image
+ * @param size - Size of the ROM image in bytes
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t load_rom_data(cpu_state_t *const state, const uint8_t *data, size_t const size);
+
+/**
+ * Select the interpreter variant whose quirks the CPU should follow.
+ * This is meant to be called once at load time, after init_cpu and before
+ * load_rom. Selecting XO-CHIP allocates its 64K address space and copies the
+ * current memory contents into it; selecting another profile releases it.
+ * @param state - Pointer to a CPU state.
+ * @param profile - The quirk profile to execute with.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t set_quirk_profile(cpu_state_t *const state, quirk_profile_t const profile);
+
+/**
+ * Get the memory currently addressed by the CPU, which depends on the quirk profile.
+ * @param state - Pointer to a CPU state.
+ * @param memory - Pointer to store the address of the memory at.
+ * @param size - Pointer to store the size of the memory at; may be NULL.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t get_memory(cpu_state_t *const state, uint8_t **const memory, size_t *const size);
+
+/**
+ * Get the opcode at PC as the next instruction will fetch it, without executing it.
+ * @param state - Pointer to a CPU state.
+ * @param opcode - Pointer to store the opcode at.
+ * @return STATUS_OK if successful, otherwise the error fetching it would fail with.
+ */
+status_code_t chip8_peek_opcode(cpu_state_t *const state, uint16_t *const opcode);
+
+/**
+ * Get a fingerprint of the machine state: memory, registers, timers, the framebuffer
+ * and the audio pattern. Memory and the framebuffer are tracked incrementally as
+ * instructions change them, so this is cheap enough to call after every instruction.
+ * Code that modifies memory or the framebuffer directly must call chip8_state_rehash.
+ * @param state - Pointer to a CPU state.
+ * @param hash - Pointer to store the hash at.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t chip8_state_hash(cpu_state_t *const state, uint64_t *const hash);
+
+/**
+ * Recompute the rolling hashes used by chip8_state_hash from scratch, after memory or
+ * the framebuffer have been modified other than through the CPU.
+ * @param state - Pointer to a CPU state.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t chip8_state_rehash(cpu_state_t *const state);
+
+/**
+ * Copy a machine state, e.g. to explore alternative inputs from it. Unlike
+ * chip8_snapshot this leaves the tracking of changes in the original untouched.
+ * @param clone - Pointer to the copy; zeroed, or initialized by init_cpu or an earlier
+ *                copy. Release it with cleanup_cpu.
+ * @param state - Pointer to the CPU state to copy.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t chip8_clone(cpu_state_t *const clone, cpu_state_t *const state);
+
+/**
+ * Copy a machine state into a snapshot that chip8_restore can later return it to.
+ * From then on the state tracks which memory pages and framebuffer rows it changes.
+ * @param snapshot - Pointer to the snapshot; zeroed, or initialized by init_cpu or an
+ *                   earlier snapshot. Release it with cleanup_cpu.
+ * @param state - Pointer to the CPU state to copy.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t chip8_snapshot(cpu_state_t *const snapshot, cpu_state_t *const state);
+
+/**
+ * Return a state to a snapshot taken of it, copying back only the memory pages and
+ * framebuffer rows changed since the snapshot or the previous restore. An attached
+ * execution trace recorder stays attached.
+ * @param state - Pointer to the CPU state to restore.
+ * @param snapshot - Pointer to a snapshot taken by chip8_snapshot.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t chip8_restore(cpu_state_t *const state, cpu_state_t *const snapshot);
+
+/**
+ * Bring a snapshot up to date with the state it was taken of, copying only the memory
+ * pages and framebuffer rows changed since the snapshot, the previous restore or the
+ * previous update. Cheaper than taking a new snapshot when little has changed.
+ * @param snapshot - Pointer to a snapshot taken of state by chip8_snapshot.
+ * @param state - Pointer to the CPU state.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t chip8_snapshot_update(cpu_state_t *const snapshot, cpu_state_t *const state);
+
+/**
+ * Prepare a template for a pool of instances running the same ROM: a CPU state with
+ * the quirk profile selected and the ROM loaded, which is never run itself. Instances
+ * are then started and restarted from it without init_cpu or re-reading the ROM file.
+ * @param template_state - Pointer to the CPU state to initialize as the template.
+ * @param file - Path to the .ch8 rom file
+ * @param profile - The interpreter variant to follow.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t init_template(cpu_state_t *const template_state, const char *file, quirk_profile_t const profile);
+
+/**
+ * Start an instance as a full copy of a template prepared by init_template.
+ * @param state - Pointer to the CPU state to initialize; zeroed, or initialized by
+ *                init_cpu or an earlier call. Release it with cleanup_cpu.
+ * @param template_state - Pointer to the template.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t init_cpu_from_template(cpu_state_t *const state, cpu_state_t *const template_state);
+
+/**
+ * Restart an instance started by init_cpu_from_template, rewriting only the memory
+ * pages and framebuffer rows it changed since it was started or last reset.
+ * Changes made to memory or the framebuffer other than through the CPU are not tracked.
+ * @param state - Pointer to the CPU state to reset.
+ * @param template_state - Pointer to the template the instance was started from.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t reset_cpu(cpu_state_t *const state, cpu_state_t *const template_state);
+
+/**
+ * Look up a quirk profile by its command line name: chip8, schip, xochip or vip.
+ * @param name - Name of the profile.
+ * @param profile - Pointer to store the profile at.
+ * @return STATUS_OK if successful, STATUS_ERR_INVALID_PARAM if the name is unknown.
+ */
+status_code_t quirk_profile_from_name(const char *name, quirk_profile_t *const profile);
+
+/**
+ * Executes a single CPU cycle like emulation_cycle, but with the reference
+ * handlers that test the profile's quirks at run time rather than through a
+ * specialised opcode table. This is the baseline that faster execution cores
+ * are checked against; it doesn't report to an attached execution trace.
+ * @param state - Pointer to a CPU state.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t reference_cycle(cpu_state_t *const state);
+
 /**
  * Executes a single CPU cycle (fetch, decode, and execute);
  * also decrement timers if their values are not 0.
@@ -36,4 +256,60 @@ status_code_t emulation_cycle(cpu_state_t *const state);
  */
 status_code_t update_timers(cpu_state_t *const state);
 
+/**
+ * Look up a timing mode by its command line name: uniform or vip.
+ * @param name - Name of the mode.
+ * @param mode - Pointer to store the mode at.
+ * @return STATUS_OK if successful, STATUS_ERR_INVALID_PARAM if the name is unknown.
+ */
+status_code_t timing_mode_from_name(const char *name, timing_mode_t *const mode);
+
+/**
+ * Get the machine cycles the instruction at PC will take, given the current state.
+ * @param state - Pointer to a CPU state.
+ * @param mode - Timing mode to cost the instruction in.
+ * @param cycles - Pointer to store the cost at.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t instruction_cycles(cpu_state_t *const state, timing_mode_t const mode, uint32_t *const cycles);
+
+/**
+ * Reset a cycle clock with the default budget of its mode, which may be changed afterwards.
+ * @param clock - Pointer to the clock to initialize.
+ * @param mode - Timing mode.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t cycle_clock_init(cycle_clock_t *const clock, timing_mode_t const mode);
+
+/**
+ * Run the instructions of one frame within the clock's cycle budget. An instruction
+ * overrunning the budget is finished and its excess taken from the next frame, and a
+ * display wait gives up the rest of the budget, as in emulation_frame. Timers
+ * and the keypad are left to the caller, e.g. session_frame and session_read_input.
+ * @param state - Pointer to a CPU state.
+ * @param clock - Pointer to the clock of the state.
+ * @return STATUS_OK if successful, otherwise the status of the instruction that failed.
+ */
+status_code_t run_frame_cycles(cpu_state_t *const state, cycle_clock_t *const clock);
+
+/**
+ * Run the instructions of one frame: INSTRUCTIONS_PER_FRAME of them, or fewer if
+ * one waits for the vertical blank (DXYN under the COSMAC VIP profile). The frame
+ * then ends at once, to resume at the next, instead of spinning until it is over.
+ * Timers and the keypad are left to the caller.
+ * @param state - Pointer to a CPU state.
+ * @return STATUS_OK if successful, otherwise the status of the instruction that failed.
+ */
+status_code_t emulation_frame(cpu_state_t *const state);
+
+/**
+ * Run whole frames headless: the instructions of emulation_frame and a timer update
+ * each, with the keypad held in the given state.
+ * @param state - Pointer to a CPU state.
+ * @param keys - Keypad bitmask held down during the frames.
+ * @param frames - Number of frames to run.
+ * @return STATUS_OK if successful, otherwise the status of the instruction that failed.
+ */
+status_code_t run_frames(cpu_state_t *const state, uint16_t const keys, uint32_t const frames);
+
 #endif /* __CHIP_8_H__ */
@@ -0,0 +1,176 @@
+#ifndef __CHIP8D_H__
+#define __CHIP8D_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "cpu_def.h"
+#include "status_code.h"
+#include "stream.h"
+
+#define CHIP8D_MAX_SESSIONS (256)
+#define CHIP8D_MAX_TEMPLATES (32)
+#define CHIP8D_MAX_CLIENTS (64)
+#define CHIP8D_MAX_WORKERS (64)
+#define CHIP8D_MAX_SPEED (64)      // Frames a session may run per 60 Hz tick
+#define CHIP8D_LINE_SIZE (512)     // Longest command line
+#define CHIP8D_PATH_SIZE (256)
+
+/**
+ * Control protocol: one command per line, each answered with a line starting
+ * with "OK" or "ERR", followed by the result or the reason:
+ *
+ *   new <ROM file> [chip8|schip|xochip|vip]  load a session, stopped; answers its id
+ *   start <id> / stop <id>                   resume or pause a session
+ *   input <id> <hex keypad mask>             set the keys held
+ *   speed <id> <frames per tick>             frame budget per 60 Hz tick (default 1)
+ *   snapshot <id> / restore <id>             save the session's state, or return to it
+ *   subscribe <id>                           answers the stream address of its frames
+ *   close <id>                               end a session
+ *   list                                     one line per session, then "OK <count>"
+ *   stats                                    scheduler counters
+ */
+
+typedef enum
+{
+  CHIP8D_FREE = 0,
+  CHIP8D_STOPPED,
+  CHIP8D_RUNNING,
+
+  /** The ROM exited or faulted; restore or close it */
+  CHIP8D_HALTED,
+} chip8d_state_t;
+
+/** A ROM loaded once, which sessions start as copies of */
+typedef struct chip8d_template_s
+{
+  char path[CHIP8D_PATH_SIZE];
+  quirk_profile_t profile;
+  cpu_state_t state;
+  uint8_t loaded;
+} chip8d_template_t;
+
+/** A hosted session; the fields below lock are only touched with it held */
+typedef struct chip8d_session_s
+{
+  pthread_mutex_t lock;
+  chip8d_state_t state;
+  status_code_t status;
+  cpu_state_t cpu;
+  char rom[CHIP8D_PATH_SIZE];
+
+  /** State saved by the snapshot command */
+  cpu_state_t snapshot;
+  uint8_t has_snapshot;
+
+  uint16_t keypad;
+  uint32_t speed;
+
+  /** Frames left to run in the current tick */
+  uint32_t budget;
+
+  /**
+   * Whether the session is in the run queue. Left set when a session closes while
+   * queued, so that one reusing the slot takes over the entry instead of adding another.
+   */
+  uint8_t queued;
+
+  uint64_t frames;
+
+  /** Frame subscribers, started by the first subscribe command */
+  stream_server_t *stream;
+} chip8d_session_t;
+
+/** A control connection; responses the socket did not take yet wait in output */
+typedef struct chip8d_client_s
+{
+  int fd;
+  char line[CHIP8D_LINE_SIZE];
+  uint32_t length;
+  char *output;
+  size_t output_length;
+  size_t output_sent;
+  uint8_t waiting_writable;
+} chip8d_client_t;
+
+typedef struct chip8d_s
+{
+  char socket_path[CHIP8D_PATH_SIZE];
+  int listen_fd;
+  int epoll_fd;
+  int timer_fd;
+  int wake_fd;
+  uint8_t stopping;
+
+  /** Stops the thread chip8d_run drives the ticks from timer_fd with */
+  uint8_t ticker_stopping;
+
+  /** One fan-out thread serving the frame streams of every subscribed session */
+  stream_hub_t streams;
+  uint8_t streams_started;
+
+  /** Guards the session table and the templates against concurrent commands */
+  pthread_mutex_t lock;
+  chip8d_session_t *sessions;
+  chip8d_template_t templates[CHIP8D_MAX_TEMPLATES];
+  uint32_t next_template; // Replaced next once every template is in use
+  chip8d_client_t clients[CHIP8D_MAX_CLIENTS];
+  char *response;
+
+  /** Ring of the ids of sessions with frames left to run this tick */
+  pthread_mutex_t queue_lock;
+  pthread_cond_t queue_ready;
+  uint32_t queue[CHIP8D_MAX_SESSIONS];
+  uint32_t queue_head;
+  uint32_t queue_count;
+
+  pthread_t workers[CHIP8D_MAX_WORKERS];
+  uint32_t worker_count;
+
+  /** Counters: ticks, frames run, and ticks that found a session's budget unfinished */
+  uint64_t ticks;
+  uint64_t frames;
+  uint64_t overruns;
+} chip8d_t;
+
+/**
+ * Listen for control connections and start the worker pool.
+ * @param daemon - Pointer to the daemon to initialize.
+ * @param socket_path - Path of the Unix domain socket to listen on.
+ * @param workers - Number of worker threads running the sessions.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t chip8d_init(chip8d_t *const daemon, const char *socket_path, uint32_t const workers);
+
+/**
+ * Serve control connections, and drive the 60 Hz ticks from a thread of their own, until chip8d_stop is called.
+ * @param daemon - Pointer to a daemon.
+ * @return STATUS_OK if stopped, otherwise appropriate error code.
+ */
+status_code_t chip8d_run(chip8d_t *const daemon);
+
+/**
+ * Make chip8d_run return; safe to call from another thread or a signal handler.
+ * @param daemon - Pointer to a daemon.
+ * @return None
+ */
+void chip8d_stop(chip8d_t *const daemon);
+
+/**
+ * Run a command line of the control protocol.
+ * @param daemon - Pointer to a daemon.
+ * @param line - The command, without the line ending.
+ * @param response - Buffer for the response lines.
+ * @param size - Size of the buffer.
+ * @return None
+ */
+void chip8d_execute(chip8d_t *const daemon, char *line, char *const response, size_t const size);
+
+/**
+ * Stop the workers, end every session and close every connection.
+ * @param daemon - Pointer to a daemon.
+ * @return None
+ */
+void chip8d_cleanup(chip8d_t *const daemon);
+
+#endif /* __CHIP8D_H__ */
@@ -5,13 +5,58 @@
 
 #define START_ADDRESS (0x0200)
 #define MEM_SIZE (4096) // 4K RAM
+#define XO_MEM_SIZE (65536) // 64K RAM of XO-CHIP, allocated only for instances using it
+
+/**
+ * Unless CHIP8_STRICT_MEMORY is defined, memory is followed by a guard band at least as
+ * long as the longest single access (a two-plane 16x16 sprite), and addresses are masked to
+ * the size of memory instead of being bounds checked. Accesses that run past the end of
+ * memory then land harmlessly in the guard band.
+ */
+#ifdef CHIP8_STRICT_MEMORY
+#define MEM_GUARD_SIZE (0)
+#else
+#define MEM_GUARD_SIZE (64)
+#endif
+
+/** Granularity at which writes to memory are tracked; see dirty_t */
+#define MEM_PAGE_SIZE (64)
+#define MEM_PAGE_COUNT ((XO_MEM_SIZE + MEM_GUARD_SIZE + MEM_PAGE_SIZE - 1) / MEM_PAGE_SIZE)
+
 #define GRAPHICS_WIDTH (64)
 #define GRAPHICS_HEIGHT (32)
-#define GRAPHICS_SIZE (GRAPHICS_WIDTH * GRAPHICS_HEIGHT)
+#define GRAPHICS_HIRES_WIDTH (128) // SUPER-CHIP high resolution mode
+#define GRAPHICS_HIRES_HEIGHT (64)
+#define GRAPHICS_WORD_BITS (64)
+#define GRAPHICS_ROW_WORDS (GRAPHICS_HIRES_WIDTH / GRAPHICS_WORD_BITS)
+#define GRAPHICS_PLANES (2) // XO-CHIP bit-planes
+#define AUDIO_PATTERN_SIZE (16)
+#define AUDIO_PATTERN_DEFAULT_PITCH (64)
 #define NUM_KEYS (16)
 #define STACK_SIZE (16)
 #define REG_COUNT (16)
 
+/**
+ * Interpreter variants whose behaviour differs in a handful of opcodes.
+ * Each profile is executed through its own specialised opcode table.
+ */
+typedef enum
+{
+  /** Default behaviour of this emulator (V[F] reset, shift in place, clipping) */
+  QUIRK_PROFILE_CHIP8 = 0,
+
+  /** SUPER-CHIP 1.1 */
+  QUIRK_PROFILE_SUPER_CHIP,
+
+  /** XO-CHIP (Octo) */
+  QUIRK_PROFILE_XO_CHIP,
+
+  /** Original COSMAC VIP interpreter */
+  QUIRK_PROFILE_COSMAC_VIP,
+
+  QUIRK_PROFILE_COUNT,
+} quirk_profile_t;
+
 /** Definitions of CPU registers */
 typedef struct registers_s
 {
@@ -29,6 +74,9 @@ typedef struct registers_s
 
   /** 16 x 16-bit stack to store return addresses when subroutines are called */
   uint16_t stack[STACK_SIZE];
+
+  /** SUPER-CHIP RPL user flags, saved and restored by FX75 and FX85 */
+  uint8_t rpl[REG_COUNT];
 } registers_t;
 
 /**
@@ -41,16 +89,52 @@ typedef struct timers_s
   uint8_t sound;
 } timers_t;
 
-/** Display / graphics */
+/**
+ * Display / graphics
+ * Each plane packs pixels one bit each, GRAPHICS_ROW_WORDS words per row, with
+ * the most significant bit of a word being its leftmost pixel. Low resolution
+ * mode only uses the top-left 64x32 corner, i.e. the first word of the first
+ * 32 rows. Only XO-CHIP draws onto the second plane.
+ */
 typedef struct graphics_s
 {
-  /** buffer for 64x32 px output monochrome display */
-  uint8_t buffer[GRAPHICS_SIZE];
+  /** bit-planes for up to 128x64 px output display */
+  uint64_t buffer[GRAPHICS_PLANES][GRAPHICS_HIRES_HEIGHT][GRAPHICS_ROW_WORDS];
+
+  /** Bitmask of the planes affected by drawing, clearing and scrolling (XO-CHIP FN01) */
+  uint8_t plane_mask;
+
+  /** Flag indicating the 128x64 px high resolution mode is enabled */
+  uint8_t hires;
 
   /** Flag indicating the screen needs to be updated */
   uint8_t display_update;
 } graphics_t;
 
+/** Current dimensions of the display */
+#define GRAPHICS_ACTIVE_WIDTH(gfx) ((gfx)->hires ? GRAPHICS_HIRES_WIDTH : GRAPHICS_WIDTH)
+#define GRAPHICS_ACTIVE_HEIGHT(gfx) ((gfx)->hires ? GRAPHICS_HIRES_HEIGHT : GRAPHICS_HEIGHT)
+
+/** Value (0 or 1) of the pixel at (x, y) in the given plane */
+#define GRAPHICS_PIXEL(gfx, plane, x, y) \
+  (((gfx)->buffer[(plane)][(y)][(x) / GRAPHICS_WORD_BITS] >> (GRAPHICS_WORD_BITS - 1 - ((x) % GRAPHICS_WORD_BITS))) & 1)
+
+/** XO-CHIP audio pattern buffer */
+typedef struct audio_pattern_s
+{
+  /** 128 1-bit samples, played MSB first */
+  uint8_t buffer[AUDIO_PATTERN_SIZE];
+
+  /** Playback rate of the samples is 4000 * 2 ^ ((pitch - 64) / 48) Hz */
+  uint8_t pitch;
+
+  /** Flag indicating a pattern has been loaded; until then the default tone is played */
+  uint8_t loaded;
+
+  /** Flag indicating the pattern or pitch need to be passed to the audio output */
+  uint8_t audio_update;
+} audio_pattern_t;
+
 /**
  * Data structure to keep track of key presses using 16-bit integer.
  * Each bit corresponds to key 0 to key F respectively. The n-th
@@ -71,17 +155,72 @@ typedef struct peripherals_s
   /** 16 input keypad */
   keypad_state_t keypad;
 
-  /** 64x32 px output monochrome display */
+  /** 64x32 or 128x64 px output display */
   graphics_t graphics;
+
+  /** XO-CHIP sound output */
+  audio_pattern_t audio;
 } peripherals_t;
 
+/**
+ * Rolling hashes of the large parts of the machine state. They're updated as
+ * memory and the framebuffer change, so fingerprinting the state doesn't
+ * require rehashing them; see chip8_state_hash.
+ */
+typedef struct state_hash_s
+{
+  /** XOR of a positional hash of every byte of memory, including the guard band */
+  uint64_t memory;
+
+  /** XOR of a positional hash of every word of the framebuffer */
+  uint64_t graphics;
+} state_hash_t;
+
+/**
+ * The parts of memory and the framebuffer changed since the state was last
+ * snapshotted or restored, so chip8_restore only needs to copy those back.
+ */
+typedef struct dirty_s
+{
+  /** Bitmap of the MEM_PAGE_SIZE pages of memory written to */
+  uint64_t pages[(MEM_PAGE_COUNT + 63) / 64];
+
+  /** Bitmap of the rows of each plane drawn, cleared or scrolled */
+  uint64_t rows[GRAPHICS_PLANES];
+} dirty_t;
+
+struct exec_trace_s;
+
 /** CPU state definitions */
 typedef struct cpu_state_s
 {
-  uint8_t memory[MEM_SIZE];
+  uint8_t memory[MEM_SIZE + MEM_GUARD_SIZE];
+
+  /** The XO_MEM_SIZE address space used in place of memory by XO-CHIP; NULL otherwise */
+  uint8_t *xo_memory;
+
   registers_t registers;
   timers_t timers;
   peripherals_t peripherals;
+
+  /** Selects the opcode table used by emulation_cycle */
+  quirk_profile_t quirk_profile;
+
+  /** State of the generator behind CXNN; see seed_random */
+  uint32_t random;
+
+  /**
+   * Set by DXYN under the display-wait quirk of the COSMAC VIP profile: the
+   * instructions of the current frame are over. Cleared by the frame schedulers,
+   * e.g. emulation_frame, which resume at the next frame.
+   */
+  uint8_t vblank_wait;
+
+  state_hash_t hash;
+  dirty_t dirty;
+
+  /** Execution trace recorder attached by exec_trace_start; NULL when not recording */
+  struct exec_trace_s *exec_trace;
 } cpu_state_t;
 
 #endif /* __CHIP_8_CPU_DEF_H__ */
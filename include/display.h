@@ -3,11 +3,14 @@
 
 #include <stdint.h>
 
+#include "backend.h"
 #include "status_code.h"
 #include "cpu_def.h"
 
 #define DEFAULT_FG_COLOR ((color_rgba_t){.r = 0xE9, .g = 0xE9, .b = 0xE9, .a = 0xFF})
 #define DEFAULT_BG_COLOR ((color_rgba_t){.r = 0x12, .g = 0x12, .b = 0x12, .a = 0xFF})
+#define DEFAULT_PLANE2_COLOR ((color_rgba_t){.r = 0x6E, .g = 0x6E, .b = 0x6E, .a = 0xFF})
+#define DEFAULT_OVERLAP_COLOR ((color_rgba_t){.r = 0xA8, .g = 0xA8, .b = 0xA8, .a = 0xFF})
 
 /** Structure to encode color in RGBA format */
 typedef struct __attribute__((packed)) color_rgba_s
@@ -21,34 +24,61 @@ typedef struct __attribute__((packed)) color_rgba_s
 /** Parameters to initialize the display module */
 typedef struct display_init_param_s
 {
-  /** Desired color for the foreground "ON" pixels */
+  /** Desired color for the foreground "ON" pixels, lit only in the first plane */
   color_rgba_t foreground_color;
 
   /** Desired color for the background "OFF" pixels */
   color_rgba_t background_color;
+
+  /** Desired color for pixels lit only in the second XO-CHIP plane */
+  color_rgba_t plane2_color;
+
+  /** Desired color for pixels lit in both XO-CHIP planes */
+  color_rgba_t overlap_color;
 } display_init_param_t;
 
+struct SDL_Window;
+struct SDL_Renderer;
+
+/** An SDL window showing the display of one session */
+typedef struct display_s
+{
+  struct SDL_Window *window;
+  struct SDL_Renderer *renderer;
+  color_rgba_t fg_color;
+  color_rgba_t bg_color;
+  color_rgba_t plane2_color;
+  color_rgba_t overlap_color;
+} display_t;
+
+/** Video backend table of display_t; see backend.h */
+extern const video_backend_t display_sdl_backend;
+
 /**
- * Initializes the display and allocate resources for it.
+ * Initializes the display and allocate resources for it. Falls back to a software
+ * renderer when no accelerated one can be created.
+ * @param display - Pointer to the display to initialize.
  * @param title - The desired title of the window to be created.
  * @param param - Pointer to an initialization parameters struct.
  * @return STATUS_OK if successful, otherwise appropriate error code.
  */
-status_code_t display_init(const char *title, display_init_param_t *const param);
+status_code_t display_init(display_t *const display, const char *title, display_init_param_t *const param);
 
 /**
  * Render the contents of the provided graphics buffer onto the display
  * The display is updated only when the display_update flag is set.
+ * @param display - Pointer to the display.
  * @param graphics - Pointer to the graphics buffer whose contents are to be
  *                   rendered on the display.
  * @return STATUS_OK if successful, otherwise appropriate error code.
  */
-status_code_t display_render(graphics_t *const graphics);
+status_code_t display_render(display_t *const display, graphics_t *const graphics);
 
 /**
  * Cleanup and free display resources
+ * @param display - Pointer to the display.
  * @return None
  */
-void display_cleanup();
+void display_cleanup(display_t *const display);
 
 #endif /* __DISPLAY_H__ */
@@ -0,0 +1,164 @@
+#ifndef __EXEC_TRACE_H__
+#define __EXEC_TRACE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "cpu_def.h"
+#include "status_code.h"
+
+#define EXEC_TRACE_MAGIC ("C8XT")
+#define EXEC_TRACE_VERSION (2)
+#define EXEC_TRACE_BUFFER_SIZE (1 << 20) // Bytes buffered before each write to the file
+#define EXEC_TRACE_MAX_WRITES (4)        // Memory writes recorded per instruction
+#define EXEC_TRACE_MAX_WRITE_SIZE (16)   // Largest memory write recorded in full (FX55 / 5XY2)
+
+/**
+ * The trace starts with the magic, the version and the quirk profile of the machine.
+ * Each record is a flags byte and the big-endian opcode, followed by only the fields
+ * whose flag is set, in this order:
+ *   PC:     u16 pc; present only when pc isn't the previous record's pc + 2
+ *   V:      u16 mask of changed registers, then the new value of each, V0 first
+ *   I:      u16 new I
+ *   SP:     u8 new sp, u16 mask of changed stack entries, then the new value of each
+ *   MEM:    u8 count, then per write: u16 address, u8 size, size bytes
+ *   STATUS: u8 status code, when the instruction didn't return STATUS_OK
+ *   TIMERS: u8 delay, u8 sound; present only when they differ from the previous record's
+ *   GFX:    u8 hires, u64 framebuffer hash; present only when they differ from the previous record's
+ * The first record has every field that carries over (PC, TIMERS and GFX).
+ * Multi-byte fields are big-endian.
+ */
+#define EXEC_TRACE_FLAG_PC (1 << 0)
+#define EXEC_TRACE_FLAG_V (1 << 1)
+#define EXEC_TRACE_FLAG_I (1 << 2)
+#define EXEC_TRACE_FLAG_SP (1 << 3)
+#define EXEC_TRACE_FLAG_MEM (1 << 4)
+#define EXEC_TRACE_FLAG_STATUS (1 << 5)
+#define EXEC_TRACE_FLAG_TIMERS (1 << 6)
+#define EXEC_TRACE_FLAG_GFX (1 << 7)
+
+/** A memory write made by a single instruction */
+typedef struct exec_trace_write_s
+{
+  uint16_t address;
+  uint8_t size;
+  uint8_t data[EXEC_TRACE_MAX_WRITE_SIZE];
+} exec_trace_write_t;
+
+/**
+ * A decoded trace record; one per executed instruction. The timers and framebuffer
+ * are those after the instruction, carried over from earlier records when unchanged.
+ */
+typedef struct exec_trace_record_s
+{
+  uint8_t flags;
+  uint16_t pc;
+  uint16_t opcode;
+
+  /** Bitmask of the V registers changed by the instruction; see V for their new values */
+  uint16_t v_mask;
+  uint8_t V[REG_COUNT];
+  uint16_t I;
+  uint8_t sp;
+
+  /** Bitmask of the stack entries changed by the instruction; see stack for their new values */
+  uint16_t stack_mask;
+  uint16_t stack[STACK_SIZE];
+
+  uint8_t write_count;
+  exec_trace_write_t writes[EXEC_TRACE_MAX_WRITES];
+
+  uint8_t status;
+
+  timers_t timers;
+  uint8_t hires;
+
+  /** The framebuffer's rolling hash, state_hash_t graphics */
+  uint64_t graphics_hash;
+} exec_trace_record_t;
+
+/** Execution trace recorder / reader state */
+typedef struct exec_trace_s
+{
+  FILE *file;
+
+  /** Quirk profile of the recorded machine */
+  uint8_t quirk_profile;
+
+  /** First error writing the trace file; recording goes on, but stop reports it */
+  status_code_t status;
+
+  /** Pending output (recorder) or input (reader) bytes */
+  uint8_t *buffer;
+  size_t length;
+  size_t position;
+
+  /** The pc of the last record; a record at pc + 2 omits its pc */
+  uint16_t last_pc;
+  uint8_t has_last_pc;
+
+  /** The timers and framebuffer as of the last record; a record omits them when unchanged */
+  timers_t last_timers;
+  uint8_t last_hires;
+  uint64_t last_graphics_hash;
+
+  /** Register state before the instruction being recorded */
+  registers_t before;
+  exec_trace_record_t record;
+
+  uint64_t record_count;
+} exec_trace_t;
+
+/**
+ * Create a trace file and start recording every instruction executed by the CPU.
+ * Call this after init_cpu, which clears the CPU state's link to the recorder.
+ * @param trace - Pointer to the recorder to initialize.
+ * @param state - Pointer to the CPU state to record.
+ * @param path - Path of the trace file to create.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t exec_trace_start(exec_trace_t *const trace, cpu_state_t *const state, const char *path);
+
+/**
+ * Stop recording, flush the remaining records and close the trace file.
+ * @param trace - Pointer to the recorder.
+ * @param state - Pointer to the recorded CPU state.
+ * @return STATUS_OK if the whole trace was written, otherwise appropriate error code.
+ */
+status_code_t exec_trace_stop(exec_trace_t *const trace, cpu_state_t *const state);
+
+/**
+ * Hooks called by emulation_cycle around each instruction, and by the memory
+ * accessors for every write, while a recorder is attached to the CPU state.
+ * exec_trace_end returns the first error writing the trace file, if any.
+ */
+void exec_trace_begin(exec_trace_t *const trace, cpu_state_t *const state);
+void exec_trace_mem_write(exec_trace_t *const trace, uint16_t const address, uint8_t const *data, size_t const size);
+status_code_t exec_trace_end(exec_trace_t *const trace, cpu_state_t *const state, status_code_t const status);
+
+/**
+ * Open a trace file for reading. The quirk profile it was recorded with is then
+ * in the reader's quirk_profile.
+ * @param trace - Pointer to the reader to initialize.
+ * @param path - Path of the trace file.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t exec_trace_open(exec_trace_t *const trace, const char *path);
+
+/**
+ * Decode the next record of a trace file.
+ * @param trace - Pointer to the reader.
+ * @param record - Pointer to store the decoded record at.
+ * @return STATUS_OK if a record was read, STATUS_REQ_EXIT at the end of the trace,
+ *         otherwise appropriate error code.
+ */
+status_code_t exec_trace_read(exec_trace_t *const trace, exec_trace_record_t *const record);
+
+/**
+ * Close a trace file opened for reading.
+ * @param trace - Pointer to the reader.
+ * @return None
+ */
+void exec_trace_close(exec_trace_t *const trace);
+
+#endif /* __EXEC_TRACE_H__ */
@@ -0,0 +1,78 @@
+#ifndef __GOVERNOR_H__
+#define __GOVERNOR_H__
+
+#include <stdint.h>
+
+#include "chip8.h"
+#include "status_code.h"
+
+#define GOVERNOR_FRAME_NS (1000000000ULL / 60)
+
+typedef struct governor_params_s
+{
+  /** Range the cycle budget of a frame is kept in */
+  uint32_t min_budget;
+  uint32_t max_budget;
+
+  /** Frames observed between decisions */
+  uint32_t window;
+
+  /** Percentage of the frame period the host must have left over, below which the budget is cut */
+  uint32_t min_headroom;
+
+  /**
+   * Percentages of instructions spent in idle loops. Above idle_high the guest waits
+   * on its timers anyway, so the budget is lowered; below idle_low it is busy all
+   * the time and is given more, if the host has twice min_headroom to spare.
+   */
+  uint32_t idle_high;
+  uint32_t idle_low;
+} governor_params_t;
+
+/** Picks the cycle budget of a cycle_clock_t from how the frames ran */
+typedef struct governor_s
+{
+  governor_params_t params;
+
+  /** Observations of the current window */
+  uint32_t frames;
+  uint64_t frame_ns;
+  uint64_t instructions;
+  uint64_t idle_instructions;
+
+  /** Stats of the last window: its instruction rate, and the headroom and idle percentages the budget was set from */
+  uint32_t instructions_per_second;
+  uint32_t headroom;
+  uint32_t idle;
+  uint32_t adjustments;
+} governor_t;
+
+/**
+ * Get the default parameters for a clock: a budget from 3/4 of the default of its
+ * timing mode up to 4 times that, adjusted every half second.
+ * @param params - Pointer to store the parameters at.
+ * @param mode - Timing mode of the clock.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t governor_default_params(governor_params_t *const params, timing_mode_t const mode);
+
+/**
+ * Start governing a clock.
+ * @param governor - Pointer to the governor to initialize.
+ * @param params - Pointer to the parameters.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t governor_init(governor_t *const governor, const governor_params_t *params);
+
+/**
+ * Observe a frame run by run_frame_cycles and, at the end of each window, set the
+ * clock's budget for the next: cut when the host is short of headroom, lowered
+ * when the guest mostly idles, raised when it never does.
+ * @param governor - Pointer to a governor.
+ * @param clock - Pointer to the clock the frame was run with.
+ * @param frame_ns - Host time taken by the frame: emulation and presentation.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t governor_update(governor_t *const governor, cycle_clock_t *const clock, uint64_t const frame_ns);
+
+#endif /* __GOVERNOR_H__ */
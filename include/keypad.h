@@ -2,8 +2,12 @@
 #define __KEYPAD_H__
 
 #include <stdint.h>
+#include "backend.h"
 #include "status_code.h"
 
+/** Input backend reading the SDL keyboard; takes a NULL handle. See backend.h */
+extern const input_backend_t keypad_sdl_backend;
+
 /**
  * Read the keypad state and store the results in the provided flags.
  * @param key_state - Pointer to a 16-bit flags to store keypad reading values.
@@ -2,23 +2,89 @@
 #define __LOGGING_H__
 
 #include <stdio.h>
+#include <stdint.h>
 
-#define LOG_LEVEL_TRACE ("TRACE")
-#define LOG_LEVEL_DEBUG ("DEBUG")
-#define LOG_LEVEL_INFO ("INFO ")
-#define LOG_LEVEL_WARN ("WARN ")
-#define LOG_LEVEL_ERROR ("ERROR")
-#define LOG_LEVEL_FATAL ("FATAL")
+#include "status_code.h"
 
+#define LOG_LEVEL_TRACE (0)
+#define LOG_LEVEL_DEBUG (1)
+#define LOG_LEVEL_INFO (2)
+#define LOG_LEVEL_WARN (3)
+#define LOG_LEVEL_ERROR (4)
+#define LOG_LEVEL_FATAL (5)
+
+/**
+ * Messages below this level are compiled out entirely, arguments included.
+ * Override at build time, e.g. -DLOG_MIN_LEVEL=LOG_LEVEL_TRACE for staging builds.
+ */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SIZE (16384)   // Bytes buffered per logging thread, must be a power of 2
+#define LOG_MAX_THREADS (16)    // Maximum number of live threads with a log buffer; others log synchronously
+#define LOG_MAX_MSG_SIZE (256)  // Longest formatted message, including the prefix
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_TRACE
 #define Log_T(...) (Log(LOG_LEVEL_TRACE, __VA_ARGS__))
+#else
+#define Log_T(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
 #define Log_D(...) (Log(LOG_LEVEL_DEBUG, __VA_ARGS__))
+#else
+#define Log_D(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
 #define Log_I(...) (Log(LOG_LEVEL_INFO, __VA_ARGS__))
+#else
+#define Log_I(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
 #define Log_W(...) (Log(LOG_LEVEL_WARN, __VA_ARGS__))
+#else
+#define Log_W(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
 #define Log_E(...) (Log(LOG_LEVEL_ERROR, __VA_ARGS__))
+#else
+#define Log_E(...) ((void)0)
+#endif
+
 #define Log_F(...) (Log(LOG_LEVEL_FATAL, __VA_ARGS__))
 
-#define LOG_FN(...) (fprintf(stderr, __VA_ARGS__))
+#define Log(level, ...) (log_write(level, __FILE_NAME__, __LINE__, __VA_ARGS__))
+
+/**
+ * Starts the background writer that drains every thread's log buffer to stderr.
+ * Until this is called, and after log_shutdown, messages are written synchronously.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t log_init(void);
+
+/**
+ * Formats a message into the calling thread's log buffer without blocking.
+ * The buffer is allocated on the thread's first message and freed once drained
+ * after the thread exits. Messages that don't fit in it are dropped and counted.
+ * Use the Log_* macros rather than calling this directly.
+ * @param level - One of the LOG_LEVEL_* values.
+ * @param file - Name of the source file the message comes from.
+ * @param line - Line number the message comes from.
+ * @param format - printf-style format string, followed by its arguments.
+ * @return None
+ */
+void log_write(uint8_t const level, const char *file, unsigned int const line, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
 
-#define Log(level, ...) ({LOG_FN("\n%s [%s:%u]: ", level, __FILE_NAME__, __LINE__); LOG_FN(__VA_ARGS__);})
+/**
+ * Stops the background writer, waiting for messages being written by other threads,
+ * and drains all pending messages.
+ * @return None
+ */
+void log_shutdown(void);
 
 #endif
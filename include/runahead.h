@@ -0,0 +1,63 @@
+#ifndef __RUNAHEAD_H__
+#define __RUNAHEAD_H__
+
+#include <stdint.h>
+
+#include "chip8.h"
+#include "cpu_def.h"
+#include "session.h"
+#include "status_code.h"
+
+#define RUNAHEAD_MAX_FRAMES (8)
+
+/**
+ * Run-ahead: every frame the session shows the machine as it will be a few frames
+ * later if the keypad stays as it is, hiding that many frames of the ROM's own input
+ * lag, e.g. FX0A waiting for a key to be released. The real machine is snapshotted,
+ * run ahead, shown and restored.
+ */
+typedef struct runahead_s
+{
+  /** Frames run ahead of the real machine, up to RUNAHEAD_MAX_FRAMES */
+  uint32_t frames;
+
+  /** The real machine, kept up to date with chip8_snapshot_update */
+  cpu_state_t snapshot;
+  uint8_t snapshot_taken;
+
+  /** Stats: frames shown, and the host time spent running ahead and restoring */
+  uint64_t presented;
+  uint64_t total_ns;
+  uint64_t last_ns;
+  uint64_t max_ns;
+} runahead_t;
+
+/**
+ * Set up run-ahead.
+ * @param runahead - Pointer to the run-ahead state to initialize.
+ * @param frames - Frames to run ahead, 1 to RUNAHEAD_MAX_FRAMES.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t runahead_init(runahead_t *const runahead, uint32_t const frames);
+
+/**
+ * Free the snapshot of the real machine.
+ * @param runahead - Pointer to a run-ahead state.
+ * @return None
+ */
+void runahead_cleanup(runahead_t *const runahead);
+
+/**
+ * Run the 60 Hz part of a frame in place of session_frame, once the real frame has
+ * run. The sound and timers are those of the real machine. The display is that of
+ * the machine run ahead with the current keypad, each frame with clock's budget and
+ * a timer update. The session's machine is then restored to the real one; an
+ * execution trace being recorded only sees the real frames.
+ * @param runahead - Pointer to a run-ahead state.
+ * @param session - Pointer to the session.
+ * @param clock - Pointer to the clock of the real frames; left unchanged.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t runahead_frame(runahead_t *const runahead, session_t *const session, cycle_clock_t *const clock);
+
+#endif /* __RUNAHEAD_H__ */
@@ -0,0 +1,111 @@
+#ifndef __SEARCH_H__
+#define __SEARCH_H__
+
+#include <stdint.h>
+
+#include "cpu_def.h"
+#include "status_code.h"
+
+#define SEARCH_MAX_THREADS (64)
+#define SEARCH_MAX_STATES (1u << 30) // The visited set is sized to the power of two above twice this
+
+/** How a search predicate tests the byte at its address */
+typedef enum
+{
+  SEARCH_EQUAL,
+  SEARCH_NOT_EQUAL,
+  SEARCH_LESS,
+  SEARCH_GREATER,
+
+  /** Always holds; the score is the byte itself times the weight */
+  SEARCH_VALUE,
+} search_compare_t;
+
+/** A test of a byte of guest memory, e.g. a game's level or lives counter */
+typedef struct search_predicate_s
+{
+  uint16_t address;
+  search_compare_t compare;
+  uint8_t value;
+
+  /** Added to the score when the predicate holds; may be negative */
+  int32_t weight;
+} search_predicate_t;
+
+typedef struct search_params_s
+{
+  /** Keypad bitmasks tried from every state */
+  const uint16_t *actions;
+  uint32_t action_count;
+
+  /** Frames each action is held for */
+  uint32_t frames_per_step;
+
+  /** Maximum number of actions in a sequence */
+  uint32_t max_depth;
+
+  /**
+   * States kept after each step, the highest scoring first. A beam at least
+   * action_count ^ max_depth wide makes this a breadth-first search.
+   */
+  uint32_t beam_width;
+
+  /** Capacity of the set of visited state hashes, up to SEARCH_MAX_STATES; states past it are no longer deduplicated */
+  uint32_t max_states;
+
+  const search_predicate_t *predicates;
+  uint32_t predicate_count;
+
+  /** The search stops at the first state scoring at least goal_score, if has_goal is set */
+  int64_t goal_score;
+  uint8_t has_goal;
+
+  /** Worker threads stepping states in parallel, up to SEARCH_MAX_THREADS */
+  uint32_t threads;
+} search_params_t;
+
+typedef struct search_result_s
+{
+  /** Actions leading to the goal, or to the best scoring state found; free with search_free_result */
+  uint16_t *path;
+  uint32_t length;
+
+  int64_t score;
+  uint8_t goal_reached;
+
+  /** States stepped, and those of them dropped as already visited */
+  uint64_t expanded;
+  uint64_t duplicates;
+} search_result_t;
+
+/**
+ * Score a machine state: the sum of the weights of the predicates that hold.
+ * @param state - Pointer to a CPU state.
+ * @param predicates - The predicates to test.
+ * @param count - Number of predicates.
+ * @param score - Pointer to store the score at.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t search_score(cpu_state_t *const state, const search_predicate_t *predicates, uint32_t const count, int64_t *const score);
+
+/**
+ * Search for a sequence of inputs maximising the score, or reaching the goal.
+ * Every state kept after a step is stepped with every action across the worker
+ * threads, states already visited are dropped by their chip8_state_hash, and the
+ * beam_width highest scoring of the rest are kept for the next step.
+ * CXNN draws from each state's own generator, so searches are reproducible.
+ * @param root - Pointer to the CPU state to search from; left unchanged.
+ * @param params - Pointer to the search parameters.
+ * @param result - Pointer to store the result at.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t search_run(cpu_state_t *const root, const search_params_t *params, search_result_t *const result);
+
+/**
+ * Free the action sequence of a search result.
+ * @param result - Pointer to a result filled in by search_run.
+ * @return None
+ */
+void search_free_result(search_result_t *const result);
+
+#endif /* __SEARCH_H__ */
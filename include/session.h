@@ -0,0 +1,53 @@
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+#include <stdint.h>
+
+#include "backend.h"
+#include "cpu_def.h"
+#include "status_code.h"
+
+/**
+ * One emulated machine together with the backends it is shown, heard and
+ * played through. Sessions share no state, so a process may run any number of
+ * them, each on its own thread if need be. Any backend may be left NULL, e.g.
+ * for a headless or silent session.
+ */
+typedef struct session_s
+{
+  cpu_state_t cpu;
+
+  const video_backend_t *video;
+  void *video_handle;
+
+  const audio_backend_t *audio;
+  void *audio_handle;
+
+  const input_backend_t *input;
+  void *input_handle;
+} session_t;
+
+/**
+ * Read the keypad of a session through its input backend.
+ * @param session - Pointer to a session.
+ * @return STATUS_OK if successful, STATUS_REQ_EXIT if the user asked to quit,
+ *         otherwise appropriate error code.
+ */
+status_code_t session_read_input(session_t *const session);
+
+/**
+ * Run the 60 Hz part of a frame: hand the sound state to the audio backend,
+ * update the timers and render the display.
+ * @param session - Pointer to a session.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t session_frame(session_t *const session);
+
+/**
+ * Clean up the backends of a session and free its machine.
+ * @param session - Pointer to a session.
+ * @return None
+ */
+void session_cleanup(session_t *const session);
+
+#endif /* __SESSION_H__ */
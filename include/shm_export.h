@@ -0,0 +1,107 @@
+#ifndef __SHM_EXPORT_H__
+#define __SHM_EXPORT_H__
+
+#include <stdint.h>
+
+#include "cpu_def.h"
+#include "status_code.h"
+
+#define SHM_EXPORT_MAGIC (0x48533843) // "C8SH" in little endian
+#define SHM_EXPORT_VERSION (1)
+#define SHM_EXPORT_NAME_SIZE (256)
+
+/**
+ * Layout of the shared memory segment, written by the emulator once a frame and
+ * read in place by any number of other processes, e.g. bots and recorders.
+ * Readers never block the writer: they read the fields between two loads of
+ * sequence, which is odd while the writer is updating them, and start over if it
+ * changed; see shm_export_read_begin and shm_export_read_retry.
+ */
+typedef struct shm_export_layout_s
+{
+  uint32_t magic;
+  uint32_t version;
+
+  /** sizeof(shm_export_layout_t) of the writer */
+  uint32_t size;
+
+  uint32_t sequence;
+
+  /** Frames published; readers poll it for new frames */
+  uint64_t frame;
+
+  /** The frame number graphics was last updated on */
+  uint64_t graphics_frame;
+
+  quirk_profile_t quirk_profile;
+  graphics_t graphics;
+  registers_t registers;
+  timers_t timers;
+  uint16_t keypad;
+} shm_export_layout_t;
+
+/** A mapping of the segment, either by its writer or read-only by a reader */
+typedef struct shm_export_s
+{
+  char name[SHM_EXPORT_NAME_SIZE];
+  shm_export_layout_t *layout;
+  uint8_t writer;
+} shm_export_t;
+
+/**
+ * Create the segment and map it for writing; an existing one of the same name is replaced.
+ * @param export - Pointer to the export to initialize.
+ * @param name - POSIX shared memory object name, e.g. "/chip8".
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t shm_export_create(shm_export_t *const export, const char *name);
+
+/**
+ * Publish the state after a frame: the registers, timers and keypad, and the
+ * framebuffer if it changed. Call before rendering, which clears display_update.
+ * @param export - Pointer to an export created by shm_export_create.
+ * @param state - Pointer to the CPU state to publish.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t shm_export_publish(shm_export_t *const export, cpu_state_t *const state);
+
+/**
+ * Map an existing segment read-only.
+ * @param export - Pointer to the export to initialize.
+ * @param name - Name the writer created the segment with.
+ * @return STATUS_OK if successful, STATUS_ERR_FILE_NOT_FOUND if there is no such
+ *         segment, STATUS_ERR_INVALID_PARAM if it has a different layout.
+ */
+status_code_t shm_export_open(shm_export_t *const export, const char *name);
+
+/**
+ * Start reading the segment in place, waiting out an update in progress.
+ * @param export - Pointer to an open export.
+ * @return The sequence number to pass to shm_export_read_retry.
+ */
+uint32_t shm_export_read_begin(const shm_export_t *const export);
+
+/**
+ * Finish reading the segment in place.
+ * @param export - Pointer to an open export.
+ * @param sequence - The value returned by shm_export_read_begin.
+ * @return Non-zero if the writer updated the segment meanwhile, so the read must be started over.
+ */
+uint8_t shm_export_read_retry(const shm_export_t *const export, uint32_t const sequence);
+
+/**
+ * Copy a consistent snapshot of the segment.
+ * @param export - Pointer to an open export.
+ * @param copy - Pointer to store the copy at.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t shm_export_read(const shm_export_t *const export, shm_export_layout_t *const copy);
+
+/**
+ * Unmap the segment, removing it if this is the writer.
+ * @param export - Pointer to an export.
+ * @return None
+ */
+void shm_export_close(shm_export_t *const export);
+
+#endif /* __SHM_EXPORT_H__ */
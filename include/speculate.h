@@ -0,0 +1,103 @@
+#ifndef __SPECULATE_H__
+#define __SPECULATE_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "chip8.h"
+#include "cpu_def.h"
+#include "status_code.h"
+
+/** The keypad as it is, and with each single key pressed or released */
+#define SPECULATE_MAX_BRANCHES (NUM_KEYS + 1)
+
+/** A toggle count reaching this halves them all, so the predictor follows recent play */
+#define SPECULATE_HISTORY_MAX (256)
+
+/** The next frame run ahead of time with one guess at the keypad */
+typedef struct speculate_branch_s
+{
+  uint16_t keys;
+  cpu_state_t state;
+  cycle_clock_t clock;
+  status_code_t status;
+} speculate_branch_t;
+
+/**
+ * Speculative execution of the next frame. Between frames, worker threads on spare
+ * cores each run the next frame for one of the most likely keypads. When the frame
+ * comes, the branch run with the keypad actually held is committed in place of
+ * running it; on a miss the frame is run as usual.
+ */
+typedef struct speculate_s
+{
+  /** The machine and clock the branches start from, and the branches */
+  cpu_state_t base;
+  cycle_clock_t base_clock;
+  speculate_branch_t branches[SPECULATE_MAX_BRANCHES];
+  uint32_t branch_count;
+
+  /** Predictor: how often each key changed between frames, recently */
+  uint32_t toggles[NUM_KEYS];
+
+  /** Stats: frames committed from a branch or run after a miss, and the branches run and thrown away */
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t branches_run;
+  uint64_t wasted_branches;
+  uint64_t wasted_instructions;
+
+  /** Worker pool; a batch is started by bumping generation and done once pending drops to 0 */
+  pthread_t workers[SPECULATE_MAX_BRANCHES];
+  uint32_t worker_count;
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t finished;
+  uint64_t generation;
+  uint32_t next_branch;
+  uint32_t pending;
+  uint8_t running;
+  uint8_t stopping;
+} speculate_t;
+
+/**
+ * Start the worker threads.
+ * @param spec - Pointer to the speculation state to initialize.
+ * @param branches - Keypads guessed each frame, 1 to SPECULATE_MAX_BRANCHES, each
+ *                   run on a worker thread of its own.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t speculate_init(speculate_t *const spec, uint32_t const branches);
+
+/**
+ * Stop the worker threads and free the branches.
+ * @param spec - Pointer to a speculation state.
+ * @return None
+ */
+void speculate_cleanup(speculate_t *const spec);
+
+/**
+ * Start running the next frame of a machine in the background, once the current
+ * frame is over, i.e. after its timers were updated. The keypad held now is guessed
+ * first, then each single key change, the keys changed most often first. Machines
+ * recording an execution trace are not speculated on, so the trace sees every
+ * instruction. Until speculate_frame, only the keypad of the machine may change.
+ * @param spec - Pointer to a speculation state.
+ * @param state - Pointer to the CPU state.
+ * @param clock - Pointer to the clock its frames are run with.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t speculate_start(speculate_t *const spec, cpu_state_t *const state, cycle_clock_t *const clock);
+
+/**
+ * Run a frame in place of run_frame_cycles. Once the branches started by
+ * speculate_start are done, the one run with the keypad now held, if any, is
+ * copied into the machine and clock. Otherwise the frame is run as usual.
+ * @param spec - Pointer to a speculation state.
+ * @param state - Pointer to the CPU state.
+ * @param clock - Pointer to the clock its frames are run with.
+ * @return The status of the frame, as run_frame_cycles returns it.
+ */
+status_code_t speculate_frame(speculate_t *const spec, cpu_state_t *const state, cycle_clock_t *const clock);
+
+#endif /* __SPECULATE_H__ */
@@ -13,6 +13,7 @@ typedef enum
   STATUS_ERR_STACK_OVERFLOW,
   STATUS_ERR_STACK_UNDERFLOW,
   STATUS_ERR_MATH_DIV_0,
+  STATUS_ERR_INVALID_PARAM,
   STATUS_REQ_EXIT,
 } status_code_t;
 
@@ -0,0 +1,233 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "backend.h"
+#include "cpu_def.h"
+#include "status_code.h"
+
+/**
+ * Display streaming protocol. Every message is a 4 byte header, its type, a
+ * reserved byte and the length of the payload as a little endian uint16,
+ * followed by the payload.
+ *
+ * Frames (server to viewer):
+ *   uint32 frame number, little endian
+ *   uint8  flags: STREAM_FLAG_HIRES, STREAM_FLAG_KEYFRAME
+ *   uint64 mask of the rows that changed, little endian, bit n for row n
+ *   then for each changed row, its STREAM_ROW_BYTES bytes XORed with the previous
+ *   frame's (with a blank frame for keyframes), run length encoded: a uint8 count
+ *   of pairs, then pairs of unchanged and changed byte counts, each followed by
+ *   the changed bytes. Unchanged bytes after the last pair are left out.
+ * A row's bytes are the words of plane 0 then plane 1, each most significant byte first.
+ *
+ * Keypad (viewer to server): the uint16 bitmask of the keys the viewer holds,
+ * little endian. The keypad of the session is the OR of those of every viewer.
+ */
+#define STREAM_HEADER_SIZE (4)
+#define STREAM_ROW_BYTES (GRAPHICS_PLANES * GRAPHICS_ROW_WORDS * 8)
+#define STREAM_FRAME_FIXED_SIZE (13)
+#define STREAM_MAX_ROW_SIZE (1 + STREAM_ROW_BYTES + (STREAM_ROW_BYTES / 2)) // Every other byte changed
+#define STREAM_MAX_PAYLOAD (STREAM_FRAME_FIXED_SIZE + (GRAPHICS_HIRES_HEIGHT * STREAM_MAX_ROW_SIZE))
+#define STREAM_MAX_MESSAGE (STREAM_HEADER_SIZE + STREAM_MAX_PAYLOAD)
+
+#define STREAM_FLAG_HIRES (0x01)
+#define STREAM_FLAG_KEYFRAME (0x02)
+
+#define STREAM_MAX_VIEWERS (64)
+
+/** Bytes queued per viewer; a viewer further behind skips ahead to a keyframe */
+#define STREAM_VIEWER_BUFFER (16 * STREAM_MAX_MESSAGE)
+
+typedef enum
+{
+  STREAM_MSG_FRAME = 1,
+  STREAM_MSG_KEYPAD = 2,
+} stream_msg_type_t;
+
+/** Servers one fan-out thread can serve */
+#define STREAM_HUB_MAX_SERVERS (256)
+
+/** A connected viewer, owned by the fan-out thread */
+typedef struct stream_viewer_s
+{
+  int fd;
+  uint8_t *output;
+  size_t output_length;
+  size_t output_sent;
+  uint8_t waiting_writable;
+  uint8_t needs_keyframe;
+
+  uint8_t input[STREAM_HEADER_SIZE + sizeof(uint16_t)];
+  uint8_t input_length;
+  uint16_t keypad;
+} stream_viewer_t;
+
+/**
+ * A fan-out thread encoding the frames of any number of servers and serving
+ * their viewers, so that hosting many streams does not take a thread each.
+ */
+typedef struct stream_hub_s
+{
+  int epoll_fd;
+  int wake_fd;
+  pthread_t thread;
+  uint8_t thread_started;
+
+  /** Guards the servers; held by the fan-out thread while it serves them */
+  pthread_mutex_t lock;
+  struct stream_server_s *servers[STREAM_HUB_MAX_SERVERS];
+
+  /** Tells the events of a detached server from those of the next one in its slot */
+  uint32_t generations[STREAM_HUB_MAX_SERVERS];
+  uint32_t next_generation;
+  uint8_t stopping;
+} stream_hub_t;
+
+/**
+ * Publishes the frames of a session to any number of viewers over a Unix domain
+ * or loopback TCP socket, and takes their keypad input back. The fan-out thread
+ * of a hub encodes the frames and serves the viewers; the session's thread only
+ * copies the framebuffer over.
+ */
+typedef struct stream_server_s
+{
+  int listen_fd;
+  int wake_fd;
+  char unix_path[108];
+
+  /** The hub serving the server, its own unless started with stream_server_init_shared */
+  stream_hub_t *hub;
+  uint8_t owns_hub;
+  uint32_t slot;
+  uint32_t generation;
+
+  /** The latest frame, handed from the session's thread to the fan-out thread */
+  pthread_mutex_t lock;
+  uint64_t pending[GRAPHICS_PLANES][GRAPHICS_HIRES_HEIGHT][GRAPHICS_ROW_WORDS];
+  uint8_t pending_hires;
+  uint8_t pending_new;
+
+  /** The frame last sent to the viewers, which deltas are encoded against */
+  uint64_t sent[GRAPHICS_PLANES][GRAPHICS_HIRES_HEIGHT][GRAPHICS_ROW_WORDS];
+  uint8_t sent_hires;
+  uint32_t frame;
+
+  stream_viewer_t viewers[STREAM_MAX_VIEWERS];
+
+  /** OR of the keypads of every viewer */
+  uint16_t keypad;
+
+  /** Totals over every viewer */
+  uint64_t bytes_sent;
+  uint64_t keyframes_sent;
+} stream_server_t;
+
+/** Video backend publishing frames, with a stream_server_t as the handle; see backend.h */
+extern const video_backend_t stream_video_backend;
+
+/** Input backend reading the keypads of the viewers, with a stream_server_t as the handle */
+extern const input_backend_t stream_input_backend;
+
+/**
+ * Encode a frame as a delta against the previous one.
+ * @param previous - The frame the viewer has, or NULL to encode a keyframe.
+ * @param current - The frame to encode.
+ * @param hires - Whether the current frame is at the high resolution.
+ * @param frame - Frame number.
+ * @param message - Buffer of at least STREAM_MAX_MESSAGE bytes for the message, header included.
+ * @return Size of the message in bytes.
+ */
+size_t stream_encode_frame(uint64_t const (*previous)[GRAPHICS_HIRES_HEIGHT][GRAPHICS_ROW_WORDS],
+                           uint64_t const (*current)[GRAPHICS_HIRES_HEIGHT][GRAPHICS_ROW_WORDS],
+                           uint8_t const hires, uint32_t const frame, uint8_t *const message);
+
+/**
+ * Apply a frame payload to a framebuffer, setting display_update.
+ * @param graphics - Pointer to the framebuffer the payload is a delta against.
+ * @param frame - Pointer to store the frame number at; may be NULL.
+ * @param payload - The payload of a STREAM_MSG_FRAME message.
+ * @param length - Length of the payload.
+ * @return STATUS_OK if successful, STATUS_ERR_INVALID_PARAM if the payload is malformed.
+ */
+status_code_t stream_decode_frame(graphics_t *const graphics, uint32_t *const frame, uint8_t const *payload, size_t const length);
+
+/**
+ * Start a fan-out thread for servers to share.
+ * @param hub - Pointer to the hub to initialize.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t stream_hub_init(stream_hub_t *const hub);
+
+/**
+ * Stop the fan-out thread; every server on the hub must have been cleaned up first.
+ * @param hub - Pointer to a hub.
+ * @return None
+ */
+void stream_hub_cleanup(stream_hub_t *const hub);
+
+/**
+ * Start serving viewers, from a fan-out thread of the server's own.
+ * @param server - Pointer to the server to initialize.
+ * @param address - "unix:PATH" for a Unix domain socket, or "tcp:PORT" to listen on 127.0.0.1.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t stream_server_init(stream_server_t *const server, const char *address);
+
+/**
+ * Start serving viewers from the fan-out thread of a hub.
+ * @param server - Pointer to the server to initialize.
+ * @param hub - Pointer to the hub to serve it from.
+ * @param address - Address to listen on; see stream_server_init.
+ * @return STATUS_OK if successful, STATUS_ERR_NO_MEMORY if the hub is full,
+ *         otherwise appropriate error code.
+ */
+status_code_t stream_server_init_shared(stream_server_t *const server, stream_hub_t *const hub, const char *address);
+
+/**
+ * Hand a frame to the fan-out thread. Frames published faster than they are
+ * sent are merged into the next delta.
+ * @param server - Pointer to a server.
+ * @param graphics - Pointer to the framebuffer to publish.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t stream_server_publish(stream_server_t *const server, graphics_t const *const graphics);
+
+/**
+ * Disconnect the viewers and detach from the hub, stopping it if it is the server's own.
+ * @param server - Pointer to a server.
+ * @return None
+ */
+void stream_server_cleanup(stream_server_t *const server);
+
+/**
+ * Connect to a server as a viewer.
+ * @param address - Address the server listens on; see stream_server_init.
+ * @param fd - Pointer to store the connected socket at.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t stream_connect(const char *address, int *const fd);
+
+/**
+ * Read a whole message, blocking until it arrives.
+ * @param fd - A connected socket.
+ * @param type - Pointer to store the message type at.
+ * @param payload - Buffer of at least STREAM_MAX_PAYLOAD bytes for the payload.
+ * @param length - Pointer to store the payload length at.
+ * @return STATUS_OK if successful, STATUS_REQ_EXIT once the connection is closed,
+ *         otherwise appropriate error code.
+ */
+status_code_t stream_read_message(int const fd, uint8_t *const type, uint8_t *const payload, uint16_t *const length);
+
+/**
+ * Send the keys a viewer holds.
+ * @param fd - A connected socket.
+ * @param keypad - Keypad bitmask.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t stream_send_keypad(int const fd, uint16_t const keypad);
+
+#endif /* __STREAM_H__ */
@@ -0,0 +1,91 @@
+#ifndef __TERMINAL_H__
+#define __TERMINAL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "backend.h"
+#include "cpu_def.h"
+#include "display.h"
+#include "status_code.h"
+
+/** Largest grid of character cells drawn: the high resolution display in half-blocks */
+#define TERMINAL_MAX_COLUMNS (GRAPHICS_HIRES_WIDTH)
+#define TERMINAL_MAX_ROWS (GRAPHICS_HIRES_HEIGHT / 2)
+
+/** How display pixels map onto character cells */
+typedef enum
+{
+  /** Upper half blocks, 1x2 pixels per cell, in the colors of each plane combination */
+  TERMINAL_HALF_BLOCK,
+
+  /** Braille patterns, 2x4 pixels per cell, in the foreground color wherever any plane is lit */
+  TERMINAL_BRAILLE,
+} terminal_mode_t;
+
+/** Parameters to initialize a terminal display */
+typedef struct terminal_init_param_s
+{
+  /** File descriptor of the terminal, e.g. STDOUT_FILENO or a socket; left open on cleanup */
+  int fd;
+  terminal_mode_t mode;
+
+  /** Pixel colors, drawn with the nearest of the 256 xterm colors; see display_init_param_t */
+  display_init_param_t colors;
+} terminal_init_param_t;
+
+/**
+ * A display drawn with ANSI escape sequences. Only the cells that changed since
+ * the previous frame are redrawn, and each frame is sent with a single write().
+ */
+typedef struct terminal_s
+{
+  int fd;
+  terminal_mode_t mode;
+
+  /** xterm color indices by the plane bits of a pixel */
+  uint8_t palette[1 << GRAPHICS_PLANES];
+
+  /** Cells as last drawn; TERMINAL_CELL_UNKNOWN where the screen must be redrawn */
+  uint16_t cells[TERMINAL_MAX_ROWS][TERMINAL_MAX_COLUMNS];
+  uint8_t hires;
+
+  /** Escape sequences of the frame being drawn */
+  char *output;
+  size_t length;
+  size_t capacity;
+
+  /** Total bytes written, for measuring the bandwidth used */
+  uint64_t bytes_written;
+} terminal_t;
+
+/** Video backend table of terminal_t; see backend.h */
+extern const video_backend_t terminal_backend;
+
+/**
+ * Clear the terminal and hide its cursor.
+ * @param terminal - Pointer to the terminal display to initialize.
+ * @param param - Pointer to an initialization parameters struct.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t terminal_init(terminal_t *const terminal, terminal_init_param_t *const param);
+
+/**
+ * Draw the cells of the display that changed since the previous frame.
+ * If the terminal cannot take the whole frame at once, e.g. a non-blocking
+ * socket whose buffer is full, the rest is dropped and the next frame is a
+ * full redraw.
+ * @param terminal - Pointer to a terminal display.
+ * @param graphics - Pointer to the graphics buffer to draw.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t terminal_render(terminal_t *const terminal, graphics_t *const graphics);
+
+/**
+ * Restore the terminal's colors and cursor, and free the output buffer.
+ * @param terminal - Pointer to a terminal display.
+ * @return None
+ */
+void terminal_cleanup(terminal_t *const terminal);
+
+#endif /* __TERMINAL_H__ */
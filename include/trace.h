@@ -0,0 +1,56 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+#include "status_code.h"
+
+#define TRACE_DEFAULT_FILE ("chip8_trace.json")
+#define TRACE_FILE_ENV ("CHIP8_TRACE_FILE")  // Environment variable overriding the output path
+#define TRACE_MAX_EVENTS (262144)            // Spans recorded before the buffer is full
+
+/**
+ * Span instrumentation, compiled in only when CHIP8_TRACE is defined.
+ * TRACE_SPAN_BEGIN declares a local holding the span's start time and
+ * TRACE_SPAN_END records the span under the given name.
+ */
+#ifdef CHIP8_TRACE
+#define TRACE_SPAN_BEGIN(span) uint64_t span = trace_now_us()
+#define TRACE_SPAN_END(span, name) trace_record((name), (span), trace_now_us())
+#else
+#define TRACE_SPAN_BEGIN(span) ((void)0)
+#define TRACE_SPAN_END(span, name) ((void)0)
+#endif
+
+/**
+ * Allocates the in-memory span buffer. The recorded spans are written as Chrome
+ * trace-event JSON, viewable in Perfetto or chrome://tracing, when the program exits.
+ * @param path - Output file path; NULL selects $CHIP8_TRACE_FILE or TRACE_DEFAULT_FILE.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t trace_init(const char *path);
+
+/**
+ * Get the current time of the trace clock.
+ * @return Monotonic time in microseconds.
+ */
+uint64_t trace_now_us(void);
+
+/**
+ * Record a completed span. Safe to call from any thread; spans past
+ * TRACE_MAX_EVENTS are dropped and counted.
+ * @param name - Name of the span; must be a string literal or otherwise outlive the trace.
+ * @param start_us - Start time of the span from trace_now_us.
+ * @param end_us - End time of the span from trace_now_us.
+ * @return None
+ */
+void trace_record(const char *name, uint64_t const start_us, uint64_t const end_us);
+
+/**
+ * Stop recording, wait for spans being recorded by other threads, then write the
+ * recorded spans to the output file and free the buffer. Spans recorded afterwards
+ * are dropped. Called automatically at exit once trace_init has succeeded.
+ * @return None
+ */
+void trace_shutdown(void);
+
+#endif /* __TRACE_H__ */
@@ -0,0 +1,134 @@
+#ifndef __VEC_ENV_H__
+#define __VEC_ENV_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "cpu_def.h"
+#include "search.h"
+#include "status_code.h"
+
+#define VEC_ENV_MAX_THREADS (64)
+
+/** Observation size: the display at the high resolution, lower resolution pixels doubled */
+#define VEC_ENV_OBS_WIDTH(downsample) (GRAPHICS_HIRES_WIDTH / (downsample))
+#define VEC_ENV_OBS_HEIGHT(downsample) (GRAPHICS_HIRES_HEIGHT / (downsample))
+
+typedef struct vec_env_params_s
+{
+  /** ROM run by every environment, and the quirk profile to run it with */
+  const char *rom;
+  quirk_profile_t profile;
+
+  uint32_t num_envs;
+
+  /** Worker threads stepping the environments; 0 or 1 steps them on the calling thread */
+  uint32_t threads;
+
+  /** Frames each action is held for per step */
+  uint32_t frame_skip;
+
+  /** Frames after which an episode is cut short; 0 for no limit */
+  uint32_t max_episode_frames;
+
+  /**
+   * Observations are downsampled by this factor (1, 2, 4 or 8) in both directions,
+   * each pixel being the OR of the block it covers. Pixel values are the plane bits,
+   * 1 for the first plane and 2 for the second.
+   */
+  uint8_t downsample;
+
+  /** Number of most recent frames in each observation, the oldest first */
+  uint8_t frame_stack;
+
+  /**
+   * The reward of a step is the change in the score of reward_predicates over it;
+   * see search_score.
+   */
+  const search_predicate_t *reward_predicates;
+  uint32_t reward_count;
+
+  /** An episode ends when any of these holds, i.e. contributes a non-zero score */
+  const search_predicate_t *done_predicates;
+  uint32_t done_count;
+} vec_env_params_t;
+
+/** Per environment state */
+typedef struct vec_env_instance_s
+{
+  cpu_state_t state;
+  int64_t score;
+  uint32_t episode_frames;
+} vec_env_instance_t;
+
+/** A batch of headless emulators running the same ROM */
+typedef struct vec_env_s
+{
+  vec_env_params_t params;
+
+  /** The ROM loaded into a machine that is never run; environments are reset from it */
+  cpu_state_t template_state;
+  vec_env_instance_t *instances;
+
+  /** Bytes of observation written per environment */
+  size_t obs_size;
+
+  /** Arguments of the batch being stepped, shared with the workers */
+  const uint16_t *actions;
+  uint8_t *observations;
+  float *rewards;
+  uint8_t *dones;
+  uint8_t resetting;
+  status_code_t status;
+
+  /** Worker pool; a batch is started by bumping generation and done once pending drops to 0 */
+  pthread_t workers[VEC_ENV_MAX_THREADS];
+  uint32_t worker_count;
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t finished;
+  uint64_t generation;
+  uint32_t next_env;
+  uint32_t pending;
+  uint8_t stopping;
+} vec_env_t;
+
+/**
+ * Load the ROM and create the environments and the worker threads.
+ * @param env - Pointer to the batch of environments to initialize.
+ * @param params - Pointer to the parameters; the predicates must outlive the batch.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t vec_env_init(vec_env_t *const env, const vec_env_params_t *params);
+
+/**
+ * Stop the worker threads and free the environments.
+ * @param env - Pointer to a batch of environments.
+ * @return None
+ */
+void vec_env_cleanup(vec_env_t *const env);
+
+/**
+ * Restart every environment and write their first observations.
+ * @param env - Pointer to a batch of environments.
+ * @param observations - Caller owned buffer of num_envs * obs_size bytes, written
+ *                       in place, one environment after another.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t vec_env_reset(vec_env_t *const env, uint8_t *const observations);
+
+/**
+ * Step every environment with its action: a keypad bitmask held for frame_skip frames.
+ * An environment whose episode ends is restarted at once, its observation being the
+ * first of the new episode.
+ * @param env - Pointer to a batch of environments.
+ * @param actions - One keypad bitmask per environment.
+ * @param observations - Caller owned buffer of num_envs * obs_size bytes.
+ * @param rewards - Caller owned buffer of num_envs rewards.
+ * @param dones - Caller owned buffer of num_envs flags, set for the episodes that ended.
+ * @return STATUS_OK if successful, otherwise appropriate error code.
+ */
+status_code_t vec_env_step(vec_env_t *const env, const uint16_t *actions, uint8_t *const observations,
+                           float *const rewards, uint8_t *const dones);
+
+#endif /* __VEC_ENV_H__ */
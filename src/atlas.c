@@ -0,0 +1,201 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "atlas.h"
+#include "atlas_canvas.h"
+#include "cpu_def.h"
+#include "display.h"
+#include "logging.h"
+#include "status_code.h"
+#include "trace.h"
+
+#define CELL_GAP (2) // Screen pixels of background between neighbouring cells
+
+status_code_t atlas_init(atlas_t *const atlas, const char *title, atlas_init_param_t *const param)
+{
+  Log_I("Initializing the texture atlas...");
+
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(atlas);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(title);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(param);
+
+  if (param->scale == 0)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(atlas, 0, sizeof(atlas_t));
+  atlas->scale = param->scale;
+
+  status_code_t status = atlas_canvas_init(&atlas->canvas, param->cells, param->columns, &param->colors);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  atlas_canvas_t *canvas = &atlas->canvas;
+  atlas->cell = malloc(sizeof(atlas_cell_t) * canvas->cells);
+  if (atlas->cell == NULL)
+  {
+    atlas_cleanup(atlas);
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  for (uint32_t i = 0; i < canvas->cells; i++)
+  {
+    atlas->cell[i] = (atlas_cell_t){.atlas = atlas, .index = i};
+  }
+
+  int16_t init_result;
+  if ((init_result = SDL_InitSubSystem(SDL_INIT_VIDEO)) != 0)
+  {
+    Log_E("Failed to inittialize SDL Video Subsystem (%d)", init_result);
+    atlas_cleanup(atlas);
+    return STATUS_ERR_GENERIC;
+  }
+  atlas->video_started = 1;
+
+  // Lets the renderer merge the copies of all cells into as few draw calls as it can
+  SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
+
+  atlas->window = SDL_CreateWindow(
+      title,
+      SDL_WINDOWPOS_CENTERED,
+      SDL_WINDOWPOS_CENTERED,
+      (canvas->columns * ((ATLAS_CELL_WIDTH * atlas->scale) + CELL_GAP)) + CELL_GAP,
+      (canvas->rows * ((ATLAS_CELL_HEIGHT * atlas->scale) + CELL_GAP)) + CELL_GAP,
+      0);
+
+  atlas->renderer = SDL_CreateRenderer(atlas->window, -1, SDL_RENDERER_ACCELERATED);
+  atlas->texture = SDL_CreateTexture(atlas->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                     canvas->width, canvas->height);
+  if ((atlas->window == NULL) || (atlas->renderer == NULL) || (atlas->texture == NULL))
+  {
+    Log_E("Failed to create the atlas window: %s", SDL_GetError());
+    atlas_cleanup(atlas);
+    return STATUS_ERR_GENERIC;
+  }
+
+  Log_I("Texture atlas of %u cells (%ux%u px) initialized.", canvas->cells, canvas->width, canvas->height);
+  return STATUS_OK;
+}
+
+/** Write a session's display into its cell; see atlas_canvas_draw */
+static status_code_t atlas_render(atlas_cell_t *const cell, graphics_t *const graphics)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(cell);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(graphics);
+  if (!graphics->display_update)
+  {
+    return STATUS_OK;
+  }
+
+  graphics->display_update = 0;
+  return atlas_canvas_draw(&cell->atlas->canvas, cell->index, graphics);
+}
+
+status_code_t atlas_present(atlas_t *const atlas)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(atlas);
+
+  atlas_canvas_t *canvas = &atlas->canvas;
+
+  if (canvas->dirty)
+  {
+    // One upload covering every row of cells that changed
+    SDL_Rect rect = {
+        .x = 0,
+        .y = canvas->dirty_first * ATLAS_CELL_HEIGHT,
+        .w = canvas->width,
+        .h = (canvas->dirty_last - canvas->dirty_first + 1) * ATLAS_CELL_HEIGHT,
+    };
+    uint32_t const *pixels = canvas->pixels + (rect.y * canvas->width);
+
+    TRACE_SPAN_BEGIN(upload_span);
+    int result = SDL_UpdateTexture(atlas->texture, &rect, pixels, canvas->width * sizeof(uint32_t));
+    TRACE_SPAN_END(upload_span, "SDL_UpdateTexture");
+    if (result != 0)
+    {
+      Log_E("Failed to update the atlas texture: %s", SDL_GetError());
+      return STATUS_ERR_GENERIC;
+    }
+    canvas->dirty = 0;
+  }
+
+  uint8_t r = (canvas->palette[0] >> 16) & 0xFF;
+  uint8_t g = (canvas->palette[0] >> 8) & 0xFF;
+  uint8_t b = canvas->palette[0] & 0xFF;
+
+  SDL_SetRenderDrawColor(atlas->renderer, r, g, b, 0xFF);
+  SDL_RenderClear(atlas->renderer);
+
+  for (uint32_t i = 0; i < canvas->cells; i++)
+  {
+    uint32_t column = i % canvas->columns;
+    uint32_t row = i / canvas->columns;
+    SDL_Rect source = {
+        .x = column * ATLAS_CELL_WIDTH,
+        .y = row * ATLAS_CELL_HEIGHT,
+        .w = ATLAS_CELL_WIDTH,
+        .h = ATLAS_CELL_HEIGHT,
+    };
+    SDL_Rect dest = {
+        .x = CELL_GAP + (column * ((ATLAS_CELL_WIDTH * atlas->scale) + CELL_GAP)),
+        .y = CELL_GAP + (row * ((ATLAS_CELL_HEIGHT * atlas->scale) + CELL_GAP)),
+        .w = ATLAS_CELL_WIDTH * atlas->scale,
+        .h = ATLAS_CELL_HEIGHT * atlas->scale,
+    };
+
+    SDL_RenderCopy(atlas->renderer, atlas->texture, &source, &dest);
+  }
+
+  TRACE_SPAN_BEGIN(present_span);
+  SDL_RenderPresent(atlas->renderer);
+  TRACE_SPAN_END(present_span, "SDL_RenderPresent");
+  return STATUS_OK;
+}
+
+void atlas_cleanup(atlas_t *const atlas)
+{
+  if (atlas == NULL)
+  {
+    return;
+  }
+
+  Log_I("Cleaning up the texture atlas.");
+  if (atlas->texture != NULL)
+  {
+    SDL_DestroyTexture(atlas->texture);
+  }
+  if (atlas->renderer != NULL)
+  {
+    SDL_DestroyRenderer(atlas->renderer);
+  }
+  if (atlas->window != NULL)
+  {
+    SDL_DestroyWindow(atlas->window);
+  }
+  atlas_canvas_cleanup(&atlas->canvas);
+  free(atlas->cell);
+
+  // Only what atlas_init brought up; an embedder may be using SDL video itself
+  if (atlas->video_started)
+  {
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+  }
+  memset(atlas, 0, sizeof(atlas_t));
+}
+
+/** Adapters of the video backend table */
+static status_code_t render_backend(void *const handle, graphics_t *const graphics)
+{
+  return atlas_render(handle, graphics);
+}
+
+static void cleanup_backend(void __attribute__((unused)) *const handle)
+{
+}
+
+const video_backend_t atlas_backend = {
+    .render = render_backend,
+    .cleanup = cleanup_backend,
+};
@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atlas_canvas.h"
+#include "cpu_def.h"
+#include "display.h"
+#include "status_code.h"
+
+static uint32_t argb(color_rgba_t const *const color)
+{
+  return ((uint32_t)color->a << 24) | ((uint32_t)color->r << 16) | ((uint32_t)color->g << 8) | color->b;
+}
+
+status_code_t atlas_canvas_init(atlas_canvas_t *const canvas, uint32_t const cells, uint32_t const columns,
+                                display_init_param_t const *const colors)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(canvas);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(colors);
+
+  if ((cells == 0) || (cells > ATLAS_MAX_CELLS) || (columns == 0))
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(canvas, 0, sizeof(atlas_canvas_t));
+  canvas->cells = cells;
+  canvas->columns = (columns > cells) ? cells : columns;
+  canvas->rows = (cells + canvas->columns - 1) / canvas->columns;
+  canvas->width = canvas->columns * ATLAS_CELL_WIDTH;
+  canvas->height = canvas->rows * ATLAS_CELL_HEIGHT;
+
+  canvas->palette[0] = argb(&colors->background_color);
+  canvas->palette[1] = argb(&colors->foreground_color);
+  canvas->palette[2] = argb(&colors->plane2_color);
+  canvas->palette[3] = argb(&colors->overlap_color);
+
+  canvas->pixels = malloc(sizeof(uint32_t) * canvas->width * canvas->height);
+  if (canvas->pixels == NULL)
+  {
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  for (uint32_t i = 0; i < (canvas->width * canvas->height); i++)
+  {
+    canvas->pixels[i] = canvas->palette[0];
+  }
+
+  // The whole texture starts out blank
+  canvas->dirty = 1;
+  canvas->dirty_first = 0;
+  canvas->dirty_last = canvas->rows - 1;
+
+  return STATUS_OK;
+}
+
+status_code_t atlas_canvas_draw(atlas_canvas_t *const canvas, uint32_t const index, graphics_t const *const graphics)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(canvas);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(graphics);
+
+  if (index >= canvas->cells)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  uint32_t cell_row = index / canvas->columns;
+  uint32_t *origin = canvas->pixels + (cell_row * ATLAS_CELL_HEIGHT * canvas->width) +
+                     ((index % canvas->columns) * ATLAS_CELL_WIDTH);
+  uint8_t scale = graphics->hires ? 1 : 2;
+
+  for (uint8_t y = 0; y < GRAPHICS_ACTIVE_HEIGHT(graphics); y++)
+  {
+    uint32_t *line = origin + ((uint32_t)y * scale * canvas->width);
+
+    for (uint8_t x = 0; x < GRAPHICS_ACTIVE_WIDTH(graphics); x++)
+    {
+      uint8_t shift = (GRAPHICS_WORD_BITS - 1) - (x % GRAPHICS_WORD_BITS);
+      uint8_t w = x / GRAPHICS_WORD_BITS;
+      uint8_t value = ((graphics->buffer[0][y][w] >> shift) & 1) | (((graphics->buffer[1][y][w] >> shift) & 1) << 1);
+      uint32_t color = canvas->palette[value];
+
+      line[x * scale] = color;
+      if (scale == 2)
+      {
+        line[(x * 2) + 1] = color;
+      }
+    }
+
+    if (scale == 2)
+    {
+      memcpy(line + canvas->width, line, sizeof(uint32_t) * ATLAS_CELL_WIDTH);
+    }
+  }
+
+  if (!canvas->dirty)
+  {
+    canvas->dirty_first = cell_row;
+    canvas->dirty_last = cell_row;
+    canvas->dirty = 1;
+  }
+  canvas->dirty_first = (cell_row < canvas->dirty_first) ? cell_row : canvas->dirty_first;
+  canvas->dirty_last = (cell_row > canvas->dirty_last) ? cell_row : canvas->dirty_last;
+
+  return STATUS_OK;
+}
+
+void atlas_canvas_cleanup(atlas_canvas_t *const canvas)
+{
+  if (canvas == NULL)
+  {
+    return;
+  }
+
+  free(canvas->pixels);
+  memset(canvas, 0, sizeof(atlas_canvas_t));
+}
@@ -1,40 +1,60 @@
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <SDL2/SDL.h>
 
 #include "audio.h"
+#include "cpu_def.h"
 #include "logging.h"
 #include "status_code.h"
+#include "trace.h"
 
 /**
- * Data structure definition to keep track
- * of the audio module's internal state
+ * Helper function to populate the audio output buffer with the XO-CHIP audio pattern.
+ * Each bit of the 128-bit pattern is one 1-bit sample, played back MSB first at the
+ * rate set by the pattern pitch.
  */
-typedef struct audio_handle_s
+static void audio_fill_pattern(audio_t *const audio, int16_t *const int16_buf, int const count)
 {
-  SDL_AudioDeviceID audio_device;
-  uint32_t sample_freq_hz;
-  uint32_t tone_freq_hz;
-} audio_handle_t;
+  uint16_t const pattern_bits = AUDIO_PATTERN_SIZE * 8;
 
-static audio_handle_t audio_handle;
+  for (int i = 0; i < count; i++)
+  {
+    uint16_t bit = (uint16_t)audio->pattern_phase;
+    uint8_t level = (audio->pattern[bit / 8] >> (7 - (bit % 8))) & 0x1;
+
+    int16_buf[i] = level ? DEFAULT_VOLUME : -DEFAULT_VOLUME;
+
+    audio->pattern_phase += audio->pattern_step;
+    while (audio->pattern_phase >= pattern_bits)
+    {
+      audio->pattern_phase -= pattern_bits;
+    }
+  }
+}
 
 /**
  * Handler function to populate SDL's audio output buffer with audio samples. In this case,
- * the buffer will be populated with triangular wave samples.
- * @param userdata - Pointer to custom user data (unused)
+ * the buffer will be populated with triangular wave samples, or with the XO-CHIP audio
+ * pattern once one has been loaded.
+ * @param audio - The audio output the callback was registered by
  * @param audio_buffer - Audio output buffer provided by SDL
  * @param len - Number of samples requested by SDL
  * @return - None
  */
-static void audio_callback(void __attribute__((unused)) * userdata, uint8_t *audio_buffer, int len)
+static void audio_generate(audio_t *const audio, uint8_t *audio_buffer, int len)
 {
-  static uint32_t sample_num = 0;
-
   int32_t output;
-  int32_t samples_per_period = audio_handle.sample_freq_hz / audio_handle.tone_freq_hz;
+  int32_t samples_per_period = audio->sample_freq_hz / audio->tone_freq_hz;
   int16_t* int16_buf = (int16_t*)audio_buffer;
 
+  if (audio->pattern_loaded)
+  {
+    audio_fill_pattern(audio, int16_buf, len / 2);
+    return;
+  }
+
   /**
    * Generate samples of a triangular wave and fill the audio output buffer with them.
    * One period of the triangular wave is based on the scaled and shifted version of
@@ -65,24 +85,29 @@ static void audio_callback(void __attribute__((unused)) * userdata, uint8_t *aud
    */
   for (int i = 0; i < len/2; i++)
   {
-    output = 4 * DEFAULT_VOLUME * sample_num / samples_per_period;
+    output = 4 * DEFAULT_VOLUME * audio->sample_num / samples_per_period;
     output = abs(output - (2 * DEFAULT_VOLUME)) - DEFAULT_VOLUME;
     int16_buf[i] = (int16_t)output;
-    sample_num++;
-    sample_num %= samples_per_period;
+    audio->sample_num++;
+    audio->sample_num %= samples_per_period;
   }
 }
 
-status_code_t audio_init(audio_init_param_t *const param)
+/** SDL audio callback; wraps audio_generate in a trace span */
+static void audio_callback(void *userdata, uint8_t *audio_buffer, int len)
 {
-  Log_I("Initializing the audio module...");
-
-  VERIFY_PTR_RETURN_ERROR_IF_NULL(param);
+  TRACE_SPAN_BEGIN(audio_span);
+  audio_generate((audio_t *)userdata, audio_buffer, len);
+  TRACE_SPAN_END(audio_span, "audio_callback");
+}
 
-  if ((param->sample_freq_hz == 0) || (param->tone_freq_hz == 0))
-  {
-    return STATUS_ERR_MATH_DIV_0;
-  }
+/**
+ * Helper function to bring up the SDL audio subsystem and open the output device.
+ * On failure everything opened so far is released again, leaving audio_device at 0.
+ */
+static status_code_t audio_open(audio_t *const audio)
+{
+  Log_I("Opening the audio device...");
 
   int16_t init_result;
   if ((init_result = SDL_InitSubSystem(SDL_INIT_AUDIO)) != 0)
@@ -92,72 +117,161 @@ status_code_t audio_init(audio_init_param_t *const param)
   }
 
   SDL_AudioSpec desired_spec = (SDL_AudioSpec){
-      .freq = param->sample_freq_hz,
+      .freq = audio->sample_freq_hz,
       .format = AUDIO_S16LSB,
       .channels = 1,
       .samples = 512,
       .callback = audio_callback,
-      .userdata = NULL,
+      .userdata = audio,
   };
 
   SDL_AudioSpec obtained_spec;
 
-  audio_handle.audio_device = SDL_OpenAudioDevice(NULL, 0, &desired_spec, &obtained_spec, 0);
-  audio_handle.sample_freq_hz = param->sample_freq_hz;
-  audio_handle.tone_freq_hz = param->tone_freq_hz;
+  // SDL converts to the format and channels asked for, but taking the device's own rate and
+  // buffer size avoids resampling; the tone and pattern are generated at whatever rate it runs
+  audio->audio_device = SDL_OpenAudioDevice(NULL, 0, &desired_spec, &obtained_spec,
+                                            SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
 
-  if (audio_handle.audio_device == 0)
+  if ((audio->audio_device == 0) || (obtained_spec.freq <= 0))
   {
     Log_E("Failed to open audio device.");
+    if (audio->audio_device != 0)
+    {
+      SDL_CloseAudioDevice(audio->audio_device);
+      audio->audio_device = 0;
+    }
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
     return STATUS_ERR_GENERIC;
   }
 
-  status_code_t status = STATUS_OK;
+  if ((desired_spec.freq != obtained_spec.freq) || (desired_spec.samples != obtained_spec.samples))
+  {
+    Log_I("Audio device runs at %d Hz with %d samples per buffer", obtained_spec.freq, obtained_spec.samples);
+  }
+
+  // The device starts paused, so the callback doesn't run yet
+  audio->sample_freq_hz = (uint32_t)obtained_spec.freq;
+  audio->sample_num = 0;
+  audio->pattern_step = audio->pattern_rate_hz / audio->sample_freq_hz;
+
+  Log_I("Audio device successfully opened.");
+  return STATUS_OK;
+}
+
+status_code_t audio_init(audio_t *const audio, audio_init_param_t *const param)
+{
+  Log_I("Initializing the audio module...");
+
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(audio);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(param);
+
+  if ((param->sample_freq_hz == 0) || (param->tone_freq_hz == 0))
+  {
+    return STATUS_ERR_MATH_DIV_0;
+  }
+
+  // Many ROMs never beep; the device is opened by the first audio_play_beep
+  audio->audio_device = 0;
+  audio->open_failed = 0;
+  audio->sample_freq_hz = param->sample_freq_hz;
+  audio->tone_freq_hz = param->tone_freq_hz;
+
+  Log_I("Audio module successfully initialized.");
+  return STATUS_OK;
+}
+
+void audio_set_pattern(audio_t *const audio, uint8_t const *const pattern, uint8_t const pitch)
+{
+  if ((audio == NULL) || (pattern == NULL) || (audio->sample_freq_hz == 0))
+  {
+    return;
+  }
+
+  // Playback rate in bits per second: 4000 * 2 ^ ((pitch - 64) / 48)
+  double playback_rate_hz = 4000.0 * pow(2.0, ((double)pitch - 64.0) / 48.0);
+
+  // Until the device is opened there is no callback to race with
+  if (audio->audio_device != 0)
+  {
+    SDL_LockAudioDevice(audio->audio_device);
+  }
+  memcpy(audio->pattern, pattern, AUDIO_PATTERN_SIZE);
+  audio->pattern_rate_hz = playback_rate_hz;
+  audio->pattern_step = playback_rate_hz / audio->sample_freq_hz;
+  audio->pattern_loaded = 1;
+  if (audio->audio_device != 0)
+  {
+    SDL_UnlockAudioDevice(audio->audio_device);
+  }
+}
 
-  if (desired_spec.freq != obtained_spec.freq)
+void audio_play_beep(audio_t *const audio)
+{
+  if ((audio->audio_device == 0) && !audio->open_failed)
   {
-    Log_E("Failed to obtain the desired audio sample rate. Desired: %d Hz; obtained: %d Hz", desired_spec.freq, obtained_spec.freq);
-    status = STATUS_ERR_GENERIC;
+    if (audio_open(audio) != STATUS_OK)
+    {
+      Log_W("No audio device available; continuing without sound.");
+      audio->open_failed = 1;
+    }
   }
 
-  if (desired_spec.format != obtained_spec.format)
+  if (audio->audio_device != 0)
   {
-    Log_E("Failed to obtain the desired audio format. Desired: 0x%04X; obtained: 0x%04X", desired_spec.format, obtained_spec.format);
-    status = STATUS_ERR_GENERIC;
+    SDL_PauseAudioDevice(audio->audio_device, 0);
   }
+}
 
-  if (desired_spec.channels != obtained_spec.channels)
+void audio_mute(audio_t *const audio)
+{
+  if (audio->audio_device != 0)
   {
-    Log_E("Failed to obtain the desired number of audio channels. Desired: %d; obtained: %d", desired_spec.channels, obtained_spec.channels);
-    status = STATUS_ERR_GENERIC;
+    SDL_PauseAudioDevice(audio->audio_device, 1);
   }
+}
 
-  if (desired_spec.samples != obtained_spec.samples)
+void audio_cleanup(audio_t *const audio)
+{
+  if (audio == NULL)
   {
-    Log_E("Failed to obtain the desired number of audio samples. Desired: %d; obtained: %d", desired_spec.samples, obtained_spec.samples);
-    status = STATUS_ERR_GENERIC;
+    return;
   }
 
-  if (status == STATUS_OK)
+  Log_I("Cleaning up the audio module.");
+  if (audio->audio_device != 0)
   {
-    Log_I("Audio module successfully initialized.");
+    SDL_CloseAudioDevice(audio->audio_device);
+    audio->audio_device = 0;
+
+    // The subsystem is only held while the device is open
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
   }
+}
 
-  return status;
+/** Adapters of the audio backend table */
+static void set_pattern_backend(void *const handle, uint8_t const *const pattern, uint8_t const pitch)
+{
+  audio_set_pattern(handle, pattern, pitch);
 }
 
-void audio_play_beep()
+static void play_beep_backend(void *const handle)
 {
-  SDL_PauseAudioDevice(audio_handle.audio_device, 0);
+  audio_play_beep(handle);
 }
 
-void audio_mute()
+static void mute_backend(void *const handle)
 {
-  SDL_PauseAudioDevice(audio_handle.audio_device, 1);
+  audio_mute(handle);
 }
 
-void audio_cleanup()
+static void cleanup_backend(void *const handle)
 {
-  Log_I("Cleaning up the audio module.");
-  SDL_CloseAudioDevice(audio_handle.audio_device);
+  audio_cleanup(handle);
 }
+
+const audio_backend_t audio_sdl_backend = {
+    .set_pattern = set_pattern_backend,
+    .play_beep = play_beep_backend,
+    .mute = mute_backend,
+    .cleanup = cleanup_backend,
+};
@@ -8,6 +8,8 @@
 #include "chip8.h"
 #include "cpu_def.h"
 #include "status_code.h"
+#include "logging.h"
+#include "exec_trace.h"
 
 #define DECODE_X(opcode) ((opcode >> 8) & 0xF)
 #define DECODE_Y(opcode) ((opcode >> 4) & 0xF)
@@ -18,53 +20,192 @@
 #define KEY_MASK(index) (1 << (index & 0xF))
 #define KEY_PRESSED(key_state_ptr, index) (((key_state_ptr)->current & KEY_MASK(index)) ? 1 : 0)
 
-status_code_t fetch(cpu_state_t *const state, uint16_t *const opcode);
-status_code_t mem_read(cpu_state_t *const state, const uint16_t address, uint8_t *const dest, const size_t size);
-status_code_t mem_write(cpu_state_t *const state, const uint16_t address, uint8_t *const source, const size_t size);
-
-status_code_t op_table_0(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_table_8(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_table_E(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_table_F(uint16_t const opcode, cpu_state_t *const state);
-
-status_code_t op_00E0(uint16_t const opcode, cpu_state_t *const state);
+/**
+ * Quirk flags. Handlers that behave differently between interpreters take
+ * these as a compile-time constant so each profile's table is specialised
+ * and the unused branches are folded away.
+ */
+#define QUIRK_VF_RESET (1 << 0)        // 8XY1/8XY2/8XY3 reset V[F] to 0
+#define QUIRK_SHIFT_VY (1 << 1)        // 8XY6/8XYE shift V[Y] into V[X] instead of V[X] in place
+#define QUIRK_MEM_INCREMENT_I (1 << 2) // FX55/FX65 leave I pointing past the last register accessed
+#define QUIRK_CLIP_SPRITES (1 << 3)    // DXYN clips sprites at the screen edges instead of wrapping
+#define QUIRK_JUMP_VX (1 << 4)         // BXNN jumps to XNN + V[X] instead of NNN + V[0]
+#define QUIRK_SCHIP_OPCODES (1 << 5)   // 00CN, 00FB-00FF, DXY0, FX30, FX75 and FX85 are available
+#define QUIRK_XO_CHIP_OPCODES (1 << 6) // 64K memory, bit-planes, 5XY2, 5XY3, F000, FN01, F002 and FX3A
+#define QUIRK_DISPLAY_WAIT (1 << 7)    // DXYN waits for the vertical blank, ending the frame's instructions
+
+#define QUIRKS_NONE (0)
+#define QUIRKS_CHIP8 (QUIRK_VF_RESET | QUIRK_CLIP_SPRITES)
+#define QUIRKS_SUPER_CHIP (QUIRK_CLIP_SPRITES | QUIRK_JUMP_VX | QUIRK_SCHIP_OPCODES)
+#define QUIRKS_XO_CHIP (QUIRK_SHIFT_VY | QUIRK_MEM_INCREMENT_I | QUIRK_SCHIP_OPCODES | QUIRK_XO_CHIP_OPCODES)
+#define QUIRKS_COSMAC_VIP (QUIRK_VF_RESET | QUIRK_SHIFT_VY | QUIRK_MEM_INCREMENT_I | QUIRK_CLIP_SPRITES | QUIRK_DISPLAY_WAIT)
+
+#define QUIRK_TEMPLATE static inline __attribute__((always_inline))
+
+#define MEM_LIMIT(quirks) (((quirks) & QUIRK_XO_CHIP_OPCODES) ? XO_MEM_SIZE : MEM_SIZE)
+#define MEM_ADDRESS(address, quirks) ((address) & (MEM_LIMIT(quirks) - 1))
+
+#define FNV_OFFSET_BASIS (0xCBF29CE484222325ULL)
+#define FNV_PRIME (0x100000001B3ULL)
+
+#define FONT_ADDRESS (0x0000)
+#define FONT_HIRES_ADDRESS (0x0050)
+#define SCROLL_PIXELS (4) // Horizontal distance scrolled by 00FB and 00FC
+#define RANDOM_DEFAULT_SEED (0x9E3779B9) // Used in place of 0, from which xorshift32 would only ever produce 0
+
+QUIRK_TEMPLATE status_code_t fetch(cpu_state_t *const state, uint16_t *const opcode, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t mem_read(cpu_state_t *const state, const uint16_t address, uint8_t *const dest, const size_t size, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t mem_write(cpu_state_t *const state, const uint16_t address, const uint8_t *const source, const size_t size, uint32_t const quirks);
+QUIRK_TEMPLATE void skip_next(cpu_state_t *const state, uint32_t const quirks);
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t const size);
+static inline uint64_t hash_position(uint32_t const position, uint64_t const value);
+static inline uint64_t hash_mix(uint64_t z);
+static void rehash_memory(cpu_state_t *const state);
+static void rehash_graphics(cpu_state_t *const state);
+static void rewrite_planes(cpu_state_t *const state, uint8_t const planes);
+static void mark_pages_dirty(cpu_state_t *const state, uint32_t const address, size_t const size);
+static uint32_t vip_cycles(cpu_state_t *const state, uint16_t const opcode);
+
+QUIRK_TEMPLATE status_code_t op_table_0(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_table_5(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_table_8(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_table_E(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_table_F(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+
+QUIRK_TEMPLATE status_code_t op_00CN(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_00E0(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
 status_code_t op_00EE(uint16_t const opcode, cpu_state_t *const state);
+QUIRK_TEMPLATE status_code_t op_00FB(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_00FC(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+status_code_t op_00FD(uint16_t const opcode, cpu_state_t *const state);
+status_code_t op_00FE(uint16_t const opcode, cpu_state_t *const state);
+status_code_t op_00FF(uint16_t const opcode, cpu_state_t *const state);
 status_code_t op_1NNN(uint16_t const opcode, cpu_state_t *const state);
 status_code_t op_2NNN(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_3XNN(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_4XNN(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_5XY0(uint16_t const opcode, cpu_state_t *const state);
+QUIRK_TEMPLATE status_code_t op_3XNN(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_4XNN(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_5XY0(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_5XY2(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_5XY3(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
 status_code_t op_6XNN(uint16_t const opcode, cpu_state_t *const state);
 status_code_t op_7XNN(uint16_t const opcode, cpu_state_t *const state);
 status_code_t op_8XY0(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_8XY1(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_8XY2(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_8XY3(uint16_t const opcode, cpu_state_t *const state);
+QUIRK_TEMPLATE status_code_t op_8XY1(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_8XY2(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_8XY3(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
 status_code_t op_8XY4(uint16_t const opcode, cpu_state_t *const state);
 status_code_t op_8XY5(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_8X06(uint16_t const opcode, cpu_state_t *const state);
+QUIRK_TEMPLATE status_code_t op_8X06(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
 status_code_t op_8XY7(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_8X0E(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_9XY0(uint16_t const opcode, cpu_state_t *const state);
+QUIRK_TEMPLATE status_code_t op_8X0E(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_9XY0(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
 status_code_t op_ANNN(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_BNNN(uint16_t const opcode, cpu_state_t *const state);
+QUIRK_TEMPLATE status_code_t op_BNNN(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
 status_code_t op_CXNN(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_DXYN(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_EX9E(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_EXA1(uint16_t const opcode, cpu_state_t *const state);
+QUIRK_TEMPLATE status_code_t op_DXYN(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_EX9E(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_EXA1(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_F000(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+status_code_t op_FN01(uint16_t const opcode, cpu_state_t *const state);
+QUIRK_TEMPLATE status_code_t op_F002(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
 status_code_t op_FX07(uint16_t const opcode, cpu_state_t *const state);
 status_code_t op_FX0A(uint16_t const opcode, cpu_state_t *const state);
 status_code_t op_FX15(uint16_t const opcode, cpu_state_t *const state);
 status_code_t op_FX18(uint16_t const opcode, cpu_state_t *const state);
 status_code_t op_FX1E(uint16_t const opcode, cpu_state_t *const state);
 status_code_t op_FX29(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_FX33(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_FX55(uint16_t const opcode, cpu_state_t *const state);
-status_code_t op_FX65(uint16_t const opcode, cpu_state_t *const state);
+status_code_t op_FX30(uint16_t const opcode, cpu_state_t *const state);
+QUIRK_TEMPLATE status_code_t op_FX33(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+status_code_t op_FX3A(uint16_t const opcode, cpu_state_t *const state);
+QUIRK_TEMPLATE status_code_t op_FX55(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+QUIRK_TEMPLATE status_code_t op_FX65(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks);
+status_code_t op_FX75(uint16_t const opcode, cpu_state_t *const state);
+status_code_t op_FX85(uint16_t const opcode, cpu_state_t *const state);
 
 typedef status_code_t (*opcode_handler_fn)(uint16_t const opcode, cpu_state_t *const state);
+typedef status_code_t (*instruction_step_fn)(cpu_state_t *const state);
 
-uint8_t fontset[80] = {
+/** Instantiates a handler template with a profile's quirks */
+#define QUIRK_WRAPPER(name, handler, quirks)                                             \
+  static status_code_t name##_##handler(uint16_t const opcode, cpu_state_t *const state) \
+  {                                                                                      \
+    return handler(opcode, state, (quirks));                                             \
+  }
+
+/**
+ * Generates the opcode table of a quirk profile, and the function that fetches
+ * and executes one instruction with it. The entries whose behaviour depends on
+ * quirks are instantiated with the profile's quirks; the rest are shared
+ * between all profiles.
+ */
+#define DEFINE_QUIRK_PROFILE(name, quirks)                            \
+  QUIRK_WRAPPER(name, op_table_0, quirks)                             \
+  QUIRK_WRAPPER(name, op_3XNN, quirks)                                \
+  QUIRK_WRAPPER(name, op_4XNN, quirks)                                \
+  QUIRK_WRAPPER(name, op_table_5, quirks)                             \
+  QUIRK_WRAPPER(name, op_table_8, quirks)                             \
+  QUIRK_WRAPPER(name, op_9XY0, quirks)                                \
+  QUIRK_WRAPPER(name, op_BNNN, quirks)                                \
+  QUIRK_WRAPPER(name, op_DXYN, quirks)                                \
+  QUIRK_WRAPPER(name, op_table_E, quirks)                             \
+  QUIRK_WRAPPER(name, op_table_F, quirks)                             \
+  static const opcode_handler_fn name##_op_table[16] = {              \
+      name##_op_table_0, op_1NNN, op_2NNN, name##_op_3XNN,            \
+      name##_op_4XNN, name##_op_table_5, op_6XNN, op_7XNN,            \
+      name##_op_table_8, name##_op_9XY0, op_ANNN, name##_op_BNNN,     \
+      op_CXNN, name##_op_DXYN, name##_op_table_E, name##_op_table_F}; \
+  static status_code_t name##_step(cpu_state_t *const state)          \
+  {                                                                   \
+    uint16_t opcode;                                                  \
+    status_code_t status = fetch(state, &opcode, (quirks));           \
+    RETURN_STATUS_IF_NOT_OK(status);                                  \
+    Log_T("%03X: %04X", state->registers.pc - 2, opcode);             \
+    return name##_op_table[((opcode >> 12) & 0xF)](opcode, state);    \
+  }
+
+DEFINE_QUIRK_PROFILE(chip8, QUIRKS_CHIP8)
+DEFINE_QUIRK_PROFILE(super_chip, QUIRKS_SUPER_CHIP)
+DEFINE_QUIRK_PROFILE(xo_chip, QUIRKS_XO_CHIP)
+DEFINE_QUIRK_PROFILE(cosmac_vip, QUIRKS_COSMAC_VIP)
+
+/** Fetch + decode + execute functions indexed by quirk_profile_t */
+static const instruction_step_fn profile_steps[QUIRK_PROFILE_COUNT] = {
+    [QUIRK_PROFILE_CHIP8] = chip8_step,
+    [QUIRK_PROFILE_SUPER_CHIP] = super_chip_step,
+    [QUIRK_PROFILE_XO_CHIP] = xo_chip_step,
+    [QUIRK_PROFILE_COSMAC_VIP] = cosmac_vip_step,
+};
+
+/** Quirks of each profile, indexed by quirk_profile_t */
+static const uint32_t profile_quirks[QUIRK_PROFILE_COUNT] = {
+    [QUIRK_PROFILE_CHIP8] = QUIRKS_CHIP8,
+    [QUIRK_PROFILE_SUPER_CHIP] = QUIRKS_SUPER_CHIP,
+    [QUIRK_PROFILE_XO_CHIP] = QUIRKS_XO_CHIP,
+    [QUIRK_PROFILE_COSMAC_VIP] = QUIRKS_COSMAC_VIP,
+};
+
+/** Command line names of each profile, indexed by quirk_profile_t */
+static const char *const profile_names[QUIRK_PROFILE_COUNT] = {
+    [QUIRK_PROFILE_CHIP8] = "chip8",
+    [QUIRK_PROFILE_SUPER_CHIP] = "schip",
+    [QUIRK_PROFILE_XO_CHIP] = "xochip",
+    [QUIRK_PROFILE_COSMAC_VIP] = "vip",
+};
+
+/** Command line names of each timing mode, indexed by timing_mode_t */
+static const char *const timing_mode_names[TIMING_MODE_COUNT] = {
+    [TIMING_UNIFORM] = "uniform",
+    [TIMING_VIP] = "vip",
+};
+
+/**
+ * The reference core: the same handlers, but looking the quirks up at run time
+ * instead of being specialised per profile. Slower, and kept as simple as
+ * possible so the specialised tables can be checked against it.
+ */
+DEFINE_QUIRK_PROFILE(reference, profile_quirks[state->quirk_profile])
+
+static const uint8_t fontset[80] = {
     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
     0x20, 0x60, 0x20, 0x20, 0x70, // 1
     0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
@@ -83,20 +224,64 @@ uint8_t fontset[80] = {
     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+/** SUPER-CHIP 8x10 px digits, with the A-F glyphs added by XO-CHIP */
+static const uint8_t fontset_hires[160] = {
+    0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+    0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+    0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+    0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+    0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+    0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+    0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
 status_code_t init_cpu(cpu_state_t *const state)
 {
   VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
 
   status_code_t status = STATUS_OK;
 
-  srand((uint16_t)time(NULL));
   memset(state, 0, sizeof(cpu_state_t));
+  seed_random(state, (uint32_t)hash_mix(((uint64_t)time(NULL) << 32) ^ (uintptr_t)state));
   state->registers.pc = START_ADDRESS;
-  status = mem_write(state, 0, fontset, sizeof(fontset));
+  state->peripherals.graphics.plane_mask = 0x1;
+  state->peripherals.audio.pitch = AUDIO_PATTERN_DEFAULT_PITCH;
+  status = mem_write(state, FONT_ADDRESS, fontset, sizeof(fontset), QUIRKS_NONE);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  status = mem_write(state, FONT_HIRES_ADDRESS, fontset_hires, sizeof(fontset_hires), QUIRKS_NONE);
 
   return status;
 }
 
+void cleanup_cpu(cpu_state_t *const state)
+{
+  if (state == NULL)
+  {
+    return;
+  }
+
+  free(state->xo_memory);
+  state->xo_memory = NULL;
+}
+
+status_code_t seed_random(cpu_state_t *const state, uint32_t const seed)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  state->random = seed ? seed : RANDOM_DEFAULT_SEED;
+  return STATUS_OK;
+}
+
 status_code_t load_rom(cpu_state_t *const state, const char *file)
 {
   VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
@@ -113,10 +298,17 @@ status_code_t load_rom(cpu_state_t *const state, const char *file)
   stat(file, &st);
   size_t fsize = st.st_size;
 
-  size_t bytes_read = fread(state->memory + START_ADDRESS, 1, sizeof(state->memory) - START_ADDRESS, fp);
+  uint8_t *memory = NULL;
+  size_t mem_size = 0;
+  get_memory(state, &memory, &mem_size);
+
+  size_t bytes_read = fread(memory + START_ADDRESS, 1, mem_size - START_ADDRESS, fp);
 
   fclose(fp);
 
+  mark_pages_dirty(state, START_ADDRESS, bytes_read);
+  rehash_memory(state);
+
   if (bytes_read != fsize)
   {
     return STATUS_ERR_NO_MEMORY;
@@ -125,32 +317,503 @@ status_code_t load_rom(cpu_state_t *const state, const char *file)
   return STATUS_OK;
 }
 
-status_code_t emulation_cycle(cpu_state_t *const state)
+status_code_t load_rom_data(cpu_state_t *const state, const uint8_t *data, size_t const size)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(data);
+
+  uint8_t *memory = NULL;
+  size_t mem_size = 0;
+  get_memory(state, &memory, &mem_size);
+
+  if (size > (mem_size - START_ADDRESS))
+  {
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  // Update the hash for just the bytes loaded, a ROM being much smaller than memory
+  for (size_t i = 0; i < size; i++)
+  {
+    uint32_t position = START_ADDRESS + i;
+    state->hash.memory ^= hash_position(position, memory[position]) ^ hash_position(position, data[i]);
+  }
+
+  memcpy(memory + START_ADDRESS, data, size);
+  mark_pages_dirty(state, START_ADDRESS, size);
+
+  return STATUS_OK;
+}
+
+status_code_t set_quirk_profile(cpu_state_t *const state, quirk_profile_t const profile)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  if (profile >= QUIRK_PROFILE_COUNT)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  if ((profile == QUIRK_PROFILE_XO_CHIP) && (state->xo_memory == NULL))
+  {
+    state->xo_memory = calloc(XO_MEM_SIZE + MEM_GUARD_SIZE, 1);
+    if (state->xo_memory == NULL)
+    {
+      return STATUS_ERR_NO_MEMORY;
+    }
+
+    memcpy(state->xo_memory, state->memory, MEM_SIZE);
+    state->peripherals.graphics.plane_mask = 0x1;
+  }
+  else if ((profile != QUIRK_PROFILE_XO_CHIP) && (state->xo_memory != NULL))
+  {
+    memcpy(state->memory, state->xo_memory, MEM_SIZE);
+    cleanup_cpu(state);
+  }
+
+  uint8_t *memory;
+  size_t size;
+  get_memory(state, &memory, &size);
+
+  state->quirk_profile = profile;
+  mark_pages_dirty(state, 0, size + MEM_GUARD_SIZE);
+  rehash_memory(state);
+  return STATUS_OK;
+}
+
+status_code_t get_memory(cpu_state_t *const state, uint8_t **const memory, size_t *const size)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(memory);
+
+  *memory = (state->xo_memory != NULL) ? state->xo_memory : state->memory;
+
+  if (size != NULL)
+  {
+    *size = (state->xo_memory != NULL) ? XO_MEM_SIZE : MEM_SIZE;
+  }
+
+  return STATUS_OK;
+}
+
+status_code_t chip8_state_hash(cpu_state_t *const state, uint64_t *const hash)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(hash);
+
+  registers_t const *reg = &state->registers;
+  graphics_t const *gfx = &state->peripherals.graphics;
+  audio_pattern_t const *audio = &state->peripherals.audio;
+
+  // The small parts of the state are cheaper to hash on demand than to track
+  uint64_t h = FNV_OFFSET_BASIS;
+  h = hash_bytes(h, &state->hash.memory, sizeof(state->hash.memory));
+  h = hash_bytes(h, &state->hash.graphics, sizeof(state->hash.graphics));
+  h = hash_bytes(h, &reg->sp, sizeof(reg->sp));
+  h = hash_bytes(h, &reg->pc, sizeof(reg->pc));
+  h = hash_bytes(h, &reg->I, sizeof(reg->I));
+  h = hash_bytes(h, reg->V, sizeof(reg->V));
+  h = hash_bytes(h, reg->stack, sizeof(reg->stack));
+  h = hash_bytes(h, reg->rpl, sizeof(reg->rpl));
+  h = hash_bytes(h, &state->timers.delay, sizeof(state->timers.delay));
+  h = hash_bytes(h, &state->timers.sound, sizeof(state->timers.sound));
+  h = hash_bytes(h, &gfx->plane_mask, sizeof(gfx->plane_mask));
+  h = hash_bytes(h, &gfx->hires, sizeof(gfx->hires));
+  h = hash_bytes(h, audio->buffer, sizeof(audio->buffer));
+  h = hash_bytes(h, &audio->pitch, sizeof(audio->pitch));
+  h = hash_bytes(h, &state->random, sizeof(state->random));
+
+  *hash = h;
+  return STATUS_OK;
+}
+
+status_code_t chip8_state_rehash(cpu_state_t *const state)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  rehash_memory(state);
+  rehash_graphics(state);
+  return STATUS_OK;
+}
+
+status_code_t chip8_clone(cpu_state_t *const clone, cpu_state_t *const state)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(clone);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  uint8_t *xo_memory = clone->xo_memory;
+
+  if ((state->xo_memory != NULL) && (xo_memory == NULL))
+  {
+    xo_memory = malloc(XO_MEM_SIZE + MEM_GUARD_SIZE);
+    if (xo_memory == NULL)
+    {
+      return STATUS_ERR_NO_MEMORY;
+    }
+  }
+  else if ((state->xo_memory == NULL) && (xo_memory != NULL))
+  {
+    free(xo_memory);
+    xo_memory = NULL;
+  }
+
+  memcpy(clone, state, sizeof(cpu_state_t));
+  clone->xo_memory = xo_memory;
+  clone->exec_trace = NULL;
+
+  if (xo_memory != NULL)
+  {
+    memcpy(xo_memory, state->xo_memory, XO_MEM_SIZE + MEM_GUARD_SIZE);
+  }
+
+  return STATUS_OK;
+}
+
+status_code_t chip8_snapshot(cpu_state_t *const snapshot, cpu_state_t *const state)
+{
+  status_code_t status = chip8_clone(snapshot, state);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  memset(&snapshot->dirty, 0, sizeof(dirty_t));
+  memset(&state->dirty, 0, sizeof(dirty_t));
+  return STATUS_OK;
+}
+
+/**
+ * Helper function to copy the parts of a machine changed since it was last in sync with
+ * another, as recorded in its dirty bitmaps: the memory pages and framebuffer rows, and
+ * all of the registers and other small state.
+ */
+static void copy_changes(cpu_state_t *const dest, cpu_state_t *const src, dirty_t const *const dirty)
+{
+  uint8_t *dest_memory, *src_memory;
+  size_t size;
+  get_memory(dest, &dest_memory, NULL);
+  get_memory(src, &src_memory, &size);
+
+  // Pages past the memory in use, e.g. of the 64K memory on a 4K machine, have nothing to copy
+  size_t const limit = size + MEM_GUARD_SIZE;
+
+  for (uint32_t w = 0; w < (sizeof(dirty->pages) / sizeof(uint64_t)); w++)
+  {
+    for (uint64_t pages = dirty->pages[w]; pages != 0; pages &= pages - 1)
+    {
+      size_t offset = ((w * 64) + __builtin_ctzll(pages)) * MEM_PAGE_SIZE;
+      if (offset < limit)
+      {
+        memcpy(dest_memory + offset, src_memory + offset, MEM_PAGE_SIZE);
+      }
+    }
+  }
+
+  graphics_t *dest_gfx = &dest->peripherals.graphics;
+  graphics_t const *src_gfx = &src->peripherals.graphics;
+
+  for (uint8_t plane = 0; plane < GRAPHICS_PLANES; plane++)
+  {
+    for (uint64_t rows = dirty->rows[plane]; rows != 0; rows &= rows - 1)
+    {
+      uint8_t row = __builtin_ctzll(rows);
+      memcpy(dest_gfx->buffer[plane][row], src_gfx->buffer[plane][row], sizeof(dest_gfx->buffer[plane][row]));
+    }
+  }
+
+  dest_gfx->plane_mask = src_gfx->plane_mask;
+  dest_gfx->hires = src_gfx->hires;
+
+  dest->registers = src->registers;
+  dest->timers = src->timers;
+  dest->peripherals.keypad = src->peripherals.keypad;
+  dest->peripherals.audio = src->peripherals.audio;
+  dest->quirk_profile = src->quirk_profile;
+  dest->random = src->random;
+  dest->vblank_wait = src->vblank_wait;
+  dest->hash = src->hash;
+}
+
+status_code_t chip8_restore(cpu_state_t *const state, cpu_state_t *const snapshot)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(snapshot);
+
+  // Switching between the 4K and 64K memories leaves nothing to restore incrementally
+  if ((state->xo_memory == NULL) != (snapshot->xo_memory == NULL))
+  {
+    struct exec_trace_s *exec_trace = state->exec_trace;
+    status_code_t status = chip8_snapshot(state, snapshot);
+    state->exec_trace = exec_trace;
+    return status;
+  }
+
+  copy_changes(state, snapshot, &state->dirty);
+  state->peripherals.graphics.display_update = 1;
+
+  memset(&state->dirty, 0, sizeof(dirty_t));
+  return STATUS_OK;
+}
+
+status_code_t chip8_snapshot_update(cpu_state_t *const snapshot, cpu_state_t *const state)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(snapshot);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  if ((state->xo_memory == NULL) != (snapshot->xo_memory == NULL))
+  {
+    return chip8_snapshot(snapshot, state);
+  }
+
+  copy_changes(snapshot, state, &state->dirty);
+
+  memset(&state->dirty, 0, sizeof(dirty_t));
+  return STATUS_OK;
+}
+
+status_code_t init_template(cpu_state_t *const template_state, const char *file, quirk_profile_t const profile)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(template_state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(file);
+
+  status_code_t status = init_cpu(template_state);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  status = set_quirk_profile(template_state, profile);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  status = load_rom(template_state, file);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  memset(&template_state->dirty, 0, sizeof(dirty_t));
+  return STATUS_OK;
+}
+
+status_code_t init_cpu_from_template(cpu_state_t *const state, cpu_state_t *const template_state)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(template_state);
+
+  return chip8_snapshot(state, template_state);
+}
+
+status_code_t reset_cpu(cpu_state_t *const state, cpu_state_t *const template_state)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(template_state);
+
+  return chip8_restore(state, template_state);
+}
+
+status_code_t quirk_profile_from_name(const char *name, quirk_profile_t *const profile)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(name);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(profile);
+
+  for (uint8_t i = 0; i < QUIRK_PROFILE_COUNT; i++)
+  {
+    if (strcmp(name, profile_names[i]) == 0)
+    {
+      *profile = (quirk_profile_t)i;
+      return STATUS_OK;
+    }
+  }
+
+  return STATUS_ERR_INVALID_PARAM;
+}
+
+status_code_t timing_mode_from_name(const char *name, timing_mode_t *const mode)
 {
-  // Instruction table
-  static opcode_handler_fn op_table[16] = {
-      op_table_0, op_1NNN, op_2NNN, op_3XNN,
-      op_4XNN, op_5XY0, op_6XNN, op_7XNN,
-      op_table_8, op_9XY0, op_ANNN, op_BNNN,
-      op_CXNN, op_DXYN, op_table_E, op_table_F};
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(name);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(mode);
 
+  for (uint8_t i = 0; i < TIMING_MODE_COUNT; i++)
+  {
+    if (strcmp(name, timing_mode_names[i]) == 0)
+    {
+      *mode = (timing_mode_t)i;
+      return STATUS_OK;
+    }
+  }
+
+  return STATUS_ERR_INVALID_PARAM;
+}
+
+status_code_t instruction_cycles(cpu_state_t *const state, timing_mode_t const mode, uint32_t *const cycles)
+{
   VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(cycles);
+
+  if ((mode >= TIMING_MODE_COUNT) || (state->quirk_profile >= QUIRK_PROFILE_COUNT))
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
 
   uint16_t opcode;
-  status_code_t status;
+  status_code_t status = chip8_peek_opcode(state, &opcode);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  *cycles = (mode == TIMING_VIP) ? vip_cycles(state, opcode) : 1;
+  return STATUS_OK;
+}
+
+status_code_t cycle_clock_init(cycle_clock_t *const clock, timing_mode_t const mode)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(clock);
+
+  if (mode >= TIMING_MODE_COUNT)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(clock, 0, sizeof(cycle_clock_t));
+  clock->mode = mode;
+  clock->budget = (mode == TIMING_VIP) ? (VIP_CYCLES_PER_FRAME - VIP_DISPLAY_DMA_CYCLES) : INSTRUCTIONS_PER_FRAME;
+  return STATUS_OK;
+}
+
+status_code_t run_frame_cycles(cpu_state_t *const state, cycle_clock_t *const clock)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(clock);
+
+  // vip_cycles looks up the profile's quirks before emulation_cycle would reject it
+  if (state->quirk_profile >= QUIRK_PROFILE_COUNT)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  status_code_t status = STATUS_OK;
+
+  clock->balance += (int32_t)clock->budget;
+  clock->total_budget_cycles += clock->budget;
+  clock->busy_cycles = 0;
+  clock->instructions = 0;
+  clock->idle_instructions = 0;
+  clock->frames++;
+
+  while ((clock->balance > 0) && (status == STATUS_OK))
+  {
+    uint16_t pc = state->registers.pc;
+    uint16_t opcode;
+
+    // Fails only where fetch would, in strict builds past the end of memory
+    status = chip8_peek_opcode(state, &opcode);
+    if (status != STATUS_OK)
+    {
+      break;
+    }
+
+    uint32_t cycles = (clock->mode == TIMING_VIP) ? vip_cycles(state, opcode) : 1;
+
+    status = emulation_cycle(state);
+
+    clock->balance -= (int32_t)cycles;
+    clock->busy_cycles += cycles;
+    clock->total_busy_cycles += cycles;
+    clock->instructions++;
+    clock->loop_length++;
+
+    if (((opcode >> 12) == 0x1) && ((opcode & 0x0FFF) <= pc))
+    {
+      if ((clock->loop_pc == pc) && (memcmp(&clock->loop_registers, &state->registers, sizeof(registers_t)) == 0))
+      {
+        // Capped to the frame, as the loop may have started in the previous one
+        clock->idle_instructions += (clock->loop_length < clock->instructions) ? clock->loop_length : clock->instructions;
+      }
+      clock->loop_pc = pc;
+      memcpy(&clock->loop_registers, &state->registers, sizeof(registers_t));
+      clock->loop_length = 0;
+    }
+
+    // The rest of the frame is spent waiting for the vertical blank, not executing
+    if (state->vblank_wait)
+    {
+      state->vblank_wait = 0;
+      clock->balance = (clock->balance > 0) ? 0 : clock->balance;
+    }
+  }
+
+  return status;
+}
+
+status_code_t reference_cycle(cpu_state_t *const state)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  if (state->quirk_profile >= QUIRK_PROFILE_COUNT)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
 
-  // Fetch
-  status = fetch(state, &opcode);
+  status_code_t status = reference_step(state);
   RETURN_STATUS_IF_NOT_OK(status);
 
-  // Decode + Execute
-  status = op_table[((opcode >> 12) & 0xF)](opcode, state);
+  state->peripherals.keypad.previous = state->peripherals.keypad.current;
+  return STATUS_OK;
+}
+
+status_code_t emulation_cycle(cpu_state_t *const state)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  if (state->quirk_profile >= QUIRK_PROFILE_COUNT)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  if (state->exec_trace != NULL)
+  {
+    exec_trace_begin(state->exec_trace, state);
+  }
+
+  // Fetch + Decode + Execute
+  status_code_t status = profile_steps[state->quirk_profile](state);
+
+  // A trace that can't be written anymore stops emulation, rather than silently losing its tail
+  if (state->exec_trace != NULL)
+  {
+    status_code_t trace_status = exec_trace_end(state->exec_trace, state, status);
+    status = (status == STATUS_OK) ? trace_status : status;
+  }
   RETURN_STATUS_IF_NOT_OK(status);
 
   state->peripherals.keypad.previous = state->peripherals.keypad.current;
   return STATUS_OK;
 }
 
+status_code_t emulation_frame(cpu_state_t *const state)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  for (uint8_t i = 0; i < INSTRUCTIONS_PER_FRAME; i++)
+  {
+    status_code_t status = emulation_cycle(state);
+    RETURN_STATUS_IF_NOT_OK(status);
+
+    if (state->vblank_wait)
+    {
+      state->vblank_wait = 0;
+      break;
+    }
+  }
+
+  return STATUS_OK;
+}
+
+status_code_t run_frames(cpu_state_t *const state, uint16_t const keys, uint32_t const frames)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  for (uint32_t frame = 0; frame < frames; frame++)
+  {
+    state->peripherals.keypad.current = keys;
+
+    status_code_t status = emulation_frame(state);
+    RETURN_STATUS_IF_NOT_OK(status);
+
+    update_timers(state);
+  }
+
+  return STATUS_OK;
+}
+
 status_code_t update_timers(cpu_state_t *const state)
 {
   VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
@@ -168,14 +831,33 @@ status_code_t update_timers(cpu_state_t *const state)
   return STATUS_OK;
 }
 
+status_code_t chip8_peek_opcode(cpu_state_t *const state, uint16_t *const opcode)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(opcode);
+
+  if (state->quirk_profile >= QUIRK_PROFILE_COUNT)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  // Read as fetch reads it, the second byte from the guard band at the end of memory
+  uint8_t bytes[2] = {0};
+  status_code_t status = mem_read(state, state->registers.pc, bytes, 2, profile_quirks[state->quirk_profile]);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  *opcode = (uint16_t)((bytes[0] << 8)) | bytes[1];
+  return STATUS_OK;
+}
+
 /** Private */
-status_code_t fetch(cpu_state_t *const state, uint16_t *const opcode)
+QUIRK_TEMPLATE status_code_t fetch(cpu_state_t *const state, uint16_t *const opcode, uint32_t const quirks)
 {
   status_code_t status = STATUS_OK;
   registers_t *reg = &state->registers;
 
   uint8_t bytes[2] = {0};
-  status = mem_read(state, reg->pc, bytes, 2);
+  status = mem_read(state, reg->pc, bytes, 2, quirks);
   RETURN_STATUS_IF_NOT_OK(status);
 
   *opcode = (uint16_t)((bytes[0] << 8)) | bytes[1];
@@ -184,40 +866,337 @@ status_code_t fetch(cpu_state_t *const state, uint16_t *const opcode)
   return STATUS_OK;
 }
 
-status_code_t mem_read(cpu_state_t *const state, const uint16_t address, uint8_t *const dest, const size_t size)
+/**
+ * Approximate machine cycles the COSMAC VIP interpreter takes over an instruction,
+ * fetch and dispatch included, given the state it is about to execute in. Opcodes
+ * the VIP does not have are costed like the cheapest of their group.
+ */
+static uint32_t vip_cycles(cpu_state_t *const state, uint16_t const opcode)
+{
+  registers_t *reg = &state->registers;
+  uint8_t x = (uint8_t)((opcode >> 8) & 0xF);
+  uint8_t y = (uint8_t)((opcode >> 4) & 0xF);
+  uint8_t nn = (uint8_t)(opcode & 0xFF);
+  uint8_t n = (uint8_t)(opcode & 0xF);
+  uint8_t key = (uint8_t)((state->peripherals.keypad.current >> (reg->V[x] & 0xF)) & 1);
+  uint32_t cycles = 40; // Fetch and dispatch
+
+  switch (opcode >> 12)
+  {
+  case 0x0:
+    // Clearing the display writes all 256 bytes of it one at a time
+    cycles += (opcode == 0x00E0) ? 3078 : 10;
+    break;
+  case 0x1:
+    cycles += 12;
+    break;
+  case 0x2:
+    cycles += 26;
+    break;
+  case 0x3:
+    cycles += (reg->V[x] == nn) ? 14 : 10; // A taken skip costs 4 more
+    break;
+  case 0x4:
+    cycles += (reg->V[x] != nn) ? 14 : 10;
+    break;
+  case 0x5:
+    cycles += (reg->V[x] == reg->V[y]) ? 18 : 14;
+    break;
+  case 0x6:
+    cycles += 6;
+    break;
+  case 0x7:
+    cycles += 10;
+    break;
+  case 0x8:
+    cycles += 44;
+    break;
+  case 0x9:
+    cycles += (reg->V[x] != reg->V[y]) ? 18 : 14;
+    break;
+  case 0xA:
+    cycles += 12;
+    break;
+  case 0xB:
+    cycles += 22;
+    break;
+  case 0xC:
+    cycles += 36;
+    break;
+  case 0xD:
+  {
+    // Each row is shifted into place across two bytes unless the sprite is byte aligned. DXY0
+    // draws no rows on the VIP; only profiles with the SUPER-CHIP opcodes draw 16x16 sprites
+    uint8_t rows = ((n == 0) && (profile_quirks[state->quirk_profile] & QUIRK_SCHIP_OPCODES)) ? 16 : n;
+    cycles += 26 + (rows * ((reg->V[x] & 7) ? 46 : 34));
+    break;
+  }
+  case 0xE:
+    cycles += ((nn == 0x9E) ? key : !key) ? 18 : 14;
+    break;
+  case 0xF:
+    switch (nn)
+    {
+    case 0x1E:
+    case 0x29:
+      cycles += 16;
+      break;
+    case 0x33:
+      // Repeated subtraction, one loop per unit of each digit
+      cycles += 80 + (16 * ((reg->V[x] / 100) + ((reg->V[x] / 10) % 10) + (reg->V[x] % 10)));
+      break;
+    case 0x55:
+    case 0x65:
+      cycles += 14 + (14 * (x + 1));
+      break;
+    default:
+      cycles += 10;
+      break;
+    }
+    break;
+  }
+
+  return cycles;
+}
+
+/** FNV-1a over a run of bytes, continuing from hash */
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t const size)
+{
+  const uint8_t *bytes = data;
+
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= FNV_PRIME;
+  }
+
+  return hash;
+}
+
+/** 64-bit finalizer of SplitMix64; maps 0 to 0 */
+static inline uint64_t hash_mix(uint64_t z)
+{
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * Contribution of a value at a position to a rolling hash. Zero values contribute
+ * nothing, so the hashes of a zeroed state are 0 and only need updating on writes.
+ */
+static inline uint64_t hash_position(uint32_t const position, uint64_t const value)
+{
+  return hash_mix(value) * (hash_mix(position + 1) | 1);
+}
+
+static void rehash_memory(cpu_state_t *const state)
+{
+  uint8_t *memory;
+  size_t size;
+  get_memory(state, &memory, &size);
+
+  state->hash.memory = 0;
+  for (uint32_t i = 0; i < (size + MEM_GUARD_SIZE); i++)
+  {
+    state->hash.memory ^= hash_position(i, memory[i]);
+  }
+}
+
+static void rehash_graphics(cpu_state_t *const state)
+{
+  uint64_t const *words = &state->peripherals.graphics.buffer[0][0][0];
+  uint32_t count = sizeof(state->peripherals.graphics.buffer) / sizeof(uint64_t);
+
+  state->hash.graphics = 0;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    state->hash.graphics ^= hash_position(i, words[i]);
+  }
+}
+
+/** Rehash the framebuffer after whole planes were rewritten, marking all of their rows dirty */
+static void rewrite_planes(cpu_state_t *const state, uint8_t const planes)
+{
+  for (uint8_t plane = 0; plane < GRAPHICS_PLANES; plane++)
+  {
+    if (planes & (1 << plane))
+    {
+      state->dirty.rows[plane] = UINT64_MAX;
+    }
+  }
+
+  rehash_graphics(state);
+}
+
+/** Mark the memory pages spanned by a write as dirty */
+static void mark_pages_dirty(cpu_state_t *const state, uint32_t const address, size_t const size)
+{
+  if (size == 0)
+  {
+    return;
+  }
+
+  uint32_t last = (address + size - 1) / MEM_PAGE_SIZE;
+
+  for (uint32_t page = address / MEM_PAGE_SIZE; (page <= last) && (page < MEM_PAGE_COUNT); page++)
+  {
+    state->dirty.pages[page / 64] |= 1ULL << (page % 64);
+  }
+}
+
+/** The memory addressed under the given quirks */
+QUIRK_TEMPLATE uint8_t *mem_base(cpu_state_t *const state, uint32_t const quirks)
 {
-  if ((address + size - 1) >= MEM_SIZE)
+  return (quirks & QUIRK_XO_CHIP_OPCODES) ? state->xo_memory : state->memory;
+}
+
+/**
+ * Memory accessors. Unless built with CHIP8_STRICT_MEMORY, the address is masked to the
+ * size of memory and any excess bytes go to the guard band, so size must not exceed
+ * MEM_GUARD_SIZE.
+ */
+QUIRK_TEMPLATE status_code_t mem_read(cpu_state_t *const state, const uint16_t address, uint8_t *const dest, const size_t size, uint32_t const quirks)
+{
+#ifdef CHIP8_STRICT_MEMORY
+  if ((address + size - 1) >= MEM_LIMIT(quirks))
   {
     return STATUS_ERR_MEM_OUT_OF_BOUNDS;
   }
+#endif
 
-  memcpy(dest, &(state->memory[address]), size);
+  memcpy(dest, &(mem_base(state, quirks)[MEM_ADDRESS(address, quirks)]), size);
   return STATUS_OK;
 }
 
-status_code_t mem_write(cpu_state_t *const state, const uint16_t address, uint8_t *const source, const size_t size)
+QUIRK_TEMPLATE status_code_t mem_write(cpu_state_t *const state, const uint16_t address, const uint8_t *const source, const size_t size, uint32_t const quirks)
 {
-  if ((address + size - 1) >= MEM_SIZE)
+#ifdef CHIP8_STRICT_MEMORY
+  if ((address + size - 1) >= MEM_LIMIT(quirks))
   {
     return STATUS_ERR_MEM_OUT_OF_BOUNDS;
   }
+#endif
 
-  memcpy(&(state->memory[address]), source, size);
+  uint8_t *dest = &(mem_base(state, quirks)[MEM_ADDRESS(address, quirks)]);
+
+  for (size_t i = 0; i < size; i++)
+  {
+    uint32_t position = MEM_ADDRESS(address, quirks) + i;
+    state->hash.memory ^= hash_position(position, dest[i]) ^ hash_position(position, source[i]);
+  }
+
+  memcpy(dest, source, size);
+  mark_pages_dirty(state, MEM_ADDRESS(address, quirks), size);
+
+  if (state->exec_trace != NULL)
+  {
+    exec_trace_mem_write(state->exec_trace, MEM_ADDRESS(address, quirks), source, size);
+  }
   return STATUS_OK;
 }
 
-status_code_t op_table_0(uint16_t const opcode, cpu_state_t *const state)
+/** Bitmask of the planes affected by graphics operations under the given quirks */
+QUIRK_TEMPLATE uint8_t selected_planes(graphics_t *const gfx, uint32_t const quirks)
+{
+  return (quirks & QUIRK_XO_CHIP_OPCODES) ? gfx->plane_mask : 0x1;
+}
+
+/**
+ * Advance the PC past the next instruction, which with XO-CHIP opcodes
+ * may be the 4-byte long F000 NNNN.
+ */
+QUIRK_TEMPLATE void skip_next(cpu_state_t *const state, uint32_t const quirks)
+{
+  registers_t *reg = &state->registers;
+
+  if (quirks & QUIRK_XO_CHIP_OPCODES)
+  {
+    uint8_t bytes[2] = {0};
+
+    if ((mem_read(state, reg->pc, bytes, 2, quirks) == STATUS_OK) && (bytes[0] == 0xF0) && (bytes[1] == 0x00))
+    {
+      reg->pc += 2;
+    }
+  }
+
+  reg->pc += 2;
+}
+
+QUIRK_TEMPLATE status_code_t op_table_0(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   status_code_t status = STATUS_OK;
 
+  if ((quirks & QUIRK_SCHIP_OPCODES) && ((opcode & 0xFFF0) == 0x00C0))
+  {
+    return op_00CN(opcode, state, quirks);
+  }
+
   switch (DECODE_NN(opcode))
   {
   case 0xE0:
-    status = op_00E0(opcode, state);
+    status = op_00E0(opcode, state, quirks);
     break;
   case 0xEE:
     status = op_00EE(opcode, state);
     break;
+  case 0xFB:
+    if (quirks & QUIRK_SCHIP_OPCODES)
+    {
+      status = op_00FB(opcode, state, quirks);
+    }
+    break;
+  case 0xFC:
+    if (quirks & QUIRK_SCHIP_OPCODES)
+    {
+      status = op_00FC(opcode, state, quirks);
+    }
+    break;
+  case 0xFD:
+    if (quirks & QUIRK_SCHIP_OPCODES)
+    {
+      status = op_00FD(opcode, state);
+    }
+    break;
+  case 0xFE:
+    if (quirks & QUIRK_SCHIP_OPCODES)
+    {
+      status = op_00FE(opcode, state);
+    }
+    break;
+  case 0xFF:
+    if (quirks & QUIRK_SCHIP_OPCODES)
+    {
+      status = op_00FF(opcode, state);
+    }
+    break;
+  default:
+    break;
+  }
+
+  return status;
+}
+
+QUIRK_TEMPLATE status_code_t op_table_5(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
+{
+  status_code_t status = STATUS_OK;
+
+  if (!(quirks & QUIRK_XO_CHIP_OPCODES))
+  {
+    return op_5XY0(opcode, state, quirks);
+  }
+
+  switch (DECODE_N(opcode))
+  {
+  case 0x0:
+    status = op_5XY0(opcode, state, quirks);
+    break;
+  case 0x2:
+    status = op_5XY2(opcode, state, quirks);
+    break;
+  case 0x3:
+    status = op_5XY3(opcode, state, quirks);
+    break;
   default:
     break;
   }
@@ -225,7 +1204,7 @@ status_code_t op_table_0(uint16_t const opcode, cpu_state_t *const state)
   return status;
 }
 
-status_code_t op_table_8(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_table_8(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   status_code_t status = STATUS_OK;
 
@@ -235,13 +1214,13 @@ status_code_t op_table_8(uint16_t const opcode, cpu_state_t *const state)
     status = op_8XY0(opcode, state);
     break;
   case 0x1:
-    status = op_8XY1(opcode, state);
+    status = op_8XY1(opcode, state, quirks);
     break;
   case 0x2:
-    status = op_8XY2(opcode, state);
+    status = op_8XY2(opcode, state, quirks);
     break;
   case 0x3:
-    status = op_8XY3(opcode, state);
+    status = op_8XY3(opcode, state, quirks);
     break;
   case 0x4:
     status = op_8XY4(opcode, state);
@@ -250,13 +1229,13 @@ status_code_t op_table_8(uint16_t const opcode, cpu_state_t *const state)
     status = op_8XY5(opcode, state);
     break;
   case 0x6:
-    status = op_8X06(opcode, state);
+    status = op_8X06(opcode, state, quirks);
     break;
   case 0x7:
     status = op_8XY7(opcode, state);
     break;
   case 0xE:
-    status = op_8X0E(opcode, state);
+    status = op_8X0E(opcode, state, quirks);
     break;
   default:
     break;
@@ -264,17 +1243,17 @@ status_code_t op_table_8(uint16_t const opcode, cpu_state_t *const state)
   return status;
 }
 
-status_code_t op_table_E(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_table_E(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   status_code_t status = STATUS_OK;
 
   switch (DECODE_NN(opcode))
   {
   case 0x9E:
-    status = op_EX9E(opcode, state);
+    status = op_EX9E(opcode, state, quirks);
     break;
   case 0xA1:
-    status = op_EXA1(opcode, state);
+    status = op_EXA1(opcode, state, quirks);
     break;
   default:
     break;
@@ -282,12 +1261,30 @@ status_code_t op_table_E(uint16_t const opcode, cpu_state_t *const state)
   return status;
 }
 
-status_code_t op_table_F(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_table_F(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   status_code_t status = STATUS_OK;
 
   switch (DECODE_NN(opcode))
   {
+  case 0x00:
+    if ((quirks & QUIRK_XO_CHIP_OPCODES) && (opcode == 0xF000))
+    {
+      status = op_F000(opcode, state, quirks);
+    }
+    break;
+  case 0x01:
+    if (quirks & QUIRK_XO_CHIP_OPCODES)
+    {
+      status = op_FN01(opcode, state);
+    }
+    break;
+  case 0x02:
+    if ((quirks & QUIRK_XO_CHIP_OPCODES) && (opcode == 0xF002))
+    {
+      status = op_F002(opcode, state, quirks);
+    }
+    break;
   case 0x07:
     status = op_FX07(opcode, state);
     break;
@@ -306,14 +1303,38 @@ status_code_t op_table_F(uint16_t const opcode, cpu_state_t *const state)
   case 0x29:
     status = op_FX29(opcode, state);
     break;
+  case 0x30:
+    if (quirks & QUIRK_SCHIP_OPCODES)
+    {
+      status = op_FX30(opcode, state);
+    }
+    break;
   case 0x33:
-    status = op_FX33(opcode, state);
+    status = op_FX33(opcode, state, quirks);
+    break;
+  case 0x3A:
+    if (quirks & QUIRK_XO_CHIP_OPCODES)
+    {
+      status = op_FX3A(opcode, state);
+    }
     break;
   case 0x55:
-    status = op_FX55(opcode, state);
+    status = op_FX55(opcode, state, quirks);
     break;
   case 0x65:
-    status = op_FX65(opcode, state);
+    status = op_FX65(opcode, state, quirks);
+    break;
+  case 0x75:
+    if (quirks & QUIRK_SCHIP_OPCODES)
+    {
+      status = op_FX75(opcode, state);
+    }
+    break;
+  case 0x85:
+    if (quirks & QUIRK_SCHIP_OPCODES)
+    {
+      status = op_FX85(opcode, state);
+    }
     break;
   default:
     break;
@@ -322,14 +1343,49 @@ status_code_t op_table_F(uint16_t const opcode, cpu_state_t *const state)
   return status;
 }
 
+/**
+ * 0x00CN: SCD N
+ * Scrolls the display down by N pixels
+ */
+QUIRK_TEMPLATE status_code_t op_00CN(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
+{
+  graphics_t *gfx = &state->peripherals.graphics;
+
+  uint8_t n = DECODE_N(opcode);
+  uint8_t height = GRAPHICS_ACTIVE_HEIGHT(gfx);
+  uint8_t planes = selected_planes(gfx, quirks);
+
+  for (uint8_t plane = 0; plane < GRAPHICS_PLANES; plane++)
+  {
+    if (planes & (1 << plane))
+    {
+      memmove(gfx->buffer[plane][n], gfx->buffer[plane][0], (height - n) * sizeof(gfx->buffer[plane][0]));
+      memset(gfx->buffer[plane][0], 0, n * sizeof(gfx->buffer[plane][0]));
+    }
+  }
+
+  rewrite_planes(state, planes);
+  gfx->display_update = 1;
+  return STATUS_OK;
+}
+
 /**
  * 0x00E0: CLS
  * Clears the screen
  */
-status_code_t op_00E0(uint16_t const __attribute__((unused)) opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_00E0(uint16_t const __attribute__((unused)) opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   graphics_t *gfx = &state->peripherals.graphics;
-  memset(gfx->buffer, 0, GRAPHICS_SIZE);
+  uint8_t planes = selected_planes(gfx, quirks);
+
+  for (uint8_t plane = 0; plane < GRAPHICS_PLANES; plane++)
+  {
+    if (planes & (1 << plane))
+    {
+      memset(gfx->buffer[plane], 0, sizeof(gfx->buffer[plane]));
+    }
+  }
+  rewrite_planes(state, planes);
   gfx->display_update = 1;
 
   return STATUS_OK;
@@ -354,6 +1410,115 @@ status_code_t op_00EE(uint16_t const __attribute__((unused)) opcode, cpu_state_t
   return STATUS_OK;
 }
 
+/**
+ * 0x00FB: SCR
+ * Scrolls the display right by 4 pixels
+ */
+QUIRK_TEMPLATE status_code_t op_00FB(uint16_t const __attribute__((unused)) opcode, cpu_state_t *const state, uint32_t const quirks)
+{
+  graphics_t *gfx = &state->peripherals.graphics;
+
+  uint8_t height = GRAPHICS_ACTIVE_HEIGHT(gfx);
+  uint8_t words = GRAPHICS_ACTIVE_WIDTH(gfx) / GRAPHICS_WORD_BITS;
+  uint8_t planes = selected_planes(gfx, quirks);
+
+  for (uint8_t plane = 0; plane < GRAPHICS_PLANES; plane++)
+  {
+    if (!(planes & (1 << plane)))
+    {
+      continue;
+    }
+
+    for (uint8_t row = 0; row < height; row++)
+    {
+      uint64_t *line = gfx->buffer[plane][row];
+
+      for (uint8_t w = words - 1; w > 0; w--)
+      {
+        line[w] = (line[w] >> SCROLL_PIXELS) | (line[w - 1] << (GRAPHICS_WORD_BITS - SCROLL_PIXELS));
+      }
+      line[0] >>= SCROLL_PIXELS;
+    }
+  }
+
+  rewrite_planes(state, planes);
+  gfx->display_update = 1;
+  return STATUS_OK;
+}
+
+/**
+ * 0x00FC: SCL
+ * Scrolls the display left by 4 pixels
+ */
+QUIRK_TEMPLATE status_code_t op_00FC(uint16_t const __attribute__((unused)) opcode, cpu_state_t *const state, uint32_t const quirks)
+{
+  graphics_t *gfx = &state->peripherals.graphics;
+
+  uint8_t height = GRAPHICS_ACTIVE_HEIGHT(gfx);
+  uint8_t words = GRAPHICS_ACTIVE_WIDTH(gfx) / GRAPHICS_WORD_BITS;
+  uint8_t planes = selected_planes(gfx, quirks);
+
+  for (uint8_t plane = 0; plane < GRAPHICS_PLANES; plane++)
+  {
+    if (!(planes & (1 << plane)))
+    {
+      continue;
+    }
+
+    for (uint8_t row = 0; row < height; row++)
+    {
+      uint64_t *line = gfx->buffer[plane][row];
+
+      for (uint8_t w = 0; w < words - 1; w++)
+      {
+        line[w] = (line[w] << SCROLL_PIXELS) | (line[w + 1] >> (GRAPHICS_WORD_BITS - SCROLL_PIXELS));
+      }
+      line[words - 1] <<= SCROLL_PIXELS;
+    }
+  }
+
+  rewrite_planes(state, planes);
+  gfx->display_update = 1;
+  return STATUS_OK;
+}
+
+/**
+ * 0x00FD: EXIT
+ * Exits the interpreter
+ */
+status_code_t op_00FD(uint16_t const __attribute__((unused)) opcode, cpu_state_t *const state __attribute__((unused)))
+{
+  return STATUS_REQ_EXIT;
+}
+
+/**
+ * 0x00FE: LOW
+ * Switches to the 64x32 px low resolution mode
+ */
+status_code_t op_00FE(uint16_t const __attribute__((unused)) opcode, cpu_state_t *const state)
+{
+  graphics_t *gfx = &state->peripherals.graphics;
+
+  gfx->hires = 0;
+  gfx->display_update = 1;
+
+  return STATUS_OK;
+}
+
+/**
+ * 0x00FF: HIGH
+ * Switches to the 128x64 px high resolution mode
+ */
+status_code_t op_00FF(uint16_t const __attribute__((unused)) opcode, cpu_state_t *const state)
+{
+  graphics_t *gfx = &state->peripherals.graphics;
+
+  gfx->hires = 1;
+  gfx->display_update = 1;
+
+  return STATUS_OK;
+}
+
 /**
  * 0x1NNN: JMP NNN
  * Jump to address 0xNNN
@@ -390,7 +1555,7 @@ status_code_t op_2NNN(uint16_t const opcode, cpu_state_t *const state)
  * 0x3XNN: SKEQ Vx, NN
  * Skip if V[X] == 0xNN
  */
-status_code_t op_3XNN(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_3XNN(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
@@ -398,7 +1563,7 @@ status_code_t op_3XNN(uint16_t const opcode, cpu_state_t *const state)
 
   if (reg->V[x] == DECODE_NN(opcode))
   {
-    reg->pc += 2;
+    skip_next(state, quirks);
   }
 
   return STATUS_OK;
@@ -408,7 +1573,7 @@ status_code_t op_3XNN(uint16_t const opcode, cpu_state_t *const state)
  * 0x4XNN: SKNE Vx, NN
  * Skip if V[X] != 0xNN
  */
-status_code_t op_4XNN(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_4XNN(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
@@ -416,7 +1581,7 @@ status_code_t op_4XNN(uint16_t const opcode, cpu_state_t *const state)
 
   if (reg->V[x] != DECODE_NN(opcode))
   {
-    reg->pc += 2;
+    skip_next(state, quirks);
   }
 
   return STATUS_OK;
@@ -426,7 +1591,7 @@ status_code_t op_4XNN(uint16_t const opcode, cpu_state_t *const state)
  * 0x5XY0: SKEQ Vx, Vy
  * Skip if V[X] == V[Y]
  */
-status_code_t op_5XY0(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_5XY0(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
@@ -435,7 +1600,58 @@ status_code_t op_5XY0(uint16_t const opcode, cpu_state_t *const state)
 
   if (reg->V[x] == reg->V[y])
   {
-    reg->pc += 2;
+    skip_next(state, quirks);
+  }
+
+  return STATUS_OK;
+}
+
+/**
+ * 0x5XY2: STR Vx, Vy
+ * Stores the values in V[X] to V[Y] (inclusive) in memory, starting at address I.
+ * The registers are stored in descending order when X > Y.
+ * Note: This doesn't change I
+ */
+QUIRK_TEMPLATE status_code_t op_5XY2(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
+{
+  registers_t *reg = &state->registers;
+
+  uint8_t x = DECODE_X(opcode);
+  uint8_t y = DECODE_Y(opcode);
+  int8_t step = (x <= y) ? 1 : -1;
+  uint8_t count = ((x <= y) ? (y - x) : (x - y)) + 1;
+  uint8_t values[REG_COUNT];
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    values[i] = reg->V[x + (i * step)];
+  }
+
+  return mem_write(state, reg->I, values, count, quirks);
+}
+
+/**
+ * 0x5XY3: LDR Vx, Vy
+ * Fills V[X] to V[Y] (inclusive) with values from memory, starting at address I.
+ * The registers are loaded in descending order when X > Y.
+ * Note: This doesn't change I
+ */
+QUIRK_TEMPLATE status_code_t op_5XY3(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
+{
+  registers_t *reg = &state->registers;
+
+  uint8_t x = DECODE_X(opcode);
+  uint8_t y = DECODE_Y(opcode);
+  int8_t step = (x <= y) ? 1 : -1;
+  uint8_t count = ((x <= y) ? (y - x) : (x - y)) + 1;
+  uint8_t values[REG_COUNT];
+
+  status_code_t status = mem_read(state, reg->I, values, count, quirks);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    reg->V[x + (i * step)] = values[i];
   }
 
   return STATUS_OK;
@@ -491,9 +1707,9 @@ status_code_t op_8XY0(uint16_t const opcode, cpu_state_t *const state)
 /**
  * 0x8XY1: OR Vx, Vy
  * Bitwise-OR the value in register V[Y] into V[X]
- * Note: This resets V[F] to 0
+ * Note: This resets V[F] to 0 under QUIRK_VF_RESET
  */
-status_code_t op_8XY1(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_8XY1(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
@@ -501,7 +1717,10 @@ status_code_t op_8XY1(uint16_t const opcode, cpu_state_t *const state)
   uint8_t y = DECODE_Y(opcode);
 
   reg->V[x] |= reg->V[y];
-  reg->V[0xF] = 0;
+  if (quirks & QUIRK_VF_RESET)
+  {
+    reg->V[0xF] = 0;
+  }
 
   return STATUS_OK;
 }
@@ -509,9 +1728,9 @@ status_code_t op_8XY1(uint16_t const opcode, cpu_state_t *const state)
 /**
  * 0x8XY2: AND Vx, Vy
  * Bitwise-AND the value in register V[Y] into V[X]
- * Note: This resets V[F] to 0
+ * Note: This resets V[F] to 0 under QUIRK_VF_RESET
  */
-status_code_t op_8XY2(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_8XY2(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
@@ -519,7 +1738,10 @@ status_code_t op_8XY2(uint16_t const opcode, cpu_state_t *const state)
   uint8_t y = DECODE_Y(opcode);
 
   reg->V[x] &= reg->V[y];
-  reg->V[0xF] = 0;
+  if (quirks & QUIRK_VF_RESET)
+  {
+    reg->V[0xF] = 0;
+  }
 
   return STATUS_OK;
 }
@@ -527,9 +1749,9 @@ status_code_t op_8XY2(uint16_t const opcode, cpu_state_t *const state)
 /**
  * 0x8XY3: XOR Vx, Vy
  * Bitwise-XOR the value in register V[Y] into V[X]
- * Note: This resets V[F] to 0
+ * Note: This resets V[F] to 0 under QUIRK_VF_RESET
  */
-status_code_t op_8XY3(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_8XY3(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
@@ -537,7 +1759,10 @@ status_code_t op_8XY3(uint16_t const opcode, cpu_state_t *const state)
   uint8_t y = DECODE_Y(opcode);
 
   reg->V[x] ^= reg->V[y];
-  reg->V[0xF] = 0;
+  if (quirks & QUIRK_VF_RESET)
+  {
+    reg->V[0xF] = 0;
+  }
 
   return STATUS_OK;
 }
@@ -586,15 +1811,17 @@ status_code_t op_8XY5(uint16_t const opcode, cpu_state_t *const state)
 /**
  * 0x8X06: SHR Vx
  * Shifts V[X] to the right by 1 and stores the LSB prior to the shift in V[F]
+ * Note: Under QUIRK_SHIFT_VY this is 0x8XY6, which shifts V[Y] into V[X]
  */
-status_code_t op_8X06(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_8X06(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
   uint8_t x = DECODE_X(opcode);
-  uint8_t carry = reg->V[x] & 0x1;
+  uint8_t src = (quirks & QUIRK_SHIFT_VY) ? reg->V[DECODE_Y(opcode)] : reg->V[x];
+  uint8_t carry = src & 0x1;
 
-  reg->V[x] >>= 1;
+  reg->V[x] = src >> 1;
   reg->V[0xF] = carry;
 
   return STATUS_OK;
@@ -622,15 +1849,17 @@ status_code_t op_8XY7(uint16_t const opcode, cpu_state_t *const state)
 /**
  * 0x8X0E: SHL Vx
  * Shifts V[X] to the left by 1 and stores the MSB prior to the shift in V[F]
+ * Note: Under QUIRK_SHIFT_VY this is 0x8XYE, which shifts V[Y] into V[X]
  */
-status_code_t op_8X0E(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_8X0E(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
   uint8_t x = DECODE_X(opcode);
-  uint8_t carry = (reg->V[x] & 0x80) >> 7;
+  uint8_t src = (quirks & QUIRK_SHIFT_VY) ? reg->V[DECODE_Y(opcode)] : reg->V[x];
+  uint8_t carry = (src & 0x80) >> 7;
 
-  reg->V[x] <<= 1;
+  reg->V[x] = src << 1;
   reg->V[0xF] = carry;
 
   return STATUS_OK;
@@ -640,7 +1869,7 @@ status_code_t op_8X0E(uint16_t const opcode, cpu_state_t *const state)
  * 0x9XY0: SKNE Vx, Vy
  * Skip if V[X] != V[Y]
  */
-status_code_t op_9XY0(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_9XY0(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
@@ -649,7 +1878,7 @@ status_code_t op_9XY0(uint16_t const opcode, cpu_state_t *const state)
 
   if (reg->V[x] != reg->V[y])
   {
-    reg->pc += 2;
+    skip_next(state, quirks);
   }
 
   return STATUS_OK;
@@ -671,12 +1900,15 @@ status_code_t op_ANNN(uint16_t const opcode, cpu_state_t *const state)
 /**
  * 0xBNNN: JMI NNN
  * Jump to the address 0xNNN + V0
+ * Note: Under QUIRK_JUMP_VX this is 0xBXNN, which jumps to 0xXNN + V[X]
  */
-status_code_t op_BNNN(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_BNNN(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
-  reg->pc = reg->V[0] + DECODE_NNN(opcode);
+  uint8_t offset = (quirks & QUIRK_JUMP_VX) ? reg->V[DECODE_X(opcode)] : reg->V[0];
+
+  reg->pc = offset + DECODE_NNN(opcode);
 
   return STATUS_OK;
 }
@@ -691,16 +1923,60 @@ status_code_t op_CXNN(uint16_t const opcode, cpu_state_t *const state)
 
   uint8_t x = DECODE_X(opcode);
 
-  reg->V[x] = (rand() & (opcode)) & 0x00FF;
+  // xorshift32, each instance drawing from its own generator
+  uint32_t random = state->random ? state->random : RANDOM_DEFAULT_SEED;
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  state->random = random;
+
+  reg->V[x] = (random & (opcode)) & 0x00FF;
 
   return STATUS_OK;
 }
 
+/**
+ * XOR a sprite row into a row of the display, clipping whatever falls outside of it.
+ * @param hash - Rolling hash of the framebuffer, updated for every word changed.
+ * @param position - Position of the row's first word within the framebuffer.
+ * @param line - Display row to draw onto.
+ * @param sprite - Sprite row, aligned such that its MSB is its leftmost pixel.
+ * @param x - Horizontal position of the sprite's leftmost pixel; may be negative.
+ * @param words - Number of words spanned by the active display width.
+ * @return 1 if any pixel on the display was turned off, 0 otherwise.
+ */
+static inline uint8_t draw_sprite_row(uint64_t *const hash, uint32_t const position, uint64_t *const line, uint64_t const sprite, int16_t const x, uint8_t const words)
+{
+  uint64_t collision = 0;
+
+  for (uint8_t w = 0; w < words; w++)
+  {
+    int16_t shift = x - (w * GRAPHICS_WORD_BITS);
+
+    if ((shift >= GRAPHICS_WORD_BITS) || (shift <= -GRAPHICS_WORD_BITS))
+    {
+      continue;
+    }
+
+    uint64_t bits = (shift >= 0) ? (sprite >> shift) : (sprite << -shift);
+    collision |= line[w] & bits;
+    *hash ^= hash_position(position + w, line[w]) ^ hash_position(position + w, line[w] ^ bits);
+    line[w] ^= bits;
+  }
+
+  return collision ? 1 : 0;
+}
+
 /**
  * 0xDXYN: DISP X, Y, N
  * Draw a sprite on the display at (V[X], V[Y]) that has a height of N
+ * Note: Pixels past the screen edges are clipped under QUIRK_CLIP_SPRITES,
+ * otherwise they wrap around to the opposite edge.
+ * Note: With SUPER-CHIP opcodes, DXY0 draws a 16x16 px sprite
+ * Note: With XO-CHIP opcodes, the sprite is drawn onto each selected plane in
+ * turn, each one taking the next sprite's worth of bytes from memory.
  */
-status_code_t op_DXYN(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_DXYN(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
   graphics_t *gfx = &state->peripherals.graphics;
@@ -708,39 +1984,78 @@ status_code_t op_DXYN(uint16_t const opcode, cpu_state_t *const state)
   uint8_t x = DECODE_X(opcode);
   uint8_t y = DECODE_Y(opcode);
   uint8_t h = DECODE_N(opcode);
-  uint8_t sprite_pixel = 0;
+  uint8_t wide = ((h == 0) && (quirks & QUIRK_SCHIP_OPCODES)) ? 1 : 0;
+  uint8_t sprite_width = wide ? 16 : 8;
+  uint8_t sprite[GRAPHICS_PLANES * 32] = {0};
+  uint8_t collision = 0;
+
+  uint8_t width = GRAPHICS_ACTIVE_WIDTH(gfx);
+  uint8_t height = GRAPHICS_ACTIVE_HEIGHT(gfx);
+  uint8_t words = width / GRAPHICS_WORD_BITS;
+  uint8_t planes = selected_planes(gfx, quirks);
+  uint8_t plane_count = (planes & 0x1) + ((planes >> 1) & 0x1);
+
+  if (wide)
+  {
+    h = 16;
+  }
 
-  uint16_t x_orig = reg->V[x] % GRAPHICS_WIDTH;
-  uint16_t y_orig = reg->V[y] % GRAPHICS_HEIGHT;
+  size_t sprite_size = h * (sprite_width / 8);
 
-  reg->V[0xF] = 0;
-  for (uint16_t row = 0; row < h; row++)
+  if ((sprite_size > 0) && (plane_count > 0))
   {
-    status_code_t status = mem_read(state, reg->I + row, &sprite_pixel, 1);
+    status_code_t status = mem_read(state, reg->I, sprite, sprite_size * plane_count, quirks);
     RETURN_STATUS_IF_NOT_OK(status);
+  }
+
+  int16_t x_orig = reg->V[x] % width;
+  uint16_t y_orig = reg->V[y] % height;
+  uint8_t const *data = sprite;
 
-    for (uint16_t col = 0; col < 8; col++)
+  for (uint8_t plane = 0; plane < GRAPHICS_PLANES; plane++)
+  {
+    if (!(planes & (1 << plane)))
     {
-      if (sprite_pixel & (0x80 >> col))
-      {
-        uint16_t y_pos = y_orig + row;
-        uint16_t x_pos = x_orig + col;
-        uint16_t index = x_pos + (y_pos * GRAPHICS_WIDTH);
+      continue;
+    }
 
-        if ((y_pos < GRAPHICS_HEIGHT) && (x_pos < GRAPHICS_WIDTH))
-        {
-          if (gfx->buffer[index])
-          {
-            reg->V[0xF] = 1;
-          }
+    for (uint16_t row = 0; row < h; row++)
+    {
+      uint16_t y_pos = y_orig + row;
+      uint64_t bits = wide ? ((uint64_t)((data[2 * row] << 8) | data[2 * row + 1]) << 48)
+                           : ((uint64_t)data[row] << 56);
 
-          gfx->buffer[index] ^= 1;
+      if (y_pos >= height)
+      {
+        if (quirks & QUIRK_CLIP_SPRITES)
+        {
+          break;
         }
+        y_pos -= height;
+      }
+
+      uint64_t *line = gfx->buffer[plane][y_pos];
+      uint32_t position = ((plane * GRAPHICS_HIRES_HEIGHT) + y_pos) * GRAPHICS_ROW_WORDS;
+      state->dirty.rows[plane] |= 1ULL << y_pos;
+      collision |= draw_sprite_row(&state->hash.graphics, position, line, bits, x_orig, words);
+
+      if (!(quirks & QUIRK_CLIP_SPRITES) && ((x_orig + sprite_width) > width))
+      {
+        collision |= draw_sprite_row(&state->hash.graphics, position, line, bits, x_orig - width, words);
       }
     }
+
+    data += sprite_size;
   }
 
+  reg->V[0xF] = collision;
   gfx->display_update = 1;
+
+  // Rather than spinning until the next frame, as FX0A does for a key, the scheduler yields
+  if (quirks & QUIRK_DISPLAY_WAIT)
+  {
+    state->vblank_wait = 1;
+  }
   return STATUS_OK;
 }
 
@@ -748,7 +2063,7 @@ status_code_t op_DXYN(uint16_t const opcode, cpu_state_t *const state)
  * 0xEX9E: SKPR Vx
  * Skip if the key stored in V[X] is pressed
  */
-status_code_t op_EX9E(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_EX9E(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   uint8_t x = DECODE_X(opcode);
 
@@ -757,7 +2072,7 @@ status_code_t op_EX9E(uint16_t const opcode, cpu_state_t *const state)
 
   if (KEY_PRESSED(key_state, reg->V[x]))
   {
-    reg->pc += 2;
+    skip_next(state, quirks);
   }
 
   return STATUS_OK;
@@ -767,7 +2082,7 @@ status_code_t op_EX9E(uint16_t const opcode, cpu_state_t *const state)
  * 0xEXA1: SKNP Vx
  * Skip if the key stored in V[X] is not pressed
  */
-status_code_t op_EXA1(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_EXA1(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   uint8_t x = DECODE_X(opcode);
 
@@ -776,12 +2091,61 @@ status_code_t op_EXA1(uint16_t const opcode, cpu_state_t *const state)
 
   if (!KEY_PRESSED(key_state, reg->V[x]))
   {
-    reg->pc += 2;
+    skip_next(state, quirks);
   }
 
   return STATUS_OK;
 }
 
+/**
+ * 0xF000 NNNN: LDI NNNN
+ * Sets the index register to the 16-bit address in the following word
+ */
+QUIRK_TEMPLATE status_code_t op_F000(uint16_t const __attribute__((unused)) opcode, cpu_state_t *const state, uint32_t const quirks)
+{
+  registers_t *reg = &state->registers;
+
+  uint8_t bytes[2] = {0};
+  status_code_t status = mem_read(state, reg->pc, bytes, 2, quirks);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  reg->I = (uint16_t)(bytes[0] << 8) | bytes[1];
+  reg->pc += 2;
+
+  return STATUS_OK;
+}
+
+/**
+ * 0xFN01: PLANE N
+ * Selects the bit-planes affected by drawing, clearing and scrolling
+ */
+status_code_t op_FN01(uint16_t const opcode, cpu_state_t *const state)
+{
+  graphics_t *gfx = &state->peripherals.graphics;
+
+  gfx->plane_mask = DECODE_X(opcode) & ((1 << GRAPHICS_PLANES) - 1);
+
+  return STATUS_OK;
+}
+
+/**
+ * 0xF002: AUDIO
+ * Loads 16 bytes starting at address I into the audio pattern buffer
+ */
+QUIRK_TEMPLATE status_code_t op_F002(uint16_t const __attribute__((unused)) opcode, cpu_state_t *const state, uint32_t const quirks)
+{
+  registers_t *reg = &state->registers;
+  audio_pattern_t *audio = &state->peripherals.audio;
+
+  status_code_t status = mem_read(state, reg->I, audio->buffer, AUDIO_PATTERN_SIZE, quirks);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  audio->loaded = 1;
+  audio->audio_update = 1;
+
+  return STATUS_OK;
+}
+
 /**
  * 0xFX07: GDLY Vx
  * Sets V[X] to the value of the delay timer
@@ -887,6 +2251,21 @@ status_code_t op_FX29(uint16_t const opcode, cpu_state_t *const state)
   return STATUS_OK;
 }
 
+/**
+ * 0xFX30: HFONT Vx
+ * Sets I to the location of the 8x10 px sprite for the digit in V[X]
+ */
+status_code_t op_FX30(uint16_t const opcode, cpu_state_t *const state)
+{
+  registers_t *reg = &state->registers;
+
+  uint8_t x = DECODE_X(opcode);
+
+  reg->I = FONT_HIRES_ADDRESS + (reg->V[x] & 0xF) * 10;
+
+  return STATUS_OK;
+}
+
 /**
  * 0xFX33: BCD Vx
  * Stores the binary-coded decimal representation of V[X],
@@ -895,7 +2274,7 @@ status_code_t op_FX29(uint16_t const opcode, cpu_state_t *const state)
  * and the ones digit at location I+2.
  * Note: This doesn't change I
  */
-status_code_t op_FX33(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_FX33(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
@@ -911,33 +2290,94 @@ status_code_t op_FX33(uint16_t const opcode, cpu_state_t *const state)
 
   bcd[0] = value % 10;
 
-  return mem_write(state, reg->I, bcd, 3);
+  return mem_write(state, reg->I, bcd, 3, quirks);
+}
+
+/**
+ * 0xFX3A: PITCH Vx
+ * Sets the playback rate of the audio pattern to 4000 * 2 ^ ((V[X] - 64) / 48) Hz
+ */
+status_code_t op_FX3A(uint16_t const opcode, cpu_state_t *const state)
+{
+  registers_t *reg = &state->registers;
+  audio_pattern_t *audio = &state->peripherals.audio;
+
+  uint8_t x = DECODE_X(opcode);
+
+  audio->pitch = reg->V[x];
+  audio->audio_update = 1;
+
+  return STATUS_OK;
 }
 
 /**
  * 0xFX55: STR V0, Vx
  * Stores the values in V[0] to V[X] (including V[X]) in memory, starting at address I.
- * Note: This doesn't change I
+ * Note: This doesn't change I, unless under QUIRK_MEM_INCREMENT_I
  */
-status_code_t op_FX55(uint16_t const opcode, cpu_state_t *const state)
+QUIRK_TEMPLATE status_code_t op_FX55(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
 {
   registers_t *reg = &state->registers;
 
   size_t size = DECODE_X(opcode) + 1;
 
-  return mem_write(state, reg->I, reg->V, size);
+  status_code_t status = mem_write(state, reg->I, reg->V, size, quirks);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  if (quirks & QUIRK_MEM_INCREMENT_I)
+  {
+    reg->I += size;
+  }
+
+  return STATUS_OK;
 }
 
 /**
  * 0xFX65: LDR V0, Vx
  * Fills from V[0] to V[X] (including V[X]) with values from memory, starting at address I.
- * Note: This doesn't change I
+ * Note: This doesn't change I, unless under QUIRK_MEM_INCREMENT_I
+ */
+QUIRK_TEMPLATE status_code_t op_FX65(uint16_t const opcode, cpu_state_t *const state, uint32_t const quirks)
+{
+  registers_t *reg = &state->registers;
+
+  size_t size = DECODE_X(opcode) + 1;
+
+  status_code_t status = mem_read(state, reg->I, reg->V, size, quirks);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  if (quirks & QUIRK_MEM_INCREMENT_I)
+  {
+    reg->I += size;
+  }
+
+  return STATUS_OK;
+}
+
+/**
+ * 0xFX75: SRPL Vx
+ * Stores the values in V[0] to V[X] (including V[X]) in the RPL user flags
+ */
+status_code_t op_FX75(uint16_t const opcode, cpu_state_t *const state)
+{
+  registers_t *reg = &state->registers;
+
+  size_t size = DECODE_X(opcode) + 1;
+  memcpy(reg->rpl, reg->V, size);
+
+  return STATUS_OK;
+}
+
+/**
+ * 0xFX85: LRPL Vx
+ * Fills V[0] to V[X] (including V[X]) with the values in the RPL user flags
  */
-status_code_t op_FX65(uint16_t const opcode, cpu_state_t *const state)
+status_code_t op_FX85(uint16_t const opcode, cpu_state_t *const state)
 {
   registers_t *reg = &state->registers;
 
   size_t size = DECODE_X(opcode) + 1;
+  memcpy(reg->V, reg->rpl, size);
 
-  return mem_read(state, reg->I, reg->V, size);
+  return STATUS_OK;
 }
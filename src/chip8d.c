@@ -0,0 +1,850 @@
+#define _POSIX_C_SOURCE 200809L // sockets, strtok_r, snprintf
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "chip8d.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "logging.h"
+#include "status_code.h"
+#include "stream.h"
+
+#define CHIP8D_TICK_NS (1000000000L / 60)
+#define CHIP8D_WAKE_TAG (UINT32_MAX)
+#define CHIP8D_LISTEN_TAG (UINT32_MAX - 1)
+#define CHIP8D_EPOLL_EVENTS (64)
+#define CHIP8D_BACKLOG (16)
+#define CHIP8D_RESPONSE_SIZE (CHIP8D_MAX_SESSIONS * (CHIP8D_PATH_SIZE + 64))
+#define CHIP8D_CLIENT_BUFFER (2 * CHIP8D_RESPONSE_SIZE) // A control client further behind on its responses is dropped
+
+static const char *const state_names[] = {
+    [CHIP8D_FREE] = "free",
+    [CHIP8D_STOPPED] = "stopped",
+    [CHIP8D_RUNNING] = "running",
+    [CHIP8D_HALTED] = "halted",
+};
+
+static void enqueue(chip8d_t *const daemon, uint32_t const id)
+{
+  pthread_mutex_lock(&daemon->queue_lock);
+  daemon->queue[(daemon->queue_head + daemon->queue_count) % CHIP8D_MAX_SESSIONS] = id;
+  daemon->queue_count++;
+  pthread_cond_signal(&daemon->queue_ready);
+  pthread_mutex_unlock(&daemon->queue_lock);
+}
+
+/** Run a single frame of a session, requeueing it behind the others while it has budget left */
+static void run_frame(chip8d_t *const daemon, uint32_t const id)
+{
+  chip8d_session_t *session = &daemon->sessions[id];
+  cpu_state_t *cpu = &session->cpu;
+
+  pthread_mutex_lock(&session->lock);
+
+  if ((session->state != CHIP8D_RUNNING) || (session->budget == 0))
+  {
+    session->queued = 0;
+    pthread_mutex_unlock(&session->lock);
+    return;
+  }
+
+  uint16_t keys = session->keypad;
+  if (session->stream != NULL)
+  {
+    keys |= __atomic_load_n(&session->stream->keypad, __ATOMIC_RELAXED);
+  }
+
+  status_code_t status = run_frames(cpu, keys, 1);
+  if (status != STATUS_OK)
+  {
+    Log_I("Session %u halted: %u", id, status);
+    session->state = CHIP8D_HALTED;
+    session->status = status;
+  }
+
+  if (cpu->peripherals.graphics.display_update)
+  {
+    cpu->peripherals.graphics.display_update = 0;
+    if (session->stream != NULL)
+    {
+      stream_server_publish(session->stream, &cpu->peripherals.graphics);
+    }
+  }
+
+  session->budget--;
+  session->frames++;
+  __atomic_fetch_add(&daemon->frames, 1, __ATOMIC_RELAXED);
+
+  uint8_t requeue = (session->state == CHIP8D_RUNNING) && (session->budget > 0);
+  session->queued = requeue;
+  pthread_mutex_unlock(&session->lock);
+
+  if (requeue)
+  {
+    enqueue(daemon, id);
+  }
+}
+
+static void *chip8d_worker(void *arg)
+{
+  chip8d_t *daemon = arg;
+
+  while (1)
+  {
+    pthread_mutex_lock(&daemon->queue_lock);
+    while (!daemon->stopping && (daemon->queue_count == 0))
+    {
+      pthread_cond_wait(&daemon->queue_ready, &daemon->queue_lock);
+    }
+    if (daemon->stopping)
+    {
+      pthread_mutex_unlock(&daemon->queue_lock);
+      return NULL;
+    }
+
+    uint32_t id = daemon->queue[daemon->queue_head];
+    daemon->queue_head = (daemon->queue_head + 1) % CHIP8D_MAX_SESSIONS;
+    daemon->queue_count--;
+    pthread_mutex_unlock(&daemon->queue_lock);
+
+    run_frame(daemon, id);
+  }
+}
+
+/** Give every running session its frames for the tick */
+static void tick(chip8d_t *const daemon)
+{
+  __atomic_fetch_add(&daemon->ticks, 1, __ATOMIC_RELAXED);
+
+  for (uint32_t id = 0; id < CHIP8D_MAX_SESSIONS; id++)
+  {
+    chip8d_session_t *session = &daemon->sessions[id];
+    uint8_t push = 0;
+
+    pthread_mutex_lock(&session->lock);
+    if (session->state == CHIP8D_RUNNING)
+    {
+      // Budgets do not carry over: a session that cannot keep up runs slower
+      __atomic_fetch_add(&daemon->overruns, (session->budget > 0), __ATOMIC_RELAXED);
+      session->budget = session->speed;
+      push = !session->queued;
+      session->queued = 1;
+    }
+    pthread_mutex_unlock(&session->lock);
+
+    if (push)
+    {
+      enqueue(daemon, id);
+    }
+  }
+}
+
+/**
+ * Drive the 60 Hz ticks. Apart from the event loop, so that commands taking a while,
+ * such as loading a ROM from disk, do not hold up the sessions already running.
+ */
+static void *chip8d_ticker(void *arg)
+{
+  chip8d_t *daemon = arg;
+  uint64_t expirations;
+
+  while (!__atomic_load_n(&daemon->ticker_stopping, __ATOMIC_ACQUIRE))
+  {
+    // Ticks missed while busy are not made up for
+    if (read(daemon->timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+    {
+      tick(daemon);
+    }
+  }
+
+  return NULL;
+}
+
+/** The template of a ROM, loading it if it is not cached */
+static chip8d_template_t *find_template(chip8d_t *const daemon, const char *path, quirk_profile_t const profile, status_code_t *const status)
+{
+  chip8d_template_t *template_state = NULL;
+
+  for (uint32_t i = 0; i < CHIP8D_MAX_TEMPLATES; i++)
+  {
+    chip8d_template_t *candidate = &daemon->templates[i];
+
+    if (candidate->loaded && (candidate->profile == profile) && (strcmp(candidate->path, path) == 0))
+    {
+      *status = STATUS_OK;
+      return candidate;
+    }
+    template_state = ((template_state == NULL) && !candidate->loaded) ? candidate : template_state;
+  }
+
+  if (template_state == NULL)
+  {
+    template_state = &daemon->templates[daemon->next_template];
+    daemon->next_template = (daemon->next_template + 1) % CHIP8D_MAX_TEMPLATES;
+  }
+
+  cleanup_cpu(&template_state->state);
+  memset(template_state, 0, sizeof(chip8d_template_t));
+
+  *status = init_template(&template_state->state, path, profile);
+  if (*status != STATUS_OK)
+  {
+    cleanup_cpu(&template_state->state);
+    memset(template_state, 0, sizeof(chip8d_template_t));
+    return NULL;
+  }
+
+  snprintf(template_state->path, sizeof(template_state->path), "%s", path);
+  template_state->profile = profile;
+  template_state->loaded = 1;
+  return template_state;
+}
+
+static void command_new(chip8d_t *const daemon, char *const *args, uint32_t const count, char *const response, size_t const size)
+{
+  quirk_profile_t profile = QUIRK_PROFILE_CHIP8;
+  status_code_t status;
+
+  if ((count < 2) || (count > 3) || (strlen(args[1]) >= CHIP8D_PATH_SIZE) ||
+      ((count == 3) && (quirk_profile_from_name(args[2], &profile) != STATUS_OK)))
+  {
+    snprintf(response, size, "ERR usage: new <ROM file> [chip8|schip|xochip|vip]\n");
+    return;
+  }
+
+  uint32_t id = 0;
+  while ((id < CHIP8D_MAX_SESSIONS) && (daemon->sessions[id].state != CHIP8D_FREE))
+  {
+    id++;
+  }
+  if (id == CHIP8D_MAX_SESSIONS)
+  {
+    snprintf(response, size, "ERR no free sessions\n");
+    return;
+  }
+
+  // A ROM not loaded yet is read from disk here, holding up other commands but not the ticks
+  chip8d_template_t *template_state = find_template(daemon, args[1], profile, &status);
+  if (template_state == NULL)
+  {
+    snprintf(response, size, "ERR failed to load %s: %u\n", args[1], status);
+    return;
+  }
+
+  chip8d_session_t *session = &daemon->sessions[id];
+  pthread_mutex_lock(&session->lock);
+  status = init_cpu_from_template(&session->cpu, &template_state->state);
+  if (status == STATUS_OK)
+  {
+    // Copies of a template share its generator; every session gets its own
+    seed_random(&session->cpu, (uint32_t)time(NULL) ^ ((id + 1) * 0x9E3779B9u));
+    snprintf(session->rom, sizeof(session->rom), "%s", args[1]);
+    session->state = CHIP8D_STOPPED;
+    session->status = STATUS_OK;
+    session->keypad = 0;
+    session->speed = 1;
+    session->budget = 0;
+    session->frames = 0;
+    session->has_snapshot = 0;
+  }
+  else
+  {
+    cleanup_cpu(&session->cpu);
+  }
+  pthread_mutex_unlock(&session->lock);
+
+  if (status != STATUS_OK)
+  {
+    snprintf(response, size, "ERR failed to start a session: %u\n", status);
+    return;
+  }
+
+  Log_I("Session %u loaded %s", id, args[1]);
+  snprintf(response, size, "OK %u\n", id);
+}
+
+static void close_session(chip8d_session_t *const session)
+{
+  session->state = CHIP8D_FREE;
+  session->budget = 0;
+  cleanup_cpu(&session->cpu);
+  if (session->has_snapshot)
+  {
+    cleanup_cpu(&session->snapshot);
+    session->has_snapshot = 0;
+  }
+  if (session->stream != NULL)
+  {
+    stream_server_cleanup(session->stream);
+    free(session->stream);
+    session->stream = NULL;
+  }
+}
+
+/** Commands acting on a single session, run with its lock held */
+static void command_session(chip8d_t *const daemon, char *const *args, uint32_t const count, chip8d_session_t *const session,
+                            uint32_t const id, char *const response, size_t const size)
+{
+  const char *command = args[0];
+
+  if (strcmp(command, "start") == 0)
+  {
+    if (session->state == CHIP8D_HALTED)
+    {
+      snprintf(response, size, "ERR session %u halted: %u\n", id, session->status);
+      return;
+    }
+    session->state = CHIP8D_RUNNING;
+  }
+  else if (strcmp(command, "stop") == 0)
+  {
+    session->state = (session->state == CHIP8D_RUNNING) ? CHIP8D_STOPPED : session->state;
+    session->budget = 0;
+  }
+  else if ((strcmp(command, "input") == 0) && (count == 3))
+  {
+    session->keypad = (uint16_t)strtoul(args[2], NULL, 16);
+  }
+  else if ((strcmp(command, "speed") == 0) && (count == 3))
+  {
+    uint32_t speed = strtoul(args[2], NULL, 10);
+    if ((speed == 0) || (speed > CHIP8D_MAX_SPEED))
+    {
+      snprintf(response, size, "ERR speed must be 1 to %u\n", CHIP8D_MAX_SPEED);
+      return;
+    }
+    session->speed = speed;
+  }
+  else if (strcmp(command, "snapshot") == 0)
+  {
+    status_code_t status = chip8_snapshot(&session->snapshot, &session->cpu);
+    if (status != STATUS_OK)
+    {
+      snprintf(response, size, "ERR snapshot failed: %u\n", status);
+      return;
+    }
+    session->has_snapshot = 1;
+  }
+  else if (strcmp(command, "restore") == 0)
+  {
+    if (!session->has_snapshot)
+    {
+      snprintf(response, size, "ERR no snapshot\n");
+      return;
+    }
+    chip8_restore(&session->cpu, &session->snapshot);
+    session->state = (session->state == CHIP8D_HALTED) ? CHIP8D_STOPPED : session->state;
+    session->status = STATUS_OK;
+  }
+  else if (strcmp(command, "subscribe") == 0)
+  {
+    char address[CHIP8D_PATH_SIZE + 32];
+    snprintf(address, sizeof(address), "unix:%s.%u", daemon->socket_path, id);
+
+    if (session->stream == NULL)
+    {
+      session->stream = malloc(sizeof(stream_server_t));
+      status_code_t status =
+          (session->stream != NULL) ? stream_server_init_shared(session->stream, &daemon->streams, address) : STATUS_ERR_NO_MEMORY;
+      if (status != STATUS_OK)
+      {
+        free(session->stream);
+        session->stream = NULL;
+        snprintf(response, size, "ERR failed to stream: %u\n", status);
+        return;
+      }
+      // The first frame subscribers see
+      session->cpu.peripherals.graphics.display_update = 1;
+    }
+    snprintf(response, size, "OK %s\n", address);
+    return;
+  }
+  else if (strcmp(command, "close") == 0)
+  {
+    close_session(session);
+    Log_I("Session %u closed", id);
+  }
+  else
+  {
+    snprintf(response, size, "ERR unknown command or arguments: %s\n", command);
+    return;
+  }
+
+  snprintf(response, size, "OK\n");
+}
+
+void chip8d_execute(chip8d_t *const daemon, char *line, char *const response, size_t const size)
+{
+  char *args[4];
+  uint32_t count = 0;
+  char *save;
+
+  if ((daemon == NULL) || (line == NULL) || (response == NULL) || (size == 0))
+  {
+    return;
+  }
+
+  for (char *token = strtok_r(line, " \t\r", &save); (token != NULL) && (count < 4); token = strtok_r(NULL, " \t\r", &save))
+  {
+    args[count++] = token;
+  }
+
+  if (count == 0)
+  {
+    snprintf(response, size, "ERR empty command\n");
+    return;
+  }
+
+  pthread_mutex_lock(&daemon->lock);
+
+  if (strcmp(args[0], "new") == 0)
+  {
+    command_new(daemon, args, count, response, size);
+  }
+  else if (strcmp(args[0], "list") == 0)
+  {
+    size_t length = 0;
+    uint32_t sessions = 0;
+
+    response[0] = '\0';
+    for (uint32_t id = 0; id < CHIP8D_MAX_SESSIONS; id++)
+    {
+      chip8d_session_t *session = &daemon->sessions[id];
+
+      pthread_mutex_lock(&session->lock);
+      if ((session->state != CHIP8D_FREE) && (length < size))
+      {
+        length += snprintf(response + length, size - length, "%u %s %llu %u %04X %s\n", id, state_names[session->state],
+                           (unsigned long long)session->frames, session->speed, session->keypad, session->rom);
+        sessions++;
+      }
+      pthread_mutex_unlock(&session->lock);
+    }
+    if (length < size)
+    {
+      snprintf(response + length, size - length, "OK %u\n", sessions);
+    }
+  }
+  else if (strcmp(args[0], "stats") == 0)
+  {
+    uint32_t sessions = 0;
+    for (uint32_t id = 0; id < CHIP8D_MAX_SESSIONS; id++)
+    {
+      sessions += (__atomic_load_n(&daemon->sessions[id].state, __ATOMIC_RELAXED) != CHIP8D_FREE);
+    }
+    snprintf(response, size, "OK sessions=%u workers=%u ticks=%llu frames=%llu overruns=%llu\n", sessions,
+             daemon->worker_count, (unsigned long long)__atomic_load_n(&daemon->ticks, __ATOMIC_RELAXED),
+             (unsigned long long)__atomic_load_n(&daemon->frames, __ATOMIC_RELAXED),
+             (unsigned long long)__atomic_load_n(&daemon->overruns, __ATOMIC_RELAXED));
+  }
+  else
+  {
+    char *end = NULL;
+    unsigned long id = (count >= 2) ? strtoul(args[1], &end, 10) : CHIP8D_MAX_SESSIONS;
+
+    if ((end == NULL) || (*end != '\0') || (id >= CHIP8D_MAX_SESSIONS))
+    {
+      snprintf(response, size, "ERR usage: %s <id> ...\n", args[0]);
+    }
+    else
+    {
+      chip8d_session_t *session = &daemon->sessions[id];
+
+      pthread_mutex_lock(&session->lock);
+      if (session->state == CHIP8D_FREE)
+      {
+        snprintf(response, size, "ERR no session %lu\n", id);
+      }
+      else
+      {
+        command_session(daemon, args, count, session, (uint32_t)id, response, size);
+      }
+      pthread_mutex_unlock(&session->lock);
+    }
+  }
+
+  pthread_mutex_unlock(&daemon->lock);
+}
+
+static void drop_client(chip8d_t *const daemon, chip8d_client_t *const client)
+{
+  epoll_ctl(daemon->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+  close(client->fd);
+  free(client->output);
+  memset(client, 0, sizeof(chip8d_client_t));
+  client->fd = -1;
+}
+
+static void accept_client(chip8d_t *const daemon)
+{
+  int fd = accept(daemon->listen_fd, NULL, NULL);
+  if (fd < 0)
+  {
+    return;
+  }
+
+  chip8d_client_t *client = NULL;
+  for (uint32_t i = 0; (i < CHIP8D_MAX_CLIENTS) && (client == NULL); i++)
+  {
+    client = (daemon->clients[i].fd < 0) ? &daemon->clients[i] : NULL;
+  }
+
+  // Sends must not block the loop serving every other client and the ticks
+  int flags = fcntl(fd, F_GETFL, 0);
+  char *output = (client != NULL) ? malloc(CHIP8D_CLIENT_BUFFER) : NULL;
+  if ((output == NULL) || (flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0))
+  {
+    Log_W("Refusing control connection: %s", (client == NULL) ? "too many clients" : "out of resources");
+    free(output);
+    close(fd);
+    return;
+  }
+
+  memset(client, 0, sizeof(chip8d_client_t));
+  client->fd = fd;
+  client->output = output;
+
+  struct epoll_event event = {.events = EPOLLIN, .data.u32 = (uint32_t)(client - daemon->clients)};
+  epoll_ctl(daemon->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+/** Send what the socket takes of a client's responses, waiting for it to become writable for the rest */
+static status_code_t flush_client(chip8d_t *const daemon, chip8d_client_t *const client)
+{
+  while (client->output_sent < client->output_length)
+  {
+    ssize_t sent = send(client->fd, client->output + client->output_sent, client->output_length - client->output_sent, MSG_NOSIGNAL);
+
+    if (sent > 0)
+    {
+      client->output_sent += (size_t)sent;
+    }
+    else if ((sent < 0) && (errno == EINTR))
+    {
+      continue;
+    }
+    else if ((sent < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+    {
+      break;
+    }
+    else
+    {
+      return STATUS_ERR_GENERIC;
+    }
+  }
+
+  if (client->output_sent == client->output_length)
+  {
+    client->output_sent = 0;
+    client->output_length = 0;
+  }
+
+  uint8_t waiting = (client->output_length > 0);
+  if (waiting != client->waiting_writable)
+  {
+    struct epoll_event event = {.events = EPOLLIN | (waiting ? EPOLLOUT : 0), .data.u32 = (uint32_t)(client - daemon->clients)};
+    epoll_ctl(daemon->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+    client->waiting_writable = waiting;
+  }
+
+  return STATUS_OK;
+}
+
+/** Queue a response for a client; fails if the client is too far behind on reading them */
+static status_code_t queue_response(chip8d_client_t *const client, const char *const response)
+{
+  size_t size = strlen(response);
+
+  if ((client->output_sent > 0) && ((client->output_length + size) > CHIP8D_CLIENT_BUFFER))
+  {
+    memmove(client->output, client->output + client->output_sent, client->output_length - client->output_sent);
+    client->output_length -= client->output_sent;
+    client->output_sent = 0;
+  }
+
+  if ((client->output_length + size) > CHIP8D_CLIENT_BUFFER)
+  {
+    Log_W("Dropping control client on fd %d: not reading its responses", client->fd);
+    return STATUS_ERR_GENERIC;
+  }
+
+  memcpy(client->output + client->output_length, response, size);
+  client->output_length += size;
+  return STATUS_OK;
+}
+
+/** Run the complete command lines a client sent; returns non-zero once the client is gone */
+static uint8_t serve_client(chip8d_t *const daemon, chip8d_client_t *const client)
+{
+  ssize_t length = read(client->fd, client->line + client->length, CHIP8D_LINE_SIZE - client->length);
+  if (length <= 0)
+  {
+    return (length == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR));
+  }
+  client->length += (uint32_t)length;
+
+  char *newline;
+  while ((newline = memchr(client->line, '\n', client->length)) != NULL)
+  {
+    size_t line_length = (size_t)(newline - client->line);
+
+    *newline = '\0';
+    chip8d_execute(daemon, client->line, daemon->response, CHIP8D_RESPONSE_SIZE);
+    if (queue_response(client, daemon->response) != STATUS_OK)
+    {
+      return 1;
+    }
+
+    client->length -= (uint32_t)(line_length + 1);
+    memmove(client->line, newline + 1, client->length);
+  }
+
+  if (client->length == CHIP8D_LINE_SIZE)
+  {
+    client->length = 0;
+    if (queue_response(client, "ERR line too long\n") != STATUS_OK)
+    {
+      return 1;
+    }
+  }
+
+  return flush_client(daemon, client) != STATUS_OK;
+}
+
+status_code_t chip8d_init(chip8d_t *const daemon, const char *socket_path, uint32_t const workers)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(daemon);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(socket_path);
+
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+
+  if ((workers == 0) || (workers > CHIP8D_MAX_WORKERS) || (strlen(socket_path) >= sizeof(address.sun_path)))
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(daemon, 0, sizeof(chip8d_t));
+  snprintf(daemon->socket_path, sizeof(daemon->socket_path), "%s", socket_path);
+  strcpy(address.sun_path, socket_path);
+  daemon->listen_fd = -1;
+  daemon->epoll_fd = -1;
+  daemon->timer_fd = -1;
+  daemon->wake_fd = -1;
+  for (uint32_t i = 0; i < CHIP8D_MAX_CLIENTS; i++)
+  {
+    daemon->clients[i].fd = -1;
+  }
+
+  pthread_mutex_init(&daemon->lock, NULL);
+  pthread_mutex_init(&daemon->queue_lock, NULL);
+  pthread_cond_init(&daemon->queue_ready, NULL);
+
+  daemon->sessions = calloc(CHIP8D_MAX_SESSIONS, sizeof(chip8d_session_t));
+  daemon->response = malloc(CHIP8D_RESPONSE_SIZE);
+  if ((daemon->sessions == NULL) || (daemon->response == NULL))
+  {
+    chip8d_cleanup(daemon);
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  for (uint32_t i = 0; i < CHIP8D_MAX_SESSIONS; i++)
+  {
+    pthread_mutex_init(&daemon->sessions[i].lock, NULL);
+  }
+
+  // A socket left behind by a daemon that did not shut down cleanly would fail the bind
+  unlink(socket_path);
+
+  struct itimerspec period = {.it_interval = {.tv_nsec = CHIP8D_TICK_NS}, .it_value = {.tv_nsec = CHIP8D_TICK_NS}};
+  daemon->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  daemon->epoll_fd = epoll_create1(0);
+  daemon->timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+  daemon->wake_fd = eventfd(0, 0);
+
+  if ((daemon->listen_fd < 0) || (daemon->epoll_fd < 0) || (daemon->timer_fd < 0) || (daemon->wake_fd < 0) ||
+      (bind(daemon->listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0) ||
+      (listen(daemon->listen_fd, CHIP8D_BACKLOG) != 0) || (timerfd_settime(daemon->timer_fd, 0, &period, NULL) != 0))
+  {
+    Log_E("Failed to listen on %s: %s", socket_path, strerror(errno));
+    chip8d_cleanup(daemon);
+    return STATUS_ERR_GENERIC;
+  }
+
+  struct epoll_event listen_event = {.events = EPOLLIN, .data.u32 = CHIP8D_LISTEN_TAG};
+  struct epoll_event wake_event = {.events = EPOLLIN, .data.u32 = CHIP8D_WAKE_TAG};
+  epoll_ctl(daemon->epoll_fd, EPOLL_CTL_ADD, daemon->listen_fd, &listen_event);
+  epoll_ctl(daemon->epoll_fd, EPOLL_CTL_ADD, daemon->wake_fd, &wake_event);
+
+  if (stream_hub_init(&daemon->streams) != STATUS_OK)
+  {
+    chip8d_cleanup(daemon);
+    return STATUS_ERR_GENERIC;
+  }
+  daemon->streams_started = 1;
+
+  for (; daemon->worker_count < workers; daemon->worker_count++)
+  {
+    if (pthread_create(&daemon->workers[daemon->worker_count], NULL, chip8d_worker, daemon) != 0)
+    {
+      chip8d_cleanup(daemon);
+      return STATUS_ERR_GENERIC;
+    }
+  }
+
+  Log_I("chip8d listening on %s with %u workers", socket_path, workers);
+  return STATUS_OK;
+}
+
+status_code_t chip8d_run(chip8d_t *const daemon)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(daemon);
+
+  struct epoll_event events[CHIP8D_EPOLL_EVENTS];
+  pthread_t ticker;
+  status_code_t status = STATUS_OK;
+  uint8_t running = 1;
+
+  __atomic_store_n(&daemon->ticker_stopping, 0, __ATOMIC_RELEASE);
+  if (pthread_create(&ticker, NULL, chip8d_ticker, daemon) != 0)
+  {
+    return STATUS_ERR_GENERIC;
+  }
+
+  while (running)
+  {
+    int count = epoll_wait(daemon->epoll_fd, events, CHIP8D_EPOLL_EVENTS, -1);
+    if ((count < 0) && (errno != EINTR))
+    {
+      status = STATUS_ERR_GENERIC;
+      break;
+    }
+
+    for (int e = 0; (e < count) && running; e++)
+    {
+      uint32_t tag = events[e].data.u32;
+
+      if (tag == CHIP8D_WAKE_TAG)
+      {
+        running = 0;
+      }
+      else if (tag == CHIP8D_LISTEN_TAG)
+      {
+        accept_client(daemon);
+      }
+      else if (daemon->clients[tag].fd >= 0)
+      {
+        chip8d_client_t *client = &daemon->clients[tag];
+
+        if ((events[e].events & (EPOLLERR | EPOLLHUP)) || ((events[e].events & EPOLLIN) && serve_client(daemon, client)) ||
+            ((events[e].events & EPOLLOUT) && (flush_client(daemon, client) != STATUS_OK)))
+        {
+          drop_client(daemon, client);
+        }
+      }
+    }
+  }
+
+  // The ticker notices within a tick
+  __atomic_store_n(&daemon->ticker_stopping, 1, __ATOMIC_RELEASE);
+  pthread_join(ticker, NULL);
+  return status;
+}
+
+void chip8d_stop(chip8d_t *const daemon)
+{
+  uint64_t wake = 1;
+
+  if ((daemon != NULL) && (daemon->wake_fd >= 0))
+  {
+    // Only async-signal-safe calls here
+    ssize_t written = write(daemon->wake_fd, &wake, sizeof(wake));
+    (void)written;
+  }
+}
+
+void chip8d_cleanup(chip8d_t *const daemon)
+{
+  if (daemon == NULL)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&daemon->queue_lock);
+  daemon->stopping = 1;
+  pthread_cond_broadcast(&daemon->queue_ready);
+  pthread_mutex_unlock(&daemon->queue_lock);
+
+  for (uint32_t i = 0; i < daemon->worker_count; i++)
+  {
+    pthread_join(daemon->workers[i], NULL);
+  }
+  daemon->worker_count = 0;
+
+  for (uint32_t i = 0; (daemon->sessions != NULL) && (i < CHIP8D_MAX_SESSIONS); i++)
+  {
+    if (daemon->sessions[i].state != CHIP8D_FREE)
+    {
+      close_session(&daemon->sessions[i]);
+    }
+    pthread_mutex_destroy(&daemon->sessions[i].lock);
+  }
+  free(daemon->sessions);
+  daemon->sessions = NULL;
+
+  // After the sessions, which detach their streams from it
+  if (daemon->streams_started)
+  {
+    stream_hub_cleanup(&daemon->streams);
+    daemon->streams_started = 0;
+  }
+
+  for (uint32_t i = 0; i < CHIP8D_MAX_TEMPLATES; i++)
+  {
+    cleanup_cpu(&daemon->templates[i].state);
+    daemon->templates[i].loaded = 0;
+  }
+
+  for (uint32_t i = 0; i < CHIP8D_MAX_CLIENTS; i++)
+  {
+    if (daemon->clients[i].fd >= 0)
+    {
+      drop_client(daemon, &daemon->clients[i]);
+    }
+  }
+
+  int *fds[] = {&daemon->listen_fd, &daemon->epoll_fd, &daemon->timer_fd, &daemon->wake_fd};
+  for (uint8_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+  {
+    if (*fds[i] >= 0)
+    {
+      close(*fds[i]);
+      *fds[i] = -1;
+    }
+  }
+
+  if (daemon->socket_path[0] != '\0')
+  {
+    unlink(daemon->socket_path);
+    daemon->socket_path[0] = '\0';
+  }
+
+  free(daemon->response);
+  daemon->response = NULL;
+
+  pthread_cond_destroy(&daemon->queue_ready);
+  pthread_mutex_destroy(&daemon->queue_lock);
+  pthread_mutex_destroy(&daemon->lock);
+}
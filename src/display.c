@@ -6,23 +6,15 @@
 #include "cpu_def.h"
 #include "logging.h"
 #include "status_code.h"
+#include "trace.h"
 
-#define PIXEL_WIDTH (8)
+#define PIXEL_WIDTH (8) // Size of a low resolution pixel; high resolution pixels are half as wide
 
-typedef struct display_handle_s
-{
-  SDL_Window *window;
-  SDL_Renderer *renderer;
-  color_rgba_t fg_color;
-  color_rgba_t bg_color;
-} display_handle_t;
-
-static display_handle_t display_handle;
-
-status_code_t display_init(const char *title, display_init_param_t *const param)
+status_code_t display_init(display_t *const display, const char *title, display_init_param_t *const param)
 {
   Log_I("Initializing the display module...");
 
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(display);
   VERIFY_PTR_RETURN_ERROR_IF_NULL(title);
   VERIFY_PTR_RETURN_ERROR_IF_NULL(param);
 
@@ -33,26 +25,79 @@ status_code_t display_init(const char *title, display_init_param_t *const param)
     return STATUS_ERR_GENERIC;
   }
 
-  display_handle.window = SDL_CreateWindow(
+  display->window = SDL_CreateWindow(
       title,
       SDL_WINDOWPOS_CENTERED,
       SDL_WINDOWPOS_CENTERED,
       (GRAPHICS_WIDTH * PIXEL_WIDTH),
       (GRAPHICS_HEIGHT * PIXEL_WIDTH),
       0);
+  if (display->window == NULL)
+  {
+    Log_E("Failed to create the window: %s", SDL_GetError());
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    return STATUS_ERR_GENERIC;
+  }
 
-  display_handle.renderer = SDL_CreateRenderer(display_handle.window, -1, SDL_RENDERER_ACCELERATED);
+  // Hosts without a GPU, e.g. remote sessions, still get a software renderer
+  display->renderer = SDL_CreateRenderer(display->window, -1, SDL_RENDERER_ACCELERATED);
+  if (display->renderer == NULL)
+  {
+    Log_W("No accelerated renderer (%s); falling back to software rendering", SDL_GetError());
+    display->renderer = SDL_CreateRenderer(display->window, -1, SDL_RENDERER_SOFTWARE);
+  }
+  if (display->renderer == NULL)
+  {
+    Log_E("Failed to create a renderer: %s", SDL_GetError());
+    SDL_DestroyWindow(display->window);
+    display->window = NULL;
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    return STATUS_ERR_GENERIC;
+  }
 
-  memcpy(&display_handle.bg_color, &param->background_color, sizeof(color_rgba_t));
-  memcpy(&display_handle.fg_color, &param->foreground_color, sizeof(color_rgba_t));
+  memcpy(&display->bg_color, &param->background_color, sizeof(color_rgba_t));
+  memcpy(&display->fg_color, &param->foreground_color, sizeof(color_rgba_t));
+  memcpy(&display->plane2_color, &param->plane2_color, sizeof(color_rgba_t));
+  memcpy(&display->overlap_color, &param->overlap_color, sizeof(color_rgba_t));
 
   Log_I("Display module successfully initialized.");
   return STATUS_OK;
 }
 
-status_code_t display_render(graphics_t *const graphics)
+/**
+ * Helper function to draw every lit pixel of a row as horizontal runs.
+ * Each run of lit pixels is drawn as a single rectangle using the current draw color.
+ */
+static void render_row(SDL_Renderer *const renderer, uint64_t const *const row_words, uint8_t const words, uint8_t const row, uint8_t const pixel_width)
 {
+  for (uint8_t w = 0; w < words; w++)
+  {
+    uint64_t bits = row_words[w];
+    uint8_t col = 0;
+
+    while (bits)
+    {
+      uint8_t gap = __builtin_clzll(bits);
+      bits <<= gap;
+      uint8_t run = (~bits) ? __builtin_clzll(~bits) : GRAPHICS_WORD_BITS;
+      bits = (run < GRAPHICS_WORD_BITS) ? (bits << run) : 0;
 
+      SDL_Rect rect;
+
+      rect.x = ((w * GRAPHICS_WORD_BITS) + col + gap) * pixel_width;
+      rect.y = row * pixel_width;
+      rect.w = run * pixel_width;
+      rect.h = pixel_width;
+
+      SDL_RenderFillRect(renderer, &rect);
+      col += gap + run;
+    }
+  }
+}
+
+status_code_t display_render(display_t *const display, graphics_t *const graphics)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(display);
   VERIFY_PTR_RETURN_ERROR_IF_NULL(graphics);
   if (!graphics->display_update)
   {
@@ -60,40 +105,86 @@ status_code_t display_render(graphics_t *const graphics)
   }
 
   graphics->display_update = 0;
-  color_rgba_t const *fg_color = &display_handle.fg_color;
-  color_rgba_t const *bg_color = &display_handle.bg_color;
-
-  SDL_SetRenderDrawColor(display_handle.renderer, bg_color->r, bg_color->g, bg_color->b, bg_color->a);
-  SDL_RenderClear(display_handle.renderer);
-
-  SDL_SetRenderDrawColor(display_handle.renderer, fg_color->r, fg_color->g, fg_color->b, fg_color->a);
-
-  for (uint8_t row = 0; row < GRAPHICS_HEIGHT; row++)
+  color_rgba_t const *bg_color = &display->bg_color;
+
+  /**
+   * Pixels are colored by which planes they are lit in: plane 1 only,
+   * plane 2 only, or both. Each combination is drawn in its own pass.
+   */
+  color_rgba_t const *pass_colors[] = {
+      &display->fg_color,
+      &display->plane2_color,
+      &display->overlap_color,
+  };
+
+  SDL_SetRenderDrawColor(display->renderer, bg_color->r, bg_color->g, bg_color->b, bg_color->a);
+  SDL_RenderClear(display->renderer);
+
+  uint8_t height = GRAPHICS_ACTIVE_HEIGHT(graphics);
+  uint8_t words = GRAPHICS_ACTIVE_WIDTH(graphics) / GRAPHICS_WORD_BITS;
+  uint8_t pixel_width = graphics->hires ? (PIXEL_WIDTH / 2) : PIXEL_WIDTH;
+
+  for (uint8_t pass = 0; pass < 3; pass++)
   {
-    for (uint8_t col = 0; col < GRAPHICS_WIDTH; col++)
-    {
-      if (graphics->buffer[col + (row * GRAPHICS_WIDTH)])
-      {
-        SDL_Rect rect;
+    color_rgba_t const *color = pass_colors[pass];
+    SDL_SetRenderDrawColor(display->renderer, color->r, color->g, color->b, color->a);
 
-        rect.x = col * PIXEL_WIDTH;
-        rect.y = row * PIXEL_WIDTH;
-        rect.w = PIXEL_WIDTH;
-        rect.h = PIXEL_WIDTH;
+    for (uint8_t row = 0; row < height; row++)
+    {
+      uint64_t row_words[GRAPHICS_ROW_WORDS];
 
-        SDL_RenderFillRect(display_handle.renderer, &rect);
+      for (uint8_t w = 0; w < words; w++)
+      {
+        uint64_t p0 = graphics->buffer[0][row][w];
+        uint64_t p1 = graphics->buffer[1][row][w];
+        row_words[w] = (pass == 0) ? (p0 & ~p1) : (pass == 1) ? (~p0 & p1) : (p0 & p1);
       }
+
+      render_row(display->renderer, row_words, words, row, pixel_width);
     }
   }
 
-  SDL_RenderPresent(display_handle.renderer);
+  TRACE_SPAN_BEGIN(present_span);
+  SDL_RenderPresent(display->renderer);
+  TRACE_SPAN_END(present_span, "SDL_RenderPresent");
   return STATUS_OK;
 }
 
-void display_cleanup()
+void display_cleanup(display_t *const display)
 {
+  if (display == NULL)
+  {
+    return;
+  }
+
   Log_I("Cleaning up the display module.");
-  SDL_DestroyRenderer(display_handle.renderer);
-  SDL_DestroyWindow(display_handle.window);
-  SDL_Quit();
+  if (display->renderer != NULL)
+  {
+    SDL_DestroyRenderer(display->renderer);
+  }
+  if (display->window != NULL)
+  {
+    SDL_DestroyWindow(display->window);
+  }
+  display->renderer = NULL;
+  display->window = NULL;
+
+  // Other sessions may still have windows open; SDL_Quit is left to the application
+  SDL_QuitSubSystem(SDL_INIT_VIDEO);
 }
+
+/** Adapters of the video backend table */
+static status_code_t render_backend(void *const handle, graphics_t *const graphics)
+{
+  return display_render(handle, graphics);
+}
+
+static void cleanup_backend(void *const handle)
+{
+  display_cleanup(handle);
+}
+
+const video_backend_t display_sdl_backend = {
+    .render = render_backend,
+    .cleanup = cleanup_backend,
+};
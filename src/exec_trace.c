@@ -0,0 +1,467 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exec_trace.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "status_code.h"
+
+#define HEADER_SIZE (6) // Magic, version and quirk profile
+
+/**
+ * Helper function to write the buffered records to the trace file.
+ * The first error is kept, so that it's reported even if later writes succeed.
+ */
+static status_code_t flush_buffer(exec_trace_t *const trace)
+{
+  if (trace->length == 0)
+  {
+    return trace->status;
+  }
+
+  size_t length = trace->length;
+  trace->length = 0;
+
+  if ((fwrite(trace->buffer, 1, length, trace->file) != length) && (trace->status == STATUS_OK))
+  {
+    trace->status = STATUS_ERR_GENERIC;
+  }
+  return trace->status;
+}
+
+static inline void put_u8(exec_trace_t *const trace, uint8_t const value)
+{
+  trace->buffer[trace->length++] = value;
+}
+
+static inline void put_u16(exec_trace_t *const trace, uint16_t const value)
+{
+  trace->buffer[trace->length++] = (uint8_t)(value >> 8);
+  trace->buffer[trace->length++] = (uint8_t)(value & 0xFF);
+}
+
+static inline void put_u64(exec_trace_t *const trace, uint64_t const value)
+{
+  for (int8_t shift = 56; shift >= 0; shift -= 8)
+  {
+    trace->buffer[trace->length++] = (uint8_t)(value >> shift);
+  }
+}
+
+status_code_t exec_trace_start(exec_trace_t *const trace, cpu_state_t *const state, const char *path)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(trace);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(path);
+
+  memset(trace, 0, sizeof(exec_trace_t));
+
+  trace->buffer = malloc(EXEC_TRACE_BUFFER_SIZE);
+  if (trace->buffer == NULL)
+  {
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  trace->file = fopen(path, "wb");
+  if (trace->file == NULL)
+  {
+    free(trace->buffer);
+    trace->buffer = NULL;
+    return STATUS_ERR_FILE_NOT_FOUND;
+  }
+
+  memcpy(trace->buffer, EXEC_TRACE_MAGIC, 4);
+  trace->length = 4;
+  put_u8(trace, EXEC_TRACE_VERSION);
+  put_u8(trace, (uint8_t)state->quirk_profile);
+  trace->quirk_profile = (uint8_t)state->quirk_profile;
+
+  state->exec_trace = trace;
+  return STATUS_OK;
+}
+
+status_code_t exec_trace_stop(exec_trace_t *const trace, cpu_state_t *const state)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(trace);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  if (state->exec_trace == trace)
+  {
+    state->exec_trace = NULL;
+  }
+
+  status_code_t status = trace->status;
+
+  if (trace->file != NULL)
+  {
+    status = flush_buffer(trace);
+    if ((fclose(trace->file) != 0) && (status == STATUS_OK))
+    {
+      status = STATUS_ERR_GENERIC;
+    }
+    trace->file = NULL;
+  }
+
+  free(trace->buffer);
+  trace->buffer = NULL;
+
+  return status;
+}
+
+void exec_trace_begin(exec_trace_t *const trace, cpu_state_t *const state)
+{
+  memcpy(&trace->before, &state->registers, sizeof(registers_t));
+  trace->record.pc = state->registers.pc;
+  trace->record.write_count = 0;
+
+  // An opcode that can't be fetched is recorded as 0, the fetch failure as the instruction's status
+  if (chip8_peek_opcode(state, &trace->record.opcode) != STATUS_OK)
+  {
+    trace->record.opcode = 0;
+  }
+}
+
+void exec_trace_mem_write(exec_trace_t *const trace, uint16_t const address, uint8_t const *data, size_t const size)
+{
+  exec_trace_record_t *record = &trace->record;
+
+  if (record->write_count >= EXEC_TRACE_MAX_WRITES)
+  {
+    return;
+  }
+
+  exec_trace_write_t *write = &record->writes[record->write_count++];
+  write->address = address;
+  write->size = (size < EXEC_TRACE_MAX_WRITE_SIZE) ? size : EXEC_TRACE_MAX_WRITE_SIZE;
+  memcpy(write->data, data, write->size);
+}
+
+status_code_t exec_trace_end(exec_trace_t *const trace, cpu_state_t *const state, status_code_t const status)
+{
+  registers_t const *before = &trace->before;
+  registers_t const *after = &state->registers;
+  timers_t const *timers = &state->timers;
+  graphics_t const *gfx = &state->peripherals.graphics;
+  exec_trace_record_t *record = &trace->record;
+
+  uint8_t flags = 0;
+  uint16_t v_mask = 0;
+  uint16_t stack_mask = 0;
+
+  for (uint8_t i = 0; i < REG_COUNT; i++)
+  {
+    v_mask |= (before->V[i] != after->V[i]) ? (1 << i) : 0;
+  }
+
+  for (uint8_t i = 0; i < STACK_SIZE; i++)
+  {
+    stack_mask |= (before->stack[i] != after->stack[i]) ? (1 << i) : 0;
+  }
+
+  flags |= (!trace->has_last_pc || (record->pc != (uint16_t)(trace->last_pc + 2))) ? EXEC_TRACE_FLAG_PC : 0;
+  flags |= v_mask ? EXEC_TRACE_FLAG_V : 0;
+  flags |= (before->I != after->I) ? EXEC_TRACE_FLAG_I : 0;
+  flags |= ((before->sp != after->sp) || stack_mask) ? EXEC_TRACE_FLAG_SP : 0;
+  flags |= record->write_count ? EXEC_TRACE_FLAG_MEM : 0;
+  flags |= (status != STATUS_OK) ? EXEC_TRACE_FLAG_STATUS : 0;
+  flags |= (!trace->has_last_pc || (timers->delay != trace->last_timers.delay) || (timers->sound != trace->last_timers.sound))
+               ? EXEC_TRACE_FLAG_TIMERS
+               : 0;
+  flags |= (!trace->has_last_pc || (gfx->hires != trace->last_hires) || (state->hash.graphics != trace->last_graphics_hash))
+               ? EXEC_TRACE_FLAG_GFX
+               : 0;
+
+  // Worst case record size: every field present with every write at its largest
+  size_t max_size = 5 + 2 + REG_COUNT + 2 + 3 + (2 * STACK_SIZE) + 1 + (EXEC_TRACE_MAX_WRITES * (3 + EXEC_TRACE_MAX_WRITE_SIZE)) + 1 + 2 + 9;
+  if ((trace->length + max_size) > EXEC_TRACE_BUFFER_SIZE)
+  {
+    flush_buffer(trace);
+  }
+
+  put_u8(trace, flags);
+  put_u16(trace, record->opcode);
+
+  if (flags & EXEC_TRACE_FLAG_PC)
+  {
+    put_u16(trace, record->pc);
+  }
+
+  if (flags & EXEC_TRACE_FLAG_V)
+  {
+    put_u16(trace, v_mask);
+    for (uint8_t i = 0; i < REG_COUNT; i++)
+    {
+      if (v_mask & (1 << i))
+      {
+        put_u8(trace, after->V[i]);
+      }
+    }
+  }
+
+  if (flags & EXEC_TRACE_FLAG_I)
+  {
+    put_u16(trace, after->I);
+  }
+
+  if (flags & EXEC_TRACE_FLAG_SP)
+  {
+    put_u8(trace, after->sp);
+    put_u16(trace, stack_mask);
+    for (uint8_t i = 0; i < STACK_SIZE; i++)
+    {
+      if (stack_mask & (1 << i))
+      {
+        put_u16(trace, after->stack[i]);
+      }
+    }
+  }
+
+  if (flags & EXEC_TRACE_FLAG_MEM)
+  {
+    put_u8(trace, record->write_count);
+    for (uint8_t i = 0; i < record->write_count; i++)
+    {
+      put_u16(trace, record->writes[i].address);
+      put_u8(trace, record->writes[i].size);
+      memcpy(&trace->buffer[trace->length], record->writes[i].data, record->writes[i].size);
+      trace->length += record->writes[i].size;
+    }
+  }
+
+  if (flags & EXEC_TRACE_FLAG_STATUS)
+  {
+    put_u8(trace, (uint8_t)status);
+  }
+
+  if (flags & EXEC_TRACE_FLAG_TIMERS)
+  {
+    put_u8(trace, timers->delay);
+    put_u8(trace, timers->sound);
+  }
+
+  if (flags & EXEC_TRACE_FLAG_GFX)
+  {
+    put_u8(trace, gfx->hires);
+    put_u64(trace, state->hash.graphics);
+  }
+
+  trace->last_pc = record->pc;
+  trace->has_last_pc = 1;
+  trace->last_timers = *timers;
+  trace->last_hires = gfx->hires;
+  trace->last_graphics_hash = state->hash.graphics;
+  trace->record_count++;
+
+  return trace->status;
+}
+
+/**
+ * Helper function to copy the next bytes of the trace file, refilling the buffer as needed.
+ * Returns 0 if the file ends first.
+ */
+static uint8_t get_bytes(exec_trace_t *const trace, uint8_t *dest, size_t size)
+{
+  while (size > 0)
+  {
+    if (trace->position == trace->length)
+    {
+      trace->length = fread(trace->buffer, 1, EXEC_TRACE_BUFFER_SIZE, trace->file);
+      trace->position = 0;
+
+      if (trace->length == 0)
+      {
+        return 0;
+      }
+    }
+
+    size_t available = trace->length - trace->position;
+    size_t chunk = (available < size) ? available : size;
+
+    memcpy(dest, &trace->buffer[trace->position], chunk);
+    trace->position += chunk;
+    dest += chunk;
+    size -= chunk;
+  }
+
+  return 1;
+}
+
+static uint8_t get_u16(exec_trace_t *const trace, uint16_t *const value)
+{
+  uint8_t bytes[2];
+
+  if (!get_bytes(trace, bytes, 2))
+  {
+    return 0;
+  }
+
+  *value = (uint16_t)(bytes[0] << 8) | bytes[1];
+  return 1;
+}
+
+static uint8_t get_u64(exec_trace_t *const trace, uint64_t *const value)
+{
+  uint8_t bytes[8];
+
+  if (!get_bytes(trace, bytes, 8))
+  {
+    return 0;
+  }
+
+  *value = 0;
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    *value = (*value << 8) | bytes[i];
+  }
+  return 1;
+}
+
+status_code_t exec_trace_open(exec_trace_t *const trace, const char *path)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(trace);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(path);
+
+  memset(trace, 0, sizeof(exec_trace_t));
+
+  trace->file = fopen(path, "rb");
+  if (trace->file == NULL)
+  {
+    return STATUS_ERR_FILE_NOT_FOUND;
+  }
+
+  trace->buffer = malloc(EXEC_TRACE_BUFFER_SIZE);
+  if (trace->buffer == NULL)
+  {
+    exec_trace_close(trace);
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  uint8_t header[HEADER_SIZE];
+  if (!get_bytes(trace, header, HEADER_SIZE) || (memcmp(header, EXEC_TRACE_MAGIC, 4) != 0) ||
+      (header[4] != EXEC_TRACE_VERSION) || (header[5] >= QUIRK_PROFILE_COUNT))
+  {
+    exec_trace_close(trace);
+    return STATUS_ERR_GENERIC;
+  }
+
+  trace->quirk_profile = header[5];
+  return STATUS_OK;
+}
+
+status_code_t exec_trace_read(exec_trace_t *const trace, exec_trace_record_t *const record)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(trace);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(record);
+
+  memset(record, 0, sizeof(exec_trace_record_t));
+
+  if (!get_bytes(trace, &record->flags, 1))
+  {
+    return STATUS_REQ_EXIT;
+  }
+
+  // The first record has no earlier one to carry fields over from
+  if ((trace->record_count == 0) &&
+      ((record->flags & (EXEC_TRACE_FLAG_PC | EXEC_TRACE_FLAG_TIMERS | EXEC_TRACE_FLAG_GFX)) !=
+       (EXEC_TRACE_FLAG_PC | EXEC_TRACE_FLAG_TIMERS | EXEC_TRACE_FLAG_GFX)))
+  {
+    return STATUS_ERR_GENERIC;
+  }
+
+  uint8_t ok = get_u16(trace, &record->opcode);
+
+  record->pc = trace->last_pc + 2;
+  if (ok && (record->flags & EXEC_TRACE_FLAG_PC))
+  {
+    ok = get_u16(trace, &record->pc);
+  }
+
+  if (ok && (record->flags & EXEC_TRACE_FLAG_V))
+  {
+    ok = get_u16(trace, &record->v_mask);
+    for (uint8_t i = 0; ok && (i < REG_COUNT); i++)
+    {
+      if (record->v_mask & (1 << i))
+      {
+        ok = get_bytes(trace, &record->V[i], 1);
+      }
+    }
+  }
+
+  if (ok && (record->flags & EXEC_TRACE_FLAG_I))
+  {
+    ok = get_u16(trace, &record->I);
+  }
+
+  if (ok && (record->flags & EXEC_TRACE_FLAG_SP))
+  {
+    ok = get_bytes(trace, &record->sp, 1) && get_u16(trace, &record->stack_mask);
+    for (uint8_t i = 0; ok && (i < STACK_SIZE); i++)
+    {
+      if (record->stack_mask & (1 << i))
+      {
+        ok = get_u16(trace, &record->stack[i]);
+      }
+    }
+  }
+
+  if (ok && (record->flags & EXEC_TRACE_FLAG_MEM))
+  {
+    ok = get_bytes(trace, &record->write_count, 1) && (record->write_count <= EXEC_TRACE_MAX_WRITES);
+    for (uint8_t i = 0; ok && (i < record->write_count); i++)
+    {
+      exec_trace_write_t *write = &record->writes[i];
+      ok = get_u16(trace, &write->address) && get_bytes(trace, &write->size, 1) &&
+           (write->size <= EXEC_TRACE_MAX_WRITE_SIZE) && get_bytes(trace, write->data, write->size);
+    }
+  }
+
+  if (ok && (record->flags & EXEC_TRACE_FLAG_STATUS))
+  {
+    ok = get_bytes(trace, &record->status, 1);
+  }
+
+  record->timers = trace->last_timers;
+  if (ok && (record->flags & EXEC_TRACE_FLAG_TIMERS))
+  {
+    ok = get_bytes(trace, &record->timers.delay, 1) && get_bytes(trace, &record->timers.sound, 1);
+  }
+
+  record->hires = trace->last_hires;
+  record->graphics_hash = trace->last_graphics_hash;
+  if (ok && (record->flags & EXEC_TRACE_FLAG_GFX))
+  {
+    ok = get_bytes(trace, &record->hires, 1) && get_u64(trace, &record->graphics_hash);
+  }
+
+  if (!ok)
+  {
+    return STATUS_ERR_GENERIC;
+  }
+
+  trace->last_pc = record->pc;
+  trace->last_timers = record->timers;
+  trace->last_hires = record->hires;
+  trace->last_graphics_hash = record->graphics_hash;
+  trace->record_count++;
+  return STATUS_OK;
+}
+
+void exec_trace_close(exec_trace_t *const trace)
+{
+  if (trace == NULL)
+  {
+    return;
+  }
+
+  if (trace->file != NULL)
+  {
+    fclose(trace->file);
+    trace->file = NULL;
+  }
+
+  free(trace->buffer);
+  trace->buffer = NULL;
+}
@@ -0,0 +1,102 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "governor.h"
+#include "chip8.h"
+#include "logging.h"
+#include "status_code.h"
+
+#define GOVERNOR_DEFAULT_WINDOW (30)
+#define GOVERNOR_DEFAULT_MIN_HEADROOM (25)
+#define GOVERNOR_DEFAULT_IDLE_HIGH (50)
+#define GOVERNOR_DEFAULT_IDLE_LOW (10)
+
+status_code_t governor_default_params(governor_params_t *const params, timing_mode_t const mode)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(params);
+
+  cycle_clock_t clock;
+  status_code_t status = cycle_clock_init(&clock, mode);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  params->min_budget = (clock.budget * 3) / 4;
+  params->max_budget = clock.budget * 4;
+  params->window = GOVERNOR_DEFAULT_WINDOW;
+  params->min_headroom = GOVERNOR_DEFAULT_MIN_HEADROOM;
+  params->idle_high = GOVERNOR_DEFAULT_IDLE_HIGH;
+  params->idle_low = GOVERNOR_DEFAULT_IDLE_LOW;
+  return STATUS_OK;
+}
+
+status_code_t governor_init(governor_t *const governor, const governor_params_t *params)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(governor);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(params);
+
+  if ((params->min_budget == 0) || (params->min_budget > params->max_budget) || (params->window == 0) ||
+      (params->min_headroom >= 50) || (params->idle_low >= params->idle_high) || (params->idle_high > 100))
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(governor, 0, sizeof(governor_t));
+  governor->params = *params;
+  return STATUS_OK;
+}
+
+status_code_t governor_update(governor_t *const governor, cycle_clock_t *const clock, uint64_t const frame_ns)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(governor);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(clock);
+
+  governor_params_t const *params = &governor->params;
+
+  governor->frames++;
+  governor->frame_ns += frame_ns;
+  governor->instructions += clock->instructions;
+  governor->idle_instructions += clock->idle_instructions;
+
+  if (governor->frames < params->window)
+  {
+    return STATUS_OK;
+  }
+
+  uint64_t average_ns = governor->frame_ns / governor->frames;
+  uint32_t budget = clock->budget;
+
+  governor->headroom = (average_ns >= GOVERNOR_FRAME_NS) ? 0 : (uint32_t)(100 - ((100 * average_ns) / GOVERNOR_FRAME_NS));
+  governor->idle = (governor->instructions == 0) ? 0 : (uint32_t)((100 * governor->idle_instructions) / governor->instructions);
+
+  if (governor->headroom < params->min_headroom)
+  {
+    budget -= budget / 4;
+  }
+  else if (governor->idle > params->idle_high)
+  {
+    budget -= budget / 8;
+  }
+  else if ((governor->idle < params->idle_low) && (governor->headroom >= (2 * params->min_headroom)))
+  {
+    budget += (budget / 4) + 1;
+  }
+
+  budget = (budget < params->min_budget) ? params->min_budget : budget;
+  budget = (budget > params->max_budget) ? params->max_budget : budget;
+
+  if (budget != clock->budget)
+  {
+    Log_D("Clock budget %u -> %u cycles per frame (headroom %u%%, idle %u%%)", clock->budget, budget,
+          governor->headroom, governor->idle);
+    clock->budget = budget;
+    governor->adjustments++;
+  }
+
+  // The rate over the window just observed
+  governor->instructions_per_second = (uint32_t)((governor->instructions * 60) / governor->frames);
+
+  governor->frames = 0;
+  governor->frame_ns = 0;
+  governor->instructions = 0;
+  governor->idle_instructions = 0;
+  return STATUS_OK;
+}
@@ -42,3 +42,13 @@ status_code_t keypad_read(uint16_t *const keypad)
 
   return status;
 }
+
+/** Adapter of the input backend table */
+static status_code_t read_backend(void __attribute__((unused)) *const handle, uint16_t *const keypad)
+{
+  return keypad_read(keypad);
+}
+
+const input_backend_t keypad_sdl_backend = {
+    .read = read_backend,
+};
@@ -0,0 +1,316 @@
+#define _POSIX_C_SOURCE 200809L // nanosleep
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "logging.h"
+#include "status_code.h"
+
+#define WRITER_IDLE_NS (1000000) // How long the writer sleeps when there is nothing to drain
+
+/**
+ * Single-producer single-consumer byte ring owned by one logging thread.
+ * The owning thread only advances head and the writer only advances tail,
+ * so neither side ever needs a lock.
+ */
+typedef struct log_ring_s
+{
+  char buffer[LOG_RING_SIZE];
+  uint32_t head;
+  uint32_t tail;
+  uint32_t dropped;
+  uint8_t retired; // Set when the owning thread exits; the ring is freed once drained
+} log_ring_t;
+
+typedef struct log_handle_s
+{
+  /** Rings of the threads that have logged, each allocated on the thread's first message */
+  log_ring_t *rings[LOG_MAX_THREADS];
+
+  /** Guards rings; held while draining so that rings are not freed under the drain */
+  pthread_mutex_t lock;
+
+  /** Retires the ring of a thread when it exits */
+  pthread_key_t ring_key;
+  pthread_once_t ring_key_once;
+
+  /** log_write calls between checking running and pushing, waited for by log_shutdown */
+  uint32_t writers;
+  uint8_t running;
+  pthread_t writer;
+} log_handle_t;
+
+static log_handle_t log_handle = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .ring_key_once = PTHREAD_ONCE_INIT,
+};
+static __thread log_ring_t *thread_ring;
+
+static const char *const level_names[] = {
+    [LOG_LEVEL_TRACE] = "TRACE",
+    [LOG_LEVEL_DEBUG] = "DEBUG",
+    [LOG_LEVEL_INFO] = "INFO ",
+    [LOG_LEVEL_WARN] = "WARN ",
+    [LOG_LEVEL_ERROR] = "ERROR",
+    [LOG_LEVEL_FATAL] = "FATAL",
+};
+
+/**
+ * Helper function to copy a formatted message into a ring.
+ * Returns 0 and leaves the ring untouched if there isn't room for the whole message.
+ */
+static uint8_t ring_push(log_ring_t *const ring, const char *msg, uint32_t const len)
+{
+  uint32_t head = ring->head;
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+  if ((LOG_RING_SIZE - (head - tail)) < len)
+  {
+    return 0;
+  }
+
+  uint32_t offset = head & (LOG_RING_SIZE - 1);
+  uint32_t first = ((LOG_RING_SIZE - offset) < len) ? (LOG_RING_SIZE - offset) : len;
+
+  memcpy(&ring->buffer[offset], msg, first);
+  memcpy(ring->buffer, msg + first, len - first);
+
+  __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+  return 1;
+}
+
+/**
+ * Helper function to write out everything pending in a ring.
+ * Returns the number of bytes written.
+ */
+static uint32_t ring_drain(log_ring_t *const ring)
+{
+  uint32_t tail = ring->tail;
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  uint32_t len = head - tail;
+
+  if (len > 0)
+  {
+    uint32_t offset = tail & (LOG_RING_SIZE - 1);
+    uint32_t first = ((LOG_RING_SIZE - offset) < len) ? (LOG_RING_SIZE - offset) : len;
+
+    fwrite(&ring->buffer[offset], 1, first, stderr);
+    fwrite(ring->buffer, 1, len - first, stderr);
+
+    __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+  }
+
+  uint32_t dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_ACQ_REL);
+  if (dropped > 0)
+  {
+    fprintf(stderr, "\n%s [%s:%u]: %u log messages dropped", level_names[LOG_LEVEL_WARN], __FILE_NAME__, __LINE__, dropped);
+  }
+
+  return len;
+}
+
+/**
+ * Helper function to drain every ring once, freeing those of threads that have exited.
+ * Returns the total number of bytes written.
+ */
+static uint32_t drain_all(void)
+{
+  uint32_t written = 0;
+
+  pthread_mutex_lock(&log_handle.lock);
+  for (uint32_t i = 0; i < LOG_MAX_THREADS; i++)
+  {
+    log_ring_t *ring = log_handle.rings[i];
+    if (ring == NULL)
+    {
+      continue;
+    }
+
+    // Read before draining: a retired ring gets no more messages after the flag is set
+    uint8_t retired = __atomic_load_n(&ring->retired, __ATOMIC_ACQUIRE);
+
+    written += ring_drain(ring);
+    if (retired)
+    {
+      log_handle.rings[i] = NULL;
+      free(ring);
+    }
+  }
+  pthread_mutex_unlock(&log_handle.lock);
+
+  if (written > 0)
+  {
+    fflush(stderr);
+  }
+
+  return written;
+}
+
+/** Thread exit handler of a thread's ring: the writer frees it once drained, or it is freed here without one */
+static void retire_ring(void *arg)
+{
+  log_ring_t *ring = arg;
+
+  pthread_mutex_lock(&log_handle.lock);
+  if (__atomic_load_n(&log_handle.running, __ATOMIC_ACQUIRE))
+  {
+    __atomic_store_n(&ring->retired, 1, __ATOMIC_RELEASE);
+  }
+  else
+  {
+    for (uint32_t i = 0; i < LOG_MAX_THREADS; i++)
+    {
+      if (log_handle.rings[i] == ring)
+      {
+        log_handle.rings[i] = NULL;
+      }
+    }
+    ring_drain(ring);
+    fflush(stderr);
+    free(ring);
+  }
+  pthread_mutex_unlock(&log_handle.lock);
+}
+
+static void create_ring_key(void)
+{
+  pthread_key_create(&log_handle.ring_key, retire_ring);
+}
+
+/**
+ * Helper function to allocate and register a ring for the calling thread on its first message.
+ * Returns NULL if all LOG_MAX_THREADS rings are in use or no memory is left.
+ */
+static log_ring_t *get_thread_ring(void)
+{
+  if (thread_ring != NULL)
+  {
+    return thread_ring;
+  }
+
+  pthread_once(&log_handle.ring_key_once, create_ring_key);
+
+  log_ring_t *ring = calloc(1, sizeof(log_ring_t));
+  if (ring == NULL)
+  {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&log_handle.lock);
+  for (uint32_t i = 0; (i < LOG_MAX_THREADS) && (thread_ring == NULL); i++)
+  {
+    if (log_handle.rings[i] == NULL)
+    {
+      log_handle.rings[i] = ring;
+      thread_ring = ring;
+    }
+  }
+  pthread_mutex_unlock(&log_handle.lock);
+
+  if (thread_ring == NULL)
+  {
+    free(ring);
+    return NULL;
+  }
+
+  pthread_setspecific(log_handle.ring_key, ring);
+  return thread_ring;
+}
+
+/** Background writer thread; drains the rings until log_shutdown is called */
+static void *log_writer(void __attribute__((unused)) * arg)
+{
+  struct timespec idle = {.tv_sec = 0, .tv_nsec = WRITER_IDLE_NS};
+
+  while (__atomic_load_n(&log_handle.running, __ATOMIC_ACQUIRE))
+  {
+    if (drain_all() == 0)
+    {
+      nanosleep(&idle, NULL);
+    }
+  }
+
+  drain_all();
+  return NULL;
+}
+
+status_code_t log_init(void)
+{
+  if (__atomic_load_n(&log_handle.running, __ATOMIC_ACQUIRE))
+  {
+    return STATUS_OK;
+  }
+
+  __atomic_store_n(&log_handle.running, 1, __ATOMIC_RELEASE);
+
+  if (pthread_create(&log_handle.writer, NULL, log_writer, NULL) != 0)
+  {
+    __atomic_store_n(&log_handle.running, 0, __ATOMIC_RELEASE);
+    return STATUS_ERR_GENERIC;
+  }
+
+  atexit(log_shutdown);
+  return STATUS_OK;
+}
+
+void log_write(uint8_t const level, const char *file, unsigned int const line, const char *format, ...)
+{
+  char msg[LOG_MAX_MSG_SIZE];
+  va_list args;
+
+  int prefix_len = snprintf(msg, sizeof(msg), "\n%s [%s:%u]: ", level_names[level], file, line);
+  if (prefix_len < 0)
+  {
+    return;
+  }
+  prefix_len = (prefix_len < (int)sizeof(msg)) ? prefix_len : (int)(sizeof(msg) - 1);
+
+  va_start(args, format);
+  int body_len = vsnprintf(msg + prefix_len, sizeof(msg) - prefix_len, format, args);
+  va_end(args);
+
+  uint32_t len = prefix_len + ((body_len > 0) ? (uint32_t)body_len : 0);
+  len = (len < sizeof(msg)) ? len : (sizeof(msg) - 1);
+
+  // Announce the push before checking the flag, so that log_shutdown either waits for it or is seen
+  __atomic_add_fetch(&log_handle.writers, 1, __ATOMIC_SEQ_CST);
+
+  log_ring_t *ring = __atomic_load_n(&log_handle.running, __ATOMIC_SEQ_CST) ? get_thread_ring() : NULL;
+
+  if (ring == NULL)
+  {
+    // No writer running or no ring left for this thread: write synchronously
+    fwrite(msg, 1, len, stderr);
+  }
+  else if (!ring_push(ring, msg, len))
+  {
+    __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+  }
+
+  __atomic_sub_fetch(&log_handle.writers, 1, __ATOMIC_RELEASE);
+}
+
+void log_shutdown(void)
+{
+  if (!__atomic_exchange_n(&log_handle.running, 0, __ATOMIC_SEQ_CST))
+  {
+    return;
+  }
+
+  // Messages being pushed now still land in a ring; later ones are written synchronously
+  while (__atomic_load_n(&log_handle.writers, __ATOMIC_ACQUIRE) > 0)
+  {
+    sched_yield();
+  }
+
+  pthread_join(log_handle.writer, NULL);
+
+  // The writer may have stopped before the last pushes; the rings of exited threads are freed
+  drain_all();
+}
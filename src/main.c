@@ -1,6 +1,10 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
+#include <signal.h>
 #include <SDL2/SDL.h>
 
 #include "chip8.h"
@@ -8,30 +12,120 @@
 #include "audio.h"
 #include "display.h"
 #include "logging.h"
+#include "session.h"
+#include "shm_export.h"
 #include "timer.h"
+#include "trace.h"
+#include "exec_trace.h"
+#include "governor.h"
+#include "runahead.h"
+#include "speculate.h"
 
 #define WINDOW_TITLE ("Chip-8 Emulator")
-#define LOOP_FREQ_HZ (700)
 #define DISPLAY_FREQ_HZ (60)
+#define EXEC_TRACE_ENV ("CHIP8_EXEC_TRACE") // Path to record a binary execution trace to, if set
+#define CLOCK_ENV ("CHIP8_CLOCK") // Cycles per second, or auto to let the governor pick them
+#define TIMING_ENV ("CHIP8_TIMING") // Timing mode, uniform or vip; vip by default with the vip profile
+#define SHM_EXPORT_ENV ("CHIP8_SHM_EXPORT") // Shared memory object to export the machine state to, if set
+#define RUNAHEAD_ENV ("CHIP8_RUNAHEAD") // Frames to run ahead of the machine to hide its input lag, if set
+#define SPECULATE_ENV ("CHIP8_SPECULATE") // Keypads to run the next frame with on spare cores, if set
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_interrupt(int signal)
+{
+  (void)signal;
+  interrupted = 1;
+}
 
 void print_usage(void)
 {
-  printf("\nUsage: chip8_emu.out <ROM file>\n");
+  printf("\nUsage: chip8_emu.out <ROM file> [chip8|schip|xochip|vip]\n");
 }
 
-void cleanup()
+/** A machine being loaded on a thread of its own while the display is set up */
+typedef struct rom_loader_s
 {
-  audio_cleanup();
-  display_cleanup();
+  cpu_state_t *cpu;
+  const char *path;
+  quirk_profile_t profile;
+  status_code_t status;
+} rom_loader_t;
+
+void *load_machine(void *arg)
+{
+  rom_loader_t *loader = arg;
+
+  // Initialize the CPU
+  Log_I("Initializing CPU...");
+  loader->status = init_cpu(loader->cpu);
+  if (loader->status != STATUS_OK)
+  {
+    Log_E("An error occurred while initializing CPU: %u", loader->status);
+    return NULL;
+  }
+  set_quirk_profile(loader->cpu, loader->profile);
+  Log_I("CPU Init complete.");
+
+  // Load ROM file content to memory
+  Log_I("Loading ROM file: %s", loader->path);
+  loader->status = load_rom(loader->cpu, loader->path);
+  if (loader->status != STATUS_OK)
+  {
+    Log_E("An error occurred while loading ROM: %u", loader->status);
+    return NULL;
+  }
+  Log_I("ROM loaded succesfully.");
+  return NULL;
+}
+
+void cleanup(session_t *const session, shm_export_t *const export)
+{
+  shm_export_close(export);
+  if (session->cpu.exec_trace != NULL)
+  {
+    status_code_t status = exec_trace_stop(session->cpu.exec_trace, &session->cpu);
+    if (status != STATUS_OK)
+    {
+      Log_E("An error occurred while writing the execution trace: %u", status);
+    }
+  }
+  session_cleanup(session);
+  SDL_Quit();
 }
 
 int main(int argc, char **argv)
 {
 
-  cpu_state_t cpu_state = {0};
-  timer_t system_timer, display_timer;
+  uint64_t start_time = SDL_GetPerformanceCounter();
+  session_t session = {0};
+  cpu_state_t *const cpu_state = &session.cpu;
+  display_t display = {0};
+  audio_t audio = {0};
+  timer_t display_timer;
+  cycle_clock_t cycle_clock;
+  timing_mode_t timing_mode;
+  const char *timing_name = getenv(TIMING_ENV);
+  const char *clock_rate = getenv(CLOCK_ENV);
+  governor_t governor;
+  governor_params_t governor_params;
+  uint8_t governed = 0;
+  runahead_t runahead = {0};
+  const char *runahead_frames = getenv(RUNAHEAD_ENV);
+  speculate_t speculate;
+  const char *speculate_branches = getenv(SPECULATE_ENV);
+  uint8_t speculating = 0;
+  exec_trace_t exec_trace;
+  const char *exec_trace_path = getenv(EXEC_TRACE_ENV);
+  shm_export_t export = {0};
+  const char *export_name = getenv(SHM_EXPORT_ENV);
+  rom_loader_t loader;
+  pthread_t loader_thread;
+  uint8_t loader_started = 0;
   status_code_t status = STATUS_OK;
   uint8_t main_loop = 1;
+  uint8_t first_frame = 1;
+  quirk_profile_t quirk_profile = QUIRK_PROFILE_CHIP8;
   audio_init_param_t audio_init_param = (audio_init_param_t){
       .sample_freq_hz = DEFAULT_SAMPLE_FREQ_HZ,
       .tone_freq_hz = DEFAULT_TONE_FREQ_HZ,
@@ -39,43 +133,58 @@ int main(int argc, char **argv)
   display_init_param_t display_init_param = (display_init_param_t){
       .background_color = DEFAULT_BG_COLOR,
       .foreground_color = DEFAULT_FG_COLOR,
+      .plane2_color = DEFAULT_PLANE2_COLOR,
+      .overlap_color = DEFAULT_OVERLAP_COLOR,
   };
 
-  if (argc != 2)
+  log_init();
+
+#ifdef CHIP8_TRACE
+  trace_init(NULL);
+#endif
+
+  if ((argc < 2) || (argc > 3))
   {
     print_usage();
     return STATUS_ERR_GENERIC;
   }
 
-  // Initialize the CPU
-  Log_I("Initializing CPU...");
-  status = init_cpu(&cpu_state);
-  if (status != STATUS_OK)
+  if ((argc == 3) && (quirk_profile_from_name(argv[2], &quirk_profile) != STATUS_OK))
   {
-    Log_E("An error occurred while initializing CPU: %u", status);
-    return status;
+    print_usage();
+    return STATUS_ERR_INVALID_PARAM;
   }
-  Log_I("CPU Init complete.");
 
-  // Load ROM file content to memory
-  Log_I("Loading ROM file: %s", argv[1]);
-  status = load_rom(&cpu_state, argv[1]);
-  if (status != STATUS_OK)
+  timing_mode = (quirk_profile == QUIRK_PROFILE_COSMAC_VIP) ? TIMING_VIP : TIMING_UNIFORM;
+  if ((timing_name != NULL) && (timing_mode_from_name(timing_name, &timing_mode) != STATUS_OK))
   {
-    Log_E("An error occurred while loading ROM: %u", status);
-    return status;
+    Log_E("Unknown timing mode %s; expected uniform or vip", timing_name);
+    return STATUS_ERR_INVALID_PARAM;
   }
-  Log_I("ROM loaded succesfully.");
+  cycle_clock_init(&cycle_clock, timing_mode);
 
-  // Initialize system frequency timer
-  Log_I("Initializing system timer...");
-  status = timer_init(&system_timer, LOOP_FREQ_HZ);
-  if (status != STATUS_OK)
+  if ((clock_rate != NULL) && (strcmp(clock_rate, "auto") == 0))
   {
-    Log_E("An error occurred while initializing system timer: %u", status);
-    return status;
+    governor_default_params(&governor_params, timing_mode);
+    governor_init(&governor, &governor_params);
+    governed = 1;
+  }
+  else if (clock_rate != NULL)
+  {
+    unsigned long rate = strtoul(clock_rate, NULL, 10);
+    if (rate < DISPLAY_FREQ_HZ)
+    {
+      Log_E("Invalid clock rate %s; expected at least %u cycles per second, or auto", clock_rate, DISPLAY_FREQ_HZ);
+      return STATUS_ERR_INVALID_PARAM;
+    }
+    cycle_clock.budget = (uint32_t)((rate + (DISPLAY_FREQ_HZ / 2)) / DISPLAY_FREQ_HZ);
+  }
+
+  if ((runahead_frames != NULL) && (runahead_init(&runahead, strtoul(runahead_frames, NULL, 10)) != STATUS_OK))
+  {
+    Log_E("Invalid run-ahead %s; expected 1 to %u frames", runahead_frames, RUNAHEAD_MAX_FRAMES);
+    return STATUS_ERR_INVALID_PARAM;
   }
-  Log_I("System timer initialized successfully.");
 
   // Initialize display and audio timer
   Log_I("Initializing 60 Hz display timer...");
@@ -87,27 +196,106 @@ int main(int argc, char **argv)
   }
   Log_I("60 Hz display timer initialized successfully.");
 
-  // Initialize the display module
-  status = display_init(WINDOW_TITLE, &display_init_param);
+  // Load the ROM while the window, the slowest part of starting up, is created
+  loader = (rom_loader_t){
+      .cpu = cpu_state,
+      .path = argv[1],
+      .profile = quirk_profile,
+  };
+  loader_started = (pthread_create(&loader_thread, NULL, load_machine, &loader) == 0);
+  if (!loader_started)
+  {
+    load_machine(&loader);
+  }
+
+  // Initialize the display module; without one the machine runs headless, e.g. for the shared memory export
+  status = display_init(&display, WINDOW_TITLE, &display_init_param);
+  if (status == STATUS_OK)
+  {
+    session.video = &display_sdl_backend;
+    session.video_handle = &display;
+  }
+  else
+  {
+    Log_W("No display available; running without video output.");
+  }
+
+  if (loader_started)
+  {
+    pthread_join(loader_thread, NULL);
+  }
+  status = loader.status;
   if (status != STATUS_OK)
   {
-    cleanup();
+    cleanup(&session, &export);
     return status;
   }
 
+  // Record an execution trace if requested
+  if (exec_trace_path != NULL)
+  {
+    status = exec_trace_start(&exec_trace, cpu_state, exec_trace_path);
+    if (status != STATUS_OK)
+    {
+      Log_E("An error occurred while creating the execution trace %s: %u", exec_trace_path, status);
+      cleanup(&session, &export);
+      return status;
+    }
+    Log_I("Recording execution trace to %s", exec_trace_path);
+  }
+
+  // Export the machine state to other processes if requested
+  if (export_name != NULL)
+  {
+    status = shm_export_create(&export, export_name);
+    if (status != STATUS_OK)
+    {
+      Log_E("An error occurred while exporting to shared memory %s: %u", export_name, status);
+      cleanup(&session, &export);
+      return status;
+    }
+  }
+
   // Initialize the audio module
-  status = audio_init(&audio_init_param);
+  status = audio_init(&audio, &audio_init_param);
   if (status != STATUS_OK)
   {
-    cleanup();
+    cleanup(&session, &export);
     return status;
   }
+  session.audio = &audio_sdl_backend;
+  session.audio_handle = &audio;
+
+  // The keypad is read from the window's events; headless there is no input, and Ctrl-C stops the machine
+  if (session.video != NULL)
+  {
+    session.input = &keypad_sdl_backend;
+  }
+  else
+  {
+    signal(SIGINT, on_interrupt);
+    signal(SIGTERM, on_interrupt);
+  }
+
+  // Run each next frame ahead of time for the likeliest keypads if requested
+  if (speculate_branches != NULL)
+  {
+    status = speculate_init(&speculate, strtoul(speculate_branches, NULL, 10));
+    if (status != STATUS_OK)
+    {
+      Log_E("Failed to start speculating on %s keypads; expected 1 to %u: %u", speculate_branches,
+            SPECULATE_MAX_BRANCHES, status);
+      cleanup(&session, &export);
+      return status;
+    }
+    speculating = 1;
+  }
 
   Log_I("Starting the main execution loop");
-  while (main_loop)
+  while (main_loop && !interrupted)
   {
 
-    status = keypad_read(&cpu_state.peripherals.keypad.current);
+    status = session_read_input(&session);
     if (status == STATUS_REQ_EXIT)
     {
       Log_I("Exiting...");
@@ -119,30 +307,86 @@ int main(int argc, char **argv)
       main_loop = 0;
     }
 
-    if (timer_check(&system_timer))
+    // Each frame runs a budget of machine cycles; see run_frame_cycles
+    if (timer_check(&display_timer))
     {
-      status = emulation_cycle(&cpu_state);
-      if (status != STATUS_OK)
+      uint64_t frame_start = SDL_GetPerformanceCounter();
+
+      TRACE_SPAN_BEGIN(cycle_span);
+      status = speculating ? speculate_frame(&speculate, cpu_state, &cycle_clock) : run_frame_cycles(cpu_state, &cycle_clock);
+      TRACE_SPAN_END(cycle_span, "emulation_cycle");
+      if (status == STATUS_REQ_EXIT)
+      {
+        Log_I("Program exited.");
+        main_loop = 0;
+      }
+      else if (status != STATUS_OK)
       {
         Log_F("Emulation cycle encountered an error: %u", status);
         main_loop = 0;
       }
-    }
 
-    if (timer_check(&display_timer))
-    {
-      ((cpu_state.timers.sound > 0) ? audio_play_beep() : audio_mute());
-      update_timers(&cpu_state);
+      if (export.layout != NULL)
+      {
+        shm_export_publish(&export, cpu_state);
+      }
 
-      status = display_render(&cpu_state.peripherals.graphics);
+      status = (runahead.frames > 0) ? runahead_frame(&runahead, &session, &cycle_clock) : session_frame(&session);
       if (status != STATUS_OK)
       {
-        Log_F("Display rendering encountered an error: %u", status);
+        Log_F("Frame update encountered an error: %u", status);
         main_loop = 0;
       }
+
+      if (first_frame)
+      {
+        Log_I("First frame presented %.1f ms after start",
+              ((SDL_GetPerformanceCounter() - start_time) * 1000.0) / SDL_GetPerformanceFrequency());
+        first_frame = 0;
+      }
+
+      if (governed)
+      {
+        uint64_t frame_ticks = SDL_GetPerformanceCounter() - frame_start;
+        governor_update(&governor, &cycle_clock, (frame_ticks * 1000000000ULL) / SDL_GetPerformanceFrequency());
+      }
+
+      // The next frame runs on spare cores until then, with the clock as the governor left it
+      if (speculating && (speculate_start(&speculate, cpu_state, &cycle_clock) != STATUS_OK))
+      {
+        Log_W("Failed to speculate on the next frame; it runs as usual");
+      }
     }
   }
 
-  cleanup();
+  if (cycle_clock.frames > 0)
+  {
+    Log_I("Emulated load: %.1f%% of the frame cycle budget on average",
+          (100.0 * cycle_clock.total_busy_cycles) / (double)cycle_clock.total_budget_cycles);
+  }
+  if (governed)
+  {
+    Log_I("Clock governor: %u instructions per second, %u cycles per frame, %u adjustments",
+          governor.instructions_per_second, cycle_clock.budget, governor.adjustments);
+  }
+
+  if (runahead.presented > 0)
+  {
+    Log_I("Run-ahead: %u frames, hiding %.1f ms of input lag, at %.2f ms per frame on average and %.2f ms at worst",
+          runahead.frames, (runahead.frames * 1000.0) / DISPLAY_FREQ_HZ,
+          (runahead.total_ns / 1e6) / runahead.presented, runahead.max_ns / 1e6);
+  }
+  runahead_cleanup(&runahead);
+  if (speculating)
+  {
+    uint64_t speculated = speculate.hits + speculate.misses;
+    Log_I("Speculation: %llu of %llu frames hit (%.1f%%), %llu of %llu branches wasted, %llu instructions",
+          (unsigned long long)speculate.hits, (unsigned long long)speculated,
+          speculated ? (100.0 * speculate.hits) / speculated : 0.0, (unsigned long long)speculate.wasted_branches,
+          (unsigned long long)speculate.branches_run, (unsigned long long)speculate.wasted_instructions);
+    speculate_cleanup(&speculate);
+  }
+
+  cleanup(&session, &export);
   return status;
 }
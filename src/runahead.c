@@ -0,0 +1,106 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "runahead.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "session.h"
+#include "status_code.h"
+#include "trace.h"
+
+static uint64_t now_ns(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+status_code_t runahead_init(runahead_t *const runahead, uint32_t const frames)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(runahead);
+
+  if ((frames == 0) || (frames > RUNAHEAD_MAX_FRAMES))
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(runahead, 0, sizeof(runahead_t));
+  runahead->frames = frames;
+  return STATUS_OK;
+}
+
+void runahead_cleanup(runahead_t *const runahead)
+{
+  if (runahead == NULL)
+  {
+    return;
+  }
+
+  cleanup_cpu(&runahead->snapshot);
+  runahead->snapshot_taken = 0;
+}
+
+status_code_t runahead_frame(runahead_t *const runahead, session_t *const session, cycle_clock_t *const clock)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(runahead);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(session);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(clock);
+
+  cpu_state_t *cpu = &session->cpu;
+
+  // The real frame's sound and timers, without rendering it
+  const video_backend_t *video = session->video;
+  session->video = NULL;
+  status_code_t status = session_frame(session);
+  session->video = video;
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  uint64_t start = now_ns();
+
+  // Only what the real frame changed needs copying into the snapshot
+  status = runahead->snapshot_taken ? chip8_snapshot_update(&runahead->snapshot, cpu)
+                                    : chip8_snapshot(&runahead->snapshot, cpu);
+  RETURN_STATUS_IF_NOT_OK(status);
+  runahead->snapshot_taken = 1;
+
+  struct exec_trace_s *exec_trace = cpu->exec_trace;
+  cycle_clock_t ahead_clock = *clock;
+
+  cpu->exec_trace = NULL;
+
+  TRACE_SPAN_BEGIN(ahead_span);
+  for (uint32_t frame = 0; frame < runahead->frames; frame++)
+  {
+    // An error or exit shows up again in the real frames; the frames run so far are still shown
+    if ((run_frame_cycles(cpu, &ahead_clock) != STATUS_OK) || (update_timers(cpu) != STATUS_OK))
+    {
+      break;
+    }
+  }
+  TRACE_SPAN_END(ahead_span, "run_ahead");
+
+  if (video != NULL)
+  {
+    TRACE_SPAN_BEGIN(render_span);
+    status = video->render(session->video_handle, &cpu->peripherals.graphics);
+    TRACE_SPAN_END(render_span, "display_render");
+  }
+
+  status_code_t restore_status = chip8_restore(cpu, &runahead->snapshot);
+  cpu->exec_trace = exec_trace;
+  RETURN_STATUS_IF_NOT_OK(restore_status);
+
+  // Host time on top of the real frame, rendering the frame ahead included
+  runahead->last_ns = now_ns() - start;
+  runahead->total_ns += runahead->last_ns;
+  if (runahead->last_ns > runahead->max_ns)
+  {
+    runahead->max_ns = runahead->last_ns;
+  }
+  runahead->presented++;
+
+  return status;
+}
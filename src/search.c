@@ -0,0 +1,455 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "search.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "logging.h"
+#include "status_code.h"
+
+#define NO_PARENT (UINT32_MAX)
+
+/** A machine state reached by the search */
+typedef struct search_node_s
+{
+  cpu_state_t state;
+  uint64_t hash;
+  int64_t score;
+
+  /** Trail entry of the node once kept; of its parent until then */
+  uint32_t trail;
+
+  /** The action that led to this state */
+  uint16_t keys;
+  status_code_t status;
+} search_node_t;
+
+/**
+ * The search tree of kept states, stored as links to their parents; a state's
+ * action sequence is recovered by walking them back to the root.
+ */
+typedef struct trail_entry_s
+{
+  uint32_t parent;
+  uint16_t keys;
+} trail_entry_t;
+
+/** A kept child's rank, ordering children by score, then by index */
+typedef struct ranking_s
+{
+  int64_t score;
+  uint32_t index;
+} ranking_t;
+
+typedef struct search_context_s
+{
+  const search_params_t *params;
+
+  /** States kept after the previous step, beam_width of them at most */
+  search_node_t *frontier;
+  uint32_t frontier_count;
+
+  /** Every frontier state stepped with every action */
+  search_node_t *children;
+  uint32_t child_count;
+
+  /** Index of the next child to step, shared by the worker threads */
+  uint32_t next_child;
+
+  /** Open addressing set of the hashes of visited states; 0 marks an empty slot */
+  uint64_t *visited;
+  uint32_t visited_mask;
+  uint32_t visited_count;
+
+  trail_entry_t *trail;
+  uint32_t trail_length;
+  uint32_t trail_capacity;
+} search_context_t;
+
+status_code_t search_score(cpu_state_t *const state, const search_predicate_t *predicates, uint32_t const count, int64_t *const score)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(score);
+
+  uint8_t *memory;
+  size_t size;
+  get_memory(state, &memory, &size);
+
+  *score = 0;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    search_predicate_t const *predicate = &predicates[i];
+    uint8_t byte = memory[predicate->address % size];
+    uint8_t holds = 0;
+
+    switch (predicate->compare)
+    {
+    case SEARCH_EQUAL:
+      holds = (byte == predicate->value);
+      break;
+    case SEARCH_NOT_EQUAL:
+      holds = (byte != predicate->value);
+      break;
+    case SEARCH_LESS:
+      holds = (byte < predicate->value);
+      break;
+    case SEARCH_GREATER:
+      holds = (byte > predicate->value);
+      break;
+    case SEARCH_VALUE:
+      *score += (int64_t)predicate->weight * byte;
+      break;
+    default:
+      return STATUS_ERR_INVALID_PARAM;
+    }
+
+    *score += holds ? predicate->weight : 0;
+  }
+
+  return STATUS_OK;
+}
+
+/**
+ * Helper function to add a state hash to the visited set.
+ * Returns 0 if it was already there, 1 otherwise, including when the set is full.
+ */
+static uint8_t visit(search_context_t *const ctx, uint64_t hash)
+{
+  hash = hash ? hash : 1;
+
+  if (ctx->visited_count >= ctx->params->max_states)
+  {
+    for (uint32_t slot = hash & ctx->visited_mask; ctx->visited[slot] != 0; slot = (slot + 1) & ctx->visited_mask)
+    {
+      if (ctx->visited[slot] == hash)
+      {
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  uint32_t slot = hash & ctx->visited_mask;
+  while (ctx->visited[slot] != 0)
+  {
+    if (ctx->visited[slot] == hash)
+    {
+      return 0;
+    }
+    slot = (slot + 1) & ctx->visited_mask;
+  }
+
+  ctx->visited[slot] = hash;
+  ctx->visited_count++;
+  return 1;
+}
+
+static status_code_t add_trail(search_context_t *const ctx, uint32_t const parent, uint16_t const keys, uint32_t *const index)
+{
+  if (ctx->trail_length == ctx->trail_capacity)
+  {
+    uint32_t capacity = ctx->trail_capacity ? (ctx->trail_capacity * 2) : 1024;
+    trail_entry_t *trail = realloc(ctx->trail, capacity * sizeof(trail_entry_t));
+    if (trail == NULL)
+    {
+      return STATUS_ERR_NO_MEMORY;
+    }
+    ctx->trail = trail;
+    ctx->trail_capacity = capacity;
+  }
+
+  ctx->trail[ctx->trail_length] = (trail_entry_t){.parent = parent, .keys = keys};
+  *index = ctx->trail_length++;
+  return STATUS_OK;
+}
+
+/** Step a frontier state with one of the actions */
+static void expand(search_context_t *const ctx, uint32_t const index)
+{
+  const search_params_t *params = ctx->params;
+  search_node_t *parent = &ctx->frontier[index / params->action_count];
+  search_node_t *child = &ctx->children[index];
+
+  child->keys = params->actions[index % params->action_count];
+  child->trail = parent->trail;
+  child->status = chip8_clone(&child->state, &parent->state);
+
+  if (child->status == STATUS_OK)
+  {
+    child->status = run_frames(&child->state, child->keys, params->frames_per_step);
+  }
+
+  if (child->status == STATUS_OK)
+  {
+    chip8_state_hash(&child->state, &child->hash);
+    child->status = search_score(&child->state, params->predicates, params->predicate_count, &child->score);
+  }
+}
+
+static void *search_worker(void *arg)
+{
+  search_context_t *ctx = arg;
+
+  for (uint32_t i = __atomic_fetch_add(&ctx->next_child, 1, __ATOMIC_RELAXED); i < ctx->child_count;
+       i = __atomic_fetch_add(&ctx->next_child, 1, __ATOMIC_RELAXED))
+  {
+    expand(ctx, i);
+  }
+
+  return NULL;
+}
+
+/** Step every frontier state with every action, across the worker threads */
+static void expand_frontier(search_context_t *const ctx)
+{
+  pthread_t workers[SEARCH_MAX_THREADS];
+  uint32_t count = ctx->params->threads;
+  uint32_t started = 0;
+
+  count = (count > SEARCH_MAX_THREADS) ? SEARCH_MAX_THREADS : count;
+  ctx->child_count = ctx->frontier_count * ctx->params->action_count;
+  ctx->next_child = 0;
+
+  // The calling thread is a worker too
+  for (; (started + 1) < count; started++)
+  {
+    if (pthread_create(&workers[started], NULL, search_worker, ctx) != 0)
+    {
+      Log_W("Failed to start search worker %u", started + 1);
+      break;
+    }
+  }
+
+  search_worker(ctx);
+
+  for (uint32_t i = 0; i < started; i++)
+  {
+    pthread_join(workers[i], NULL);
+  }
+}
+
+static int compare_rankings(const void *a, const void *b)
+{
+  ranking_t const *ra = a;
+  ranking_t const *rb = b;
+
+  if (ra->score != rb->score)
+  {
+    return (ra->score > rb->score) ? -1 : 1;
+  }
+  return (ra->index < rb->index) ? -1 : 1;
+}
+
+/** Write the action sequence leading to a trail entry into the result */
+static status_code_t set_path(search_context_t *const ctx, uint32_t const trail, search_result_t *const result)
+{
+  uint32_t length = 0;
+
+  for (uint32_t i = trail; i != NO_PARENT; i = ctx->trail[i].parent)
+  {
+    length++;
+  }
+
+  free(result->path);
+  result->path = (length > 0) ? malloc(length * sizeof(uint16_t)) : NULL;
+  result->length = length;
+
+  if ((length > 0) && (result->path == NULL))
+  {
+    result->length = 0;
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  for (uint32_t i = trail; i != NO_PARENT; i = ctx->trail[i].parent)
+  {
+    result->path[--length] = ctx->trail[i].keys;
+  }
+
+  return STATUS_OK;
+}
+
+/**
+ * Keep the beam_width highest scoring children not visited before as the next frontier.
+ * Sets *best to the index of the highest scoring one, or NO_PARENT if none are left.
+ */
+static status_code_t select_frontier(search_context_t *const ctx, search_result_t *const result, uint32_t *const best)
+{
+  ranking_t *rankings = malloc(ctx->child_count * sizeof(ranking_t));
+  uint32_t count = 0;
+  status_code_t status = STATUS_OK;
+
+  if (rankings == NULL)
+  {
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  for (uint32_t i = 0; i < ctx->child_count; i++)
+  {
+    search_node_t *child = &ctx->children[i];
+
+    if (child->status == STATUS_ERR_NO_MEMORY)
+    {
+      free(rankings);
+      return STATUS_ERR_NO_MEMORY;
+    }
+
+    // Runs ending in an error, e.g. a stack overflow, are dead ends
+    if (child->status != STATUS_OK)
+    {
+      continue;
+    }
+
+    if (!visit(ctx, child->hash))
+    {
+      result->duplicates++;
+      continue;
+    }
+
+    rankings[count++] = (ranking_t){.score = child->score, .index = i};
+  }
+
+  result->expanded += ctx->child_count;
+  qsort(rankings, count, sizeof(ranking_t), compare_rankings);
+
+  ctx->frontier_count = (count < ctx->params->beam_width) ? count : ctx->params->beam_width;
+  *best = NO_PARENT;
+
+  for (uint32_t k = 0; (k < ctx->frontier_count) && (status == STATUS_OK); k++)
+  {
+    search_node_t *child = &ctx->children[rankings[k].index];
+    search_node_t *node = &ctx->frontier[k];
+
+    status = chip8_clone(&node->state, &child->state);
+    if (status == STATUS_OK)
+    {
+      node->hash = child->hash;
+      node->score = child->score;
+      node->keys = child->keys;
+      status = add_trail(ctx, child->trail, child->keys, &node->trail);
+    }
+  }
+
+  if ((status == STATUS_OK) && (ctx->frontier_count > 0))
+  {
+    *best = 0;
+  }
+
+  free(rankings);
+  return status;
+}
+
+static void free_context(search_context_t *const ctx, uint32_t const frontier_size, uint32_t const children_size)
+{
+  for (uint32_t i = 0; (ctx->frontier != NULL) && (i < frontier_size); i++)
+  {
+    cleanup_cpu(&ctx->frontier[i].state);
+  }
+  for (uint32_t i = 0; (ctx->children != NULL) && (i < children_size); i++)
+  {
+    cleanup_cpu(&ctx->children[i].state);
+  }
+
+  free(ctx->frontier);
+  free(ctx->children);
+  free(ctx->visited);
+  free(ctx->trail);
+}
+
+status_code_t search_run(cpu_state_t *const root, const search_params_t *params, search_result_t *const result)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(root);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(params);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(result);
+
+  memset(result, 0, sizeof(search_result_t));
+
+  if ((params->actions == NULL) || (params->action_count == 0) || (params->beam_width == 0) ||
+      (params->beam_width > (UINT32_MAX / params->action_count)) || (params->max_states == 0) ||
+      (params->max_states > SEARCH_MAX_STATES) || ((params->predicates == NULL) && (params->predicate_count > 0)))
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  search_context_t ctx = {.params = params};
+  uint32_t frontier_size = params->beam_width;
+  uint32_t children_size = params->beam_width * params->action_count;
+  uint32_t visited_size = 1;
+
+  while (visited_size < (2 * params->max_states))
+  {
+    visited_size <<= 1;
+  }
+
+  ctx.frontier = calloc(frontier_size, sizeof(search_node_t));
+  ctx.children = calloc(children_size, sizeof(search_node_t));
+  ctx.visited = calloc(visited_size, sizeof(uint64_t));
+  ctx.visited_mask = visited_size - 1;
+
+  if ((ctx.frontier == NULL) || (ctx.children == NULL) || (ctx.visited == NULL))
+  {
+    free_context(&ctx, frontier_size, children_size);
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  search_node_t *start = &ctx.frontier[0];
+  status_code_t status = chip8_clone(&start->state, root);
+
+  if (status == STATUS_OK)
+  {
+    start->trail = NO_PARENT;
+    ctx.frontier_count = 1;
+    chip8_state_hash(&start->state, &start->hash);
+    visit(&ctx, start->hash);
+    status = search_score(&start->state, params->predicates, params->predicate_count, &result->score);
+    result->goal_reached = params->has_goal && (result->score >= params->goal_score);
+  }
+
+  for (uint32_t depth = 0; (status == STATUS_OK) && (depth < params->max_depth) && !result->goal_reached; depth++)
+  {
+    uint32_t best;
+
+    expand_frontier(&ctx);
+    status = select_frontier(&ctx, result, &best);
+
+    if ((status != STATUS_OK) || (best == NO_PARENT))
+    {
+      break;
+    }
+
+    search_node_t *node = &ctx.frontier[best];
+    if (node->score > result->score)
+    {
+      result->score = node->score;
+      status = set_path(&ctx, node->trail, result);
+    }
+
+    if (params->has_goal && (node->score >= params->goal_score))
+    {
+      result->goal_reached = 1;
+    }
+
+    Log_D("Search depth %u: %u states kept, best score %lld", depth + 1, ctx.frontier_count, (long long)node->score);
+  }
+
+  free_context(&ctx, frontier_size, children_size);
+
+  if (status != STATUS_OK)
+  {
+    search_free_result(result);
+  }
+  return status;
+}
+
+void search_free_result(search_result_t *const result)
+{
+  if (result == NULL)
+  {
+    return;
+  }
+
+  free(result->path);
+  result->path = NULL;
+  result->length = 0;
+}
@@ -0,0 +1,87 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "session.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "status_code.h"
+#include "trace.h"
+
+status_code_t session_read_input(session_t *const session)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(session);
+
+  if (session->input == NULL)
+  {
+    return STATUS_OK;
+  }
+
+  TRACE_SPAN_BEGIN(keypad_span);
+  status_code_t status = session->input->read(session->input_handle, &session->cpu.peripherals.keypad.current);
+  TRACE_SPAN_END(keypad_span, "keypad_read");
+
+  return status;
+}
+
+status_code_t session_frame(session_t *const session)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(session);
+
+  cpu_state_t *cpu = &session->cpu;
+  audio_pattern_t *pattern = &cpu->peripherals.audio;
+
+  if (session->audio != NULL)
+  {
+    if (pattern->audio_update && pattern->loaded)
+    {
+      session->audio->set_pattern(session->audio_handle, pattern->buffer, pattern->pitch);
+    }
+
+    if (cpu->timers.sound > 0)
+    {
+      session->audio->play_beep(session->audio_handle);
+    }
+    else
+    {
+      session->audio->mute(session->audio_handle);
+    }
+  }
+  pattern->audio_update = 0;
+
+  TRACE_SPAN_BEGIN(timers_span);
+  status_code_t status = update_timers(cpu);
+  TRACE_SPAN_END(timers_span, "update_timers");
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  if (session->video != NULL)
+  {
+    TRACE_SPAN_BEGIN(render_span);
+    status = session->video->render(session->video_handle, &cpu->peripherals.graphics);
+    TRACE_SPAN_END(render_span, "display_render");
+  }
+
+  return status;
+}
+
+void session_cleanup(session_t *const session)
+{
+  if (session == NULL)
+  {
+    return;
+  }
+
+  if (session->audio != NULL)
+  {
+    session->audio->cleanup(session->audio_handle);
+    session->audio = NULL;
+  }
+
+  if (session->video != NULL)
+  {
+    session->video->cleanup(session->video_handle);
+    session->video = NULL;
+  }
+
+  session->input = NULL;
+  cleanup_cpu(&session->cpu);
+}
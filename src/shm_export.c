@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200809L // shm_open
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shm_export.h"
+#include "cpu_def.h"
+#include "logging.h"
+#include "status_code.h"
+
+status_code_t shm_export_create(shm_export_t *const export, const char *name)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(export);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(name);
+
+  if (strlen(name) >= SHM_EXPORT_NAME_SIZE)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(export, 0, sizeof(shm_export_t));
+
+  // Readers still mapping a previous segment keep it, but no longer see updates
+  shm_unlink(name);
+
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0)
+  {
+    Log_E("Failed to create shared memory %s: %s", name, strerror(errno));
+    return STATUS_ERR_GENERIC;
+  }
+
+  void *mapping = MAP_FAILED;
+  if (ftruncate(fd, sizeof(shm_export_layout_t)) == 0)
+  {
+    mapping = mmap(NULL, sizeof(shm_export_layout_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+
+  if (mapping == MAP_FAILED)
+  {
+    Log_E("Failed to map shared memory %s: %s", name, strerror(errno));
+    shm_unlink(name);
+    return STATUS_ERR_GENERIC;
+  }
+
+  snprintf(export->name, sizeof(export->name), "%s", name);
+  export->layout = mapping;
+  export->writer = 1;
+
+  // The segment starts zeroed, i.e. with an even sequence; magic goes last so readers see it complete
+  export->layout->version = SHM_EXPORT_VERSION;
+  export->layout->size = sizeof(shm_export_layout_t);
+  __atomic_store_n(&export->layout->magic, SHM_EXPORT_MAGIC, __ATOMIC_RELEASE);
+
+  Log_I("Exporting the machine state to shared memory %s", name);
+  return STATUS_OK;
+}
+
+status_code_t shm_export_publish(shm_export_t *const export, cpu_state_t *const state)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(export);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+
+  shm_export_layout_t *layout = export->layout;
+
+  if ((layout == NULL) || !export->writer)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  uint32_t sequence = layout->sequence;
+  __atomic_store_n(&layout->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  layout->frame++;
+  if (state->peripherals.graphics.display_update || (layout->graphics_frame == 0))
+  {
+    memcpy(&layout->graphics, &state->peripherals.graphics, sizeof(graphics_t));
+    layout->graphics_frame = layout->frame;
+  }
+  layout->quirk_profile = state->quirk_profile;
+  layout->registers = state->registers;
+  layout->timers = state->timers;
+  layout->keypad = state->peripherals.keypad.current;
+
+  __atomic_store_n(&layout->sequence, sequence + 2, __ATOMIC_RELEASE);
+  return STATUS_OK;
+}
+
+status_code_t shm_export_open(shm_export_t *const export, const char *name)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(export);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(name);
+
+  struct stat info;
+
+  if (strlen(name) >= SHM_EXPORT_NAME_SIZE)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(export, 0, sizeof(shm_export_t));
+
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+  {
+    return STATUS_ERR_FILE_NOT_FOUND;
+  }
+
+  if ((fstat(fd, &info) != 0) || ((size_t)info.st_size < sizeof(shm_export_layout_t)))
+  {
+    close(fd);
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  void *mapping = mmap(NULL, sizeof(shm_export_layout_t), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    return STATUS_ERR_GENERIC;
+  }
+
+  shm_export_layout_t *layout = mapping;
+  if ((__atomic_load_n(&layout->magic, __ATOMIC_ACQUIRE) != SHM_EXPORT_MAGIC) ||
+      (layout->version != SHM_EXPORT_VERSION) || (layout->size != sizeof(shm_export_layout_t)))
+  {
+    munmap(mapping, sizeof(shm_export_layout_t));
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  snprintf(export->name, sizeof(export->name), "%s", name);
+  export->layout = layout;
+  return STATUS_OK;
+}
+
+uint32_t shm_export_read_begin(const shm_export_t *const export)
+{
+  uint32_t sequence;
+
+  // Updates take a few microseconds at most, so this rarely waits
+  while ((sequence = __atomic_load_n(&export->layout->sequence, __ATOMIC_ACQUIRE)) & 1)
+  {
+    sched_yield();
+  }
+
+  return sequence;
+}
+
+uint8_t shm_export_read_retry(const shm_export_t *const export, uint32_t const sequence)
+{
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&export->layout->sequence, __ATOMIC_RELAXED) != sequence;
+}
+
+status_code_t shm_export_read(const shm_export_t *const export, shm_export_layout_t *const copy)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(export);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(copy);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(export->layout);
+
+  uint32_t sequence;
+
+  do
+  {
+    sequence = shm_export_read_begin(export);
+    memcpy(copy, export->layout, sizeof(shm_export_layout_t));
+  } while (shm_export_read_retry(export, sequence));
+
+  return STATUS_OK;
+}
+
+void shm_export_close(shm_export_t *const export)
+{
+  if ((export == NULL) || (export->layout == NULL))
+  {
+    return;
+  }
+
+  munmap(export->layout, sizeof(shm_export_layout_t));
+  export->layout = NULL;
+
+  if (export->writer)
+  {
+    shm_unlink(export->name);
+    export->writer = 0;
+  }
+}
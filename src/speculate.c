@@ -0,0 +1,267 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "speculate.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "logging.h"
+#include "status_code.h"
+
+/** Run the next frame from the base machine with a branch's keypad */
+static void run_branch(speculate_t *const spec, speculate_branch_t *const branch)
+{
+  branch->clock = spec->base_clock;
+  branch->clock.instructions = 0;
+  branch->status = chip8_clone(&branch->state, &spec->base);
+  if (branch->status != STATUS_OK)
+  {
+    return;
+  }
+
+  branch->state.peripherals.keypad.current = branch->keys;
+  branch->status = run_frame_cycles(&branch->state, &branch->clock);
+}
+
+static void *speculate_worker(void *arg)
+{
+  speculate_t *spec = arg;
+  uint64_t generation = 0;
+
+  pthread_mutex_lock(&spec->lock);
+  while (1)
+  {
+    while (!spec->stopping && (spec->generation == generation))
+    {
+      pthread_cond_wait(&spec->start, &spec->lock);
+    }
+    if (spec->stopping)
+    {
+      break;
+    }
+    generation = spec->generation;
+    pthread_mutex_unlock(&spec->lock);
+
+    for (uint32_t i = __atomic_fetch_add(&spec->next_branch, 1, __ATOMIC_RELAXED); i < spec->branch_count;
+         i = __atomic_fetch_add(&spec->next_branch, 1, __ATOMIC_RELAXED))
+    {
+      run_branch(spec, &spec->branches[i]);
+    }
+
+    pthread_mutex_lock(&spec->lock);
+    if (--spec->pending == 0)
+    {
+      pthread_cond_signal(&spec->finished);
+    }
+  }
+  pthread_mutex_unlock(&spec->lock);
+
+  return NULL;
+}
+
+/** Wait for the branches of the running batch, if any, to be done */
+static void wait_batch(speculate_t *const spec)
+{
+  if (!spec->running)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&spec->lock);
+  while (spec->pending > 0)
+  {
+    pthread_cond_wait(&spec->finished, &spec->lock);
+  }
+  pthread_mutex_unlock(&spec->lock);
+
+  spec->running = 0;
+}
+
+/** Guess the keypads of the next frame: the current one, then single key changes, most frequent first */
+static void predict(speculate_t *const spec, uint16_t const keys)
+{
+  uint8_t taken[NUM_KEYS] = {0};
+
+  spec->branches[0].keys = keys;
+
+  for (uint32_t b = 1; b < spec->branch_count; b++)
+  {
+    uint8_t best = NUM_KEYS;
+
+    for (uint8_t key = 0; key < NUM_KEYS; key++)
+    {
+      if (!taken[key] && ((best == NUM_KEYS) || (spec->toggles[key] > spec->toggles[best])))
+      {
+        best = key;
+      }
+    }
+
+    taken[best] = 1;
+    spec->branches[b].keys = keys ^ (uint16_t)(1 << best);
+  }
+}
+
+/** Count the keys that changed between frames */
+static void learn(speculate_t *const spec, uint16_t const changed)
+{
+  uint8_t decay = 0;
+
+  for (uint8_t key = 0; key < NUM_KEYS; key++)
+  {
+    if ((changed >> key) & 1)
+    {
+      decay |= (++spec->toggles[key] >= SPECULATE_HISTORY_MAX);
+    }
+  }
+
+  for (uint8_t key = 0; decay && (key < NUM_KEYS); key++)
+  {
+    spec->toggles[key] /= 2;
+  }
+}
+
+status_code_t speculate_init(speculate_t *const spec, uint32_t const branches)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(spec);
+
+  if ((branches == 0) || (branches > SPECULATE_MAX_BRANCHES))
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(spec, 0, sizeof(speculate_t));
+  spec->branch_count = branches;
+
+  pthread_mutex_init(&spec->lock, NULL);
+  pthread_cond_init(&spec->start, NULL);
+  pthread_cond_init(&spec->finished, NULL);
+
+  for (; spec->worker_count < branches; spec->worker_count++)
+  {
+    if (pthread_create(&spec->workers[spec->worker_count], NULL, speculate_worker, spec) != 0)
+    {
+      Log_W("Failed to start speculation worker %u", spec->worker_count + 1);
+      break;
+    }
+  }
+
+  if (spec->worker_count == 0)
+  {
+    speculate_cleanup(spec);
+    return STATUS_ERR_GENERIC;
+  }
+  return STATUS_OK;
+}
+
+void speculate_cleanup(speculate_t *const spec)
+{
+  if (spec == NULL)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&spec->lock);
+  spec->stopping = 1;
+  pthread_cond_broadcast(&spec->start);
+  pthread_mutex_unlock(&spec->lock);
+
+  for (uint32_t i = 0; i < spec->worker_count; i++)
+  {
+    pthread_join(spec->workers[i], NULL);
+  }
+  spec->worker_count = 0;
+  spec->running = 0;
+
+  pthread_cond_destroy(&spec->finished);
+  pthread_cond_destroy(&spec->start);
+  pthread_mutex_destroy(&spec->lock);
+
+  for (uint32_t i = 0; i < SPECULATE_MAX_BRANCHES; i++)
+  {
+    cleanup_cpu(&spec->branches[i].state);
+  }
+  cleanup_cpu(&spec->base);
+}
+
+status_code_t speculate_start(speculate_t *const spec, cpu_state_t *const state, cycle_clock_t *const clock)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(spec);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(clock);
+
+  wait_batch(spec);
+
+  if (state->exec_trace != NULL)
+  {
+    return STATUS_OK;
+  }
+
+  // The branches copy the machine from the base, so that the caller may go on updating its keypad meanwhile
+  status_code_t status = chip8_clone(&spec->base, state);
+  RETURN_STATUS_IF_NOT_OK(status);
+  spec->base_clock = *clock;
+  predict(spec, state->peripherals.keypad.current);
+
+  pthread_mutex_lock(&spec->lock);
+  spec->next_branch = 0;
+  spec->pending = spec->worker_count;
+  spec->generation++;
+  pthread_cond_broadcast(&spec->start);
+  pthread_mutex_unlock(&spec->lock);
+
+  spec->running = 1;
+  return STATUS_OK;
+}
+
+status_code_t speculate_frame(speculate_t *const spec, cpu_state_t *const state, cycle_clock_t *const clock)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(spec);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(state);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(clock);
+
+  if (!spec->running)
+  {
+    return run_frame_cycles(state, clock);
+  }
+
+  wait_batch(spec);
+
+  uint16_t keys = state->peripherals.keypad.current;
+  speculate_branch_t *hit = NULL;
+
+  learn(spec, keys ^ spec->branches[0].keys);
+
+  // A budget changed since, e.g. by the clock governor, or a trace started, makes every branch stale
+  if ((clock->budget == spec->base_clock.budget) && (state->exec_trace == NULL))
+  {
+    for (uint32_t i = 0; (i < spec->branch_count) && (hit == NULL); i++)
+    {
+      if ((spec->branches[i].keys == keys) && (spec->branches[i].status != STATUS_ERR_NO_MEMORY))
+      {
+        hit = &spec->branches[i];
+      }
+    }
+  }
+
+  spec->branches_run += spec->branch_count;
+  for (uint32_t i = 0; i < spec->branch_count; i++)
+  {
+    if (&spec->branches[i] != hit)
+    {
+      spec->wasted_branches++;
+      spec->wasted_instructions += spec->branches[i].clock.instructions;
+    }
+  }
+
+  if (hit == NULL)
+  {
+    spec->misses++;
+    return run_frame_cycles(state, clock);
+  }
+
+  spec->hits++;
+  status_code_t status = chip8_clone(state, &hit->state);
+  RETURN_STATUS_IF_NOT_OK(status);
+  *clock = hit->clock;
+  return hit->status;
+}
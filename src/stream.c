@@ -0,0 +1,918 @@
+#define _POSIX_C_SOURCE 200809L // sockets, strerror
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "stream.h"
+#include "cpu_def.h"
+#include "logging.h"
+#include "status_code.h"
+
+#define STREAM_LISTEN_TAG (STREAM_MAX_VIEWERS)
+#define STREAM_WAKE_TAG (STREAM_MAX_VIEWERS + 1)
+#define STREAM_HUB_STOP_TAG (UINT64_MAX)
+#define STREAM_EPOLL_EVENTS (64)
+#define STREAM_BACKLOG (16)
+
+typedef uint64_t frame_buffer_t[GRAPHICS_HIRES_HEIGHT][GRAPHICS_ROW_WORDS];
+
+static void put_le(uint8_t *const dest, uint64_t value, uint8_t const size)
+{
+  for (uint8_t i = 0; i < size; i++, value >>= 8)
+  {
+    dest[i] = (uint8_t)value;
+  }
+}
+
+static uint64_t get_le(uint8_t const *const source, uint8_t const size)
+{
+  uint64_t value = 0;
+
+  for (uint8_t i = size; i > 0; i--)
+  {
+    value = (value << 8) | source[i - 1];
+  }
+  return value;
+}
+
+/** A row of both planes XORed against the previous frame, words most significant byte first */
+static void row_delta(frame_buffer_t const *previous, frame_buffer_t const *current, uint8_t const row, uint8_t *const delta)
+{
+  uint8_t *out = delta;
+
+  for (uint8_t plane = 0; plane < GRAPHICS_PLANES; plane++)
+  {
+    for (uint8_t w = 0; w < GRAPHICS_ROW_WORDS; w++)
+    {
+      uint64_t word = current[plane][row][w] ^ ((previous != NULL) ? previous[plane][row][w] : 0);
+
+      for (int8_t shift = 56; shift >= 0; shift -= 8)
+      {
+        *out++ = (uint8_t)(word >> shift);
+      }
+    }
+  }
+}
+
+size_t stream_encode_frame(uint64_t const (*previous)[GRAPHICS_HIRES_HEIGHT][GRAPHICS_ROW_WORDS],
+                           uint64_t const (*current)[GRAPHICS_HIRES_HEIGHT][GRAPHICS_ROW_WORDS],
+                           uint8_t const hires, uint32_t const frame, uint8_t *const message)
+{
+  uint8_t *payload = message + STREAM_HEADER_SIZE;
+  uint8_t *out = payload + STREAM_FRAME_FIXED_SIZE;
+  uint64_t rows = 0;
+
+  for (uint8_t row = 0; row < GRAPHICS_HIRES_HEIGHT; row++)
+  {
+    uint8_t delta[STREAM_ROW_BYTES];
+    uint8_t unchanged = 1;
+
+    row_delta(previous, current, row, delta);
+    for (uint8_t i = 0; (i < STREAM_ROW_BYTES) && unchanged; i++)
+    {
+      unchanged = (delta[i] == 0);
+    }
+    if (unchanged)
+    {
+      continue;
+    }
+    rows |= 1ULL << row;
+
+    // The number of pairs, then pairs of unchanged and changed byte counts, the changed bytes after each pair
+    uint8_t *pairs = out++;
+    *pairs = 0;
+
+    for (uint8_t i = 0; i < STREAM_ROW_BYTES;)
+    {
+      uint8_t skip = 0;
+      uint8_t count = 0;
+
+      while (((i + skip) < STREAM_ROW_BYTES) && (delta[i + skip] == 0))
+      {
+        skip++;
+      }
+      while (((i + skip + count) < STREAM_ROW_BYTES) && (delta[i + skip + count] != 0))
+      {
+        count++;
+      }
+      if (count == 0)
+      {
+        break;
+      }
+
+      *out++ = skip;
+      *out++ = count;
+      memcpy(out, &delta[i + skip], count);
+      out += count;
+      i += skip + count;
+      (*pairs)++;
+    }
+  }
+
+  put_le(payload, frame, sizeof(uint32_t));
+  payload[4] = (hires ? STREAM_FLAG_HIRES : 0) | ((previous == NULL) ? STREAM_FLAG_KEYFRAME : 0);
+  put_le(payload + 5, rows, sizeof(uint64_t));
+
+  size_t length = (size_t)(out - payload);
+  message[0] = STREAM_MSG_FRAME;
+  message[1] = 0;
+  put_le(message + 2, length, sizeof(uint16_t));
+
+  return STREAM_HEADER_SIZE + length;
+}
+
+status_code_t stream_decode_frame(graphics_t *const graphics, uint32_t *const frame, uint8_t const *payload, size_t const length)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(graphics);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(payload);
+
+  if (length < STREAM_FRAME_FIXED_SIZE)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  uint8_t flags = payload[4];
+  uint64_t rows = get_le(payload + 5, sizeof(uint64_t));
+  uint8_t const *in = payload + STREAM_FRAME_FIXED_SIZE;
+  uint8_t const *end = payload + length;
+
+  if (flags & STREAM_FLAG_KEYFRAME)
+  {
+    memset(graphics->buffer, 0, sizeof(graphics->buffer));
+  }
+
+  for (uint8_t row = 0; row < GRAPHICS_HIRES_HEIGHT; row++)
+  {
+    uint8_t delta[STREAM_ROW_BYTES] = {0};
+
+    if (!(rows & (1ULL << row)))
+    {
+      continue;
+    }
+
+    if (in == end)
+    {
+      return STATUS_ERR_INVALID_PARAM;
+    }
+
+    uint8_t pairs = *in++;
+    for (uint8_t pair = 0, i = 0; pair < pairs; pair++)
+    {
+      if ((end - in) < 2)
+      {
+        return STATUS_ERR_INVALID_PARAM;
+      }
+
+      uint8_t skip = in[0];
+      uint8_t count = in[1];
+      in += 2;
+
+      if (((i + skip + count) > STREAM_ROW_BYTES) || ((end - in) < count) || (count == 0))
+      {
+        return STATUS_ERR_INVALID_PARAM;
+      }
+
+      memcpy(&delta[i + skip], in, count);
+      in += count;
+      i += skip + count;
+    }
+
+    uint8_t const *bytes = delta;
+    for (uint8_t plane = 0; plane < GRAPHICS_PLANES; plane++)
+    {
+      for (uint8_t w = 0; w < GRAPHICS_ROW_WORDS; w++)
+      {
+        uint64_t word = 0;
+        for (uint8_t b = 0; b < sizeof(uint64_t); b++)
+        {
+          word = (word << 8) | *bytes++;
+        }
+        graphics->buffer[plane][row][w] ^= word;
+      }
+    }
+  }
+
+  if (in != end)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  if (frame != NULL)
+  {
+    *frame = (uint32_t)get_le(payload, sizeof(uint32_t));
+  }
+  graphics->hires = (flags & STREAM_FLAG_HIRES) ? 1 : 0;
+  graphics->display_update = 1;
+  return STATUS_OK;
+}
+
+/** Fill in the socket address named by "unix:PATH" or "tcp:PORT" */
+static status_code_t parse_address(const char *address, struct sockaddr_storage *const storage, socklen_t *const length)
+{
+  memset(storage, 0, sizeof(struct sockaddr_storage));
+
+  if (strncmp(address, "unix:", 5) == 0)
+  {
+    struct sockaddr_un *un = (struct sockaddr_un *)storage;
+
+    if ((strlen(address + 5) == 0) || (strlen(address + 5) >= sizeof(un->sun_path)))
+    {
+      return STATUS_ERR_INVALID_PARAM;
+    }
+    un->sun_family = AF_UNIX;
+    strcpy(un->sun_path, address + 5);
+    *length = sizeof(struct sockaddr_un);
+    return STATUS_OK;
+  }
+
+  if (strncmp(address, "tcp:", 4) == 0)
+  {
+    struct sockaddr_in *in = (struct sockaddr_in *)storage;
+    char *end;
+    unsigned long port = strtoul(address + 4, &end, 10);
+
+    if ((end == (address + 4)) || (*end != '\0') || (port > UINT16_MAX))
+    {
+      return STATUS_ERR_INVALID_PARAM;
+    }
+    in->sin_family = AF_INET;
+    in->sin_port = htons((uint16_t)port);
+    in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    *length = sizeof(struct sockaddr_in);
+    return STATUS_OK;
+  }
+
+  return STATUS_ERR_INVALID_PARAM;
+}
+
+static status_code_t set_nonblocking(int const fd)
+{
+  int flags = fcntl(fd, F_GETFL, 0);
+  return ((flags >= 0) && (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0)) ? STATUS_OK : STATUS_ERR_GENERIC;
+}
+
+/** The epoll data of one of a server's sockets: its generation, its slot in the hub and which socket it is */
+static uint64_t event_data(stream_server_t const *const server, uint32_t const tag)
+{
+  return ((uint64_t)server->generation << 32) | ((uint64_t)server->slot << 16) | tag;
+}
+
+static void drop_viewer(stream_server_t *const server, stream_viewer_t *const viewer)
+{
+  Log_I("Stream viewer on fd %d disconnected", viewer->fd);
+  epoll_ctl(server->hub->epoll_fd, EPOLL_CTL_DEL, viewer->fd, NULL);
+  close(viewer->fd);
+  free(viewer->output);
+  memset(viewer, 0, sizeof(stream_viewer_t));
+  viewer->fd = -1;
+
+  uint16_t keypad = 0;
+  for (uint32_t i = 0; i < STREAM_MAX_VIEWERS; i++)
+  {
+    keypad |= server->viewers[i].keypad;
+  }
+  __atomic_store_n(&server->keypad, keypad, __ATOMIC_RELAXED);
+}
+
+/** Send what the socket takes of a viewer's queue, waiting for it to become writable for the rest */
+static status_code_t flush_viewer(stream_server_t *const server, stream_viewer_t *const viewer)
+{
+  while (viewer->output_sent < viewer->output_length)
+  {
+    ssize_t sent = send(viewer->fd, viewer->output + viewer->output_sent, viewer->output_length - viewer->output_sent, MSG_NOSIGNAL);
+
+    if (sent > 0)
+    {
+      viewer->output_sent += (size_t)sent;
+      server->bytes_sent += (uint64_t)sent;
+    }
+    else if ((sent < 0) && (errno == EINTR))
+    {
+      continue;
+    }
+    else if ((sent < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+    {
+      break;
+    }
+    else
+    {
+      return STATUS_ERR_GENERIC;
+    }
+  }
+
+  if (viewer->output_sent == viewer->output_length)
+  {
+    viewer->output_sent = 0;
+    viewer->output_length = 0;
+  }
+
+  uint8_t waiting = (viewer->output_length > 0);
+  if (waiting != viewer->waiting_writable)
+  {
+    struct epoll_event event = {.events = EPOLLIN | (waiting ? EPOLLOUT : 0),
+                                .data.u64 = event_data(server, (uint32_t)(viewer - server->viewers))};
+    epoll_ctl(server->hub->epoll_fd, EPOLL_CTL_MOD, viewer->fd, &event);
+    viewer->waiting_writable = waiting;
+  }
+
+  return STATUS_OK;
+}
+
+/** Queue a message for a viewer; one that cannot keep up is resynchronised with a keyframe later */
+static void queue_message(stream_viewer_t *const viewer, uint8_t const *const message, size_t const size)
+{
+  if ((viewer->output_sent > 0) && ((viewer->output_length + size) > STREAM_VIEWER_BUFFER))
+  {
+    memmove(viewer->output, viewer->output + viewer->output_sent, viewer->output_length - viewer->output_sent);
+    viewer->output_length -= viewer->output_sent;
+    viewer->output_sent = 0;
+  }
+
+  if ((viewer->output_length + size) > STREAM_VIEWER_BUFFER)
+  {
+    viewer->needs_keyframe = 1;
+    return;
+  }
+
+  memcpy(viewer->output + viewer->output_length, message, size);
+  viewer->output_length += size;
+}
+
+/** Send the latest published frame to every viewer */
+static void broadcast(stream_server_t *const server, uint8_t const new_frame)
+{
+  uint64_t current[GRAPHICS_PLANES][GRAPHICS_HIRES_HEIGHT][GRAPHICS_ROW_WORDS];
+  uint8_t hires;
+  uint8_t delta[STREAM_MAX_MESSAGE];
+  uint8_t keyframe[STREAM_MAX_MESSAGE];
+  size_t delta_size = 0;
+  size_t keyframe_size = 0;
+
+  if (new_frame)
+  {
+    pthread_mutex_lock(&server->lock);
+    memcpy(current, server->pending, sizeof(current));
+    hires = server->pending_hires;
+    server->pending_new = 0;
+    pthread_mutex_unlock(&server->lock);
+
+    server->frame++;
+    delta_size = stream_encode_frame((frame_buffer_t const *)server->sent, (frame_buffer_t const *)current, hires, server->frame, delta);
+
+    // Nothing changed: no message, unless the resolution did
+    if ((delta_size == (STREAM_HEADER_SIZE + STREAM_FRAME_FIXED_SIZE)) && (hires == server->sent_hires))
+    {
+      delta_size = 0;
+    }
+
+    memcpy(server->sent, current, sizeof(current));
+    server->sent_hires = hires;
+  }
+
+  for (uint32_t i = 0; i < STREAM_MAX_VIEWERS; i++)
+  {
+    stream_viewer_t *viewer = &server->viewers[i];
+
+    if (viewer->fd < 0)
+    {
+      continue;
+    }
+
+    if (viewer->needs_keyframe && (viewer->output_length == viewer->output_sent))
+    {
+      if (keyframe_size == 0)
+      {
+        keyframe_size = stream_encode_frame(NULL, (frame_buffer_t const *)server->sent, server->sent_hires, server->frame, keyframe);
+      }
+      viewer->needs_keyframe = 0;
+      queue_message(viewer, keyframe, keyframe_size);
+      server->keyframes_sent++;
+    }
+    else if (!viewer->needs_keyframe && (delta_size > 0))
+    {
+      queue_message(viewer, delta, delta_size);
+    }
+
+    if (flush_viewer(server, viewer) != STATUS_OK)
+    {
+      drop_viewer(server, viewer);
+    }
+  }
+}
+
+static void accept_viewers(stream_server_t *const server)
+{
+  while (1)
+  {
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+      return;
+    }
+
+    stream_viewer_t *viewer = NULL;
+    for (uint32_t i = 0; (i < STREAM_MAX_VIEWERS) && (viewer == NULL); i++)
+    {
+      viewer = (server->viewers[i].fd < 0) ? &server->viewers[i] : NULL;
+    }
+
+    uint8_t *output = (viewer != NULL) ? malloc(STREAM_VIEWER_BUFFER) : NULL;
+    if ((output == NULL) || (set_nonblocking(fd) != STATUS_OK))
+    {
+      Log_W("Refusing stream viewer: %s", (viewer == NULL) ? "too many viewers" : "out of resources");
+      free(output);
+      close(fd);
+      continue;
+    }
+
+    memset(viewer, 0, sizeof(stream_viewer_t));
+    viewer->fd = fd;
+    viewer->output = output;
+    viewer->needs_keyframe = 1;
+
+    struct epoll_event event = {.events = EPOLLIN, .data.u64 = event_data(server, (uint32_t)(viewer - server->viewers))};
+    epoll_ctl(server->hub->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    Log_I("Stream viewer connected on fd %d", fd);
+  }
+}
+
+/** Read keypad messages from a viewer; returns non-zero once the viewer is gone */
+static uint8_t read_viewer(stream_server_t *const server, stream_viewer_t *const viewer)
+{
+  uint8_t input[256];
+  ssize_t length;
+
+  while ((length = recv(viewer->fd, input, sizeof(input), 0)) > 0)
+  {
+    for (ssize_t i = 0; i < length; i++)
+    {
+      viewer->input[viewer->input_length++] = input[i];
+      if (viewer->input_length < sizeof(viewer->input))
+      {
+        continue;
+      }
+      viewer->input_length = 0;
+
+      if ((viewer->input[0] != STREAM_MSG_KEYPAD) || (get_le(&viewer->input[2], sizeof(uint16_t)) != sizeof(uint16_t)))
+      {
+        Log_W("Unexpected message from stream viewer on fd %d", viewer->fd);
+        return 1;
+      }
+      viewer->keypad = (uint16_t)get_le(&viewer->input[STREAM_HEADER_SIZE], sizeof(uint16_t));
+    }
+  }
+
+  uint16_t keypad = 0;
+  for (uint32_t i = 0; i < STREAM_MAX_VIEWERS; i++)
+  {
+    keypad |= server->viewers[i].keypad;
+  }
+  __atomic_store_n(&server->keypad, keypad, __ATOMIC_RELAXED);
+
+  return (length == 0) || ((length < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR));
+}
+
+/** Serve an event on one of a server's sockets */
+static void serve_event(stream_server_t *const server, uint32_t const tag, uint32_t const events)
+{
+  uint8_t resync = 0;
+
+  if (tag == STREAM_WAKE_TAG)
+  {
+    uint64_t wakes;
+    if (read(server->wake_fd, &wakes, sizeof(wakes)) < 0)
+    {
+      return;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    uint8_t new_frame = server->pending_new;
+    pthread_mutex_unlock(&server->lock);
+
+    if (new_frame)
+    {
+      broadcast(server, 1);
+    }
+  }
+  else if (tag == STREAM_LISTEN_TAG)
+  {
+    accept_viewers(server);
+    resync = 1;
+  }
+  else
+  {
+    stream_viewer_t *viewer = &server->viewers[tag];
+
+    if (viewer->fd < 0)
+    {
+      return;
+    }
+    if ((events & (EPOLLERR | EPOLLHUP)) || ((events & EPOLLIN) && read_viewer(server, viewer)))
+    {
+      drop_viewer(server, viewer);
+    }
+    else if ((events & EPOLLOUT) && (flush_viewer(server, viewer) != STATUS_OK))
+    {
+      drop_viewer(server, viewer);
+    }
+    else if (viewer->needs_keyframe && (viewer->output_length == 0))
+    {
+      // Caught up after falling behind; the display may not change again for a while
+      resync = 1;
+    }
+  }
+
+  // New viewers get a keyframe of the last frame sent without waiting for the next one
+  if (resync && (server->frame > 0))
+  {
+    broadcast(server, 0);
+  }
+}
+
+static void *stream_fan_out(void *arg)
+{
+  stream_hub_t *hub = arg;
+  struct epoll_event events[STREAM_EPOLL_EVENTS];
+
+  while (1)
+  {
+    int count = epoll_wait(hub->epoll_fd, events, STREAM_EPOLL_EVENTS, -1);
+
+    pthread_mutex_lock(&hub->lock);
+    for (int e = 0; e < count; e++)
+    {
+      uint64_t data = events[e].data.u64;
+
+      if (data == STREAM_HUB_STOP_TAG)
+      {
+        if (hub->stopping)
+        {
+          pthread_mutex_unlock(&hub->lock);
+          return NULL;
+        }
+        continue;
+      }
+
+      // Events fetched before their server was detached are dropped
+      uint32_t slot = (uint32_t)((data >> 16) & 0xFFFF);
+      stream_server_t *server = hub->servers[slot];
+      if ((server != NULL) && (hub->generations[slot] == (uint32_t)(data >> 32)))
+      {
+        serve_event(server, (uint32_t)(data & 0xFFFF), events[e].events);
+      }
+    }
+    pthread_mutex_unlock(&hub->lock);
+  }
+}
+
+status_code_t stream_hub_init(stream_hub_t *const hub)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(hub);
+
+  memset(hub, 0, sizeof(stream_hub_t));
+  pthread_mutex_init(&hub->lock, NULL);
+  hub->epoll_fd = epoll_create1(0);
+  hub->wake_fd = eventfd(0, EFD_NONBLOCK);
+
+  struct epoll_event stop_event = {.events = EPOLLIN, .data.u64 = STREAM_HUB_STOP_TAG};
+  if ((hub->epoll_fd < 0) || (hub->wake_fd < 0) || (epoll_ctl(hub->epoll_fd, EPOLL_CTL_ADD, hub->wake_fd, &stop_event) != 0) ||
+      (pthread_create(&hub->thread, NULL, stream_fan_out, hub) != 0))
+  {
+    stream_hub_cleanup(hub);
+    return STATUS_ERR_GENERIC;
+  }
+  hub->thread_started = 1;
+
+  return STATUS_OK;
+}
+
+void stream_hub_cleanup(stream_hub_t *const hub)
+{
+  if (hub == NULL)
+  {
+    return;
+  }
+
+  if (hub->thread_started)
+  {
+    uint64_t wake = 1;
+
+    pthread_mutex_lock(&hub->lock);
+    hub->stopping = 1;
+    pthread_mutex_unlock(&hub->lock);
+
+    if (write(hub->wake_fd, &wake, sizeof(wake)) == sizeof(wake))
+    {
+      pthread_join(hub->thread, NULL);
+    }
+    hub->thread_started = 0;
+  }
+
+  int *fds[] = {&hub->epoll_fd, &hub->wake_fd};
+  for (uint8_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+  {
+    if (*fds[i] >= 0)
+    {
+      close(*fds[i]);
+      *fds[i] = -1;
+    }
+  }
+
+  pthread_mutex_destroy(&hub->lock);
+}
+
+status_code_t stream_server_init(stream_server_t *const server, const char *address)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(server);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(address);
+
+  stream_hub_t *hub = malloc(sizeof(stream_hub_t));
+  if (hub == NULL)
+  {
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  status_code_t status = stream_hub_init(hub);
+  if (status != STATUS_OK)
+  {
+    free(hub);
+    return status;
+  }
+
+  status = stream_server_init_shared(server, hub, address);
+  if (status != STATUS_OK)
+  {
+    stream_hub_cleanup(hub);
+    free(hub);
+    return status;
+  }
+  server->owns_hub = 1;
+
+  return STATUS_OK;
+}
+
+status_code_t stream_server_init_shared(stream_server_t *const server, stream_hub_t *const hub, const char *address)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(server);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(hub);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(address);
+
+  struct sockaddr_storage storage;
+  socklen_t length;
+  status_code_t status = parse_address(address, &storage, &length);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  memset(server, 0, sizeof(stream_server_t));
+  server->listen_fd = -1;
+  server->wake_fd = -1;
+  for (uint32_t i = 0; i < STREAM_MAX_VIEWERS; i++)
+  {
+    server->viewers[i].fd = -1;
+  }
+  pthread_mutex_init(&server->lock, NULL);
+
+  if (storage.ss_family == AF_UNIX)
+  {
+    // A socket left behind by a previous server would fail the bind
+    strcpy(server->unix_path, ((struct sockaddr_un *)&storage)->sun_path);
+    unlink(server->unix_path);
+  }
+
+  int reuse = 1;
+  server->listen_fd = socket(storage.ss_family, SOCK_STREAM, 0);
+  server->wake_fd = eventfd(0, EFD_NONBLOCK);
+
+  if ((server->listen_fd < 0) || (server->wake_fd < 0) ||
+      ((storage.ss_family == AF_INET) && (setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0)) ||
+      (bind(server->listen_fd, (struct sockaddr *)&storage, length) != 0) ||
+      (listen(server->listen_fd, STREAM_BACKLOG) != 0) || (set_nonblocking(server->listen_fd) != STATUS_OK))
+  {
+    Log_E("Failed to listen on %s: %s", address, strerror(errno));
+    stream_server_cleanup(server);
+    return STATUS_ERR_GENERIC;
+  }
+
+  pthread_mutex_lock(&hub->lock);
+  uint32_t slot = 0;
+  while ((slot < STREAM_HUB_MAX_SERVERS) && (hub->servers[slot] != NULL))
+  {
+    slot++;
+  }
+
+  if (slot < STREAM_HUB_MAX_SERVERS)
+  {
+    server->hub = hub;
+    server->slot = slot;
+    server->generation = ++hub->next_generation;
+    hub->servers[slot] = server;
+    hub->generations[slot] = server->generation;
+
+    struct epoll_event listen_event = {.events = EPOLLIN, .data.u64 = event_data(server, STREAM_LISTEN_TAG)};
+    struct epoll_event wake_event = {.events = EPOLLIN, .data.u64 = event_data(server, STREAM_WAKE_TAG)};
+    epoll_ctl(hub->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &listen_event);
+    epoll_ctl(hub->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &wake_event);
+  }
+  pthread_mutex_unlock(&hub->lock);
+
+  if (server->hub == NULL)
+  {
+    Log_E("Failed to stream on %s: every stream of the hub is in use", address);
+    stream_server_cleanup(server);
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  Log_I("Streaming the display on %s", address);
+  return STATUS_OK;
+}
+
+status_code_t stream_server_publish(stream_server_t *const server, graphics_t const *const graphics)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(server);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(graphics);
+
+  uint64_t wake = 1;
+
+  pthread_mutex_lock(&server->lock);
+  memcpy(server->pending, graphics->buffer, sizeof(server->pending));
+  server->pending_hires = graphics->hires;
+  server->pending_new = 1;
+  pthread_mutex_unlock(&server->lock);
+
+  return (write(server->wake_fd, &wake, sizeof(wake)) == sizeof(wake)) ? STATUS_OK : STATUS_ERR_GENERIC;
+}
+
+void stream_server_cleanup(stream_server_t *const server)
+{
+  if (server == NULL)
+  {
+    return;
+  }
+
+  stream_hub_t *hub = server->hub;
+  if (hub != NULL)
+  {
+    // Detached while the fan-out thread is not serving it
+    pthread_mutex_lock(&hub->lock);
+    for (uint32_t i = 0; i < STREAM_MAX_VIEWERS; i++)
+    {
+      if (server->viewers[i].fd >= 0)
+      {
+        drop_viewer(server, &server->viewers[i]);
+      }
+    }
+    epoll_ctl(hub->epoll_fd, EPOLL_CTL_DEL, server->listen_fd, NULL);
+    epoll_ctl(hub->epoll_fd, EPOLL_CTL_DEL, server->wake_fd, NULL);
+    hub->servers[server->slot] = NULL;
+    pthread_mutex_unlock(&hub->lock);
+    server->hub = NULL;
+  }
+
+  int *fds[] = {&server->listen_fd, &server->wake_fd};
+  for (uint8_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+  {
+    if (*fds[i] >= 0)
+    {
+      close(*fds[i]);
+      *fds[i] = -1;
+    }
+  }
+
+  if (server->unix_path[0] != '\0')
+  {
+    unlink(server->unix_path);
+    server->unix_path[0] = '\0';
+  }
+
+  if (server->owns_hub)
+  {
+    stream_hub_cleanup(hub);
+    free(hub);
+    server->owns_hub = 0;
+  }
+
+  pthread_mutex_destroy(&server->lock);
+}
+
+status_code_t stream_connect(const char *address, int *const fd)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(address);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(fd);
+
+  struct sockaddr_storage storage;
+  socklen_t length;
+  status_code_t status = parse_address(address, &storage, &length);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  *fd = socket(storage.ss_family, SOCK_STREAM, 0);
+  if ((*fd >= 0) && (connect(*fd, (struct sockaddr *)&storage, length) == 0))
+  {
+    return STATUS_OK;
+  }
+
+  if (*fd >= 0)
+  {
+    close(*fd);
+    *fd = -1;
+  }
+  return STATUS_ERR_GENERIC;
+}
+
+/** Read exactly size bytes */
+static status_code_t read_exact(int const fd, uint8_t *const dest, size_t const size)
+{
+  for (size_t offset = 0; offset < size;)
+  {
+    ssize_t length = read(fd, dest + offset, size - offset);
+
+    if (length > 0)
+    {
+      offset += (size_t)length;
+    }
+    else if (length == 0)
+    {
+      return STATUS_REQ_EXIT;
+    }
+    else if (errno != EINTR)
+    {
+      return STATUS_ERR_GENERIC;
+    }
+  }
+
+  return STATUS_OK;
+}
+
+status_code_t stream_read_message(int const fd, uint8_t *const type, uint8_t *const payload, uint16_t *const length)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(type);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(payload);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(length);
+
+  uint8_t header[STREAM_HEADER_SIZE];
+  status_code_t status = read_exact(fd, header, sizeof(header));
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  *type = header[0];
+  *length = (uint16_t)get_le(header + 2, sizeof(uint16_t));
+  if (*length > STREAM_MAX_PAYLOAD)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  return read_exact(fd, payload, *length);
+}
+
+status_code_t stream_send_keypad(int const fd, uint16_t const keypad)
+{
+  uint8_t message[STREAM_HEADER_SIZE + sizeof(uint16_t)] = {STREAM_MSG_KEYPAD, 0};
+
+  put_le(message + 2, sizeof(uint16_t), sizeof(uint16_t));
+  put_le(message + STREAM_HEADER_SIZE, keypad, sizeof(uint16_t));
+
+  return (send(fd, message, sizeof(message), MSG_NOSIGNAL) == (ssize_t)sizeof(message)) ? STATUS_OK : STATUS_ERR_GENERIC;
+}
+
+/** Adapters of the backend tables */
+static status_code_t render_backend(void *const handle, graphics_t *const graphics)
+{
+  if ((graphics == NULL) || !graphics->display_update)
+  {
+    return STATUS_OK;
+  }
+
+  graphics->display_update = 0;
+  return stream_server_publish(handle, graphics);
+}
+
+static void cleanup_backend(void *const handle)
+{
+  stream_server_cleanup(handle);
+}
+
+static status_code_t read_backend(void *const handle, uint16_t *const keypad)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(handle);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(keypad);
+
+  *keypad = __atomic_load_n(&((stream_server_t *)handle)->keypad, __ATOMIC_RELAXED);
+  return STATUS_OK;
+}
+
+const video_backend_t stream_video_backend = {
+    .render = render_backend,
+    .cleanup = cleanup_backend,
+};
+
+const input_backend_t stream_input_backend = {
+    .read = read_backend,
+};
@@ -0,0 +1,300 @@
+#define _POSIX_C_SOURCE 200809L // write, EAGAIN
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "terminal.h"
+#include "cpu_def.h"
+#include "display.h"
+#include "logging.h"
+#include "status_code.h"
+
+#define TERMINAL_CELL_UNKNOWN (0xFFFF)
+#define TERMINAL_MAX_CELL_BYTES (32)  // Longest cursor move, color change and character of a cell
+#define TERMINAL_FRAME_OVERHEAD (64)  // Screen clear and color reset around a frame
+#define COLOR_UNKNOWN (-1)
+
+/** Nearest xterm 256 color: either the 6x6x6 color cube (16-231) or the grey ramp (232-255) */
+static uint8_t xterm_color(color_rgba_t const *const color)
+{
+  static const uint8_t levels[6] = {0x00, 0x5F, 0x87, 0xAF, 0xD7, 0xFF};
+  uint8_t const channels[3] = {color->r, color->g, color->b};
+  uint8_t cube[3];
+  int32_t cube_distance = 0;
+
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    cube[i] = (channels[i] < 48) ? 0 : (channels[i] < 115) ? 1 : (uint8_t)((channels[i] - 35) / 40);
+    cube_distance += (channels[i] - levels[cube[i]]) * (channels[i] - levels[cube[i]]);
+  }
+
+  int32_t average = (color->r + color->g + color->b) / 3;
+  uint8_t grey = (average < 8) ? 0 : (average > 238) ? 23 : (uint8_t)((average - 8) / 10);
+  int32_t grey_level = 8 + (10 * grey);
+  int32_t grey_distance = 0;
+
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    grey_distance += (channels[i] - grey_level) * (channels[i] - grey_level);
+  }
+
+  return (grey_distance < cube_distance) ? (uint8_t)(232 + grey) : (uint8_t)(16 + (36 * cube[0]) + (6 * cube[1]) + cube[2]);
+}
+
+/** Plane bits of the pixel at (x, y) */
+static inline uint8_t pixel_value(graphics_t const *const graphics, uint8_t const x, uint8_t const y)
+{
+  return (uint8_t)(GRAPHICS_PIXEL(graphics, 0, x, y) | (GRAPHICS_PIXEL(graphics, 1, x, y) << 1));
+}
+
+/** Half-block cell: the top pixel's plane bits, then the bottom pixel's */
+static uint16_t half_block_cell(graphics_t const *const graphics, uint8_t const column, uint8_t const row)
+{
+  return (uint16_t)(pixel_value(graphics, column, row * 2) | (pixel_value(graphics, column, (row * 2) + 1) << 2));
+}
+
+/** Braille cell: the dot bits of the lit pixels, as numbered by Unicode */
+static uint16_t braille_cell(graphics_t const *const graphics, uint8_t const column, uint8_t const row)
+{
+  static const uint8_t dots[4][2] = {{0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
+  uint16_t cell = 0;
+
+  for (uint8_t dy = 0; dy < 4; dy++)
+  {
+    for (uint8_t dx = 0; dx < 2; dx++)
+    {
+      cell |= pixel_value(graphics, (column * 2) + dx, (row * 4) + dy) ? dots[dy][dx] : 0;
+    }
+  }
+
+  return cell;
+}
+
+static void append(terminal_t *const terminal, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void append(terminal_t *const terminal, const char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  int written = vsnprintf(terminal->output + terminal->length, terminal->capacity - terminal->length, format, args);
+  va_end(args);
+
+  if (written > 0)
+  {
+    terminal->length += (size_t)written;
+  }
+}
+
+/** Forget what is on screen, so that the next frame redraws every cell */
+static void invalidate(terminal_t *const terminal)
+{
+  for (uint16_t row = 0; row < TERMINAL_MAX_ROWS; row++)
+  {
+    for (uint16_t column = 0; column < TERMINAL_MAX_COLUMNS; column++)
+    {
+      terminal->cells[row][column] = TERMINAL_CELL_UNKNOWN;
+    }
+  }
+}
+
+/** Write out the frame in one go, if the terminal takes it */
+static status_code_t flush(terminal_t *const terminal)
+{
+  size_t offset = 0;
+
+  while (offset < terminal->length)
+  {
+    ssize_t written = write(terminal->fd, terminal->output + offset, terminal->length - offset);
+
+    if (written > 0)
+    {
+      offset += (size_t)written;
+      continue;
+    }
+
+    if ((written < 0) && (errno == EINTR))
+    {
+      continue;
+    }
+
+    if ((written < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+    {
+      // The viewer is falling behind; what it missed is redrawn with the next frame
+      Log_D("Terminal output dropped %zu bytes", terminal->length - offset);
+      invalidate(terminal);
+      break;
+    }
+
+    Log_E("Failed to write to the terminal: %s", strerror(errno));
+    terminal->bytes_written += offset;
+    terminal->length = 0;
+    return STATUS_ERR_GENERIC;
+  }
+
+  terminal->bytes_written += offset;
+  terminal->length = 0;
+  return STATUS_OK;
+}
+
+status_code_t terminal_init(terminal_t *const terminal, terminal_init_param_t *const param)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(terminal);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(param);
+
+  if ((param->fd < 0) || ((param->mode != TERMINAL_HALF_BLOCK) && (param->mode != TERMINAL_BRAILLE)))
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(terminal, 0, sizeof(terminal_t));
+  terminal->fd = param->fd;
+  terminal->mode = param->mode;
+  terminal->palette[0] = xterm_color(&param->colors.background_color);
+  terminal->palette[1] = xterm_color(&param->colors.foreground_color);
+  terminal->palette[2] = xterm_color(&param->colors.plane2_color);
+  terminal->palette[3] = xterm_color(&param->colors.overlap_color);
+
+  terminal->capacity = (TERMINAL_MAX_ROWS * TERMINAL_MAX_COLUMNS * TERMINAL_MAX_CELL_BYTES) + TERMINAL_FRAME_OVERHEAD;
+  terminal->output = malloc(terminal->capacity);
+  if (terminal->output == NULL)
+  {
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  invalidate(terminal);
+
+  // Hide the cursor and clear the screen
+  append(terminal, "\x1b[?25l\x1b[0m\x1b[2J");
+  return flush(terminal);
+}
+
+status_code_t terminal_render(terminal_t *const terminal, graphics_t *const graphics)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(terminal);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(graphics);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(terminal->output);
+  if (!graphics->display_update)
+  {
+    return STATUS_OK;
+  }
+
+  graphics->display_update = 0;
+
+  uint8_t braille = (terminal->mode == TERMINAL_BRAILLE);
+  uint8_t columns = GRAPHICS_ACTIVE_WIDTH(graphics) / (braille ? 2 : 1);
+  uint8_t rows = GRAPHICS_ACTIVE_HEIGHT(graphics) / (braille ? 4 : 2);
+
+  // The grid changes size with the resolution, so the screen is cleared and drawn anew
+  if (graphics->hires != terminal->hires)
+  {
+    append(terminal, "\x1b[0m\x1b[2J");
+    invalidate(terminal);
+    terminal->hires = graphics->hires;
+  }
+
+  // Colors and cursor position are not assumed to carry over from the previous frame
+  int16_t foreground = COLOR_UNKNOWN;
+  int16_t background = COLOR_UNKNOWN;
+  int16_t cursor_row = -1;
+  int16_t cursor_column = -1;
+
+  for (uint8_t row = 0; row < rows; row++)
+  {
+    for (uint8_t column = 0; column < columns; column++)
+    {
+      uint16_t cell = braille ? braille_cell(graphics, column, row) : half_block_cell(graphics, column, row);
+      if (cell == terminal->cells[row][column])
+      {
+        continue;
+      }
+      terminal->cells[row][column] = cell;
+
+      if ((row != cursor_row) || (column != cursor_column))
+      {
+        append(terminal, "\x1b[%u;%uH", row + 1, column + 1);
+      }
+
+      // A half-block with both halves the same color is drawn as a space in the background color
+      int16_t fg = braille ? terminal->palette[1] : terminal->palette[cell & 0x3];
+      int16_t bg = braille ? terminal->palette[0] : terminal->palette[cell >> 2];
+      uint8_t blank = braille ? (cell == 0) : ((cell & 0x3) == (cell >> 2));
+
+      if (!blank && (fg != foreground) && (bg != background))
+      {
+        append(terminal, "\x1b[38;5;%u;48;5;%um", fg, bg);
+      }
+      else if (!blank && (fg != foreground))
+      {
+        append(terminal, "\x1b[38;5;%um", fg);
+      }
+      else if (bg != background)
+      {
+        append(terminal, "\x1b[48;5;%um", bg);
+      }
+      foreground = blank ? foreground : fg;
+      background = bg;
+
+      if (blank)
+      {
+        append(terminal, " ");
+      }
+      else if (braille)
+      {
+        append(terminal, "%c%c%c", 0xE2, 0xA0 | (cell >> 6), 0x80 | (cell & 0x3F));
+      }
+      else
+      {
+        append(terminal, "\xE2\x96\x80"); // U+2580 upper half block
+      }
+
+      cursor_row = row;
+      cursor_column = column + 1;
+    }
+  }
+
+  if (terminal->length == 0)
+  {
+    return STATUS_OK;
+  }
+
+  append(terminal, "\x1b[0m");
+  return flush(terminal);
+}
+
+void terminal_cleanup(terminal_t *const terminal)
+{
+  if ((terminal == NULL) || (terminal->output == NULL))
+  {
+    return;
+  }
+
+  // Leave the cursor below the display, visible again
+  uint8_t rows = TERMINAL_MAX_ROWS / ((terminal->mode == TERMINAL_BRAILLE) ? 2 : 1);
+  append(terminal, "\x1b[0m\x1b[%u;1H\x1b[?25h\n", terminal->hires ? rows : (rows / 2));
+  flush(terminal);
+
+  free(terminal->output);
+  terminal->output = NULL;
+}
+
+/** Adapters of the video backend table */
+static status_code_t render_backend(void *const handle, graphics_t *const graphics)
+{
+  return terminal_render(handle, graphics);
+}
+
+static void cleanup_backend(void *const handle)
+{
+  terminal_cleanup(handle);
+}
+
+const video_backend_t terminal_backend = {
+    .render = render_backend,
+    .cleanup = cleanup_backend,
+};
@@ -0,0 +1,155 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "trace.h"
+#include "logging.h"
+#include "status_code.h"
+
+/** A completed span, stored as a Chrome trace "X" (complete) event */
+typedef struct trace_event_s
+{
+  const char *name;
+  uint64_t start_us;
+  uint32_t dur_us;
+  uint32_t tid;
+} trace_event_t;
+
+typedef struct trace_handle_s
+{
+  trace_event_t *events;
+  uint32_t count; // Slots claimed, may exceed TRACE_MAX_EVENTS once full
+  uint32_t thread_count;
+  uint64_t origin_us;
+  const char *path;
+
+  /** Cleared by trace_shutdown, which then waits for the writers still recording to be done */
+  uint8_t enabled;
+  uint32_t writers;
+} trace_handle_t;
+
+static trace_handle_t trace_handle;
+static __thread uint32_t thread_id;
+
+/** Helper function to give each recording thread a small, stable id */
+static uint32_t get_thread_id(void)
+{
+  if (thread_id == 0)
+  {
+    thread_id = __atomic_add_fetch(&trace_handle.thread_count, 1, __ATOMIC_RELAXED);
+  }
+
+  return thread_id;
+}
+
+status_code_t trace_init(const char *path)
+{
+  if (__atomic_load_n(&trace_handle.enabled, __ATOMIC_ACQUIRE))
+  {
+    return STATUS_OK;
+  }
+
+  if (path == NULL)
+  {
+    path = getenv(TRACE_FILE_ENV);
+  }
+
+  trace_handle.path = (path != NULL) ? path : TRACE_DEFAULT_FILE;
+  trace_handle.events = calloc(TRACE_MAX_EVENTS, sizeof(trace_event_t));
+  if (trace_handle.events == NULL)
+  {
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  trace_handle.count = 0;
+  trace_handle.origin_us = trace_now_us();
+  __atomic_store_n(&trace_handle.enabled, 1, __ATOMIC_RELEASE);
+  atexit(trace_shutdown);
+
+  Log_I("Recording trace spans to %s", trace_handle.path);
+  return STATUS_OK;
+}
+
+uint64_t trace_now_us(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return ((uint64_t)now.tv_sec * 1000000) + ((uint64_t)now.tv_nsec / 1000);
+}
+
+void trace_record(const char *name, uint64_t const start_us, uint64_t const end_us)
+{
+  // Announce the write before checking the flag, so that trace_shutdown either waits for it or is seen
+  __atomic_add_fetch(&trace_handle.writers, 1, __ATOMIC_SEQ_CST);
+
+  if (__atomic_load_n(&trace_handle.enabled, __ATOMIC_SEQ_CST))
+  {
+    uint32_t index = __atomic_fetch_add(&trace_handle.count, 1, __ATOMIC_RELAXED);
+    if (index < TRACE_MAX_EVENTS)
+    {
+      trace_handle.events[index] = (trace_event_t){
+          .name = name,
+          .start_us = start_us,
+          .dur_us = (uint32_t)(end_us - start_us),
+          .tid = get_thread_id(),
+      };
+    }
+  }
+
+  __atomic_sub_fetch(&trace_handle.writers, 1, __ATOMIC_RELEASE);
+}
+
+void trace_shutdown(void)
+{
+  if (!__atomic_exchange_n(&trace_handle.enabled, 0, __ATOMIC_SEQ_CST))
+  {
+    return;
+  }
+
+  // Other threads, e.g. the audio callback, may still be recording a span
+  while (__atomic_load_n(&trace_handle.writers, __ATOMIC_ACQUIRE) > 0)
+  {
+    sched_yield();
+  }
+
+  trace_event_t *events = trace_handle.events;
+  trace_handle.events = NULL;
+
+  uint32_t count = __atomic_load_n(&trace_handle.count, __ATOMIC_ACQUIRE);
+  uint32_t recorded = (count < TRACE_MAX_EVENTS) ? count : TRACE_MAX_EVENTS;
+
+  if (count > TRACE_MAX_EVENTS)
+  {
+    Log_W("Trace buffer full, %u spans dropped", count - TRACE_MAX_EVENTS);
+  }
+
+  FILE *file = fopen(trace_handle.path, "w");
+  if (file == NULL)
+  {
+    Log_E("Failed to open trace file: %s", trace_handle.path);
+    free(events);
+    return;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  fprintf(file, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"chip8_emu\"}}");
+
+  for (uint32_t i = 0; i < recorded; i++)
+  {
+    trace_event_t const *event = &events[i];
+
+    fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"dur\":%u}",
+            event->name, event->tid, (unsigned long long)(event->start_us - trace_handle.origin_us), event->dur_us);
+  }
+
+  fprintf(file, "\n]}\n");
+  fclose(file);
+  free(events);
+
+  Log_I("Wrote %u trace spans to %s", recorded, trace_handle.path);
+}
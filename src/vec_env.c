@@ -0,0 +1,324 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vec_env.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "logging.h"
+#include "search.h"
+#include "status_code.h"
+
+/** Write the current display into the newest slot of an environment's frame stack */
+static void write_observation(vec_env_t *const env, cpu_state_t *const state, uint8_t *const obs)
+{
+  graphics_t const *gfx = &state->peripherals.graphics;
+  uint8_t downsample = env->params.downsample;
+  uint8_t scale = gfx->hires ? 1 : 2; // Low resolution pixels cover 2x2 high resolution ones
+  uint8_t cells = (scale > downsample) ? (scale / downsample) : 1; // Observation pixels per display pixel, each way
+  uint32_t width = VEC_ENV_OBS_WIDTH(downsample);
+  uint32_t height = VEC_ENV_OBS_HEIGHT(downsample);
+  size_t frame_size = width * height;
+  uint8_t *frame = obs + (frame_size * (env->params.frame_stack - 1));
+
+  if (env->params.frame_stack > 1)
+  {
+    memmove(obs, obs + frame_size, frame_size * (env->params.frame_stack - 1));
+  }
+
+  memset(frame, 0, frame_size);
+
+  // Only lit pixels need visiting, and most of the display is usually dark
+  for (uint32_t y = 0; y < GRAPHICS_ACTIVE_HEIGHT(gfx); y++)
+  {
+    uint8_t *row = frame + (((y * scale) / downsample) * width);
+
+    for (uint32_t w = 0; w < (GRAPHICS_ACTIVE_WIDTH(gfx) / GRAPHICS_WORD_BITS); w++)
+    {
+      uint64_t plane0 = gfx->buffer[0][y][w];
+      uint64_t plane1 = gfx->buffer[1][y][w];
+
+      for (uint64_t lit = plane0 | plane1; lit != 0;)
+      {
+        uint8_t shift = (GRAPHICS_WORD_BITS - 1) - __builtin_clzll(lit);
+        uint32_t x = (w * GRAPHICS_WORD_BITS) + (GRAPHICS_WORD_BITS - 1 - shift);
+        uint8_t value = (uint8_t)(((plane0 >> shift) & 1) | (((plane1 >> shift) & 1) << 1));
+        uint8_t *cell = row + ((x * scale) / downsample);
+
+        lit &= ~(1ULL << shift);
+
+        for (uint8_t cy = 0; cy < cells; cy++)
+        {
+          for (uint8_t cx = 0; cx < cells; cx++)
+          {
+            cell[(cy * width) + cx] |= value;
+          }
+        }
+      }
+    }
+  }
+}
+
+/** Whether any of the done predicates holds */
+static uint8_t episode_over(vec_env_t *const env, cpu_state_t *const state)
+{
+  for (uint32_t i = 0; i < env->params.done_count; i++)
+  {
+    int64_t score = 0;
+    search_score(state, &env->params.done_predicates[i], 1, &score);
+    if (score != 0)
+    {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/** Restart an environment's episode, filling its frame stack with the first frame */
+static status_code_t restart(vec_env_t *const env, vec_env_instance_t *const instance, uint8_t *const obs)
+{
+  status_code_t status = reset_cpu(&instance->state, &env->template_state);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  instance->episode_frames = 0;
+  search_score(&instance->state, env->params.reward_predicates, env->params.reward_count, &instance->score);
+
+  for (uint8_t i = 0; i < env->params.frame_stack; i++)
+  {
+    write_observation(env, &instance->state, obs);
+  }
+
+  return STATUS_OK;
+}
+
+/** Reset or step a single environment of the current batch */
+static status_code_t run_env(vec_env_t *const env, uint32_t const index)
+{
+  vec_env_instance_t *instance = &env->instances[index];
+  uint8_t *obs = env->observations + (env->obs_size * index);
+
+  if (env->resetting)
+  {
+    return restart(env, instance, obs);
+  }
+
+  int64_t score = instance->score;
+  status_code_t status = run_frames(&instance->state, env->actions[index], env->params.frame_skip);
+  uint8_t done = (status != STATUS_OK);
+
+  instance->episode_frames += env->params.frame_skip;
+  search_score(&instance->state, env->params.reward_predicates, env->params.reward_count, &instance->score);
+
+  done |= episode_over(env, &instance->state);
+  done |= (env->params.max_episode_frames > 0) && (instance->episode_frames >= env->params.max_episode_frames);
+
+  env->rewards[index] = (float)(instance->score - score);
+  env->dones[index] = done;
+
+  if (done)
+  {
+    return restart(env, instance, obs);
+  }
+
+  write_observation(env, &instance->state, obs);
+  return STATUS_OK;
+}
+
+/** Run environments of the current batch until none are left */
+static void run_batch(vec_env_t *const env)
+{
+  for (uint32_t i = __atomic_fetch_add(&env->next_env, 1, __ATOMIC_RELAXED); i < env->params.num_envs;
+       i = __atomic_fetch_add(&env->next_env, 1, __ATOMIC_RELAXED))
+  {
+    status_code_t status = run_env(env, i);
+    if (status != STATUS_OK)
+    {
+      __atomic_store_n(&env->status, status, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+static void *vec_env_worker(void *arg)
+{
+  vec_env_t *env = arg;
+  uint64_t generation = 0;
+
+  pthread_mutex_lock(&env->lock);
+  while (1)
+  {
+    while (!env->stopping && (env->generation == generation))
+    {
+      pthread_cond_wait(&env->start, &env->lock);
+    }
+    if (env->stopping)
+    {
+      break;
+    }
+    generation = env->generation;
+    pthread_mutex_unlock(&env->lock);
+
+    run_batch(env);
+
+    pthread_mutex_lock(&env->lock);
+    if (--env->pending == 0)
+    {
+      pthread_cond_signal(&env->finished);
+    }
+  }
+  pthread_mutex_unlock(&env->lock);
+
+  return NULL;
+}
+
+/** Run a batch across the workers and the calling thread */
+static status_code_t dispatch(vec_env_t *const env)
+{
+  env->status = STATUS_OK;
+  env->next_env = 0;
+
+  if (env->worker_count == 0)
+  {
+    run_batch(env);
+    return env->status;
+  }
+
+  pthread_mutex_lock(&env->lock);
+  env->pending = env->worker_count;
+  env->generation++;
+  pthread_cond_broadcast(&env->start);
+  pthread_mutex_unlock(&env->lock);
+
+  run_batch(env);
+
+  pthread_mutex_lock(&env->lock);
+  while (env->pending > 0)
+  {
+    pthread_cond_wait(&env->finished, &env->lock);
+  }
+  pthread_mutex_unlock(&env->lock);
+
+  return env->status;
+}
+
+status_code_t vec_env_init(vec_env_t *const env, const vec_env_params_t *params)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(env);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(params);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(params->rom);
+
+  uint8_t downsample = params->downsample;
+
+  if ((params->num_envs == 0) || (params->frame_skip == 0) || (params->frame_stack == 0) ||
+      (downsample == 0) || (downsample > 8) || (downsample & (downsample - 1)) ||
+      ((params->reward_predicates == NULL) && (params->reward_count > 0)) ||
+      ((params->done_predicates == NULL) && (params->done_count > 0)))
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  memset(env, 0, sizeof(vec_env_t));
+  env->params = *params;
+  env->obs_size = (size_t)VEC_ENV_OBS_WIDTH(downsample) * VEC_ENV_OBS_HEIGHT(downsample) * params->frame_stack;
+
+  status_code_t status = init_template(&env->template_state, params->rom, params->profile);
+  if (status != STATUS_OK)
+  {
+    cleanup_cpu(&env->template_state);
+    return status;
+  }
+
+  env->instances = calloc(params->num_envs, sizeof(vec_env_instance_t));
+  if (env->instances == NULL)
+  {
+    cleanup_cpu(&env->template_state);
+    return STATUS_ERR_NO_MEMORY;
+  }
+
+  for (uint32_t i = 0; (i < params->num_envs) && (status == STATUS_OK); i++)
+  {
+    status = init_cpu_from_template(&env->instances[i].state, &env->template_state);
+  }
+
+  pthread_mutex_init(&env->lock, NULL);
+  pthread_cond_init(&env->start, NULL);
+  pthread_cond_init(&env->finished, NULL);
+
+  // The calling thread takes part in every batch, so it counts as one of the threads
+  uint32_t threads = (params->threads > VEC_ENV_MAX_THREADS) ? VEC_ENV_MAX_THREADS : params->threads;
+
+  for (; (status == STATUS_OK) && ((env->worker_count + 1) < threads); env->worker_count++)
+  {
+    if (pthread_create(&env->workers[env->worker_count], NULL, vec_env_worker, env) != 0)
+    {
+      Log_W("Failed to start environment worker %u", env->worker_count + 1);
+      break;
+    }
+  }
+
+  if (status != STATUS_OK)
+  {
+    vec_env_cleanup(env);
+  }
+  return status;
+}
+
+void vec_env_cleanup(vec_env_t *const env)
+{
+  if (env == NULL)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&env->lock);
+  env->stopping = 1;
+  pthread_cond_broadcast(&env->start);
+  pthread_mutex_unlock(&env->lock);
+
+  for (uint32_t i = 0; i < env->worker_count; i++)
+  {
+    pthread_join(env->workers[i], NULL);
+  }
+  env->worker_count = 0;
+
+  pthread_cond_destroy(&env->finished);
+  pthread_cond_destroy(&env->start);
+  pthread_mutex_destroy(&env->lock);
+
+  for (uint32_t i = 0; (env->instances != NULL) && (i < env->params.num_envs); i++)
+  {
+    cleanup_cpu(&env->instances[i].state);
+  }
+  free(env->instances);
+  env->instances = NULL;
+
+  cleanup_cpu(&env->template_state);
+}
+
+status_code_t vec_env_reset(vec_env_t *const env, uint8_t *const observations)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(env);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(observations);
+
+  env->observations = observations;
+  env->resetting = 1;
+  return dispatch(env);
+}
+
+status_code_t vec_env_step(vec_env_t *const env, const uint16_t *actions, uint8_t *const observations,
+                           float *const rewards, uint8_t *const dones)
+{
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(env);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(actions);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(observations);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(rewards);
+  VERIFY_PTR_RETURN_ERROR_IF_NULL(dones);
+
+  env->actions = actions;
+  env->observations = observations;
+  env->rewards = rewards;
+  env->dones = dones;
+  env->resetting = 0;
+  return dispatch(env);
+}
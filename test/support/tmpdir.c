@@ -0,0 +1,54 @@
+#define _POSIX_C_SOURCE 200809L // mkdtemp
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tmpdir.h"
+#include "unity.h"
+
+void tmpdir_create(tmpdir_t *const tmpdir)
+{
+  snprintf(tmpdir->dir, sizeof(tmpdir->dir), "/tmp/chip8_test_XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(tmpdir->dir));
+}
+
+void tmpdir_path(tmpdir_t const *const tmpdir, const char *name, char *const path)
+{
+  snprintf(path, TMPDIR_PATH_SIZE, "%s/%s", tmpdir->dir, name);
+}
+
+void tmpdir_write(tmpdir_t const *const tmpdir, const char *name, uint8_t const *data, size_t const size, char *const path)
+{
+  tmpdir_path(tmpdir, name, path);
+
+  FILE *file = fopen(path, "wb");
+  TEST_ASSERT_NOT_NULL(file);
+  TEST_ASSERT_EQUAL_UINT64(size, fwrite(data, 1, size, file));
+  TEST_ASSERT_EQUAL_INT(0, fclose(file));
+}
+
+void tmpdir_remove(tmpdir_t *const tmpdir)
+{
+  char path[TMPDIR_PATH_SIZE];
+  struct dirent *entry;
+  DIR *dir = opendir(tmpdir->dir);
+
+  if (dir == NULL)
+  {
+    return;
+  }
+
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if ((strcmp(entry->d_name, ".") != 0) && (strcmp(entry->d_name, "..") != 0))
+    {
+      tmpdir_path(tmpdir, entry->d_name, path);
+      unlink(path);
+    }
+  }
+  closedir(dir);
+  rmdir(tmpdir->dir);
+}
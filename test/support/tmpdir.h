@@ -0,0 +1,49 @@
+#ifndef __TMPDIR_H__
+#define __TMPDIR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TMPDIR_PATH_SIZE (96)
+
+/** A directory of its own for the files and sockets of a test, removed with everything in it */
+typedef struct tmpdir_s
+{
+  char dir[32];
+} tmpdir_t;
+
+/**
+ * Create a new directory under /tmp; fails the test if it cannot.
+ * @param tmpdir - Pointer to the directory to create.
+ * @return None
+ */
+void tmpdir_create(tmpdir_t *const tmpdir);
+
+/**
+ * Path of a file in the directory.
+ * @param tmpdir - Pointer to a directory.
+ * @param name - Name of the file.
+ * @param path - Buffer of TMPDIR_PATH_SIZE bytes for the path.
+ * @return None
+ */
+void tmpdir_path(tmpdir_t const *const tmpdir, const char *name, char *const path);
+
+/**
+ * Write a file, a ROM for instance, into the directory; fails the test if it cannot.
+ * @param tmpdir - Pointer to a directory.
+ * @param name - Name of the file.
+ * @param data - Contents of the file.
+ * @param size - Size of the contents.
+ * @param path - Buffer of TMPDIR_PATH_SIZE bytes for the path of the file.
+ * @return None
+ */
+void tmpdir_write(tmpdir_t const *const tmpdir, const char *name, uint8_t const *data, size_t const size, char *const path);
+
+/**
+ * Remove the directory and whatever the test left in it.
+ * @param tmpdir - Pointer to a directory.
+ * @return None
+ */
+void tmpdir_remove(tmpdir_t *const tmpdir);
+
+#endif /* __TMPDIR_H__ */
@@ -0,0 +1,131 @@
+#include "unity.h"
+#include "atlas_canvas.h"
+#include "cpu_def.h"
+#include "status_code.h"
+#include <string.h>
+
+#define BACKGROUND (0xFF121212)
+#define FOREGROUND (0xFFE9E9E9)
+#define PLANE2 (0xFF6E6E6E)
+#define OVERLAP (0xFFA8A8A8)
+
+static const display_init_param_t colors = {
+    .background_color = DEFAULT_BG_COLOR,
+    .foreground_color = DEFAULT_FG_COLOR,
+    .plane2_color = DEFAULT_PLANE2_COLOR,
+    .overlap_color = DEFAULT_OVERLAP_COLOR,
+};
+
+static atlas_canvas_t canvas;
+static graphics_t graphics;
+
+void setUp(void)
+{
+  memset(&graphics, 0, sizeof(graphics));
+}
+
+void tearDown(void)
+{
+  atlas_canvas_cleanup(&canvas);
+}
+
+/** Pixel (x, y) of a cell, in screen pixels of the cell */
+static uint32_t cell_pixel(uint32_t const index, uint32_t const x, uint32_t const y)
+{
+  uint32_t column = index % canvas.columns;
+  uint32_t row = index / canvas.columns;
+  return canvas.pixels[(((row * ATLAS_CELL_HEIGHT) + y) * canvas.width) + (column * ATLAS_CELL_WIDTH) + x];
+}
+
+void test_atlas_canvas_init_lays_out_cells(void)
+{
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, atlas_canvas_init(&canvas, 0, 1, &colors));
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, atlas_canvas_init(&canvas, ATLAS_MAX_CELLS + 1, 1, &colors));
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, atlas_canvas_init(&canvas, 4, 0, &colors));
+
+  // More columns than cells puts them all on one row
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, atlas_canvas_init(&canvas, 3, 8, &colors));
+  TEST_ASSERT_EQUAL_UINT32(3, canvas.columns);
+  TEST_ASSERT_EQUAL_UINT32(1, canvas.rows);
+  atlas_canvas_cleanup(&canvas);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, atlas_canvas_init(&canvas, 5, 2, &colors));
+  TEST_ASSERT_EQUAL_UINT32(3, canvas.rows);
+  TEST_ASSERT_EQUAL_UINT32(2 * ATLAS_CELL_WIDTH, canvas.width);
+  TEST_ASSERT_EQUAL_UINT32(3 * ATLAS_CELL_HEIGHT, canvas.height);
+
+  for (uint32_t i = 0; i < (canvas.width * canvas.height); i++)
+  {
+    TEST_ASSERT_EQUAL_HEX32(BACKGROUND, canvas.pixels[i]);
+  }
+
+  // Nothing has been uploaded yet
+  TEST_ASSERT_EQUAL_UINT8(1, canvas.dirty);
+  TEST_ASSERT_EQUAL_UINT32(0, canvas.dirty_first);
+  TEST_ASSERT_EQUAL_UINT32(2, canvas.dirty_last);
+}
+
+void test_atlas_canvas_draw_scales_and_colors_pixels(void)
+{
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, atlas_canvas_init(&canvas, 4, 2, &colors));
+
+  // Low resolution pixels are doubled each way
+  graphics.buffer[0][0][0] = 1ULL << 63;
+  graphics.buffer[1][0][0] = 1ULL << 62;
+  graphics.buffer[0][31][0] = 1ULL | (1ULL << 1);
+  graphics.buffer[1][31][0] = 1ULL;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, atlas_canvas_draw(&canvas, 3, &graphics));
+
+  TEST_ASSERT_EQUAL_HEX32(FOREGROUND, cell_pixel(3, 0, 0));
+  TEST_ASSERT_EQUAL_HEX32(FOREGROUND, cell_pixel(3, 1, 1));
+  TEST_ASSERT_EQUAL_HEX32(PLANE2, cell_pixel(3, 2, 0));
+  TEST_ASSERT_EQUAL_HEX32(PLANE2, cell_pixel(3, 3, 1));
+  TEST_ASSERT_EQUAL_HEX32(BACKGROUND, cell_pixel(3, 4, 0));
+  TEST_ASSERT_EQUAL_HEX32(FOREGROUND, cell_pixel(3, 124, 63));
+  TEST_ASSERT_EQUAL_HEX32(OVERLAP, cell_pixel(3, 126, 62));
+  TEST_ASSERT_EQUAL_HEX32(OVERLAP, cell_pixel(3, 127, 63));
+
+  // The other cells are left alone
+  TEST_ASSERT_EQUAL_HEX32(BACKGROUND, cell_pixel(0, 0, 0));
+  TEST_ASSERT_EQUAL_HEX32(BACKGROUND, cell_pixel(2, 0, 0));
+
+  // High resolution pixels map one to one
+  memset(&graphics, 0, sizeof(graphics));
+  graphics.hires = 1;
+  graphics.buffer[0][63][1] = 1ULL;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, atlas_canvas_draw(&canvas, 3, &graphics));
+
+  TEST_ASSERT_EQUAL_HEX32(BACKGROUND, cell_pixel(3, 0, 0));
+  TEST_ASSERT_EQUAL_HEX32(BACKGROUND, cell_pixel(3, 126, 63));
+  TEST_ASSERT_EQUAL_HEX32(FOREGROUND, cell_pixel(3, 127, 63));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, atlas_canvas_draw(&canvas, 4, &graphics));
+}
+
+void test_atlas_canvas_draw_tracks_dirty_rows(void)
+{
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, atlas_canvas_init(&canvas, 8, 2, &colors));
+
+  // As after an upload
+  canvas.dirty = 0;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, atlas_canvas_draw(&canvas, 5, &graphics));
+  TEST_ASSERT_EQUAL_UINT8(1, canvas.dirty);
+  TEST_ASSERT_EQUAL_UINT32(2, canvas.dirty_first);
+  TEST_ASSERT_EQUAL_UINT32(2, canvas.dirty_last);
+
+  // The span grows to cover every row drawn into
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, atlas_canvas_draw(&canvas, 1, &graphics));
+  TEST_ASSERT_EQUAL_UINT32(0, canvas.dirty_first);
+  TEST_ASSERT_EQUAL_UINT32(2, canvas.dirty_last);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, atlas_canvas_draw(&canvas, 7, &graphics));
+  TEST_ASSERT_EQUAL_UINT32(0, canvas.dirty_first);
+  TEST_ASSERT_EQUAL_UINT32(3, canvas.dirty_last);
+
+  // Once uploaded, the next draw starts a new span
+  canvas.dirty = 0;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, atlas_canvas_draw(&canvas, 6, &graphics));
+  TEST_ASSERT_EQUAL_UINT32(3, canvas.dirty_first);
+  TEST_ASSERT_EQUAL_UINT32(3, canvas.dirty_last);
+}
@@ -2,16 +2,23 @@
 #include "chip8.h"
 #include "cpu_def.h"
 #include "status_code.h"
+#include "tmpdir.h"
 #include "string.h"
 
 TEST_FILE("chip8.c")
+TEST_FILE("exec_trace.c")
+TEST_FILE("logging.c")
+
+static tmpdir_t tmpdir;
 
 void setUp(void)
 {
+  tmpdir_create(&tmpdir);
 }
 
 void tearDown(void)
 {
+  tmpdir_remove(&tmpdir);
 }
 
 void stub_init_cpu_state(cpu_state_t *cpu_state)
@@ -21,8 +28,10 @@ void stub_init_cpu_state(cpu_state_t *cpu_state)
 
 void stub_set_opcode(cpu_state_t *cpu_state, uint16_t opcode, uint16_t offset)
 {
-  cpu_state->memory[START_ADDRESS + offset] = (uint8_t)((opcode & 0xFF00) >> 8);
-  cpu_state->memory[START_ADDRESS + offset + 1] = (uint8_t)((opcode & 0x00FF));
+  uint8_t *memory;
+  get_memory(cpu_state, &memory, NULL);
+  memory[START_ADDRESS + offset] = (uint8_t)((opcode & 0xFF00) >> 8);
+  memory[START_ADDRESS + offset + 1] = (uint8_t)((opcode & 0x00FF));
 }
 
 void stub_clear_mem(cpu_state_t *cpu_state)
@@ -33,6 +42,17 @@ void stub_clear_mem(cpu_state_t *cpu_state)
   }
 }
 
+void stub_fill_graphics(cpu_state_t *cpu_state, uint64_t pattern)
+{
+  for (int16_t row = 0; row < GRAPHICS_HIRES_HEIGHT; row++)
+  {
+    for (int16_t w = 0; w < GRAPHICS_ROW_WORDS; w++)
+    {
+      cpu_state->peripherals.graphics.buffer[0][row][w] = pattern;
+    }
+  }
+}
+
 void stub_clear_V(cpu_state_t *cpu_state)
 {
   for (int8_t i = 0; i < REG_COUNT; i++)
@@ -62,6 +82,63 @@ void test_init_cpu_with_null_ptr(void)
   TEST_ASSERT_EQUAL_INT(STATUS_ERR_NULL_PTR, init_cpu(NULL));
 }
 
+void test_set_quirk_profile(void)
+{
+  cpu_state_t cpu_state = {0};
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP));
+  TEST_ASSERT_EQUAL_INT(QUIRK_PROFILE_SUPER_CHIP, cpu_state.quirk_profile);
+}
+
+void test_set_quirk_profile_with_invalid_profile(void)
+{
+  cpu_state_t cpu_state = {0};
+
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, set_quirk_profile(&cpu_state, QUIRK_PROFILE_COUNT));
+  TEST_ASSERT_EQUAL_INT(QUIRK_PROFILE_CHIP8, cpu_state.quirk_profile);
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_NULL_PTR, set_quirk_profile(NULL, QUIRK_PROFILE_CHIP8));
+}
+
+void test_emulation_cycle_with_invalid_profile(void)
+{
+  cpu_state_t cpu_state = {0};
+
+  stub_init_cpu_state(&cpu_state);
+  cpu_state.quirk_profile = QUIRK_PROFILE_COUNT;
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, reference_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX16(START_ADDRESS, cpu_state.registers.pc);
+}
+
+void test_set_quirk_profile_xo_chip_extends_memory(void)
+{
+  cpu_state_t cpu_state = {0};
+  uint8_t *memory = NULL;
+  size_t size = 0;
+  cpu_state.memory[0x0FFF] = 0xAB;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, get_memory(&cpu_state, &memory, &size));
+  TEST_ASSERT_EQUAL_INT(XO_MEM_SIZE, size);
+  TEST_ASSERT_EQUAL_HEX8(0xAB, memory[0x0FFF]);
+
+  memory[0x0FFE] = 0xCD;
+  memory[0x1000] = 0xEF;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, set_quirk_profile(&cpu_state, QUIRK_PROFILE_CHIP8));
+  TEST_ASSERT_NULL(cpu_state.xo_memory);
+  TEST_ASSERT_EQUAL_HEX8(0xCD, cpu_state.memory[0x0FFE]);
+}
+
+void test_quirk_profile_from_name(void)
+{
+  quirk_profile_t profile = QUIRK_PROFILE_CHIP8;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, quirk_profile_from_name("vip", &profile));
+  TEST_ASSERT_EQUAL_INT(QUIRK_PROFILE_COSMAC_VIP, profile);
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, quirk_profile_from_name("chip-48", &profile));
+  TEST_ASSERT_EQUAL_INT(QUIRK_PROFILE_COSMAC_VIP, profile);
+}
+
 void test_emulation_cycle_fetch_with_valid_address(void)
 {
   cpu_state_t cpu_state = {0};
@@ -78,7 +155,15 @@ void test_emulation_cycle_fetch_with_out_of_bound_address(void)
   stub_init_cpu_state(&cpu_state);
   cpu_state.registers.pc = 0x1000;
 
+#ifdef CHIP8_STRICT_MEMORY
   TEST_ASSERT_EQUAL_INT(STATUS_ERR_MEM_OUT_OF_BOUNDS, emulation_cycle(&cpu_state));
+#else
+  cpu_state.memory[0x0000] = 0x12;
+  cpu_state.memory[0x0001] = 0x34;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX16(0x0234, cpu_state.registers.pc);
+#endif
 }
 
 void test_emulation_cycle_update_previous_keypad_state(void)
@@ -93,6 +178,203 @@ void test_emulation_cycle_update_previous_keypad_state(void)
   TEST_ASSERT_EQUAL_HEX16(0x1234, cpu_state.peripherals.keypad.previous);
 }
 
+void test_reference_cycle_applies_profile_quirks(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_COSMAC_VIP);
+  stub_set_opcode(&cpu_state, 0x8016, 0);
+  cpu_state.registers.V[0] = 0x00;
+  cpu_state.registers.V[1] = 0x05;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, reference_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x02, cpu_state.registers.V[0]);
+  TEST_ASSERT_EQUAL_HEX8(1, cpu_state.registers.V[0xF]);
+  TEST_ASSERT_EQUAL_HEX16(START_ADDRESS + 2, cpu_state.registers.pc);
+}
+
+void test_chip8_state_hash_tracks_changes_incrementally(void)
+{
+  cpu_state_t cpu_state;
+  cpu_state_t rehashed;
+  uint64_t hash, expected, initial;
+  const uint16_t opcodes[] = {0x6A78, 0xA300, 0xFA33, 0xD015, 0x00E0, 0xD01F, 0xF255};
+
+  init_cpu(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  for (uint8_t i = 0; i < sizeof(opcodes) / sizeof(opcodes[0]); i++)
+  {
+    stub_set_opcode(&cpu_state, opcodes[i], i * 2);
+  }
+  chip8_state_rehash(&cpu_state);
+  chip8_state_hash(&cpu_state, &initial);
+
+  for (uint8_t i = 0; i < sizeof(opcodes) / sizeof(opcodes[0]); i++)
+  {
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+
+    memcpy(&rehashed, &cpu_state, sizeof(cpu_state_t));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_state_rehash(&rehashed));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_state_hash(&cpu_state, &hash));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_state_hash(&rehashed, &expected));
+    TEST_ASSERT_EQUAL_HEX64(expected, hash);
+    TEST_ASSERT_TRUE(hash != initial);
+  }
+
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_NULL_PTR, chip8_state_hash(&cpu_state, NULL));
+}
+
+void test_chip8_restore_returns_to_snapshot(void)
+{
+  cpu_state_t cpu_state, pristine = {0};
+  const uint8_t rom[] = {0x6A, 0x78, 0xA3, 0x00, 0xFA, 0x33, 0xD0, 0x15, 0x00, 0xC2, 0xD0, 0x1F, 0x00, 0xFB, 0xF2, 0x55};
+  const quirk_profile_t profiles[] = {QUIRK_PROFILE_SUPER_CHIP, QUIRK_PROFILE_XO_CHIP};
+
+  for (uint8_t p = 0; p < sizeof(profiles) / sizeof(profiles[0]); p++)
+  {
+    uint8_t *memory, *pristine_memory;
+    size_t size;
+    uint64_t hash, expected;
+
+    init_cpu(&cpu_state);
+    set_quirk_profile(&cpu_state, profiles[p]);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_snapshot(&pristine, &cpu_state));
+
+    for (uint8_t run = 0; run < 2; run++)
+    {
+      TEST_ASSERT_EQUAL_INT(STATUS_OK, load_rom_data(&cpu_state, rom, sizeof(rom)));
+      for (uint8_t i = 0; i < sizeof(rom) / 2; i++)
+      {
+        TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+      }
+
+      TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_restore(&cpu_state, &pristine));
+
+      get_memory(&cpu_state, &memory, &size);
+      get_memory(&pristine, &pristine_memory, NULL);
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(pristine_memory, memory, size + MEM_GUARD_SIZE);
+      TEST_ASSERT_EQUAL_MEMORY(&pristine.peripherals.graphics.buffer, &cpu_state.peripherals.graphics.buffer,
+                               sizeof(cpu_state.peripherals.graphics.buffer));
+      TEST_ASSERT_EQUAL_MEMORY(&pristine.registers, &cpu_state.registers, sizeof(registers_t));
+
+      chip8_state_hash(&pristine, &expected);
+      chip8_state_rehash(&cpu_state);
+      chip8_state_hash(&cpu_state, &hash);
+      TEST_ASSERT_EQUAL_HEX64(expected, hash);
+    }
+
+    cleanup_cpu(&cpu_state);
+  }
+
+  cleanup_cpu(&pristine);
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_NULL_PTR, chip8_restore(&cpu_state, NULL));
+}
+
+void test_chip8_snapshot_update(void)
+{
+  cpu_state_t cpu_state, snapshot = {0}, expected = {0};
+  const uint8_t rom[] = {0x6A, 0x78, 0xA3, 0x00, 0xFA, 0x33, 0xD0, 0x15, 0x00, 0xC2, 0xD0, 0x1F, 0x00, 0xFB, 0xF2, 0x55};
+  uint8_t *memory, *expected_memory;
+  size_t size;
+
+  init_cpu(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, load_rom_data(&cpu_state, rom, sizeof(rom)));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_snapshot(&snapshot, &cpu_state));
+
+  // Store the BCD digits and draw, then bring the snapshot up to date with that
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  }
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_snapshot_update(&snapshot, &cpu_state));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_clone(&expected, &cpu_state));
+
+  // Restoring after running on returns to the updated snapshot, not the original one
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  }
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_restore(&cpu_state, &snapshot));
+
+  get_memory(&cpu_state, &memory, &size);
+  get_memory(&expected, &expected_memory, NULL);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_memory, memory, size + MEM_GUARD_SIZE);
+  TEST_ASSERT_EQUAL_MEMORY(&expected.peripherals.graphics.buffer, &cpu_state.peripherals.graphics.buffer,
+                           sizeof(cpu_state.peripherals.graphics.buffer));
+  TEST_ASSERT_EQUAL_MEMORY(&expected.registers, &cpu_state.registers, sizeof(registers_t));
+  TEST_ASSERT_EQUAL_UINT8(2, memory[0x301]);
+
+  cleanup_cpu(&expected);
+  cleanup_cpu(&snapshot);
+  cleanup_cpu(&cpu_state);
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_NULL_PTR, chip8_snapshot_update(NULL, &cpu_state));
+}
+
+void test_chip8_restore_after_profile_change(void)
+{
+  cpu_state_t cpu_state, snapshot = {0};
+  uint8_t *memory, *snapshot_memory;
+  size_t size;
+
+  // Changing the profile of a 4K machine must not mark pages past its memory dirty
+  init_cpu(&cpu_state);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_snapshot(&snapshot, &cpu_state));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_restore(&cpu_state, &snapshot));
+
+  get_memory(&cpu_state, &memory, &size);
+  get_memory(&snapshot, &snapshot_memory, NULL);
+  TEST_ASSERT_EQUAL_UINT32(MEM_SIZE, size);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(snapshot_memory, memory, size + MEM_GUARD_SIZE);
+  TEST_ASSERT_EQUAL_INT(snapshot.quirk_profile, cpu_state.quirk_profile);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_snapshot_update(&snapshot, &cpu_state));
+  TEST_ASSERT_EQUAL_INT(QUIRK_PROFILE_SUPER_CHIP, snapshot.quirk_profile);
+
+  cleanup_cpu(&snapshot);
+  cleanup_cpu(&cpu_state);
+}
+
+void test_reset_cpu_from_template(void)
+{
+  const uint8_t rom[] = {0x6A, 0x78, 0xA3, 0x00, 0xFA, 0x33, 0xD0, 0x15, 0x12, 0x00};
+  char path[TMPDIR_PATH_SIZE];
+  cpu_state_t template_state, cpu_state = {0};
+  uint64_t hash, expected;
+
+  tmpdir_write(&tmpdir, "template.ch8", rom, sizeof(rom), path);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, init_template(&template_state, path, QUIRK_PROFILE_SUPER_CHIP));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, init_cpu_from_template(&cpu_state, &template_state));
+  TEST_ASSERT_EQUAL_INT(QUIRK_PROFILE_SUPER_CHIP, cpu_state.quirk_profile);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(rom, &cpu_state.memory[START_ADDRESS], sizeof(rom));
+  chip8_state_hash(&template_state, &expected);
+
+  for (uint8_t run = 0; run < 3; run++)
+  {
+    for (uint8_t i = 0; i < 8; i++)
+    {
+      TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+    }
+    TEST_ASSERT_EQUAL_HEX8(1, cpu_state.memory[0x300]);
+
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, reset_cpu(&cpu_state, &template_state));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(template_state.memory, cpu_state.memory, sizeof(cpu_state.memory));
+    TEST_ASSERT_EQUAL_MEMORY(&template_state.peripherals.graphics.buffer, &cpu_state.peripherals.graphics.buffer,
+                             sizeof(cpu_state.peripherals.graphics.buffer));
+    TEST_ASSERT_EQUAL_HEX16(START_ADDRESS, cpu_state.registers.pc);
+    chip8_state_hash(&cpu_state, &hash);
+    TEST_ASSERT_EQUAL_HEX64(expected, hash);
+  }
+
+  tmpdir_path(&tmpdir, "missing.ch8", path);
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_FILE_NOT_FOUND, init_template(&template_state, path, QUIRK_PROFILE_CHIP8));
+  cleanup_cpu(&cpu_state);
+  cleanup_cpu(&template_state);
+}
+
 void test_update_timers(void)
 {
   cpu_state_t cpu_state = {0};
@@ -122,6 +404,144 @@ void test_update_timers_null_pointer(void)
   TEST_ASSERT_EQUAL_INT(STATUS_ERR_NULL_PTR, update_timers(NULL));
 }
 
+void test_instruction_cycles(void)
+{
+  cpu_state_t cpu_state = {0};
+  uint32_t cycles;
+  stub_init_cpu_state(&cpu_state);
+
+  stub_set_opcode(&cpu_state, 0x6005, 0);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, instruction_cycles(&cpu_state, TIMING_UNIFORM, &cycles));
+  TEST_ASSERT_EQUAL_UINT32(1, cycles);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, instruction_cycles(&cpu_state, TIMING_VIP, &cycles));
+  TEST_ASSERT_EQUAL_UINT32(46, cycles);
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, instruction_cycles(&cpu_state, TIMING_MODE_COUNT, &cycles));
+
+  // Sprites cost per row, more so when not byte aligned
+  stub_set_opcode(&cpu_state, 0xD015, 0);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, instruction_cycles(&cpu_state, TIMING_VIP, &cycles));
+  TEST_ASSERT_EQUAL_UINT32(40 + 26 + (5 * 34), cycles);
+  cpu_state.registers.V[0] = 3;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, instruction_cycles(&cpu_state, TIMING_VIP, &cycles));
+  TEST_ASSERT_EQUAL_UINT32(40 + 26 + (5 * 46), cycles);
+
+  // DXY0 draws nothing on the VIP, and a 16x16 sprite with the SUPER-CHIP opcodes
+  stub_set_opcode(&cpu_state, 0xD010, 0);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, instruction_cycles(&cpu_state, TIMING_VIP, &cycles));
+  TEST_ASSERT_EQUAL_UINT32(40 + 26, cycles);
+  cpu_state.quirk_profile = QUIRK_PROFILE_SUPER_CHIP;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, instruction_cycles(&cpu_state, TIMING_VIP, &cycles));
+  TEST_ASSERT_EQUAL_UINT32(40 + 26 + (16 * 46), cycles);
+  cpu_state.quirk_profile = QUIRK_PROFILE_COUNT;
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, instruction_cycles(&cpu_state, TIMING_VIP, &cycles));
+  cpu_state.quirk_profile = QUIRK_PROFILE_CHIP8;
+
+  // Taken skips cost more
+  stub_set_opcode(&cpu_state, 0x3003, 0);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, instruction_cycles(&cpu_state, TIMING_VIP, &cycles));
+  TEST_ASSERT_EQUAL_UINT32(54, cycles);
+  cpu_state.registers.V[0] = 4;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, instruction_cycles(&cpu_state, TIMING_VIP, &cycles));
+  TEST_ASSERT_EQUAL_UINT32(50, cycles);
+
+  // The opcode is costed as fetched, its second byte from past the end of memory
+  cpu_state.registers.pc = MEM_SIZE - 1;
+  cpu_state.memory[MEM_SIZE - 1] = 0x00;
+#ifdef CHIP8_STRICT_MEMORY
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_MEM_OUT_OF_BOUNDS, instruction_cycles(&cpu_state, TIMING_VIP, &cycles));
+#else
+  cpu_state.memory[MEM_SIZE] = 0xE0;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, instruction_cycles(&cpu_state, TIMING_VIP, &cycles));
+  TEST_ASSERT_EQUAL_UINT32(40 + 3078, cycles);
+#endif
+}
+
+void test_run_frame_cycles(void)
+{
+  cpu_state_t cpu_state = {0};
+  cycle_clock_t clock;
+  stub_init_cpu_state(&cpu_state);
+
+  // Jumping on the spot: uniform frames run INSTRUCTIONS_PER_FRAME instructions
+  stub_set_opcode(&cpu_state, 0x1200, 0);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, cycle_clock_init(&clock, TIMING_UNIFORM));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&cpu_state, &clock));
+  TEST_ASSERT_EQUAL_UINT32(INSTRUCTIONS_PER_FRAME, clock.instructions);
+  TEST_ASSERT_EQUAL_INT32(0, clock.balance);
+
+  // On the VIP, a sprite waits out the rest of the frame
+  stub_init_cpu_state(&cpu_state);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, set_quirk_profile(&cpu_state, QUIRK_PROFILE_COSMAC_VIP));
+  stub_set_opcode(&cpu_state, 0x6000, 0);
+  stub_set_opcode(&cpu_state, 0xD001, 2);
+  stub_set_opcode(&cpu_state, 0x1204, 4);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, cycle_clock_init(&clock, TIMING_VIP));
+  TEST_ASSERT_EQUAL_UINT32(VIP_CYCLES_PER_FRAME - VIP_DISPLAY_DMA_CYCLES, clock.budget);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&cpu_state, &clock));
+  TEST_ASSERT_EQUAL_UINT32(2, clock.instructions);
+  TEST_ASSERT_EQUAL_UINT32(46 + 100, clock.busy_cycles);
+  TEST_ASSERT_EQUAL_INT32(0, clock.balance);
+
+  // The overrun of the last instruction is taken from the next frame
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&cpu_state, &clock));
+  TEST_ASSERT_EQUAL_UINT32(51, clock.instructions);
+  TEST_ASSERT_EQUAL_INT32((int32_t)clock.budget - (51 * 52), clock.balance);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&cpu_state, &clock));
+  TEST_ASSERT_EQUAL_UINT32(51, clock.instructions);
+  TEST_ASSERT_EQUAL_UINT64(3, clock.frames);
+  TEST_ASSERT_EQUAL_UINT64(146 + (102 * 52), clock.total_busy_cycles);
+}
+
+void test_run_frame_cycles_idle_loops(void)
+{
+  cpu_state_t cpu_state = {0};
+  cycle_clock_t clock;
+  stub_init_cpu_state(&cpu_state);
+
+  // Jumping on the spot is idle from the second pass on
+  stub_set_opcode(&cpu_state, 0x1200, 0);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, cycle_clock_init(&clock, TIMING_UNIFORM));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&cpu_state, &clock));
+  TEST_ASSERT_EQUAL_UINT32(INSTRUCTIONS_PER_FRAME - 1, clock.idle_instructions);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&cpu_state, &clock));
+  TEST_ASSERT_EQUAL_UINT32(INSTRUCTIONS_PER_FRAME, clock.idle_instructions);
+
+  // A loop that counts is not
+  stub_init_cpu_state(&cpu_state);
+  stub_set_opcode(&cpu_state, 0x7001, 0);
+  stub_set_opcode(&cpu_state, 0x1200, 2);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, cycle_clock_init(&clock, TIMING_UNIFORM));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&cpu_state, &clock));
+  TEST_ASSERT_EQUAL_UINT32(0, clock.idle_instructions);
+}
+
+void test_emulation_frame_display_wait(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  stub_set_opcode(&cpu_state, 0x6000, 0);
+  stub_set_opcode(&cpu_state, 0xD001, 2);
+  stub_set_opcode(&cpu_state, 0x1204, 4);
+
+  // Without the quirk the frame runs its full INSTRUCTIONS_PER_FRAME
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_frame(&cpu_state));
+  TEST_ASSERT_EQUAL_UINT8(0, cpu_state.vblank_wait);
+  TEST_ASSERT_EQUAL_HEX16(0x204, cpu_state.registers.pc);
+
+  // With it the frame ends at the sprite, and resumes after it at the next
+  stub_init_cpu_state(&cpu_state);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, set_quirk_profile(&cpu_state, QUIRK_PROFILE_COSMAC_VIP));
+  stub_set_opcode(&cpu_state, 0x7001, 4);
+  stub_set_opcode(&cpu_state, 0x1204, 6);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_frame(&cpu_state));
+  TEST_ASSERT_EQUAL_UINT8(0, cpu_state.vblank_wait);
+  TEST_ASSERT_EQUAL_HEX16(0x204, cpu_state.registers.pc);
+  TEST_ASSERT_EQUAL_HEX8(0, cpu_state.registers.V[0]);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frames(&cpu_state, 0, 1));
+  TEST_ASSERT_EQUAL_HEX8(INSTRUCTIONS_PER_FRAME / 2 + 1, cpu_state.registers.V[0]);
+}
+
 void test_emulation_cycle_NOPs(void)
 {
   cpu_state_t cpu_state = {0};
@@ -155,20 +575,58 @@ void test_op_00E0(void)
   stub_set_opcode(&cpu_state, 0x00E0, 0);
 
   cpu_state.peripherals.graphics.display_update = 0;
-  for (int16_t i = 0; i < GRAPHICS_SIZE; i++)
-  {
-    cpu_state.peripherals.graphics.buffer[i] = (i % 2) ? 0x55 : 0xAA;
-  }
+  stub_fill_graphics(&cpu_state, 0xAAAAAAAA55555555);
 
   TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
-  for (int16_t i = 0; i < GRAPHICS_SIZE; i++)
+  for (int16_t row = 0; row < GRAPHICS_HIRES_HEIGHT; row++)
   {
-    TEST_ASSERT_EQUAL_HEX8(0x00, cpu_state.peripherals.graphics.buffer[i]);
+    for (int16_t w = 0; w < GRAPHICS_ROW_WORDS; w++)
+    {
+      TEST_ASSERT_EQUAL_HEX64(0, cpu_state.peripherals.graphics.buffer[0][row][w]);
+    }
   }
 
   TEST_ASSERT_EQUAL_INT(1, cpu_state.peripherals.graphics.display_update);
 }
 
+/**
+ * Test 0x00CN: SCD N
+ * Scrolls the display down by N pixels
+ */
+void test_op_00CN(void)
+{
+  cpu_state_t cpu_state = {0};
+  graphics_t *gfx = &cpu_state.peripherals.graphics;
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  stub_set_opcode(&cpu_state, 0x00C3, 0);
+  gfx->hires = 1;
+  gfx->buffer[0][0][0] = 0x1234;
+  gfx->buffer[0][60][1] = 0x5678;
+  gfx->buffer[0][63][1] = 0x9ABC;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX64(0, gfx->buffer[0][0][0]);
+  TEST_ASSERT_EQUAL_HEX64(0x1234, gfx->buffer[0][3][0]);
+  TEST_ASSERT_EQUAL_HEX64(0x5678, gfx->buffer[0][63][1]);
+  TEST_ASSERT_EQUAL_INT(1, gfx->display_update);
+}
+
+/**
+ * Test 0x00CN: SCD N
+ * Plain CHIP-8 does not have this opcode
+ */
+void test_op_00CN_chip8_is_nop(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  stub_set_opcode(&cpu_state, 0x00C3, 0);
+  cpu_state.peripherals.graphics.buffer[0][0][0] = 0x1234;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX64(0x1234, cpu_state.peripherals.graphics.buffer[0][0][0]);
+}
+
 /**
  * Test 0x00EE: RET
  * Return from a subroutine call
@@ -200,6 +658,79 @@ void test_op_00EE_with_stack_underflow(void)
   TEST_ASSERT_EQUAL_INT(STATUS_ERR_STACK_UNDERFLOW, emulation_cycle(&cpu_state));
 }
 
+/**
+ * Test 0x00FB: SCR
+ * Scrolls the display right by 4 pixels
+ */
+void test_op_00FB(void)
+{
+  cpu_state_t cpu_state = {0};
+  graphics_t *gfx = &cpu_state.peripherals.graphics;
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  stub_set_opcode(&cpu_state, 0x00FB, 0);
+  gfx->hires = 1;
+  gfx->buffer[0][5][0] = 0xF00000000000000F;
+  gfx->buffer[0][5][1] = 0x000000000000000F;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX64(0x0F00000000000000, gfx->buffer[0][5][0]);
+  TEST_ASSERT_EQUAL_HEX64(0xF000000000000000, gfx->buffer[0][5][1]);
+}
+
+/**
+ * Test 0x00FC: SCL
+ * Scrolls the display left by 4 pixels, only within the low resolution area in low resolution mode
+ */
+void test_op_00FC_lores(void)
+{
+  cpu_state_t cpu_state = {0};
+  graphics_t *gfx = &cpu_state.peripherals.graphics;
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  stub_set_opcode(&cpu_state, 0x00FC, 0);
+  gfx->buffer[0][5][0] = 0xF00000000000000F;
+  gfx->buffer[0][5][1] = 0xF000000000000000;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX64(0x00000000000000F0, gfx->buffer[0][5][0]);
+  TEST_ASSERT_EQUAL_HEX64(0xF000000000000000, gfx->buffer[0][5][1]);
+}
+
+/**
+ * Test 0x00FD: EXIT
+ * Exits the interpreter
+ */
+void test_op_00FD(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  stub_set_opcode(&cpu_state, 0x00FD, 0);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_REQ_EXIT, emulation_cycle(&cpu_state));
+}
+
+/**
+ * Test 0x00FE: LOW and 0x00FF: HIGH
+ * Switches between the display resolutions
+ */
+void test_op_00FE_00FF(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  stub_set_opcode(&cpu_state, 0x00FF, 0);
+  stub_set_opcode(&cpu_state, 0x00FE, 2);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_INT(1, cpu_state.peripherals.graphics.hires);
+  TEST_ASSERT_EQUAL_INT(1, cpu_state.peripherals.graphics.display_update);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_INT(0, cpu_state.peripherals.graphics.hires);
+}
+
 /**
  * Test 0x1NNN: JMP NNN
  * Jump to address 0xNNN
@@ -341,6 +872,62 @@ void test_op_5XY0_Vx_not_equal_Vy(void)
   TEST_ASSERT_EQUAL_HEX16(START_ADDRESS + 2, cpu_state.registers.pc);
 }
 
+/**
+ * Test 0x5XY2: STR Vx, Vy
+ * Stores V[X] to V[Y] in memory starting at I, in descending order when X > Y
+ * Note: This doesn't change I
+ */
+void test_op_5XY2(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP);
+  stub_set_opcode(&cpu_state, 0x5242, 0);
+  stub_set_opcode(&cpu_state, 0x5422, 2);
+  cpu_state.registers.V[2] = 0x22;
+  cpu_state.registers.V[3] = 0x33;
+  cpu_state.registers.V[4] = 0x44;
+  cpu_state.registers.I = 0x2000;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x22, cpu_state.xo_memory[0x2000]);
+  TEST_ASSERT_EQUAL_HEX8(0x33, cpu_state.xo_memory[0x2001]);
+  TEST_ASSERT_EQUAL_HEX8(0x44, cpu_state.xo_memory[0x2002]);
+  TEST_ASSERT_EQUAL_HEX16(0x2000, cpu_state.registers.I);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x44, cpu_state.xo_memory[0x2000]);
+  TEST_ASSERT_EQUAL_HEX8(0x22, cpu_state.xo_memory[0x2002]);
+  cleanup_cpu(&cpu_state);
+}
+
+/**
+ * Test 0x5XY3: LDR Vx, Vy
+ * Fills V[X] to V[Y] from memory starting at I, in descending order when X > Y
+ * Note: This doesn't change I
+ */
+void test_op_5XY3(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP);
+  stub_set_opcode(&cpu_state, 0x5343, 0);
+  stub_set_opcode(&cpu_state, 0x5763, 2);
+  cpu_state.registers.I = 0x2000;
+  cpu_state.xo_memory[0x2000] = 0xAA;
+  cpu_state.xo_memory[0x2001] = 0xBB;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0xAA, cpu_state.registers.V[3]);
+  TEST_ASSERT_EQUAL_HEX8(0xBB, cpu_state.registers.V[4]);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0xAA, cpu_state.registers.V[7]);
+  TEST_ASSERT_EQUAL_HEX8(0xBB, cpu_state.registers.V[6]);
+  TEST_ASSERT_EQUAL_HEX16(0x2000, cpu_state.registers.I);
+  cleanup_cpu(&cpu_state);
+}
+
 /**
  * Test 0x6XNN: MOV Vx, NN
  * Sets the value of register V[X] to 0xNN
@@ -438,6 +1025,25 @@ void test_op_8XY1_resets_VF(void)
   TEST_ASSERT_EQUAL_HEX8(0, cpu_state.registers.V[0xF]);
 }
 
+/**
+ * Test 0x8XY1: OR Vx, Vy
+ * V[F] is left untouched by the SUPER-CHIP profile
+ */
+void test_op_8XY1_super_chip_keeps_VF(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  stub_set_opcode(&cpu_state, 0x8011, 0);
+  cpu_state.registers.V[0] = 0x55;
+  cpu_state.registers.V[1] = 0x33;
+  cpu_state.registers.V[0xF] = 0xAA;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x77, cpu_state.registers.V[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xAA, cpu_state.registers.V[0xF]);
+}
+
 /**
  * Test 0x8XY2: AND Vx, Vy
  * Bitwise-AND the value in register V[Y] into V[X]
@@ -596,6 +1202,24 @@ void test_op_8X06(void)
   TEST_ASSERT_EQUAL_HEX8(1, cpu_state.registers.V[0xF]);
 }
 
+/**
+ * Test 0x8XY6: SHR Vx, Vy
+ * The COSMAC VIP profile shifts V[Y] into V[X]
+ */
+void test_op_8XY6_cosmac_vip_shifts_Vy(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_COSMAC_VIP);
+  stub_set_opcode(&cpu_state, 0x8016, 0);
+  cpu_state.registers.V[0] = 0xFF;
+  cpu_state.registers.V[1] = 0x54;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x2A, cpu_state.registers.V[0]);
+  TEST_ASSERT_EQUAL_HEX8(0, cpu_state.registers.V[0xF]);
+}
+
 /**
  * Test 0x8XY7: RSUB Vx, Vy
  * Sets V[X] to V[Y] minus V[X].
@@ -649,6 +1273,25 @@ void test_op_8X0E(void)
   TEST_ASSERT_EQUAL_HEX8(1, cpu_state.registers.V[0xF]);
 }
 
+/**
+ * Test 0x8XYE: SHL Vx, Vy
+ * The XO-CHIP profile shifts V[Y] into V[X]
+ */
+void test_op_8XYE_xo_chip_shifts_Vy(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP);
+  stub_set_opcode(&cpu_state, 0x801E, 0);
+  cpu_state.registers.V[0] = 0x01;
+  cpu_state.registers.V[1] = 0x81;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x02, cpu_state.registers.V[0]);
+  TEST_ASSERT_EQUAL_HEX8(1, cpu_state.registers.V[0xF]);
+  cleanup_cpu(&cpu_state);
+}
+
 /**
  * Test 0x9XY0: SKNE Vx, Vy
  * Skip if V[X] != V[Y]
@@ -710,13 +1353,58 @@ void test_op_BNNN(void)
   TEST_ASSERT_EQUAL_HEX16((0xCDE + 0x12), cpu_state.registers.pc);
 }
 
+/**
+ * Test 0xBXNN: JMI XNN
+ * The SUPER-CHIP profile jumps to the address 0xXNN + V[X]
+ */
+void test_op_BXNN_super_chip(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  stub_set_opcode(&cpu_state, 0xB320, 0);
+  cpu_state.registers.V[0] = 0x12;
+  cpu_state.registers.V[3] = 0x04;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX16((0x320 + 0x04), cpu_state.registers.pc);
+}
+
 /**
  * Test 0xCXNN: RAND Vx, NN
  * Sets V[X] to a random number bitwise-and'ed with 0xNN
  */
 void test_op_CXNN(void)
 {
-  /** TODO: Implement */
+  cpu_state_t cpu_state, other;
+  uint8_t values[8];
+
+  init_cpu(&cpu_state);
+  init_cpu(&other);
+  seed_random(&cpu_state, 1234);
+  seed_random(&other, 1234);
+
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    stub_set_opcode(&cpu_state, 0xC50F, i * 2);
+    stub_set_opcode(&other, 0xC5FF, i * 2);
+  }
+
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&other));
+    TEST_ASSERT_EQUAL_HEX8(0, cpu_state.registers.V[5] & 0xF0);
+    TEST_ASSERT_EQUAL_HEX8(other.registers.V[5] & 0x0F, cpu_state.registers.V[5]);
+    values[i] = other.registers.V[5];
+  }
+
+  // Each instance has its own generator, so the numbers are reproducible
+  TEST_ASSERT_TRUE((values[0] != values[1]) || (values[1] != values[2]));
+  seed_random(&other, 1234);
+  other.registers.pc = START_ADDRESS;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&other));
+  TEST_ASSERT_EQUAL_HEX8(values[0], other.registers.V[5]);
 }
 
 /**
@@ -725,7 +1413,115 @@ void test_op_CXNN(void)
  */
 void test_op_DXYN(void)
 {
-  /** TODO: Implement */
+  cpu_state_t cpu_state = {0};
+  graphics_t *gfx = &cpu_state.peripherals.graphics;
+  stub_init_cpu_state(&cpu_state);
+  stub_set_opcode(&cpu_state, 0xD012, 0);
+  stub_set_opcode(&cpu_state, 0xD012, 2);
+  cpu_state.registers.V[0] = 60;
+  cpu_state.registers.V[1] = 31;
+  cpu_state.registers.I = 0x0300;
+  cpu_state.memory[0x0300] = 0xF1;
+  cpu_state.memory[0x0301] = 0xFF;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX64(0x000000000000000F, gfx->buffer[0][31][0]);
+  TEST_ASSERT_EQUAL_HEX64(0, gfx->buffer[0][31][1]);
+  TEST_ASSERT_EQUAL_HEX64(0, gfx->buffer[0][0][0]);
+  TEST_ASSERT_EQUAL_HEX64(0, gfx->buffer[0][32][0]);
+  TEST_ASSERT_EQUAL_HEX8(0, cpu_state.registers.V[0xF]);
+  TEST_ASSERT_EQUAL_INT(1, gfx->display_update);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX64(0, gfx->buffer[0][31][0]);
+  TEST_ASSERT_EQUAL_HEX8(1, cpu_state.registers.V[0xF]);
+}
+
+/**
+ * Test 0xDXYN: DISP X, Y, N
+ * The XO-CHIP profile wraps sprites around the screen edges
+ */
+void test_op_DXYN_xo_chip_wraps(void)
+{
+  cpu_state_t cpu_state = {0};
+  graphics_t *gfx = &cpu_state.peripherals.graphics;
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP);
+  stub_set_opcode(&cpu_state, 0xD012, 0);
+  cpu_state.registers.V[0] = 60;
+  cpu_state.registers.V[1] = 31;
+  cpu_state.registers.I = 0x0300;
+  cpu_state.xo_memory[0x0300] = 0xF1;
+  cpu_state.xo_memory[0x0301] = 0xFF;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX64(0x100000000000000F, gfx->buffer[0][31][0]);
+  TEST_ASSERT_EQUAL_HEX64(0xF00000000000000F, gfx->buffer[0][0][0]);
+  TEST_ASSERT_EQUAL_HEX8(0, cpu_state.registers.V[0xF]);
+  cleanup_cpu(&cpu_state);
+}
+
+/**
+ * Test 0xDXY0: DISP X, Y, 0
+ * With SUPER-CHIP opcodes, draws a 16x16 sprite, here straddling two words of a high resolution row
+ */
+void test_op_DXY0_super_chip(void)
+{
+  cpu_state_t cpu_state = {0};
+  graphics_t *gfx = &cpu_state.peripherals.graphics;
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  stub_set_opcode(&cpu_state, 0xD010, 0);
+  gfx->hires = 1;
+  cpu_state.registers.V[0] = 56;
+  cpu_state.registers.V[1] = 0;
+  cpu_state.registers.I = 0x0300;
+  for (int8_t i = 0; i < 32; i++)
+  {
+    cpu_state.memory[0x0300 + i] = (i % 2) ? 0x01 : 0x80;
+  }
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  for (int8_t row = 0; row < 16; row++)
+  {
+    TEST_ASSERT_EQUAL_HEX64(0x0000000000000080, gfx->buffer[0][row][0]);
+    TEST_ASSERT_EQUAL_HEX64(0x0100000000000000, gfx->buffer[0][row][1]);
+  }
+  TEST_ASSERT_EQUAL_HEX64(0, gfx->buffer[0][16][0]);
+  TEST_ASSERT_EQUAL_INT(1, GRAPHICS_PIXEL(gfx, 0, 56, 0));
+  TEST_ASSERT_EQUAL_INT(1, GRAPHICS_PIXEL(gfx, 0, 71, 15));
+  TEST_ASSERT_EQUAL_INT(0, GRAPHICS_PIXEL(gfx, 0, 57, 0));
+}
+
+/**
+ * Test 0xFN01: PLANE N
+ * With both planes selected, DXYN draws consecutive sprites onto each plane
+ */
+void test_op_FN01_DXYN_two_planes(void)
+{
+  cpu_state_t cpu_state = {0};
+  graphics_t *gfx = &cpu_state.peripherals.graphics;
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP);
+  stub_set_opcode(&cpu_state, 0xF301, 0);
+  stub_set_opcode(&cpu_state, 0xD011, 2);
+  stub_set_opcode(&cpu_state, 0xF201, 4);
+  stub_set_opcode(&cpu_state, 0x00E0, 6);
+  cpu_state.registers.I = 0x0300;
+  cpu_state.xo_memory[0x0300] = 0xF0;
+  cpu_state.xo_memory[0x0301] = 0x0F;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x3, gfx->plane_mask);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX64(0xF000000000000000, gfx->buffer[0][0][0]);
+  TEST_ASSERT_EQUAL_HEX64(0x0F00000000000000, gfx->buffer[1][0][0]);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX64(0xF000000000000000, gfx->buffer[0][0][0]);
+  TEST_ASSERT_EQUAL_HEX64(0, gfx->buffer[1][0][0]);
+  cleanup_cpu(&cpu_state);
 }
 
 /**
@@ -917,6 +1713,88 @@ void test_op_FX29(void)
   TEST_ASSERT_EQUAL_HEX16((0x55 * 5), cpu_state.registers.I);
 }
 
+/**
+ * Test 0xF000 NNNN: LDI NNNN
+ * Loads the 16-bit address following the instruction into I
+ */
+void test_op_F000(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP);
+  stub_set_opcode(&cpu_state, 0xF000, 0);
+  stub_set_opcode(&cpu_state, 0xBEEF, 2);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX16(0xBEEF, cpu_state.registers.I);
+  TEST_ASSERT_EQUAL_HEX16(START_ADDRESS + 4, cpu_state.registers.pc);
+  cleanup_cpu(&cpu_state);
+}
+
+/**
+ * Test 0x3XNN: SKE Vx, NN
+ * The XO-CHIP profile skips over both words of an F000 NNNN instruction
+ */
+void test_op_3XNN_xo_chip_skips_F000(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP);
+  stub_set_opcode(&cpu_state, 0x3000, 0);
+  stub_set_opcode(&cpu_state, 0xF000, 2);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX16(START_ADDRESS + 6, cpu_state.registers.pc);
+  cleanup_cpu(&cpu_state);
+}
+
+/**
+ * Test 0xF002: AUDIO and 0xFX3A: PITCH Vx
+ * Loads the audio pattern from memory at I and sets its pitch
+ */
+void test_op_F002_FX3A(void)
+{
+  cpu_state_t cpu_state = {0};
+  audio_pattern_t *audio = &cpu_state.peripherals.audio;
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP);
+  stub_set_opcode(&cpu_state, 0xF002, 0);
+  stub_set_opcode(&cpu_state, 0xF13A, 2);
+  cpu_state.registers.I = 0x0300;
+  cpu_state.registers.V[1] = 0x70;
+  for (int8_t i = 0; i < AUDIO_PATTERN_SIZE; i++)
+  {
+    cpu_state.xo_memory[0x0300 + i] = 0xA0 | i;
+  }
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(&cpu_state.xo_memory[0x0300], audio->buffer, AUDIO_PATTERN_SIZE);
+  TEST_ASSERT_EQUAL_INT(1, audio->loaded);
+  TEST_ASSERT_EQUAL_INT(1, audio->audio_update);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x70, audio->pitch);
+  cleanup_cpu(&cpu_state);
+}
+
+/**
+ * Test 0xFX30: HFONT Vx
+ * Sets I to the location of the 8x10 px sprite for the digit in V[X]
+ */
+void test_op_FX30(void)
+{
+  cpu_state_t cpu_state;
+  init_cpu(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  stub_set_opcode(&cpu_state, 0xF030, 0);
+  cpu_state.registers.V[0] = 2;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX16(0x0050 + 20, cpu_state.registers.I);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, cpu_state.memory[cpu_state.registers.I]);
+  TEST_ASSERT_EQUAL_HEX8(0x03, cpu_state.memory[cpu_state.registers.I + 2]);
+}
+
 /**
  * Test 0xFX33: BCD Vx
  * Stores the binary-coded decimal representation of V[X],
@@ -956,7 +1834,14 @@ void test_op_FX33_with_out_of_bound_address(void)
   cpu_state.registers.V[0] = 123;
   cpu_state.registers.I = 0x0FFE;
 
+#ifdef CHIP8_STRICT_MEMORY
   TEST_ASSERT_EQUAL_INT(STATUS_ERR_MEM_OUT_OF_BOUNDS, emulation_cycle(&cpu_state));
+#else
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_INT8(1, cpu_state.memory[0x0FFE]);
+  TEST_ASSERT_EQUAL_INT8(2, cpu_state.memory[0x0FFF]);
+  TEST_ASSERT_EQUAL_INT8(0, cpu_state.memory[0x0000]);
+#endif
 }
 
 /**
@@ -990,6 +1875,22 @@ void test_op_FX55_with_valid_addresses(void)
     TEST_ASSERT_EQUAL_HEX16(0x0FF0, cpu_state.registers.I);
   }
 }
+
+/**
+ * Test 0xFX55: STR V0, Vx
+ * The COSMAC VIP profile leaves I pointing past V[X]
+ */
+void test_op_FX55_cosmac_vip_increments_I(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_COSMAC_VIP);
+  stub_set_opcode(&cpu_state, 0xF355, 0);
+  cpu_state.registers.I = 0x0300;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX16(0x0304, cpu_state.registers.I);
+}
 /**
  * Test 0xFX55: STR V0, Vx
  * Stores the values in V[0] to V[X] (including V[X]) in memory, starting at address I.
@@ -1003,8 +1904,16 @@ void test_op_FX55_with_out_of_bound_address(void)
   stub_init_cpu_state(&cpu_state);
   stub_set_opcode(&cpu_state, 0xF155, 0);
   cpu_state.registers.I = 0x0FFF;
+  cpu_state.registers.V[0] = 0xAA;
+  cpu_state.registers.V[1] = 0xBB;
 
+#ifdef CHIP8_STRICT_MEMORY
   TEST_ASSERT_EQUAL_INT(STATUS_ERR_MEM_OUT_OF_BOUNDS, emulation_cycle(&cpu_state));
+#else
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0xAA, cpu_state.memory[0x0FFF]);
+  TEST_ASSERT_EQUAL_HEX8(0, cpu_state.memory[0x0000]);
+#endif
 }
 
 /**
@@ -1038,6 +1947,27 @@ void test_op_FX65_with_valid_addresses(void)
   }
 }
 
+/**
+ * Test 0xFX65: LDR V0, Vx
+ * The XO-CHIP profile leaves I pointing past V[X]
+ */
+void test_op_FX65_xo_chip_increments_I(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_XO_CHIP);
+  stub_set_opcode(&cpu_state, 0xF165, 0);
+  cpu_state.registers.I = 0x0300;
+  cpu_state.xo_memory[0x0300] = 0x12;
+  cpu_state.xo_memory[0x0301] = 0x34;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x12, cpu_state.registers.V[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x34, cpu_state.registers.V[1]);
+  TEST_ASSERT_EQUAL_HEX16(0x0302, cpu_state.registers.I);
+  cleanup_cpu(&cpu_state);
+}
+
 /**
  * Test 0xFX65: LDR V0, Vx
  * Fills from V[0] to V[X] (including V[X]) with values from memory, starting at address I.
@@ -1051,6 +1981,37 @@ void test_op_FX65_with_out_of_bound_address(void)
   stub_init_cpu_state(&cpu_state);
   stub_set_opcode(&cpu_state, 0xF165, 0);
   cpu_state.registers.I = 0x0FFF;
+  cpu_state.memory[0x0FFF] = 0xAA;
 
+#ifdef CHIP8_STRICT_MEMORY
   TEST_ASSERT_EQUAL_INT(STATUS_ERR_MEM_OUT_OF_BOUNDS, emulation_cycle(&cpu_state));
-}
\ No newline at end of file
+#else
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0xAA, cpu_state.registers.V[0]);
+#endif
+}
+
+/**
+ * Test 0xFX75: SRPL Vx and 0xFX85: LRPL Vx
+ * Saves V[0] to V[X] to the RPL user flags and restores them
+ */
+void test_op_FX75_FX85(void)
+{
+  cpu_state_t cpu_state = {0};
+  stub_init_cpu_state(&cpu_state);
+  set_quirk_profile(&cpu_state, QUIRK_PROFILE_SUPER_CHIP);
+  stub_set_opcode(&cpu_state, 0xF275, 0);
+  stub_set_opcode(&cpu_state, 0xF185, 2);
+  cpu_state.registers.V[0] = 0x11;
+  cpu_state.registers.V[1] = 0x22;
+  cpu_state.registers.V[2] = 0x33;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  stub_clear_V(&cpu_state);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x11, cpu_state.registers.V[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x22, cpu_state.registers.V[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, cpu_state.registers.V[2]);
+  TEST_ASSERT_EQUAL_HEX8(0x33, cpu_state.registers.rpl[2]);
+}
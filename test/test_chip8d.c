@@ -0,0 +1,192 @@
+#include "unity.h"
+#include "chip8d.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "status_code.h"
+#include "stream.h"
+#include "tmpdir.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+TEST_FILE("exec_trace.c")
+TEST_FILE("logging.c")
+
+static tmpdir_t tmpdir;
+
+void setUp(void)
+{
+  tmpdir_create(&tmpdir);
+}
+
+void tearDown(void)
+{
+  tmpdir_remove(&tmpdir);
+}
+
+static void *run_chip8d(void *arg)
+{
+  chip8d_run(arg);
+  return NULL;
+}
+
+static void chip8d_command(chip8d_t *const daemon, const char *command, char *const response, size_t const size)
+{
+  char line[CHIP8D_LINE_SIZE];
+  snprintf(line, sizeof(line), "%s", command);
+  chip8d_execute(daemon, line, response, size);
+}
+
+static uint64_t session_frames(chip8d_t *const daemon, uint32_t const id)
+{
+  pthread_mutex_lock(&daemon->sessions[id].lock);
+  uint64_t frames = daemon->sessions[id].frames;
+  pthread_mutex_unlock(&daemon->sessions[id].lock);
+  return frames;
+}
+
+/** Block on the frames a session streams to fd until it has run the given number of them */
+static uint64_t chip8d_wait_frames(chip8d_t *const daemon, int const fd, uint32_t const id, uint64_t const frames)
+{
+  uint8_t payload[STREAM_MAX_PAYLOAD];
+  uint16_t length;
+  uint8_t type;
+  uint64_t current = session_frames(daemon, id);
+
+  while ((current < frames) && (stream_read_message(fd, &type, payload, &length) == STATUS_OK))
+  {
+    current = session_frames(daemon, id);
+  }
+  return current;
+}
+
+void test_chip8d(void)
+{
+  // Counts up in [0x300] and draws the count; the profile's display wait makes that once a frame,
+  // so every frame streams a different display
+  const uint8_t rom[] = {0x70, 0x01, 0xA3, 0x00, 0xF0, 0x55, 0x00, 0xE0, 0xA3, 0x00, 0xD1, 0x11, 0x12, 0x00};
+  static chip8d_t daemon;
+  char path[TMPDIR_PATH_SIZE];
+  char socket_path[TMPDIR_PATH_SIZE];
+  char address[TMPDIR_PATH_SIZE + 8];
+  char command[CHIP8D_LINE_SIZE];
+  char response[512];
+  pthread_t thread;
+  uint8_t *memory;
+  uint8_t saved;
+  int fd, frames_fd;
+
+  tmpdir_write(&tmpdir, "chip8d.ch8", rom, sizeof(rom), path);
+  tmpdir_path(&tmpdir, "chip8d.sock", socket_path);
+  snprintf(address, sizeof(address), "unix:%s", socket_path);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8d_init(&daemon, socket_path, 2));
+  TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, run_chip8d, &daemon));
+
+  snprintf(command, sizeof(command), "new %s vip", path);
+  chip8d_command(&daemon, command, response, sizeof(response));
+  TEST_ASSERT_EQUAL_STRING("OK 0\n", response);
+  snprintf(command, sizeof(command), "new %s bogus", path);
+  chip8d_command(&daemon, command, response, sizeof(response));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(response, "ERR", 3));
+  chip8d_command(&daemon, "speed 0 65", response, sizeof(response));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(response, "ERR", 3));
+  chip8d_command(&daemon, "speed 0 4", response, sizeof(response));
+  TEST_ASSERT_EQUAL_STRING("OK\n", response);
+
+  chip8d_command(&daemon, "subscribe 0", response, sizeof(response));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(response, "OK unix:", 8));
+  response[strcspn(response, "\n")] = '\0';
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_connect(&response[3], &frames_fd));
+
+  chip8d_command(&daemon, "start 0", response, sizeof(response));
+  TEST_ASSERT_EQUAL_STRING("OK\n", response);
+  TEST_ASSERT_GREATER_OR_EQUAL(8, chip8d_wait_frames(&daemon, frames_fd, 0, 8));
+  chip8d_command(&daemon, "stop 0", response, sizeof(response));
+  chip8d_command(&daemon, "snapshot 0", response, sizeof(response));
+  TEST_ASSERT_EQUAL_STRING("OK\n", response);
+  get_memory(&daemon.sessions[0].cpu, &memory, NULL);
+  saved = memory[0x300];
+  TEST_ASSERT_NOT_EQUAL(0, saved);
+
+  // Run on, then return to the snapshot
+  uint64_t frames = session_frames(&daemon, 0);
+  chip8d_command(&daemon, "start 0", response, sizeof(response));
+  TEST_ASSERT_GREATER_THAN(frames, chip8d_wait_frames(&daemon, frames_fd, 0, frames + 1));
+  chip8d_command(&daemon, "stop 0", response, sizeof(response));
+  TEST_ASSERT_NOT_EQUAL(saved, memory[0x300]);
+  chip8d_command(&daemon, "restore 0", response, sizeof(response));
+  TEST_ASSERT_EQUAL_STRING("OK\n", response);
+  get_memory(&daemon.sessions[0].cpu, &memory, NULL);
+  TEST_ASSERT_EQUAL_HEX8(saved, memory[0x300]);
+  close(frames_fd);
+
+  chip8d_command(&daemon, "list", response, sizeof(response));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(response, "0 stopped ", 10));
+  TEST_ASSERT_NOT_NULL(strstr(response, "OK 1\n"));
+
+  chip8d_command(&daemon, "close 0", response, sizeof(response));
+  TEST_ASSERT_EQUAL_STRING("OK\n", response);
+  chip8d_command(&daemon, "start 0", response, sizeof(response));
+  TEST_ASSERT_EQUAL_STRING("ERR no session 0\n", response);
+
+  // The same commands over the control socket
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_connect(address, &fd));
+  TEST_ASSERT_EQUAL_INT(6, write(fd, "stats\n", 6));
+  ssize_t length = read(fd, response, sizeof(response) - 1);
+  TEST_ASSERT_GREATER_THAN(0, length);
+  response[length] = '\0';
+  TEST_ASSERT_EQUAL_INT(0, strncmp(response, "OK sessions=0 workers=2 ", 24));
+  close(fd);
+
+  chip8d_stop(&daemon);
+  pthread_join(thread, NULL);
+  chip8d_cleanup(&daemon);
+}
+
+void test_chip8d_drops_client_not_reading(void)
+{
+  static chip8d_t daemon;
+  pthread_t thread;
+  char socket_path[TMPDIR_PATH_SIZE];
+  char address[TMPDIR_PATH_SIZE + 8];
+  char commands[500];
+  char response[256];
+  int slow_fd, fd;
+  uint8_t dropped = 0;
+
+  for (uint32_t i = 0; i < sizeof(commands); i += 5)
+  {
+    memcpy(&commands[i], "list\n", 5);
+  }
+
+  tmpdir_path(&tmpdir, "chip8d.sock", socket_path);
+  snprintf(address, sizeof(address), "unix:%s", socket_path);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8d_init(&daemon, socket_path, 1));
+  TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, run_chip8d, &daemon));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_connect(address, &slow_fd));
+
+  // Commands keep coming but the responses are never read: once its responses back up, the client is dropped
+  for (uint32_t i = 0; (i < 100000) && !dropped; i++)
+  {
+    dropped = (send(slow_fd, commands, sizeof(commands), MSG_NOSIGNAL) < 0);
+  }
+  TEST_ASSERT_TRUE(dropped);
+  close(slow_fd);
+
+  // Meanwhile the daemon went on serving other clients
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_connect(address, &fd));
+  TEST_ASSERT_EQUAL_INT(6, write(fd, "stats\n", 6));
+  ssize_t length = read(fd, response, sizeof(response) - 1);
+  TEST_ASSERT_GREATER_THAN(0, length);
+  response[length] = '\0';
+  TEST_ASSERT_EQUAL_INT(0, strncmp(response, "OK sessions=0 workers=1 ", 24));
+  close(fd);
+
+  chip8d_stop(&daemon);
+  pthread_join(thread, NULL);
+  chip8d_cleanup(&daemon);
+}
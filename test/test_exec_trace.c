@@ -0,0 +1,202 @@
+#include "unity.h"
+#include "exec_trace.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "status_code.h"
+#include "tmpdir.h"
+
+TEST_FILE("chip8.c")
+TEST_FILE("logging.c")
+
+static tmpdir_t tmpdir;
+
+void setUp(void)
+{
+  tmpdir_create(&tmpdir);
+}
+
+void tearDown(void)
+{
+  tmpdir_remove(&tmpdir);
+}
+
+void stub_init_cpu_state(cpu_state_t *cpu_state)
+{
+  cpu_state->registers.pc = START_ADDRESS;
+}
+
+void stub_set_opcode(cpu_state_t *cpu_state, uint16_t opcode, uint16_t offset)
+{
+  uint8_t *memory;
+  get_memory(cpu_state, &memory, NULL);
+  memory[START_ADDRESS + offset] = (uint8_t)((opcode & 0xFF00) >> 8);
+  memory[START_ADDRESS + offset + 1] = (uint8_t)((opcode & 0x00FF));
+}
+
+void test_emulation_cycle_exec_trace(void)
+{
+  char path[TMPDIR_PATH_SIZE];
+  cpu_state_t cpu_state = {0};
+  exec_trace_t trace;
+  exec_trace_record_t record;
+  stub_init_cpu_state(&cpu_state);
+  stub_set_opcode(&cpu_state, 0x6A12, 0);
+  stub_set_opcode(&cpu_state, 0xA300, 2);
+  stub_set_opcode(&cpu_state, 0xFA33, 4);
+  stub_set_opcode(&cpu_state, 0x1200, 6);
+  tmpdir_path(&tmpdir, "exec_trace.bin", path);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_start(&trace, &cpu_state, path));
+  for (int8_t i = 0; i < 5; i++)
+  {
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  }
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_stop(&trace, &cpu_state));
+  TEST_ASSERT_NULL(cpu_state.exec_trace);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_open(&trace, path));
+  TEST_ASSERT_EQUAL_UINT8(QUIRK_PROFILE_CHIP8, trace.quirk_profile);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_EQUAL_HEX16(START_ADDRESS, record.pc);
+  TEST_ASSERT_EQUAL_HEX16(0x6A12, record.opcode);
+  TEST_ASSERT_TRUE(record.flags & EXEC_TRACE_FLAG_TIMERS);
+  TEST_ASSERT_TRUE(record.flags & EXEC_TRACE_FLAG_GFX);
+  TEST_ASSERT_EQUAL_HEX16(1 << 0xA, record.v_mask);
+  TEST_ASSERT_EQUAL_HEX8(0x12, record.V[0xA]);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_EQUAL_HEX16(START_ADDRESS + 2, record.pc);
+  TEST_ASSERT_EQUAL_HEX16(0x0300, record.I);
+  TEST_ASSERT_FALSE(record.flags & (EXEC_TRACE_FLAG_TIMERS | EXEC_TRACE_FLAG_GFX));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_EQUAL_INT(1, record.write_count);
+  TEST_ASSERT_EQUAL_HEX16(0x0300, record.writes[0].address);
+  TEST_ASSERT_EQUAL_INT(3, record.writes[0].size);
+  TEST_ASSERT_EQUAL_HEX8(0x08, record.writes[0].data[2]);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_EQUAL_HEX16(0x1200, record.opcode);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_EQUAL_HEX16(START_ADDRESS, record.pc);
+  TEST_ASSERT_TRUE(record.flags & EXEC_TRACE_FLAG_PC);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_REQ_EXIT, exec_trace_read(&trace, &record));
+  exec_trace_close(&trace);
+}
+
+void test_exec_trace_records_stack_timers_and_framebuffer(void)
+{
+  char path[TMPDIR_PATH_SIZE];
+  cpu_state_t cpu_state = {0};
+  exec_trace_t trace;
+  exec_trace_record_t record;
+  stub_init_cpu_state(&cpu_state);
+  stub_set_opcode(&cpu_state, 0x6020, 0);
+  stub_set_opcode(&cpu_state, 0x2206, 2);
+  stub_set_opcode(&cpu_state, 0xF015, 6);
+  stub_set_opcode(&cpu_state, 0xD005, 8);
+  stub_set_opcode(&cpu_state, 0x00EE, 10);
+  cpu_state.registers.I = START_ADDRESS;
+  tmpdir_path(&tmpdir, "exec_trace.bin", path);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_start(&trace, &cpu_state, path));
+  for (int8_t i = 0; i < 5; i++)
+  {
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  }
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_stop(&trace, &cpu_state));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_open(&trace, path));
+
+  // 6020: the first record carries the timers and framebuffer as they were
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_EQUAL_HEX8(0, record.timers.delay);
+
+  // 2206: the call pushes a return address
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_EQUAL_UINT8(1, record.sp);
+  TEST_ASSERT_EQUAL_HEX16(1 << 0, record.stack_mask);
+  TEST_ASSERT_EQUAL_HEX16(cpu_state.registers.stack[0], record.stack[0]);
+
+  // F015
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_TRUE(record.flags & EXEC_TRACE_FLAG_TIMERS);
+  TEST_ASSERT_EQUAL_HEX8(0x20, record.timers.delay);
+
+  // D005
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_TRUE(record.flags & EXEC_TRACE_FLAG_GFX);
+  TEST_ASSERT_FALSE(record.flags & EXEC_TRACE_FLAG_TIMERS);
+  TEST_ASSERT_TRUE(cpu_state.hash.graphics == record.graphics_hash);
+
+  // 00EE: unchanged timers and framebuffer carry over from the earlier records
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_EQUAL_UINT8(0, record.sp);
+  TEST_ASSERT_FALSE(record.flags & (EXEC_TRACE_FLAG_TIMERS | EXEC_TRACE_FLAG_GFX));
+  TEST_ASSERT_EQUAL_HEX8(0x20, record.timers.delay);
+  TEST_ASSERT_TRUE(cpu_state.hash.graphics == record.graphics_hash);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_REQ_EXIT, exec_trace_read(&trace, &record));
+  exec_trace_close(&trace);
+}
+
+void test_exec_trace_open_rejects_unknown_profile(void)
+{
+  const uint8_t header[] = {'C', '8', 'X', 'T', EXEC_TRACE_VERSION, QUIRK_PROFILE_COUNT};
+  char path[TMPDIR_PATH_SIZE];
+  exec_trace_t trace;
+
+  tmpdir_write(&tmpdir, "exec_trace.bin", header, sizeof(header), path);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_GENERIC, exec_trace_open(&trace, path));
+}
+
+void test_exec_trace_stop_reports_write_errors(void)
+{
+  cpu_state_t cpu_state = {0};
+  exec_trace_t trace;
+  stub_init_cpu_state(&cpu_state);
+  stub_set_opcode(&cpu_state, 0x6A12, 0);
+
+  // Every write to /dev/full fails with ENOSPC
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_start(&trace, &cpu_state, "/dev/full"));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_GENERIC, exec_trace_stop(&trace, &cpu_state));
+}
+
+void test_exec_trace_records_opcode_at_end_of_memory(void)
+{
+  char path[TMPDIR_PATH_SIZE];
+  cpu_state_t cpu_state = {0};
+  exec_trace_t trace;
+  exec_trace_record_t record;
+  stub_init_cpu_state(&cpu_state);
+  cpu_state.registers.pc = MEM_SIZE - 1;
+  cpu_state.memory[MEM_SIZE - 1] = 0x60;
+  tmpdir_path(&tmpdir, "exec_trace.bin", path);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_start(&trace, &cpu_state, path));
+#ifdef CHIP8_STRICT_MEMORY
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_MEM_OUT_OF_BOUNDS, emulation_cycle(&cpu_state));
+#else
+  // The second byte comes from the guard band, as fetch reads it
+  cpu_state.memory[MEM_SIZE] = 0x12;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, emulation_cycle(&cpu_state));
+  TEST_ASSERT_EQUAL_HEX8(0x12, cpu_state.registers.V[0]);
+#endif
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_stop(&trace, &cpu_state));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_open(&trace, path));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, exec_trace_read(&trace, &record));
+  TEST_ASSERT_EQUAL_HEX16(MEM_SIZE - 1, record.pc);
+#ifdef CHIP8_STRICT_MEMORY
+  TEST_ASSERT_EQUAL_HEX16(0, record.opcode);
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_MEM_OUT_OF_BOUNDS, record.status);
+#else
+  TEST_ASSERT_EQUAL_HEX16(0x6012, record.opcode);
+#endif
+  exec_trace_close(&trace);
+}
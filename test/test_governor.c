@@ -0,0 +1,59 @@
+#include "unity.h"
+#include "governor.h"
+#include "chip8.h"
+#include "status_code.h"
+
+TEST_FILE("chip8.c")
+TEST_FILE("exec_trace.c")
+TEST_FILE("logging.c")
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_governor(void)
+{
+  governor_params_t params;
+  governor_t governor;
+  cycle_clock_t clock;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, cycle_clock_init(&clock, TIMING_UNIFORM));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, governor_default_params(&params, TIMING_UNIFORM));
+  TEST_ASSERT_EQUAL_UINT32((INSTRUCTIONS_PER_FRAME * 3) / 4, params.min_budget);
+  TEST_ASSERT_EQUAL_UINT32(INSTRUCTIONS_PER_FRAME * 4, params.max_budget);
+  params.window = 2;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, governor_init(&governor, &params));
+
+  // A busy guest on a fast host is given more
+  clock.instructions = 11;
+  clock.idle_instructions = 0;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, governor_update(&governor, &clock, 1000000));
+  TEST_ASSERT_EQUAL_UINT32(11, clock.budget);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, governor_update(&governor, &clock, 1000000));
+  TEST_ASSERT_EQUAL_UINT32(11 + 2 + 1, clock.budget);
+  TEST_ASSERT_EQUAL_UINT32(11 * 60, governor.instructions_per_second);
+  TEST_ASSERT_EQUAL_UINT32(1, governor.adjustments);
+
+  // A host running out of time cuts it
+  clock.instructions = 14;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, governor_update(&governor, &clock, 15000000));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, governor_update(&governor, &clock, 15000000));
+  TEST_ASSERT_EQUAL_UINT32(14 - 3, clock.budget);
+  TEST_ASSERT_EQUAL_UINT32(10, governor.headroom);
+
+  // A guest waiting on its timers is lowered, down to the minimum
+  clock.idle_instructions = 10;
+  for (uint8_t i = 0; i < 20; i++)
+  {
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, governor_update(&governor, &clock, 1000000));
+  }
+  TEST_ASSERT_EQUAL_UINT32(params.min_budget, clock.budget);
+  TEST_ASSERT_EQUAL_UINT32(71, governor.idle);
+
+  params.idle_low = params.idle_high;
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, governor_init(&governor, &params));
+}
@@ -0,0 +1,90 @@
+#define _POSIX_C_SOURCE 200809L // dup
+
+#include "unity.h"
+#include "logging.h"
+#include "status_code.h"
+#include "tmpdir.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOGGING_TEST_THREADS (LOG_MAX_THREADS * 3)
+
+static tmpdir_t tmpdir;
+
+void setUp(void)
+{
+  tmpdir_create(&tmpdir);
+}
+
+void tearDown(void)
+{
+  tmpdir_remove(&tmpdir);
+}
+
+static void *log_and_exit(void *arg)
+{
+  Log_I("message from thread %u", *(uint32_t *)arg);
+  return NULL;
+}
+
+void test_log_rings_reclaimed_and_drained(void)
+{
+  char path[TMPDIR_PATH_SIZE];
+  char line[LOG_MAX_MSG_SIZE];
+  uint32_t ids[LOGGING_TEST_THREADS];
+  uint8_t seen[LOGGING_TEST_THREADS] = {0};
+  uint8_t main_seen = 0;
+  int saved_stderr = dup(STDERR_FILENO);
+
+  tmpdir_path(&tmpdir, "log.txt", path);
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+  TEST_ASSERT(fd >= 0);
+  fflush(stderr);
+  dup2(fd, STDERR_FILENO);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, log_init());
+
+  // More threads than rings over time: each exited thread's ring must be given back
+  for (uint32_t i = 0; i < LOGGING_TEST_THREADS; i++)
+  {
+    pthread_t thread;
+    ids[i] = i;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, log_and_exit, &ids[i]));
+    pthread_join(thread, NULL);
+  }
+
+  // Logged right before shutdown, still in the ring when the writer stops
+  Log_I("last message from main");
+  log_shutdown();
+
+  fflush(stderr);
+  dup2(saved_stderr, STDERR_FILENO);
+  close(saved_stderr);
+
+  FILE *file = fdopen(fd, "r");
+  TEST_ASSERT_NOT_NULL(file);
+  rewind(file);
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    char *text = strstr(line, "message from thread ");
+    if (text != NULL)
+    {
+      uint32_t id = strtoul(text + strlen("message from thread "), NULL, 10);
+      TEST_ASSERT(id < LOGGING_TEST_THREADS);
+      seen[id] = 1;
+    }
+    main_seen |= (strstr(line, "last message from main") != NULL);
+  }
+  fclose(file);
+
+  for (uint32_t i = 0; i < LOGGING_TEST_THREADS; i++)
+  {
+    TEST_ASSERT_EQUAL_UINT8(1, seen[i]);
+  }
+  TEST_ASSERT_EQUAL_UINT8(1, main_seen);
+}
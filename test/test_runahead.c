@@ -0,0 +1,102 @@
+#include "unity.h"
+#include "runahead.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "session.h"
+#include "status_code.h"
+#include <string.h>
+
+TEST_FILE("chip8.c")
+TEST_FILE("exec_trace.c")
+TEST_FILE("logging.c")
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/** A video backend keeping the last frame it was asked to render */
+typedef struct mock_backend_s
+{
+  uint32_t renders;
+  uint8_t cleaned_up;
+} mock_backend_t;
+
+static graphics_t rendered_graphics;
+
+static status_code_t capture_render(void *const handle, graphics_t *const graphics)
+{
+  memcpy(&rendered_graphics, graphics, sizeof(graphics_t));
+  ((mock_backend_t *)handle)->renders++;
+  graphics->display_update = 0;
+  return STATUS_OK;
+}
+
+static void mock_video_cleanup(void *const handle)
+{
+  ((mock_backend_t *)handle)->cleaned_up = 1;
+}
+
+void test_runahead_frame(void)
+{
+  // Moves a sprite right by a pixel per pass, clearing the display in between
+  const uint8_t rom[] = {0xA2, 0x0C, 0x00, 0xE0, 0xD0, 0x11, 0x70, 0x01, 0x12, 0x02, 0x00, 0x00, 0xF0};
+  const video_backend_t video = {.render = capture_render, .cleanup = mock_video_cleanup};
+  mock_backend_t video_mock = {0};
+  session_t session = {0};
+  cpu_state_t reference = {0}, ahead = {0};
+  cycle_clock_t clock, reference_clock, ahead_clock;
+  runahead_t runahead;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, runahead_init(&runahead, 0));
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, runahead_init(&runahead, RUNAHEAD_MAX_FRAMES + 1));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, runahead_init(&runahead, 2));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, init_cpu(&session.cpu));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, load_rom_data(&session.cpu, rom, sizeof(rom)));
+  session.cpu.timers.delay = 10;
+  session.video = &video;
+  session.video_handle = &video_mock;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_clone(&reference, &session.cpu));
+  cycle_clock_init(&clock, TIMING_UNIFORM);
+  reference_clock = clock;
+
+  for (uint8_t frame = 0; frame < 3; frame++)
+  {
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&session.cpu, &clock));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, runahead_frame(&runahead, &session, &clock));
+
+    // The machine itself only ran the real frame
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&reference, &reference_clock));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, update_timers(&reference));
+    TEST_ASSERT_EQUAL_MEMORY(&reference.registers, &session.cpu.registers, sizeof(registers_t));
+    TEST_ASSERT_EQUAL_UINT8(reference.timers.delay, session.cpu.timers.delay);
+    TEST_ASSERT_EQUAL_MEMORY(&reference.peripherals.graphics.buffer, &session.cpu.peripherals.graphics.buffer,
+                             sizeof(reference.peripherals.graphics.buffer));
+
+    // What was shown is the machine two frames on
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_clone(&ahead, &reference));
+    ahead_clock = reference_clock;
+    for (uint8_t i = 0; i < 2; i++)
+    {
+      TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&ahead, &ahead_clock));
+      TEST_ASSERT_EQUAL_INT(STATUS_OK, update_timers(&ahead));
+    }
+    TEST_ASSERT_EQUAL_MEMORY(&ahead.peripherals.graphics.buffer, &rendered_graphics.buffer,
+                             sizeof(rendered_graphics.buffer));
+    TEST_ASSERT(memcmp(&reference.peripherals.graphics.buffer, &rendered_graphics.buffer,
+                       sizeof(rendered_graphics.buffer)) != 0);
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(3, video_mock.renders);
+  TEST_ASSERT_EQUAL_UINT64(3, runahead.presented);
+  TEST_ASSERT_EQUAL_UINT64(clock.frames, reference_clock.frames);
+
+  runahead_cleanup(&runahead);
+  cleanup_cpu(&ahead);
+  cleanup_cpu(&reference);
+  session_cleanup(&session);
+}
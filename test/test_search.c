@@ -0,0 +1,65 @@
+#include "unity.h"
+#include "search.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "status_code.h"
+
+TEST_FILE("chip8.c")
+TEST_FILE("exec_trace.c")
+TEST_FILE("logging.c")
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_search_run_finds_goal(void)
+{
+  // Counts key 5 presses into [0x300]
+  const uint8_t rom[] = {0x65, 0x05, 0xE5, 0xA1, 0x70, 0x01, 0xA3, 0x00, 0xF0, 0x55, 0x12, 0x02};
+  const uint16_t actions[] = {0x0000, 0x0000, 0x0020};
+  const search_predicate_t predicates[] = {{.address = 0x300, .compare = SEARCH_VALUE, .weight = 1}};
+  search_params_t params = {
+      .actions = actions,
+      .action_count = 3,
+      .frames_per_step = 1,
+      .max_depth = 8,
+      .beam_width = 4,
+      .max_states = 64,
+      .predicates = predicates,
+      .predicate_count = 1,
+      .goal_score = 6,
+      .has_goal = 1,
+      .threads = 2,
+  };
+  search_result_t result;
+  cpu_state_t cpu_state;
+
+  init_cpu(&cpu_state);
+  load_rom_data(&cpu_state, rom, sizeof(rom));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, search_run(&cpu_state, &params, &result));
+  TEST_ASSERT_TRUE(result.goal_reached);
+  TEST_ASSERT_TRUE(result.score >= 6);
+  TEST_ASSERT_EQUAL_INT(3, result.length);
+  for (uint8_t i = 0; i < result.length; i++)
+  {
+    TEST_ASSERT_EQUAL_HEX16(0x0020, result.path[i]);
+  }
+  TEST_ASSERT_TRUE(result.duplicates > 0);
+  TEST_ASSERT_EQUAL_HEX16(START_ADDRESS, cpu_state.registers.pc);
+
+  search_free_result(&result);
+  TEST_ASSERT_NULL(result.path);
+
+  params.beam_width = 0;
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, search_run(&cpu_state, &params, &result));
+
+  // A visited set this large could not be sized
+  params.beam_width = 4;
+  params.max_states = SEARCH_MAX_STATES + 1;
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, search_run(&cpu_state, &params, &result));
+}
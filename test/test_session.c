@@ -0,0 +1,113 @@
+#include "unity.h"
+#include "session.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "status_code.h"
+
+TEST_FILE("chip8.c")
+TEST_FILE("exec_trace.c")
+TEST_FILE("logging.c")
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/** Mock backends recording what a session drives them with */
+typedef struct mock_backend_s
+{
+  uint32_t renders;
+  uint32_t beeps;
+  uint32_t mutes;
+  uint8_t pitch;
+  uint8_t cleaned_up;
+} mock_backend_t;
+
+static status_code_t mock_render(void *const handle, graphics_t *const graphics)
+{
+  ((mock_backend_t *)handle)->renders++;
+  graphics->display_update = 0;
+  return STATUS_OK;
+}
+
+static void mock_video_cleanup(void *const handle)
+{
+  ((mock_backend_t *)handle)->cleaned_up = 1;
+}
+
+static void mock_set_pattern(void *const handle, uint8_t const *const pattern, uint8_t const pitch)
+{
+  (void)pattern;
+  ((mock_backend_t *)handle)->pitch = pitch;
+}
+
+static void mock_play_beep(void *const handle)
+{
+  ((mock_backend_t *)handle)->beeps++;
+}
+
+static void mock_mute(void *const handle)
+{
+  ((mock_backend_t *)handle)->mutes++;
+}
+
+static status_code_t mock_read(void *const handle, uint16_t *const keypad)
+{
+  (void)handle;
+  *keypad = 0x0020;
+  return STATUS_OK;
+}
+
+void test_session_frame(void)
+{
+  const video_backend_t video = {.render = mock_render, .cleanup = mock_video_cleanup};
+  const audio_backend_t audio = {.set_pattern = mock_set_pattern, .play_beep = mock_play_beep,
+                                 .mute = mock_mute, .cleanup = mock_video_cleanup};
+  const input_backend_t input = {.read = mock_read};
+  mock_backend_t video_mock = {0}, audio_mock = {0};
+  session_t session = {0};
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, init_cpu(&session.cpu));
+  session.video = &video;
+  session.video_handle = &video_mock;
+  session.audio = &audio;
+  session.audio_handle = &audio_mock;
+  session.input = &input;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, session_read_input(&session));
+  TEST_ASSERT_EQUAL_HEX16(0x0020, session.cpu.peripherals.keypad.current);
+
+  session.cpu.timers.sound = 2;
+  session.cpu.timers.delay = 5;
+  session.cpu.peripherals.audio.loaded = 1;
+  session.cpu.peripherals.audio.audio_update = 1;
+  session.cpu.peripherals.audio.pitch = 0x70;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, session_frame(&session));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, session_frame(&session));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, session_frame(&session));
+
+  TEST_ASSERT_EQUAL_UINT32(2, audio_mock.beeps);
+  TEST_ASSERT_EQUAL_UINT32(1, audio_mock.mutes);
+  TEST_ASSERT_EQUAL_HEX8(0x70, audio_mock.pitch);
+  TEST_ASSERT_EQUAL_INT(0, session.cpu.peripherals.audio.audio_update);
+  TEST_ASSERT_EQUAL_UINT32(3, video_mock.renders);
+  TEST_ASSERT_EQUAL_UINT8(2, session.cpu.timers.delay);
+
+  // A headless session runs without any backends
+  session.video = NULL;
+  session.audio = NULL;
+  session.input = NULL;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, session_read_input(&session));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, session_frame(&session));
+  TEST_ASSERT_EQUAL_UINT32(3, video_mock.renders);
+
+  session.video = &video;
+  session.audio = &audio;
+  session_cleanup(&session);
+  TEST_ASSERT_EQUAL_UINT8(1, video_mock.cleaned_up);
+  TEST_ASSERT_EQUAL_UINT8(1, audio_mock.cleaned_up);
+}
@@ -0,0 +1,66 @@
+#include "unity.h"
+#include "shm_export.h"
+#include "cpu_def.h"
+#include "status_code.h"
+
+TEST_FILE("logging.c")
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_shm_export(void)
+{
+  cpu_state_t cpu_state = {0};
+  shm_export_t writer;
+  shm_export_t reader;
+  shm_export_layout_t copy;
+
+  cpu_state.registers.pc = START_ADDRESS;
+  cpu_state.registers.V[3] = 0x42;
+  cpu_state.timers.delay = 7;
+  cpu_state.peripherals.keypad.current = 0x0010;
+  cpu_state.peripherals.graphics.buffer[0][5][1] = 0x8000000000000001ULL;
+  cpu_state.peripherals.graphics.display_update = 1;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_FILE_NOT_FOUND, shm_export_open(&reader, "/chip8_test_missing"));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, shm_export_create(&writer, "/chip8_test_shm"));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, shm_export_open(&reader, "/chip8_test_shm"));
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, shm_export_publish(&reader, &cpu_state));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, shm_export_publish(&writer, &cpu_state));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, shm_export_read(&reader, &copy));
+  TEST_ASSERT_EQUAL_UINT32(2, copy.sequence);
+  TEST_ASSERT_EQUAL_UINT64(1, copy.frame);
+  TEST_ASSERT_EQUAL_UINT64(1, copy.graphics_frame);
+  TEST_ASSERT_EQUAL_HEX8(0x42, copy.registers.V[3]);
+  TEST_ASSERT_EQUAL_UINT16(START_ADDRESS, copy.registers.pc);
+  TEST_ASSERT_EQUAL_UINT8(7, copy.timers.delay);
+  TEST_ASSERT_EQUAL_HEX16(0x0010, copy.keypad);
+  TEST_ASSERT_EQUAL_MEMORY(cpu_state.peripherals.graphics.buffer, copy.graphics.buffer, sizeof(copy.graphics.buffer));
+
+  // The framebuffer is only copied again once it changes; readers can read in place
+  cpu_state.peripherals.graphics.display_update = 0;
+  cpu_state.peripherals.graphics.buffer[0][5][1] = 0;
+  cpu_state.registers.pc += 2;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, shm_export_publish(&writer, &cpu_state));
+
+  uint32_t sequence = shm_export_read_begin(&reader);
+  TEST_ASSERT_EQUAL_UINT32(4, sequence);
+  TEST_ASSERT_EQUAL_UINT64(2, reader.layout->frame);
+  TEST_ASSERT_EQUAL_UINT64(1, reader.layout->graphics_frame);
+  TEST_ASSERT_EQUAL_UINT16(START_ADDRESS + 2, reader.layout->registers.pc);
+  TEST_ASSERT_EQUAL_HEX64(0x8000000000000001ULL, reader.layout->graphics.buffer[0][5][1]);
+  TEST_ASSERT_EQUAL_UINT8(0, shm_export_read_retry(&reader, sequence));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, shm_export_publish(&writer, &cpu_state));
+  TEST_ASSERT_EQUAL_UINT8(1, shm_export_read_retry(&reader, sequence));
+
+  shm_export_close(&reader);
+  shm_export_close(&writer);
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_FILE_NOT_FOUND, shm_export_open(&reader, "/chip8_test_shm"));
+}
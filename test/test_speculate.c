@@ -0,0 +1,69 @@
+#include "unity.h"
+#include "speculate.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "status_code.h"
+
+TEST_FILE("chip8.c")
+TEST_FILE("exec_trace.c")
+TEST_FILE("logging.c")
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_speculate_frame(void)
+{
+  // Counts frame passes in V2, and in V1 those without key 5 held
+  const uint8_t rom[] = {0x60, 0x05, 0xE0, 0x9E, 0x71, 0x01, 0x72, 0x01, 0x12, 0x02};
+  const uint16_t keys[] = {0x0000, 0x0000, 0x0020, 0x0020, 0x0000, 0x0003, 0x0003};
+  cpu_state_t state = {0}, reference = {0};
+  cycle_clock_t clock, reference_clock;
+  speculate_t spec;
+  uint64_t hash, expected;
+
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, speculate_init(&spec, 0));
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, speculate_init(&spec, SPECULATE_MAX_BRANCHES + 1));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, speculate_init(&spec, 3));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, init_cpu(&state));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, load_rom_data(&state, rom, sizeof(rom)));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, chip8_clone(&reference, &state));
+  cycle_clock_init(&clock, TIMING_UNIFORM);
+  reference_clock = clock;
+
+  for (uint8_t frame = 0; frame < sizeof(keys) / sizeof(keys[0]); frame++)
+  {
+    state.peripherals.keypad.current = keys[frame];
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, speculate_frame(&spec, &state, &clock));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, update_timers(&state));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, speculate_start(&spec, &state, &clock));
+
+    reference.peripherals.keypad.current = keys[frame];
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, run_frame_cycles(&reference, &reference_clock));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, update_timers(&reference));
+
+    // Committed or run, the frame leaves the machine as running it would have
+    TEST_ASSERT_EQUAL_MEMORY(&reference.registers, &state.registers, sizeof(registers_t));
+    TEST_ASSERT_EQUAL_UINT64(reference_clock.frames, clock.frames);
+    chip8_state_hash(&reference, &expected);
+    chip8_state_hash(&state, &hash);
+    TEST_ASSERT_EQUAL_HEX64(expected, hash);
+  }
+
+  // Unchanged keypads hit, as does releasing key 5 once it was seen changing; a new key or two keys miss
+  TEST_ASSERT_EQUAL_UINT64(4, spec.hits);
+  TEST_ASSERT_EQUAL_UINT64(2, spec.misses);
+  TEST_ASSERT_EQUAL_UINT64(18, spec.branches_run);
+  TEST_ASSERT_EQUAL_UINT64(14, spec.wasted_branches);
+  TEST_ASSERT(spec.wasted_instructions > 0);
+  TEST_ASSERT(reference.registers.V[1] < reference.registers.V[2]);
+
+  speculate_cleanup(&spec);
+  cleanup_cpu(&reference);
+  cleanup_cpu(&state);
+}
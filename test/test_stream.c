@@ -0,0 +1,143 @@
+#include "unity.h"
+#include "stream.h"
+#include "cpu_def.h"
+#include "status_code.h"
+#include "tmpdir.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+TEST_FILE("logging.c")
+
+static tmpdir_t tmpdir;
+
+void setUp(void)
+{
+  tmpdir_create(&tmpdir);
+}
+
+void tearDown(void)
+{
+  tmpdir_remove(&tmpdir);
+}
+
+void test_stream_server(void)
+{
+  stream_server_t server;
+  graphics_t frame = {0};
+  graphics_t view = {0};
+  uint8_t payload[STREAM_MAX_PAYLOAD];
+  char address[TMPDIR_PATH_SIZE + 8];
+  char path[TMPDIR_PATH_SIZE];
+  uint16_t length;
+  uint8_t type;
+  uint32_t number;
+  uint16_t keypad = 0;
+  int fd;
+
+  tmpdir_path(&tmpdir, "stream.sock", path);
+  snprintf(address, sizeof(address), "unix:%s", path);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, stream_server_init(&server, "udp:1234"));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_server_init(&server, address));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_connect(address, &fd));
+
+  // A new viewer starts from a keyframe
+  frame.buffer[0][3][1] = 0x8000000000000001ULL;
+  frame.buffer[1][63][0] = 0xFF;
+  frame.hires = 1;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_server_publish(&server, &frame));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_read_message(fd, &type, payload, &length));
+  TEST_ASSERT_EQUAL_INT(STREAM_MSG_FRAME, type);
+  TEST_ASSERT_EQUAL_HEX8(STREAM_FLAG_KEYFRAME | STREAM_FLAG_HIRES, payload[4]);
+  memset(view.buffer, 0xAA, sizeof(view.buffer));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_decode_frame(&view, &number, payload, length));
+  TEST_ASSERT_EQUAL_MEMORY(frame.buffer, view.buffer, sizeof(frame.buffer));
+  TEST_ASSERT_EQUAL_UINT8(1, view.hires);
+
+  // Then only the changed rows: one row with a single changed byte
+  frame.buffer[0][3][1] = 0x8000000000000000ULL;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_server_publish(&server, &frame));
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_read_message(fd, &type, payload, &length));
+  TEST_ASSERT_EQUAL_HEX8(STREAM_FLAG_HIRES, payload[4]);
+  TEST_ASSERT_EQUAL_UINT16(STREAM_FRAME_FIXED_SIZE + 4, length);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_decode_frame(&view, NULL, payload, length));
+  TEST_ASSERT_EQUAL_MEMORY(frame.buffer, view.buffer, sizeof(frame.buffer));
+
+  // Truncated payloads are rejected
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, stream_decode_frame(&view, NULL, payload, length - 1));
+
+  // Keypad input comes back over the same connection. The fan-out thread reads it, in the same pass as the
+  // first frame published after it at the latest, so once a second frame arrives the input has been read
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_send_keypad(fd, 0x0204));
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    frame.buffer[0][0][0] ^= 1;
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_server_publish(&server, &frame));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_read_message(fd, &type, payload, &length));
+  }
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_input_backend.read(&server, &keypad));
+  TEST_ASSERT_EQUAL_HEX16(0x0204, keypad);
+
+  close(fd);
+  stream_server_cleanup(&server);
+}
+
+void test_stream_servers_share_a_hub(void)
+{
+  stream_hub_t hub;
+  stream_server_t servers[2];
+  graphics_t frame = {0};
+  graphics_t views[2] = {0};
+  uint8_t payload[STREAM_MAX_PAYLOAD];
+  char addresses[2][TMPDIR_PATH_SIZE + 8];
+  char path[TMPDIR_PATH_SIZE];
+  uint16_t length;
+  uint8_t type;
+  int fds[2];
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_hub_init(&hub));
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    char name[16];
+    snprintf(name, sizeof(name), "stream%u.sock", i);
+    tmpdir_path(&tmpdir, name, path);
+    snprintf(addresses[i], sizeof(addresses[i]), "unix:%s", path);
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_server_init_shared(&servers[i], &hub, addresses[i]));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_connect(addresses[i], &fds[i]));
+  }
+
+  // Each viewer sees the frames of its own server
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    frame.buffer[0][i][0] = 1;
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_server_publish(&servers[i], &frame));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_read_message(fds[i], &type, payload, &length));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_decode_frame(&views[i], NULL, payload, length));
+    TEST_ASSERT_EQUAL_MEMORY(frame.buffer, views[i].buffer, sizeof(frame.buffer));
+  }
+
+  // A server detached from the hub leaves the others streaming, and its slot to the next one
+  stream_server_cleanup(&servers[0]);
+  close(fds[0]);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_server_init_shared(&servers[0], &hub, addresses[0]));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_connect(addresses[0], &fds[0]));
+
+  frame.buffer[0][2][0] = 1;
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_server_publish(&servers[i], &frame));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_read_message(fds[i], &type, payload, &length));
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, stream_decode_frame(&views[i], NULL, payload, length));
+    TEST_ASSERT_EQUAL_MEMORY(frame.buffer, views[i].buffer, sizeof(frame.buffer));
+  }
+
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    close(fds[i]);
+    stream_server_cleanup(&servers[i]);
+  }
+  stream_hub_cleanup(&hub);
+}
@@ -0,0 +1,70 @@
+#include "unity.h"
+#include "terminal.h"
+#include "cpu_def.h"
+#include "status_code.h"
+#include <unistd.h>
+
+TEST_FILE("logging.c")
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_terminal_render_diff(void)
+{
+  terminal_init_param_t param = {
+      .mode = TERMINAL_HALF_BLOCK,
+      .colors = {
+          .background_color = DEFAULT_BG_COLOR,
+          .foreground_color = DEFAULT_FG_COLOR,
+          .plane2_color = DEFAULT_PLANE2_COLOR,
+          .overlap_color = DEFAULT_OVERLAP_COLOR,
+      },
+  };
+  terminal_t terminal;
+  graphics_t graphics = {0};
+  char output[4096];
+  int fds[2];
+
+  TEST_ASSERT_EQUAL_INT(0, pipe(fds));
+  param.fd = fds[1];
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, terminal_init(&terminal, &param));
+  uint64_t setup_bytes = terminal.bytes_written;
+
+  // The first frame draws every cell
+  graphics.buffer[0][0][0] = 1ULL << 63;
+  graphics.display_update = 1;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, terminal_render(&terminal, &graphics));
+  TEST_ASSERT_GREATER_THAN(64 * 16, terminal.bytes_written - setup_bytes);
+  TEST_ASSERT_EQUAL_INT(0, graphics.display_update);
+
+  // Redrawing an unchanged display writes nothing
+  uint64_t full_bytes = terminal.bytes_written;
+  graphics.display_update = 1;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, terminal_render(&terminal, &graphics));
+  TEST_ASSERT_EQUAL_UINT64(full_bytes, terminal.bytes_written);
+
+  for (uint64_t drained = 0; drained < full_bytes;)
+  {
+    drained += (uint64_t)read(fds[0], output, sizeof(output));
+  }
+
+  // A single changed pixel redraws its cell alone: the first cell, lit in its lower half
+  graphics.buffer[0][0][0] = 0;
+  graphics.buffer[0][1][0] = 1ULL << 63;
+  graphics.display_update = 1;
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, terminal_render(&terminal, &graphics));
+
+  ssize_t length = read(fds[0], output, sizeof(output) - 1);
+  TEST_ASSERT_EQUAL_UINT64(terminal.bytes_written - full_bytes, (uint64_t)length);
+  output[length] = '\0';
+  TEST_ASSERT_EQUAL_STRING("\x1b[1;1H\x1b[38;5;233;48;5;254m\xE2\x96\x80\x1b[0m", output);
+
+  terminal_cleanup(&terminal);
+  close(fds[0]);
+  close(fds[1]);
+}
@@ -0,0 +1,77 @@
+#include "unity.h"
+#include "trace.h"
+#include "status_code.h"
+#include "tmpdir.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+TEST_FILE("logging.c")
+
+#define TRACE_TEST_WRITERS (4)
+
+static tmpdir_t tmpdir;
+
+void setUp(void)
+{
+  tmpdir_create(&tmpdir);
+}
+
+void tearDown(void)
+{
+  tmpdir_remove(&tmpdir);
+}
+
+/** Record spans until told to stop, as the audio callback thread might at exit */
+static void *record_spans(void *arg)
+{
+  uint8_t *stop = arg;
+
+  for (uint32_t i = 0; (i < 100000) && !__atomic_load_n(stop, __ATOMIC_ACQUIRE); i++)
+  {
+    uint64_t now = trace_now_us();
+    trace_record("writer", now, now);
+  }
+
+  return NULL;
+}
+
+void test_trace_shutdown_with_active_writers(void)
+{
+  char path[TMPDIR_PATH_SIZE];
+  char line[256];
+  pthread_t writers[TRACE_TEST_WRITERS];
+  uint8_t stop = 0;
+  uint8_t found = 0;
+
+  tmpdir_path(&tmpdir, "trace.json", path);
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, trace_init(path));
+
+  for (uint8_t i = 0; i < TRACE_TEST_WRITERS; i++)
+  {
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&writers[i], NULL, record_spans, &stop));
+  }
+
+  uint64_t now = trace_now_us();
+  trace_record("main", now, now + 5);
+
+  // Shutting down waits for the spans being recorded; later ones are dropped
+  trace_shutdown();
+  trace_record("late", now, now);
+  __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+
+  for (uint8_t i = 0; i < TRACE_TEST_WRITERS; i++)
+  {
+    pthread_join(writers[i], NULL);
+  }
+
+  FILE *file = fopen(path, "r");
+  TEST_ASSERT_NOT_NULL(file);
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    found |= (strstr(line, "\"name\":\"main\"") != NULL) && (strstr(line, "\"dur\":5}") != NULL);
+    TEST_ASSERT_NULL(strstr(line, "\"late\""));
+  }
+  fclose(file);
+  TEST_ASSERT_TRUE(found);
+}
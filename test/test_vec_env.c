@@ -0,0 +1,83 @@
+#include "unity.h"
+#include "vec_env.h"
+#include "cpu_def.h"
+#include "search.h"
+#include "status_code.h"
+#include "tmpdir.h"
+#include <string.h>
+
+TEST_FILE("chip8.c")
+TEST_FILE("exec_trace.c")
+TEST_FILE("logging.c")
+
+static tmpdir_t tmpdir;
+
+void setUp(void)
+{
+  tmpdir_create(&tmpdir);
+}
+
+void tearDown(void)
+{
+  tmpdir_remove(&tmpdir);
+}
+
+void test_vec_env_step(void)
+{
+  // Draws a 0 at the top-left corner, then counts key 5 presses into [0x300]
+  const uint8_t rom[] = {0x60, 0x00, 0xF0, 0x29, 0xD0, 0x05, 0x65, 0x05,
+                         0xE5, 0xA1, 0x70, 0x01, 0xA3, 0x00, 0xF0, 0x55, 0x12, 0x08};
+  const search_predicate_t reward = {.address = 0x300, .compare = SEARCH_VALUE, .weight = 1};
+  const search_predicate_t done = {.address = 0x300, .compare = SEARCH_GREATER, .value = 5, .weight = 1};
+  const uint16_t actions[] = {0x0020, 0x0000, 0x0020};
+  const float expected_rewards[3] = {1, 2, 3};
+  char path[TMPDIR_PATH_SIZE];
+  vec_env_params_t params = {
+      .rom = path,
+      .num_envs = 3,
+      .threads = 2,
+      .frame_skip = 1,
+      .downsample = 2,
+      .frame_stack = 2,
+      .reward_predicates = &reward,
+      .reward_count = 1,
+      .done_predicates = &done,
+      .done_count = 1,
+  };
+  vec_env_t env;
+  uint8_t observations[3][2][32][64];
+  float rewards[3];
+  uint8_t dones[3];
+
+  tmpdir_write(&tmpdir, "vec_env.ch8", rom, sizeof(rom), path);
+
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, vec_env_init(&env, &params));
+  TEST_ASSERT_EQUAL_INT(sizeof(observations[0]), env.obs_size);
+
+  memset(observations, 0xFF, sizeof(observations));
+  TEST_ASSERT_EQUAL_INT(STATUS_OK, vec_env_reset(&env, &observations[0][0][0][0]));
+  TEST_ASSERT_EQUAL_HEX8(0, observations[0][1][0][0]);
+
+  for (uint8_t step = 0; step < 3; step++)
+  {
+    TEST_ASSERT_EQUAL_INT(STATUS_OK, vec_env_step(&env, actions, &observations[0][0][0][0], rewards, dones));
+
+    for (uint8_t e = 0; e < 3; e++)
+    {
+      TEST_ASSERT_EQUAL_FLOAT(actions[e] ? expected_rewards[step] : 0, rewards[e]);
+      TEST_ASSERT_EQUAL_INT((actions[e] && (step == 2)) ? 1 : 0, dones[e]);
+    }
+  }
+
+  // The top row of the 0 in the newest frame, the previous frame's below it; restarted episodes are blank
+  TEST_ASSERT_EQUAL_HEX8(1, observations[1][1][0][3]);
+  TEST_ASSERT_EQUAL_HEX8(0, observations[1][1][0][4]);
+  TEST_ASSERT_EQUAL_HEX8(1, observations[1][0][1][0]);
+  TEST_ASSERT_EQUAL_HEX8(0, observations[1][0][1][1]);
+  TEST_ASSERT_EQUAL_HEX8(0, observations[0][1][0][0]);
+
+  vec_env_cleanup(&env);
+
+  params.downsample = 3;
+  TEST_ASSERT_EQUAL_INT(STATUS_ERR_INVALID_PARAM, vec_env_init(&env, &params));
+}
@@ -0,0 +1,193 @@
+#define _POSIX_C_SOURCE 200809L // getopt, clock_nanosleep, sigaction
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "cpu_def.h"
+#include "display.h"
+#include "session.h"
+#include "status_code.h"
+#include "stream.h"
+#include "terminal.h"
+
+#define DISPLAY_FREQ_HZ (60)
+#define NSEC_PER_SEC (1000000000L)
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_interrupt(int signal)
+{
+  (void)signal;
+  interrupted = 1;
+}
+
+void print_usage(void)
+{
+  printf("\nUsage: chip8_term.out [options] <ROM file>\n");
+  printf("\nRuns a ROM without a window and draws its display on the terminal, redrawing");
+  printf("\nonly the character cells that changed each frame. Stops on Ctrl-C.\n");
+  printf("\nOptions:");
+  printf("\n  -p <chip8|schip|xochip|vip>  Quirk profile (default chip8)");
+  printf("\n  -b                           Draw with braille patterns instead of half-blocks");
+  printf("\n  -f <frames>                  Stop after this many frames (default: run until interrupted)");
+  printf("\n  -l <unix:PATH|tcp:PORT>      Also stream the display to chip8_view.out viewers, taking their keypad input");
+  printf("\n  -q                           Do not draw on this terminal\n");
+}
+
+int main(int argc, char **argv)
+{
+  quirk_profile_t profile = QUIRK_PROFILE_CHIP8;
+  terminal_init_param_t terminal_param = {
+      .fd = STDOUT_FILENO,
+      .mode = TERMINAL_HALF_BLOCK,
+      .colors = {
+          .background_color = DEFAULT_BG_COLOR,
+          .foreground_color = DEFAULT_FG_COLOR,
+          .plane2_color = DEFAULT_PLANE2_COLOR,
+          .overlap_color = DEFAULT_OVERLAP_COLOR,
+      },
+  };
+  terminal_t terminal = {0};
+  stream_server_t server;
+  const char *stream_address = NULL;
+  uint8_t quiet = 0;
+  session_t session = {0};
+  uint64_t frame_limit = 0;
+  uint64_t frames = 0;
+  struct sigaction action;
+  struct timespec deadline;
+  int option;
+
+  while ((option = getopt(argc, argv, "p:bf:l:q")) != -1)
+  {
+    switch (option)
+    {
+    case 'p':
+      if (quirk_profile_from_name(optarg, &profile) != STATUS_OK)
+      {
+        print_usage();
+        return STATUS_ERR_INVALID_PARAM;
+      }
+      break;
+    case 'b':
+      terminal_param.mode = TERMINAL_BRAILLE;
+      break;
+    case 'f':
+      frame_limit = strtoull(optarg, NULL, 10);
+      break;
+    case 'l':
+      stream_address = optarg;
+      break;
+    case 'q':
+      quiet = 1;
+      break;
+    default:
+      print_usage();
+      return STATUS_ERR_INVALID_PARAM;
+    }
+  }
+
+  if ((argc - optind) != 1)
+  {
+    print_usage();
+    return STATUS_ERR_GENERIC;
+  }
+
+  status_code_t status = init_template(&session.cpu, argv[optind], profile);
+  if (status != STATUS_OK)
+  {
+    fprintf(stderr, "Failed to load %s: %u\n", argv[optind], status);
+    cleanup_cpu(&session.cpu);
+    return status;
+  }
+
+  if (stream_address != NULL)
+  {
+    status = stream_server_init(&server, stream_address);
+    if (status != STATUS_OK)
+    {
+      fprintf(stderr, "Failed to listen on %s: %u\n", stream_address, status);
+      cleanup_cpu(&session.cpu);
+      return status;
+    }
+    session.input = &stream_input_backend;
+    session.input_handle = &server;
+  }
+
+  if (!quiet)
+  {
+    status = terminal_init(&terminal, &terminal_param);
+    if (status != STATUS_OK)
+    {
+      cleanup_cpu(&session.cpu);
+      return status;
+    }
+    session.video = &terminal_backend;
+    session.video_handle = &terminal;
+  }
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = on_interrupt;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+  while (!interrupted && ((frame_limit == 0) || (frames < frame_limit)))
+  {
+    session_read_input(&session);
+
+    status = emulation_frame(&session.cpu);
+    if (status != STATUS_OK)
+    {
+      break;
+    }
+
+    // Published before the terminal renders, which clears display_update
+    if ((stream_address != NULL) && session.cpu.peripherals.graphics.display_update)
+    {
+      stream_server_publish(&server, &session.cpu.peripherals.graphics);
+    }
+
+    status = session_frame(&session);
+    if (status != STATUS_OK)
+    {
+      break;
+    }
+    frames++;
+
+    deadline.tv_nsec += NSEC_PER_SEC / DISPLAY_FREQ_HZ;
+    if (deadline.tv_nsec >= NSEC_PER_SEC)
+    {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= NSEC_PER_SEC;
+    }
+    while ((clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) != 0) && !interrupted)
+    {
+    }
+  }
+
+  uint64_t bytes = terminal.bytes_written;
+  session_cleanup(&session);
+
+  if ((frames > 0) && !quiet)
+  {
+    fprintf(stderr, "%llu frames, %llu bytes written (%.1f KiB/s at %u Hz)\n", (unsigned long long)frames,
+            (unsigned long long)bytes, ((double)bytes / frames) * DISPLAY_FREQ_HZ / 1024, DISPLAY_FREQ_HZ);
+  }
+
+  if (stream_address != NULL)
+  {
+    stream_server_cleanup(&server);
+    fprintf(stderr, "Streamed %llu bytes, %llu keyframes\n", (unsigned long long)server.bytes_sent,
+            (unsigned long long)server.keyframes_sent);
+  }
+
+  return (status == STATUS_REQ_EXIT) ? STATUS_OK : status;
+}
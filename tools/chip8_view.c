@@ -0,0 +1,191 @@
+#define _POSIX_C_SOURCE 200809L // getopt, clock_gettime
+
+#include <ctype.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpu_def.h"
+#include "display.h"
+#include "status_code.h"
+#include "stream.h"
+#include "terminal.h"
+
+#define KEY_HOLD_MS (150) // Terminals report key presses only, so each press holds its key this long
+#define KEY_ESCAPE (0x1B)
+#define KEY_CTRL_C (0x03)
+
+/** The keyboard layout of the SDL front end, indexed by CHIP-8 key */
+static const char key_map[NUM_KEYS + 1] = "x123qweasdzc4rfv";
+
+void print_usage(void)
+{
+  printf("\nUsage: chip8_view.out [-b] <unix:PATH|tcp:PORT>\n");
+  printf("\nShows the display streamed by chip8_term.out -l on this terminal and sends key");
+  printf("\npresses back, on the same layout as the emulator window. Esc quits.\n");
+  printf("\nOptions:");
+  printf("\n  -b  Draw with braille patterns instead of half-blocks\n");
+}
+
+static uint64_t now_ms(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000) + ((uint64_t)now.tv_nsec / 1000000);
+}
+
+int main(int argc, char **argv)
+{
+  terminal_init_param_t terminal_param = {
+      .fd = STDOUT_FILENO,
+      .mode = TERMINAL_HALF_BLOCK,
+      .colors = {
+          .background_color = DEFAULT_BG_COLOR,
+          .foreground_color = DEFAULT_FG_COLOR,
+          .plane2_color = DEFAULT_PLANE2_COLOR,
+          .overlap_color = DEFAULT_OVERLAP_COLOR,
+      },
+  };
+  terminal_t terminal;
+  graphics_t graphics = {0};
+  uint8_t payload[STREAM_MAX_PAYLOAD];
+  uint64_t release_ms[NUM_KEYS] = {0};
+  uint16_t keypad = 0;
+  struct termios saved_termios;
+  uint8_t raw_input = isatty(STDIN_FILENO);
+  int option;
+  int fd;
+
+  while ((option = getopt(argc, argv, "b")) != -1)
+  {
+    if (option != 'b')
+    {
+      print_usage();
+      return STATUS_ERR_INVALID_PARAM;
+    }
+    terminal_param.mode = TERMINAL_BRAILLE;
+  }
+
+  if ((argc - optind) != 1)
+  {
+    print_usage();
+    return STATUS_ERR_GENERIC;
+  }
+
+  status_code_t status = stream_connect(argv[optind], &fd);
+  if (status != STATUS_OK)
+  {
+    fprintf(stderr, "Failed to connect to %s\n", argv[optind]);
+    return status;
+  }
+
+  status = terminal_init(&terminal, &terminal_param);
+  if (status != STATUS_OK)
+  {
+    close(fd);
+    return status;
+  }
+
+  // Key presses are read one by one, unechoed
+  if (raw_input)
+  {
+    struct termios raw;
+    tcgetattr(STDIN_FILENO, &saved_termios);
+    raw = saved_termios;
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+  }
+
+  while (status == STATUS_OK)
+  {
+    struct pollfd fds[2] = {{.fd = fd, .events = POLLIN}, {.fd = STDIN_FILENO, .events = raw_input ? POLLIN : 0}};
+    uint64_t now = now_ms();
+    int timeout = -1;
+
+    for (uint8_t key = 0; key < NUM_KEYS; key++)
+    {
+      uint64_t wait = (release_ms[key] > now) ? (release_ms[key] - now) : 0;
+      if ((keypad & (1 << key)) && ((timeout < 0) || (wait < (uint64_t)timeout)))
+      {
+        timeout = (int)wait;
+      }
+    }
+
+    if (poll(fds, 2, timeout) < 0)
+    {
+      continue;
+    }
+
+    if (fds[0].revents & (POLLIN | POLLHUP))
+    {
+      uint8_t type;
+      uint16_t length;
+
+      status = stream_read_message(fd, &type, payload, &length);
+      if ((status == STATUS_OK) && (type == STREAM_MSG_FRAME))
+      {
+        status = stream_decode_frame(&graphics, NULL, payload, length);
+        if (status == STATUS_OK)
+        {
+          status = terminal_render(&terminal, &graphics);
+        }
+      }
+    }
+
+    uint16_t held = keypad;
+    now = now_ms();
+
+    if (fds[1].revents & POLLIN)
+    {
+      char input[64];
+      ssize_t length = read(STDIN_FILENO, input, sizeof(input));
+
+      for (ssize_t i = 0; i < length; i++)
+      {
+        if ((input[i] == KEY_ESCAPE) || (input[i] == KEY_CTRL_C))
+        {
+          status = STATUS_REQ_EXIT;
+        }
+
+        // Control bytes, such as Esc above, are never keypad keys
+        unsigned char c = (unsigned char)input[i];
+        const char *key = (c >= 0x20) ? strchr(key_map, tolower(c)) : NULL;
+        if (key != NULL)
+        {
+          held |= (uint16_t)(1 << (key - key_map));
+          release_ms[key - key_map] = now + KEY_HOLD_MS;
+        }
+      }
+    }
+
+    for (uint8_t key = 0; key < NUM_KEYS; key++)
+    {
+      if ((held & (1 << key)) && (release_ms[key] <= now))
+      {
+        held &= (uint16_t)~(1 << key);
+      }
+    }
+
+    if ((held != keypad) && (status == STATUS_OK))
+    {
+      keypad = held;
+      status = stream_send_keypad(fd, keypad);
+    }
+  }
+
+  if (raw_input)
+  {
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+  }
+  terminal_cleanup(&terminal);
+  close(fd);
+
+  return (status == STATUS_REQ_EXIT) ? STATUS_OK : status;
+}
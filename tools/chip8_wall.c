@@ -0,0 +1,184 @@
+#define _POSIX_C_SOURCE 200809L // getopt
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <SDL2/SDL.h>
+
+#include "atlas.h"
+#include "chip8.h"
+#include "cpu_def.h"
+#include "display.h"
+#include "keypad.h"
+#include "logging.h"
+#include "session.h"
+#include "status_code.h"
+#include "timer.h"
+
+#define WINDOW_TITLE ("Chip-8 Wall")
+#define DISPLAY_FREQ_HZ (60)
+#define DEFAULT_COLUMNS (8)
+#define DEFAULT_SCALE (2)
+
+void print_usage(void)
+{
+  printf("\nUsage: chip8_wall.out [options] <ROM file>...\n");
+  printf("\nRuns every ROM as its own session and shows them all in one window.");
+  printf("\nThe keypad is shared by every session.\n");
+  printf("\nOptions:");
+  printf("\n  -p <chip8|schip|xochip|vip>  Quirk profile (default chip8)");
+  printf("\n  -n <copies>                  Sessions per ROM, each with its own random seed (default 1)");
+  printf("\n  -c <columns>                 Sessions per row (default %u)", DEFAULT_COLUMNS);
+  printf("\n  -s <scale>                   Screen pixels per high resolution pixel (default %u)\n", DEFAULT_SCALE);
+}
+
+/** Start the sessions of a ROM from a single loaded template */
+status_code_t start_sessions(session_t *const sessions, uint32_t const copies, const char *rom, quirk_profile_t const profile)
+{
+  cpu_state_t template_state = {0};
+  status_code_t status = init_template(&template_state, rom, profile);
+
+  for (uint32_t i = 0; (i < copies) && (status == STATUS_OK); i++)
+  {
+    status = init_cpu_from_template(&sessions[i].cpu, &template_state);
+    seed_random(&sessions[i].cpu, i + 1);
+  }
+
+  cleanup_cpu(&template_state);
+  return status;
+}
+
+int main(int argc, char **argv)
+{
+  quirk_profile_t profile = QUIRK_PROFILE_CHIP8;
+  uint32_t copies = 1;
+  atlas_init_param_t atlas_param = {
+      .columns = DEFAULT_COLUMNS,
+      .scale = DEFAULT_SCALE,
+      .colors = {
+          .background_color = DEFAULT_BG_COLOR,
+          .foreground_color = DEFAULT_FG_COLOR,
+          .plane2_color = DEFAULT_PLANE2_COLOR,
+          .overlap_color = DEFAULT_OVERLAP_COLOR,
+      },
+  };
+  atlas_t atlas = {0};
+  timer_t display_timer;
+  uint16_t keypad = 0;
+  int option;
+
+  while ((option = getopt(argc, argv, "p:n:c:s:")) != -1)
+  {
+    switch (option)
+    {
+    case 'p':
+      if (quirk_profile_from_name(optarg, &profile) != STATUS_OK)
+      {
+        print_usage();
+        return STATUS_ERR_INVALID_PARAM;
+      }
+      break;
+    case 'n':
+      copies = strtoul(optarg, NULL, 10);
+      break;
+    case 'c':
+      atlas_param.columns = strtoul(optarg, NULL, 10);
+      break;
+    case 's':
+      atlas_param.scale = (uint8_t)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      print_usage();
+      return STATUS_ERR_INVALID_PARAM;
+    }
+  }
+
+  uint32_t roms = argc - optind;
+  if ((roms == 0) || (copies == 0) || ((roms * copies) > ATLAS_MAX_CELLS))
+  {
+    print_usage();
+    return STATUS_ERR_GENERIC;
+  }
+
+  log_init();
+
+  atlas_param.cells = roms * copies;
+  session_t *sessions = calloc(atlas_param.cells, sizeof(session_t));
+  uint8_t *halted = calloc(atlas_param.cells, sizeof(uint8_t));
+  status_code_t status = ((sessions != NULL) && (halted != NULL)) ? STATUS_OK : STATUS_ERR_NO_MEMORY;
+
+  for (uint32_t rom = 0; (rom < roms) && (status == STATUS_OK); rom++)
+  {
+    status = start_sessions(&sessions[rom * copies], copies, argv[optind + rom], profile);
+    if (status != STATUS_OK)
+    {
+      Log_E("Failed to load %s: %u", argv[optind + rom], status);
+    }
+  }
+
+  if (status == STATUS_OK)
+  {
+    status = atlas_init(&atlas, WINDOW_TITLE, &atlas_param);
+  }
+
+  if (status == STATUS_OK)
+  {
+    status = timer_init(&display_timer, DISPLAY_FREQ_HZ);
+  }
+
+  for (uint32_t i = 0; (status == STATUS_OK) && (i < atlas_param.cells); i++)
+  {
+    sessions[i].video = &atlas_backend;
+    sessions[i].video_handle = &atlas.cell[i];
+  }
+
+  while (status == STATUS_OK)
+  {
+    if (keypad_read(&keypad) != STATUS_OK)
+    {
+      Log_I("Exiting...");
+      break;
+    }
+
+    if (!timer_check(&display_timer))
+    {
+      continue;
+    }
+
+    for (uint32_t i = 0; i < atlas_param.cells; i++)
+    {
+      cpu_state_t *cpu = &sessions[i].cpu;
+      status_code_t cycle_status = STATUS_OK;
+
+      cpu->peripherals.keypad.current = keypad;
+      if (!halted[i])
+      {
+        cycle_status = emulation_frame(cpu);
+      }
+
+      // A session that exits or fails is frozen on its last frame; the others carry on
+      if (!halted[i] && (cycle_status != STATUS_OK))
+      {
+        Log_W("Session %u stopped: %u", i, cycle_status);
+        halted[i] = 1;
+      }
+
+      session_frame(&sessions[i]);
+    }
+
+    status = atlas_present(&atlas);
+  }
+
+  for (uint32_t i = 0; (sessions != NULL) && (i < atlas_param.cells); i++)
+  {
+    session_cleanup(&sessions[i]);
+  }
+  free(sessions);
+  free(halted);
+  atlas_cleanup(&atlas);
+  SDL_Quit();
+
+  return status;
+}
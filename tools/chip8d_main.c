@@ -0,0 +1,82 @@
+#define _POSIX_C_SOURCE 200809L // getopt, sigaction
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "chip8d.h"
+#include "status_code.h"
+
+#define DEFAULT_SOCKET_PATH "/tmp/chip8d.sock"
+#define DEFAULT_WORKERS (4)
+
+static chip8d_t daemon_state;
+
+static void on_interrupt(int signal)
+{
+  (void)signal;
+  chip8d_stop(&daemon_state);
+}
+
+void print_usage(void)
+{
+  printf("\nUsage: chip8d.out [options]\n");
+  printf("\nHosts many emulator sessions, controlled with line commands over a Unix domain");
+  printf("\nsocket, e.g. with `socat - UNIX-CONNECT:/tmp/chip8d.sock`; see include/chip8d.h.");
+  printf("\nStops on Ctrl-C.\n");
+  printf("\nOptions:");
+  printf("\n  -s <path>     Control socket (default " DEFAULT_SOCKET_PATH ")");
+  printf("\n  -t <threads>  Worker threads running the sessions (default %u)\n", DEFAULT_WORKERS);
+}
+
+int main(int argc, char **argv)
+{
+  const char *socket_path = DEFAULT_SOCKET_PATH;
+  uint32_t workers = DEFAULT_WORKERS;
+  struct sigaction action;
+  int option;
+
+  while ((option = getopt(argc, argv, "s:t:")) != -1)
+  {
+    switch (option)
+    {
+    case 's':
+      socket_path = optarg;
+      break;
+    case 't':
+      workers = strtoul(optarg, NULL, 10);
+      break;
+    default:
+      print_usage();
+      return STATUS_ERR_INVALID_PARAM;
+    }
+  }
+
+  if (optind != argc)
+  {
+    print_usage();
+    return STATUS_ERR_GENERIC;
+  }
+
+  status_code_t status = chip8d_init(&daemon_state, socket_path, workers);
+  if (status != STATUS_OK)
+  {
+    fprintf(stderr, "Failed to start on %s: %u\n", socket_path, status);
+    return status;
+  }
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = on_interrupt;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  status = chip8d_run(&daemon_state);
+
+  printf("%llu frames over %llu ticks, %llu overruns\n", (unsigned long long)daemon_state.frames,
+         (unsigned long long)daemon_state.ticks, (unsigned long long)daemon_state.overruns);
+  chip8d_cleanup(&daemon_state);
+  return status;
+}
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "cpu_def.h"
+#include "status_code.h"
+
+#define FUZZ_MAX_INSTRUCTIONS (10000)  // Instruction budget per input
+#define FUZZ_HEADER_SIZE (3)           // Quirk profile and keypad bytes preceding the ROM
+#define COVERAGE_FILE_ENV ("CHIP8_FUZZ_COVERAGE") // Environment variable naming the coverage bitmap file
+
+/**
+ * A machine per quirk profile, along with a snapshot of it before any ROM was loaded.
+ * Each input runs on the machine of the profile it selects, which is then restored to
+ * its snapshot; only what the input changed is copied back.
+ */
+typedef struct fuzz_machine_s
+{
+  cpu_state_t state;
+  cpu_state_t pristine;
+} fuzz_machine_t;
+
+static fuzz_machine_t machines[QUIRK_PROFILE_COUNT];
+static uint8_t initialised;
+
+/** Bitmap of the addresses an instruction was executed from, over every input */
+static uint8_t coverage[XO_MEM_SIZE / 8];
+
+/** Report the coverage at exit, writing the bitmap to $CHIP8_FUZZ_COVERAGE if set */
+static void report_coverage(void)
+{
+  uint32_t covered = 0;
+
+  for (uint32_t i = 0; i < sizeof(coverage); i++)
+  {
+    covered += __builtin_popcount(coverage[i]);
+  }
+
+  fprintf(stderr, "Executed instructions at %u addresses\n", covered);
+
+  const char *path = getenv(COVERAGE_FILE_ENV);
+  if (path == NULL)
+  {
+    return;
+  }
+
+  FILE *file = fopen(path, "wb");
+  if ((file == NULL) || (fwrite(coverage, 1, sizeof(coverage), file) != sizeof(coverage)))
+  {
+    fprintf(stderr, "Failed to write the coverage bitmap to %s\n", path);
+  }
+
+  if (file != NULL)
+  {
+    fclose(file);
+  }
+}
+
+static status_code_t init_machines(void)
+{
+  for (uint8_t p = 0; p < QUIRK_PROFILE_COUNT; p++)
+  {
+    fuzz_machine_t *machine = &machines[p];
+
+    status_code_t status = init_cpu(&machine->state);
+    RETURN_STATUS_IF_NOT_OK(status);
+
+    status = set_quirk_profile(&machine->state, (quirk_profile_t)p);
+    RETURN_STATUS_IF_NOT_OK(status);
+
+    status = chip8_snapshot(&machine->pristine, &machine->state);
+    RETURN_STATUS_IF_NOT_OK(status);
+  }
+
+  atexit(report_coverage);
+  initialised = 1;
+  return STATUS_OK;
+}
+
+/**
+ * Input layout: a byte selecting the quirk profile, two bytes of keypad state held
+ * down for the whole run, then the ROM.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  if (!initialised && (init_machines() != STATUS_OK))
+  {
+    abort();
+  }
+
+  if (size <= FUZZ_HEADER_SIZE)
+  {
+    return 0;
+  }
+
+  fuzz_machine_t *machine = &machines[data[0] % QUIRK_PROFILE_COUNT];
+  cpu_state_t *state = &machine->state;
+
+  if (load_rom_data(state, data + FUZZ_HEADER_SIZE, size - FUZZ_HEADER_SIZE) == STATUS_OK)
+  {
+    state->peripherals.keypad.current = (uint16_t)((data[1] << 8) | data[2]);
+
+    for (uint32_t i = 0; i < FUZZ_MAX_INSTRUCTIONS; i++)
+    {
+      uint16_t pc = state->registers.pc;
+      coverage[pc / 8] |= (uint8_t)(1 << (pc % 8));
+
+      // Errors such as a stack overflow end the run; only crashes are findings
+      if (emulation_cycle(state) != STATUS_OK)
+      {
+        break;
+      }
+
+      if ((i % INSTRUCTIONS_PER_FRAME) == (INSTRUCTIONS_PER_FRAME - 1))
+      {
+        update_timers(state);
+      }
+    }
+  }
+
+  chip8_restore(state, &machine->pristine);
+  return 0;
+}
+
+#ifndef CHIP8_LIBFUZZER
+/**
+ * Standalone driver for AFL++ (persistent mode when built with afl-clang-fast) and
+ * for replaying inputs: runs each file given, or stdin if there are none.
+ */
+#ifndef __AFL_LOOP
+#define __AFL_LOOP(count) (!iteration++)
+#endif
+
+static uint8_t input[FUZZ_HEADER_SIZE + XO_MEM_SIZE];
+
+static size_t read_input(FILE *file)
+{
+  return fread(input, 1, sizeof(input), file);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t __attribute__((unused)) iteration = 0;
+
+  if (argc > 1)
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      FILE *file = fopen(argv[i], "rb");
+      if (file == NULL)
+      {
+        fprintf(stderr, "Failed to open %s\n", argv[i]);
+        return STATUS_ERR_FILE_NOT_FOUND;
+      }
+
+      size_t size = read_input(file);
+      fclose(file);
+      LLVMFuzzerTestOneInput(input, size);
+    }
+
+    return 0;
+  }
+
+  while (__AFL_LOOP(10000))
+  {
+    LLVMFuzzerTestOneInput(input, read_input(stdin));
+  }
+
+  return 0;
+}
+#endif
@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "cpu_def.h"
+#include "status_code.h"
+
+#define DEFAULT_FRAMES (60 * 60)    // One minute of emulated time
+#define MAX_LISTED_DIFFS (16)       // Differing bytes / rows listed per section of a state diff
+#define LOCKSTEP_SEED (1)           // Seed of both cores' CXNN generators, set once at start
+
+/** An execution core under test; each one runs its own copy of the machine */
+typedef struct core_s
+{
+  const char *name;
+  status_code_t (*cycle)(cpu_state_t *const state);
+  cpu_state_t state;
+  status_code_t status;
+} core_t;
+
+/** Keypad state for each frame, read from an input movie */
+typedef struct movie_s
+{
+  uint16_t *frames;
+  uint32_t length;
+} movie_t;
+
+void print_usage(void)
+{
+  printf("\nUsage: lockstep.out <ROM file> [chip8|schip|xochip|vip] [input movie] [frames]\n");
+  printf("\nRuns the specialised and reference cores side by side and stops at the first");
+  printf("\ninstruction after which their states differ. The input movie is a text file with");
+  printf("\none hexadecimal keypad bitmask per frame; '-' or no movie runs without input.\n");
+}
+
+/** Fingerprint of a core's machine state */
+uint64_t state_hash(core_t *const core)
+{
+  uint64_t hash = 0;
+  chip8_state_hash(&core->state, &hash);
+  return hash;
+}
+
+/** Print every difference between the states of two cores */
+void print_state_diff(core_t *const a, core_t *const b)
+{
+  registers_t const *ra = &a->state.registers;
+  registers_t const *rb = &b->state.registers;
+  graphics_t const *ga = &a->state.peripherals.graphics;
+  graphics_t const *gb = &b->state.peripherals.graphics;
+
+  printf("%-12s %-12s %s\n", "", a->name, b->name);
+
+  if (a->status != b->status)
+  {
+    printf("%-12s %-12u %u\n", "status", a->status, b->status);
+  }
+  if (ra->pc != rb->pc)
+  {
+    printf("%-12s %03X          %03X\n", "PC", ra->pc, rb->pc);
+  }
+  if (ra->I != rb->I)
+  {
+    printf("%-12s %03X          %03X\n", "I", ra->I, rb->I);
+  }
+  if (ra->sp != rb->sp)
+  {
+    printf("%-12s %-12u %u\n", "SP", ra->sp, rb->sp);
+  }
+  for (uint8_t i = 0; i < REG_COUNT; i++)
+  {
+    if (ra->V[i] != rb->V[i])
+    {
+      printf("V%-11X %02X           %02X\n", i, ra->V[i], rb->V[i]);
+    }
+  }
+  for (uint8_t i = 0; i < STACK_SIZE; i++)
+  {
+    if (ra->stack[i] != rb->stack[i])
+    {
+      printf("stack[%-2u]    %03X          %03X\n", i, ra->stack[i], rb->stack[i]);
+    }
+  }
+  if (a->state.random != b->state.random)
+  {
+    printf("%-12s %08X     %08X\n", "random", a->state.random, b->state.random);
+  }
+  if (a->state.timers.delay != b->state.timers.delay)
+  {
+    printf("%-12s %-12u %u\n", "delay", a->state.timers.delay, b->state.timers.delay);
+  }
+  if (a->state.timers.sound != b->state.timers.sound)
+  {
+    printf("%-12s %-12u %u\n", "sound", a->state.timers.sound, b->state.timers.sound);
+  }
+
+  uint8_t *mem_a, *mem_b;
+  size_t size_a, size_b;
+  uint32_t listed = 0;
+
+  get_memory(&a->state, &mem_a, &size_a);
+  get_memory(&b->state, &mem_b, &size_b);
+
+  for (size_t i = 0; (i < size_a) && (i < size_b); i++)
+  {
+    if ((mem_a[i] != mem_b[i]) && (listed++ < MAX_LISTED_DIFFS))
+    {
+      printf("[%04zX]       %02X           %02X\n", i, mem_a[i], mem_b[i]);
+    }
+  }
+  if (listed > MAX_LISTED_DIFFS)
+  {
+    printf("... %u differing memory bytes in total\n", listed);
+  }
+
+  if ((ga->hires != gb->hires) || (ga->plane_mask != gb->plane_mask))
+  {
+    printf("%-12s %u/%-10u %u/%u\n", "hires/planes", ga->hires, ga->plane_mask, gb->hires, gb->plane_mask);
+  }
+
+  listed = 0;
+  for (uint8_t plane = 0; plane < GRAPHICS_PLANES; plane++)
+  {
+    for (uint8_t row = 0; row < GRAPHICS_HIRES_HEIGHT; row++)
+    {
+      if ((memcmp(ga->buffer[plane][row], gb->buffer[plane][row], sizeof(ga->buffer[plane][row])) != 0) &&
+          (listed++ < MAX_LISTED_DIFFS))
+      {
+        printf("plane %u row %-2u\n  %016llX%016llX\n  %016llX%016llX\n", plane, row,
+               (unsigned long long)ga->buffer[plane][row][0], (unsigned long long)ga->buffer[plane][row][1],
+               (unsigned long long)gb->buffer[plane][row][0], (unsigned long long)gb->buffer[plane][row][1]);
+      }
+    }
+  }
+  if (listed > MAX_LISTED_DIFFS)
+  {
+    printf("... %u differing framebuffer rows in total\n", listed);
+  }
+}
+
+/** Read an input movie: one hexadecimal keypad bitmask per line, '#' starts a comment */
+status_code_t load_movie(const char *path, movie_t *const movie)
+{
+  memset(movie, 0, sizeof(movie_t));
+
+  if ((path == NULL) || (strcmp(path, "-") == 0))
+  {
+    return STATUS_OK;
+  }
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+  {
+    return STATUS_ERR_FILE_NOT_FOUND;
+  }
+
+  char line[64];
+  uint32_t capacity = 0;
+
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    char *end;
+    unsigned long keys = strtoul(line, &end, 16);
+
+    if ((end == line) || (line[0] == '#'))
+    {
+      continue;
+    }
+
+    if (movie->length == capacity)
+    {
+      capacity = capacity ? (capacity * 2) : 1024;
+      uint16_t *frames = realloc(movie->frames, capacity * sizeof(uint16_t));
+      if (frames == NULL)
+      {
+        fclose(file);
+        return STATUS_ERR_NO_MEMORY;
+      }
+      movie->frames = frames;
+    }
+
+    movie->frames[movie->length++] = (uint16_t)keys;
+  }
+
+  fclose(file);
+  return STATUS_OK;
+}
+
+status_code_t init_core(core_t *const core, const char *rom, quirk_profile_t const profile)
+{
+  status_code_t status = init_cpu(&core->state);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  status = set_quirk_profile(&core->state, profile);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  // CXNN draws from the machine's own generator, which is part of the compared state. Seeding
+  // both cores once keeps their numbers in step; nothing is reseeded between instructions
+  status = seed_random(&core->state, LOCKSTEP_SEED);
+  RETURN_STATUS_IF_NOT_OK(status);
+
+  return load_rom(&core->state, rom);
+}
+
+int main(int argc, char **argv)
+{
+  core_t cores[2] = {
+      {.name = "specialised", .cycle = emulation_cycle},
+      {.name = "reference", .cycle = reference_cycle},
+  };
+  quirk_profile_t profile = QUIRK_PROFILE_CHIP8;
+  uint32_t frames = DEFAULT_FRAMES;
+  movie_t movie;
+  uint8_t running = 1;
+  int result = 0;
+
+  if ((argc < 2) || (argc > 5))
+  {
+    print_usage();
+    return STATUS_ERR_GENERIC;
+  }
+
+  if ((argc > 2) && (quirk_profile_from_name(argv[2], &profile) != STATUS_OK))
+  {
+    print_usage();
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  if (argc > 4)
+  {
+    frames = strtoul(argv[4], NULL, 10);
+  }
+
+  if (load_movie((argc > 3) ? argv[3] : NULL, &movie) != STATUS_OK)
+  {
+    fprintf(stderr, "Failed to load input movie %s\n", argv[3]);
+    return STATUS_ERR_FILE_NOT_FOUND;
+  }
+
+  for (uint8_t c = 0; c < 2; c++)
+  {
+    status_code_t status = init_core(&cores[c], argv[1], profile);
+    if (status != STATUS_OK)
+    {
+      fprintf(stderr, "Failed to start the %s core: %u\n", cores[c].name, status);
+      return status;
+    }
+  }
+
+  uint64_t step = 0;
+
+  for (uint32_t frame = 0; (frame < frames) && running; frame++)
+  {
+    uint16_t keys = (movie.length == 0) ? 0 : movie.frames[(frame < movie.length) ? frame : (movie.length - 1)];
+
+    for (uint8_t c = 0; c < 2; c++)
+    {
+      cores[c].state.peripherals.keypad.current = keys;
+    }
+
+    uint8_t waiting = 0;
+
+    for (uint8_t i = 0; (i < INSTRUCTIONS_PER_FRAME) && running && !waiting; i++, step++)
+    {
+      uint16_t pc = cores[0].state.registers.pc;
+
+      for (uint8_t c = 0; c < 2; c++)
+      {
+        cores[c].status = cores[c].cycle(&cores[c].state);
+      }
+
+      if ((cores[0].status != cores[1].status) || (state_hash(&cores[0]) != state_hash(&cores[1])))
+      {
+        printf("Cores diverged at frame %u, instruction %llu (PC %03X)\n", frame, (unsigned long long)step, pc);
+        print_state_diff(&cores[0], &cores[1]);
+        result = 1;
+        running = 0;
+      }
+      else if (cores[0].status != STATUS_OK)
+      {
+        printf("Both cores stopped with status %u at frame %u, instruction %llu (PC %03X)\n",
+               cores[0].status, frame, (unsigned long long)step, pc);
+        running = 0;
+      }
+
+      // A display wait ends the frame, as in emulation_frame; both cores run the same DXYN
+      waiting = cores[0].state.vblank_wait;
+      cores[0].state.vblank_wait = 0;
+      cores[1].state.vblank_wait = 0;
+    }
+
+    for (uint8_t c = 0; c < 2; c++)
+    {
+      update_timers(&cores[c].state);
+    }
+  }
+
+  if (!result)
+  {
+    printf("Cores agree over %llu instructions\n", (unsigned long long)step);
+  }
+
+  for (uint8_t c = 0; c < 2; c++)
+  {
+    cleanup_cpu(&cores[c].state);
+  }
+  free(movie.frames);
+
+  return result;
+}
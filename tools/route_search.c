@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L // getopt
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "cpu_def.h"
+#include "search.h"
+#include "status_code.h"
+
+#define MAX_PREDICATES (64)
+#define MAX_ACTIONS (64)
+#define ROUTE_SEED (1) // Seed of the CXNN random number generator
+
+void print_usage(void)
+{
+  printf("\nUsage: route_search.out [options] <ROM file> <predicate>...\n");
+  printf("\nSearches for the keypad inputs maximising the score of the predicates and prints");
+  printf("\nthem as an input movie, one hexadecimal keypad bitmask per frame.\n");
+  printf("\nPredicates test a byte of memory: ADDR==N, ADDR!=N, ADDR<N or ADDR>N, each adding");
+  printf("\nits weight (1 unless suffixed with *WEIGHT) to the score when it holds, or ADDR");
+  printf("\nalone to add the byte times its weight. Addresses and values may be hexadecimal.\n");
+  printf("\nOptions:");
+  printf("\n  -p <chip8|schip|xochip|vip>  Quirk profile (default chip8)");
+  printf("\n  -k <mask,mask,...>           Keypad bitmasks to try (default none and each single key)");
+  printf("\n  -f <frames>                  Frames each input is held for (default 6)");
+  printf("\n  -d <depth>                   Maximum number of inputs (default 60)");
+  printf("\n  -w <width>                   States kept after each input (default 256)");
+  printf("\n  -s <states>                  States remembered to skip revisits (default 1000000, at most 2^30)");
+  printf("\n  -g <score>                   Stop at the first state scoring at least this");
+  printf("\n  -t <threads>                 Worker threads (default 4, at most 64)\n");
+}
+
+/** Parse a predicate such as 0x1F0>3*10 */
+status_code_t parse_predicate(const char *text, search_predicate_t *const predicate)
+{
+  static const struct
+  {
+    const char *symbol;
+    search_compare_t compare;
+  } operators[] = {
+      {"==", SEARCH_EQUAL},
+      {"!=", SEARCH_NOT_EQUAL},
+      {"<", SEARCH_LESS},
+      {">", SEARCH_GREATER},
+  };
+  char *end;
+
+  memset(predicate, 0, sizeof(search_predicate_t));
+  predicate->address = (uint16_t)strtoul(text, &end, 0);
+  predicate->compare = SEARCH_VALUE;
+  predicate->weight = 1;
+
+  if (end == text)
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  for (uint8_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++)
+  {
+    size_t length = strlen(operators[i].symbol);
+
+    if (strncmp(end, operators[i].symbol, length) == 0)
+    {
+      const char *value = end + length;
+      predicate->compare = operators[i].compare;
+      predicate->value = (uint8_t)strtoul(value, &end, 0);
+      if (end == value)
+      {
+        return STATUS_ERR_INVALID_PARAM;
+      }
+      break;
+    }
+  }
+
+  if (*end == '*')
+  {
+    predicate->weight = (int32_t)strtol(end + 1, &end, 0);
+  }
+
+  return (*end == '\0') ? STATUS_OK : STATUS_ERR_INVALID_PARAM;
+}
+
+/** Parse a comma separated list of keypad bitmasks */
+uint32_t parse_actions(char *text, uint16_t *const actions)
+{
+  uint32_t count = 0;
+
+  for (char *token = strtok(text, ","); (token != NULL) && (count < MAX_ACTIONS); token = strtok(NULL, ","))
+  {
+    actions[count++] = (uint16_t)strtoul(token, NULL, 16);
+  }
+
+  return count;
+}
+
+/** Parse a count from 1 to max */
+status_code_t parse_count(const char *text, unsigned long const max, uint32_t *const count)
+{
+  char *end;
+  unsigned long value = strtoul(text, &end, 10);
+
+  if ((end == text) || (*end != '\0') || (value == 0) || (value > max))
+  {
+    return STATUS_ERR_INVALID_PARAM;
+  }
+
+  *count = (uint32_t)value;
+  return STATUS_OK;
+}
+
+int main(int argc, char **argv)
+{
+  quirk_profile_t profile = QUIRK_PROFILE_CHIP8;
+  search_predicate_t predicates[MAX_PREDICATES];
+  uint16_t actions[MAX_ACTIONS];
+  search_params_t params = {
+      .actions = actions,
+      .frames_per_step = 6,
+      .max_depth = 60,
+      .beam_width = 256,
+      .max_states = 1000000,
+      .predicates = predicates,
+      .threads = 4,
+  };
+  search_result_t result;
+  cpu_state_t state = {0};
+  int option;
+
+  // No key held, then each key on its own
+  actions[0] = 0;
+  for (uint8_t key = 0; key < NUM_KEYS; key++)
+  {
+    actions[key + 1] = (uint16_t)(1 << key);
+  }
+  params.action_count = NUM_KEYS + 1;
+
+  while ((option = getopt(argc, argv, "p:k:f:d:w:s:g:t:")) != -1)
+  {
+    switch (option)
+    {
+    case 'p':
+      if (quirk_profile_from_name(optarg, &profile) != STATUS_OK)
+      {
+        print_usage();
+        return STATUS_ERR_INVALID_PARAM;
+      }
+      break;
+    case 'k':
+      params.action_count = parse_actions(optarg, actions);
+      break;
+    case 'f':
+      params.frames_per_step = strtoul(optarg, NULL, 10);
+      break;
+    case 'd':
+      params.max_depth = strtoul(optarg, NULL, 10);
+      break;
+    case 'w':
+      if (parse_count(optarg, UINT32_MAX / MAX_ACTIONS, &params.beam_width) != STATUS_OK)
+      {
+        print_usage();
+        return STATUS_ERR_INVALID_PARAM;
+      }
+      break;
+    case 's':
+      if (parse_count(optarg, SEARCH_MAX_STATES, &params.max_states) != STATUS_OK)
+      {
+        print_usage();
+        return STATUS_ERR_INVALID_PARAM;
+      }
+      break;
+    case 'g':
+      params.goal_score = strtoll(optarg, NULL, 0);
+      params.has_goal = 1;
+      break;
+    case 't':
+      if (parse_count(optarg, SEARCH_MAX_THREADS, &params.threads) != STATUS_OK)
+      {
+        print_usage();
+        return STATUS_ERR_INVALID_PARAM;
+      }
+      break;
+    default:
+      print_usage();
+      return STATUS_ERR_INVALID_PARAM;
+    }
+  }
+
+  if ((argc - optind) < 2)
+  {
+    print_usage();
+    return STATUS_ERR_GENERIC;
+  }
+
+  for (int i = optind + 1; i < argc; i++)
+  {
+    if ((params.predicate_count == MAX_PREDICATES) ||
+        (parse_predicate(argv[i], &predicates[params.predicate_count++]) != STATUS_OK))
+    {
+      fprintf(stderr, "Invalid predicate: %s\n", argv[i]);
+      return STATUS_ERR_INVALID_PARAM;
+    }
+  }
+
+  status_code_t status = init_template(&state, argv[optind], profile);
+  if (status != STATUS_OK)
+  {
+    fprintf(stderr, "Failed to load %s: %u\n", argv[optind], status);
+    cleanup_cpu(&state);
+    return status;
+  }
+
+  // The seed lockstep.out replays routes with
+  seed_random(&state, ROUTE_SEED);
+
+  status = search_run(&state, &params, &result);
+  cleanup_cpu(&state);
+
+  if (status != STATUS_OK)
+  {
+    fprintf(stderr, "Search failed: %u\n", status);
+    return status;
+  }
+
+  printf("# Score %lld%s after %u inputs; %llu states stepped, %llu revisits skipped\n",
+         (long long)result.score, result.goal_reached ? " (goal reached)" : "", result.length,
+         (unsigned long long)result.expanded, (unsigned long long)result.duplicates);
+
+  for (uint32_t i = 0; i < result.length; i++)
+  {
+    for (uint32_t frame = 0; frame < params.frames_per_step; frame++)
+    {
+      printf("%04X\n", result.path[i]);
+    }
+  }
+
+  search_free_result(&result);
+  return (result.goal_reached || !params.has_goal) ? 0 : 1;
+}
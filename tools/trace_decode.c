@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "exec_trace.h"
+#include "status_code.h"
+
+void print_usage(void)
+{
+  printf("\nUsage: trace_decode.out <trace file>             Print every record of a trace");
+  printf("\n       trace_decode.out <trace file> <trace file> Report the first record where two traces differ\n");
+}
+
+/**
+ * Print a single trace record on one line: the index, pc and opcode followed by
+ * the registers, stack and memory it changed, and the timers and framebuffer
+ * whenever they changed since the previous record.
+ */
+void print_record(uint64_t const index, exec_trace_record_t const *const record)
+{
+  printf("#%llu %03X: %04X", (unsigned long long)index, record->pc, record->opcode);
+
+  for (uint8_t i = 0; i < REG_COUNT; i++)
+  {
+    if (record->v_mask & (1 << i))
+    {
+      printf(" V%X=%02X", i, record->V[i]);
+    }
+  }
+
+  if (record->flags & EXEC_TRACE_FLAG_I)
+  {
+    printf(" I=%03X", record->I);
+  }
+
+  if (record->flags & EXEC_TRACE_FLAG_SP)
+  {
+    printf(" SP=%u", record->sp);
+  }
+
+  for (uint8_t i = 0; i < STACK_SIZE; i++)
+  {
+    if (record->stack_mask & (1 << i))
+    {
+      printf(" S%X=%03X", i, record->stack[i]);
+    }
+  }
+
+  for (uint8_t w = 0; w < record->write_count; w++)
+  {
+    exec_trace_write_t const *write = &record->writes[w];
+
+    printf(" [%03X]=", write->address);
+    for (uint8_t b = 0; b < write->size; b++)
+    {
+      printf("%02X", write->data[b]);
+    }
+  }
+
+  if (record->flags & EXEC_TRACE_FLAG_STATUS)
+  {
+    printf(" status=%u", record->status);
+  }
+
+  if (record->flags & EXEC_TRACE_FLAG_TIMERS)
+  {
+    printf(" DT=%02X ST=%02X", record->timers.delay, record->timers.sound);
+  }
+
+  if (record->flags & EXEC_TRACE_FLAG_GFX)
+  {
+    printf(" FB=%s:%016llX", record->hires ? "hires" : "lores", (unsigned long long)record->graphics_hash);
+  }
+
+  printf("\n");
+}
+
+/**
+ * Compare the parts of two records that describe what the instruction did, and
+ * the timers and framebuffer after it. The flags of the fields carried over from
+ * earlier records only reflect how the record was encoded, so they're ignored.
+ */
+uint8_t records_equal(exec_trace_record_t const *const a, exec_trace_record_t const *const b)
+{
+  uint8_t const encoding = EXEC_TRACE_FLAG_PC | EXEC_TRACE_FLAG_TIMERS | EXEC_TRACE_FLAG_GFX;
+
+  if ((a->pc != b->pc) || (a->opcode != b->opcode) || (a->v_mask != b->v_mask) ||
+      ((a->flags & ~encoding) != (b->flags & ~encoding)) || (a->I != b->I) || (a->sp != b->sp) ||
+      (a->stack_mask != b->stack_mask) || (a->status != b->status) || (a->write_count != b->write_count) ||
+      (a->timers.delay != b->timers.delay) || (a->timers.sound != b->timers.sound) || (a->hires != b->hires) ||
+      (a->graphics_hash != b->graphics_hash))
+  {
+    return 0;
+  }
+
+  for (uint8_t i = 0; i < STACK_SIZE; i++)
+  {
+    if ((a->stack_mask & (1 << i)) && (a->stack[i] != b->stack[i]))
+    {
+      return 0;
+    }
+  }
+
+  for (uint8_t i = 0; i < REG_COUNT; i++)
+  {
+    if ((a->v_mask & (1 << i)) && (a->V[i] != b->V[i]))
+    {
+      return 0;
+    }
+  }
+
+  for (uint8_t w = 0; w < a->write_count; w++)
+  {
+    if ((a->writes[w].address != b->writes[w].address) || (a->writes[w].size != b->writes[w].size) ||
+        (memcmp(a->writes[w].data, b->writes[w].data, a->writes[w].size) != 0))
+    {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int print_trace(const char *path)
+{
+  exec_trace_t trace;
+  exec_trace_record_t record;
+  status_code_t status = exec_trace_open(&trace, path);
+
+  if (status != STATUS_OK)
+  {
+    fprintf(stderr, "Failed to open trace %s: %u\n", path, status);
+    return status;
+  }
+
+  printf("Quirk profile %u\n", trace.quirk_profile);
+
+  uint64_t index = 0;
+  while ((status = exec_trace_read(&trace, &record)) == STATUS_OK)
+  {
+    print_record(index++, &record);
+  }
+
+  exec_trace_close(&trace);
+
+  if (status != STATUS_REQ_EXIT)
+  {
+    fprintf(stderr, "Trace %s is truncated or corrupt after %llu records\n", path, (unsigned long long)index);
+    return status;
+  }
+
+  return STATUS_OK;
+}
+
+int diff_traces(const char *path_a, const char *path_b)
+{
+  exec_trace_t trace_a, trace_b;
+  exec_trace_record_t record_a, record_b;
+
+  if (exec_trace_open(&trace_a, path_a) != STATUS_OK)
+  {
+    fprintf(stderr, "Failed to open trace %s\n", path_a);
+    return STATUS_ERR_FILE_NOT_FOUND;
+  }
+
+  if (exec_trace_open(&trace_b, path_b) != STATUS_OK)
+  {
+    fprintf(stderr, "Failed to open trace %s\n", path_b);
+    exec_trace_close(&trace_a);
+    return STATUS_ERR_FILE_NOT_FOUND;
+  }
+
+  int result = 0;
+  uint64_t index = 0;
+
+  if (trace_a.quirk_profile != trace_b.quirk_profile)
+  {
+    printf("Traces were recorded with different quirk profiles (%u and %u)\n", trace_a.quirk_profile, trace_b.quirk_profile);
+    exec_trace_close(&trace_a);
+    exec_trace_close(&trace_b);
+    return 1;
+  }
+
+  while (1)
+  {
+    status_code_t status_a = exec_trace_read(&trace_a, &record_a);
+    status_code_t status_b = exec_trace_read(&trace_b, &record_b);
+
+    if ((status_a == STATUS_REQ_EXIT) && (status_b == STATUS_REQ_EXIT))
+    {
+      printf("Traces are identical (%llu records)\n", (unsigned long long)index);
+      break;
+    }
+
+    if ((status_a != STATUS_OK) || (status_b != STATUS_OK))
+    {
+      printf("Traces differ in length at record #%llu\n", (unsigned long long)index);
+      result = 1;
+      break;
+    }
+
+    if (!records_equal(&record_a, &record_b))
+    {
+      printf("Traces diverge at record #%llu\n< ", (unsigned long long)index);
+      print_record(index, &record_a);
+      printf("> ");
+      print_record(index, &record_b);
+      result = 1;
+      break;
+    }
+
+    index++;
+  }
+
+  exec_trace_close(&trace_a);
+  exec_trace_close(&trace_b);
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc == 2)
+  {
+    return print_trace(argv[1]);
+  }
+
+  if (argc == 3)
+  {
+    return diff_traces(argv[1], argv[2]);
+  }
+
+  print_usage();
+  return STATUS_ERR_GENERIC;
+}